@@ -49,6 +49,7 @@
 #include "pathfinder.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "spells.h"
 #include "ui.h"
@@ -177,6 +178,24 @@ void AnimateActionAttack(CUnit &unit, COrder &order)
 	return true;
 }
 
+/* virtual */ void COrder_Attack::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Int(this->Range);
+	snapshot.Int(this->MinRange);
+	snapshot.Pos(this->goalPos);
+	snapshot.Int(this->State);
+}
+
+/* virtual */ void COrder_Attack::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Range = snapshot.Int();
+	this->MinRange = snapshot.Int();
+	this->goalPos = snapshot.Pos();
+	this->State = snapshot.Int();
+}
+
 /* virtual */ bool COrder_Attack::IsValid() const
 {
 	if (Action == UnitActionAttack) {
@@ -316,7 +335,7 @@ bool COrder_Attack::CheckForTargetInRange(CUnit &unit)
 	if (!this->HasGoal()
 		&& this->Action != UnitActionAttackGround
 		&& !Map.WallOnMap(this->goalPos)) {
-		CUnit *goal = AttackUnitsInReactRange(unit);
+		CUnit *goal = AcquireTargetInReactRange(unit);
 
 		if (goal) {
 			COrder *savedOrder = COrder::NewActionAttack(unit, this->goalPos);
@@ -454,7 +473,7 @@ void COrder_Attack::AttackTarget(CUnit &unit)
 
 	// No target choose one.
 	if (!goal) {
-		goal = AttackUnitsInReactRange(unit);
+		goal = AcquireTargetInReactRange(unit);
 
 		// No new goal, continue way to destination.
 		if (!goal) {
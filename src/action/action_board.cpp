@@ -44,6 +44,7 @@
 #include "pathfinder.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "ui.h"
 #include "unit.h"
 #include "unittype.h"
@@ -105,6 +106,20 @@ enum {
 	return true;
 }
 
+/* virtual */ void COrder_Board::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Int(this->Range);
+	snapshot.Int(this->State);
+}
+
+/* virtual */ void COrder_Board::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Range = snapshot.Int();
+	this->State = snapshot.Int();
+}
+
 /* virtual */ bool COrder_Board::IsValid() const
 {
 	return this->HasGoal() && this->GetGoal()->IsAliveOnMap();
@@ -46,6 +46,7 @@
 #include "pathfinder.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "translate.h"
 #include "ui.h"
 #include "unit.h"
@@ -135,6 +136,26 @@ enum {
 	return true;
 }
 
+/* virtual */ void COrder_Build::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Int(this->Range);
+	snapshot.Pos(this->goalPos);
+	snapshot.Unit(this->BuildingUnit);
+	snapshot.String(this->Type->Ident);
+	snapshot.Int(this->State);
+}
+
+/* virtual */ void COrder_Build::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Range = snapshot.Int();
+	this->goalPos = snapshot.Pos();
+	this->BuildingUnit = snapshot.Unit();
+	this->Type = UnitTypeByIdent(snapshot.String());
+	this->State = snapshot.Int();
+}
+
 /* virtual */ bool COrder_Build::IsValid() const
 {
 	return true;
@@ -40,6 +40,7 @@
 #include "map.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "translate.h"
 #include "unit.h"
@@ -118,6 +119,35 @@ extern void AiReduceMadeInBuilt(PlayerAi &pai, const CUnitType &type);
 	return true;
 }
 
+/* virtual */ void COrder_Built::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	CConstructionFrame *cframe = unit.Type->Construction->Frames;
+	int frame = 0;
+	while (cframe != this->Frame) {
+		cframe = cframe->Next;
+		++frame;
+	}
+	snapshot.Unit(this->Worker);
+	snapshot.Int(this->ProgressCounter);
+	snapshot.Int(frame);
+	snapshot.Bool(this->IsCancelled);
+}
+
+/* virtual */ void COrder_Built::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Worker = snapshot.Unit();
+	this->ProgressCounter = snapshot.Int();
+	int frame = snapshot.Int();
+	CConstructionFrame *cframe = unit.Type->Construction->Frames;
+	while (frame-- && cframe->Next != NULL) {
+		cframe = cframe->Next;
+	}
+	this->Frame = cframe;
+	this->IsCancelled = snapshot.Bool();
+}
+
 /* virtual */ bool COrder_Built::IsValid() const
 {
 	return true;
@@ -41,6 +41,7 @@
 #include "map.h"
 #include "pathfinder.h"
 #include "script.h"
+#include "snapshot.h"
 #include "ui.h"
 #include "unit.h"
 #include "unittype.h"
@@ -106,6 +107,22 @@ enum {
 	return true;
 }
 
+/* virtual */ void COrder_Defend::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Int(this->Range);
+	snapshot.Pos(this->goalPos);
+	snapshot.Varint(this->State);
+}
+
+/* virtual */ void COrder_Defend::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Range = snapshot.Int();
+	this->goalPos = snapshot.Pos();
+	this->State = snapshot.Varint();
+}
+
 /* virtual */ bool COrder_Defend::IsValid() const
 {
 	return true;
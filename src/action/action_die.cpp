@@ -39,6 +39,7 @@
 
 #include "animation.h"
 #include "iolib.h"
+#include "snapshot.h"
 #include "unit.h"
 #include "unittype.h"
 
@@ -65,6 +66,16 @@
 	return false;
 }
 
+/* virtual */ void COrder_Die::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+}
+
+/* virtual */ void COrder_Die::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+}
+
 /* virtual */ bool COrder_Die::IsValid() const
 {
 	return true;
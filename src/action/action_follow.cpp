@@ -41,6 +41,7 @@
 #include "missile.h"
 #include "pathfinder.h"
 #include "script.h"
+#include "snapshot.h"
 #include "ui.h"
 #include "unit.h"
 #include "unit_find.h"
@@ -113,6 +114,22 @@ enum {
 	return true;
 }
 
+/* virtual */ void COrder_Follow::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Int(this->Range);
+	snapshot.Pos(this->goalPos);
+	snapshot.Varint(this->State);
+}
+
+/* virtual */ void COrder_Follow::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Range = snapshot.Int();
+	this->goalPos = snapshot.Pos();
+	this->State = snapshot.Varint();
+}
+
 /* virtual */ bool COrder_Follow::IsValid() const
 {
 	return true;
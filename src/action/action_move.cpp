@@ -44,6 +44,7 @@
 #include "map.h"
 #include "pathfinder.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "ui.h"
 #include "unit.h"
@@ -93,6 +94,20 @@
 	return true;
 }
 
+/* virtual */ void COrder_Move::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Int(this->Range);
+	snapshot.Pos(this->goalPos);
+}
+
+/* virtual */ void COrder_Move::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Range = snapshot.Int();
+	this->goalPos = snapshot.Pos();
+}
+
 /* virtual */ bool COrder_Move::IsValid() const
 {
 	return true;
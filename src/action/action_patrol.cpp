@@ -41,6 +41,7 @@
 #include "map.h"
 #include "pathfinder.h"
 #include "script.h"
+#include "snapshot.h"
 #include "ui.h"
 #include "unit.h"
 #include "unittype.h"
@@ -104,6 +105,24 @@
 	return true;
 }
 
+/* virtual */ void COrder_Patrol::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Pos(this->goalPos);
+	snapshot.Int(this->Range);
+	snapshot.Varint(this->WaitingCycle);
+	snapshot.Pos(this->WayPoint);
+}
+
+/* virtual */ void COrder_Patrol::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->goalPos = snapshot.Pos();
+	this->Range = snapshot.Int();
+	this->WaitingCycle = snapshot.Varint();
+	this->WayPoint = snapshot.Pos();
+}
+
 /* virtual */ bool COrder_Patrol::IsValid() const
 {
 	return true;
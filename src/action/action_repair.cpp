@@ -44,6 +44,7 @@
 #include "pathfinder.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "translate.h"
 #include "unit.h"
@@ -124,6 +125,24 @@
 	return true;
 }
 
+/* virtual */ void COrder_Repair::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Pos(this->goalPos);
+	snapshot.Unit(this->ReparableTarget);
+	snapshot.Varint(this->RepairCycle);
+	snapshot.Varint(this->State);
+}
+
+/* virtual */ void COrder_Repair::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->goalPos = snapshot.Pos();
+	this->ReparableTarget = snapshot.Unit();
+	this->RepairCycle = snapshot.Varint();
+	this->State = snapshot.Varint();
+}
+
 /* virtual */ bool COrder_Repair::IsValid() const
 {
 	return true;
@@ -41,6 +41,7 @@
 #include "animation.h"
 #include "iolib.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "player.h"
 #include "translate.h"
@@ -93,6 +94,21 @@
 	return true;
 }
 
+/* virtual */ void COrder_Research::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.String(this->Upgrade ? this->Upgrade->Ident : "");
+}
+
+/* virtual */ void COrder_Research::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	const std::string ident = snapshot.String();
+	if (!ident.empty()) {
+		this->Upgrade = CUpgrade::Get(ident);
+	}
+}
+
 /* virtual */ bool COrder_Research::IsValid() const
 {
 	return true;
@@ -44,6 +44,7 @@
 #include "pathfinder.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "tileset.h"
 #include "ui.h"
@@ -296,6 +297,35 @@ COrder_Resource::~COrder_Resource()
 	return true;
 }
 
+/* virtual */ void COrder_Resource::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Pos(this->goalPos);
+	Assert(this->worker != NULL && worker->IsAlive());
+	snapshot.Unit(this->worker);
+	snapshot.Varint(this->CurrentResource);
+	snapshot.Pos(this->Resource.Pos);
+	snapshot.Unit(this->Resource.Mine);
+	snapshot.Unit(this->Depot);
+	snapshot.Bool(this->DoneHarvesting);
+	snapshot.Int(this->TimeToHarvest);
+	snapshot.Int(this->State);
+}
+
+/* virtual */ void COrder_Resource::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->goalPos = snapshot.Pos();
+	this->worker = snapshot.Unit();
+	this->CurrentResource = snapshot.Varint();
+	this->Resource.Pos = snapshot.Pos();
+	this->Resource.Mine = snapshot.Unit();
+	this->Depot = snapshot.Unit();
+	this->DoneHarvesting = snapshot.Bool();
+	this->TimeToHarvest = snapshot.Int();
+	this->State = snapshot.Int();
+}
+
 /* virtual */ bool COrder_Resource::IsValid() const
 {
 	return true;
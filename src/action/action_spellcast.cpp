@@ -49,6 +49,7 @@
 #include "pathfinder.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "spells.h"
 #include "translate.h"
@@ -128,6 +129,24 @@
 	return true;
 }
 
+/* virtual */ void COrder_SpellCast::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Int(this->Range);
+	snapshot.Pos(this->goalPos);
+	snapshot.Int(this->State);
+	snapshot.String(this->Spell->Ident);
+}
+
+/* virtual */ void COrder_SpellCast::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Range = snapshot.Int();
+	this->goalPos = snapshot.Pos();
+	this->State = snapshot.Int();
+	this->Spell = SpellTypeByIdent(snapshot.String());
+}
+
 /* virtual */ bool COrder_SpellCast::IsValid() const
 {
 	Assert(Action == UnitActionSpellCast);
@@ -44,6 +44,7 @@
 #include "missile.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "spells.h"
 #include "unit.h"
 #include "unit_find.h"
@@ -93,6 +94,18 @@ enum {
 	return true;
 }
 
+/* virtual */ void COrder_Still::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Int(this->State);
+}
+
+/* virtual */ void COrder_Still::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->State = snapshot.Int();
+}
+
 /* virtual */ bool COrder_Still::IsValid() const
 {
 	return true;
@@ -319,7 +332,7 @@ bool AutoAttack(CUnit &unit)
 		return false;
 	}
 	// Normal units react in reaction range.
-	CUnit *goal = AttackUnitsInReactRange(unit);
+	CUnit *goal = AcquireTargetInReactRange(unit);
 
 	if (goal == NULL) {
 		return false;
@@ -41,6 +41,7 @@
 #include "animation.h"
 #include "iolib.h"
 #include "player.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "translate.h"
 #include "ui.h"
@@ -91,6 +92,20 @@
 	return true;
 }
 
+/* virtual */ void COrder_Train::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.String(this->Type->Ident);
+	snapshot.Int(this->Ticks);
+}
+
+/* virtual */ void COrder_Train::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Type = UnitTypeByIdent(snapshot.String());
+	this->Ticks = snapshot.Int();
+}
+
 /* virtual */ bool COrder_Train::IsValid() const
 {
 	return true;
@@ -42,6 +42,7 @@
 #include "pathfinder.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "ui.h"
 #include "unit.h"
 #include "unittype.h"
@@ -92,6 +93,20 @@
 	return true;
 }
 
+/* virtual */ void COrder_Unload::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.Pos(this->goalPos);
+	snapshot.Int(this->State);
+}
+
+/* virtual */ void COrder_Unload::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->goalPos = snapshot.Pos();
+	this->State = snapshot.Int();
+}
+
 /* virtual */ bool COrder_Unload::IsValid() const
 {
 	return true;
@@ -43,6 +43,7 @@
 #include "map.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "spells.h"
 #include "translate.h"
 #include "unit.h"
@@ -186,6 +187,18 @@ static int TransformUnitIntoType(CUnit &unit, const CUnitType &newtype)
 	return true;
 }
 
+/* virtual */ void COrder_TransformInto::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.String(this->Type->Ident);
+}
+
+/* virtual */ void COrder_TransformInto::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Type = UnitTypeByIdent(snapshot.String());
+}
+
 /* virtual */ bool COrder_TransformInto::IsValid() const
 {
 	return true;
@@ -233,6 +246,20 @@ static int TransformUnitIntoType(CUnit &unit, const CUnitType &newtype)
 	return true;
 }
 
+/* virtual */ void COrder_UpgradeTo::Save(CSnapshotWriter &snapshot, const CUnit &unit) const
+{
+	SaveGenericData(snapshot);
+	snapshot.String(this->Type->Ident);
+	snapshot.Int(this->Ticks);
+}
+
+/* virtual */ void COrder_UpgradeTo::Load(CSnapshotReader &snapshot, const CUnit &unit)
+{
+	LoadGenericData(snapshot);
+	this->Type = UnitTypeByIdent(snapshot.String());
+	this->Ticks = snapshot.Int();
+}
+
 /* virtual */ bool COrder_UpgradeTo::IsValid() const
 {
 	return true;
@@ -66,7 +66,9 @@
 #include "pathfinder.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "spells.h"
+#include "sync_digest.h"
 #include "unit.h"
 #include "unit_find.h"
 #include "unit_manager.h"
@@ -245,6 +247,79 @@ void CclParseOrder(lua_State *l, CUnit &unit, COrderPtr *orderPtr)
 	}
 }
 
+void COrder::SaveGenericData(CSnapshotWriter &snapshot) const
+{
+	snapshot.Bool(this->Finished);
+	snapshot.Unit(this->Goal);
+}
+
+void COrder::LoadGenericData(CSnapshotReader &snapshot)
+{
+	this->Finished = snapshot.Bool();
+	this->Goal = snapshot.Unit();
+}
+
+/**
+**  Save an order to a snapshot.
+**
+**  @param order     Order to save, NULL for no order.
+**  @param unit      Unit of the order.
+**  @param snapshot  Output snapshot.
+*/
+void SaveOrder(const COrder *order, const CUnit &unit, CSnapshotWriter &snapshot)
+{
+	if (order == NULL) {
+		snapshot.Varint(UnitActionNone);
+		return;
+	}
+	snapshot.Varint(order->Action);
+	order->Save(snapshot, unit);
+}
+
+/**
+**  Load an order from a snapshot.
+**
+**  @param snapshot  Input snapshot.
+**  @param unit      Unit of the order.
+**
+**  @return  The new order, NULL for no order.
+*/
+COrder *LoadOrder(CSnapshotReader &snapshot, CUnit &unit)
+{
+	COrder *order;
+
+	switch (snapshot.Varint()) {
+		case UnitActionNone: return NULL;
+		case UnitActionStill: order = new COrder_Still(false); break;
+		case UnitActionStandGround: order = new COrder_Still(true); break;
+		case UnitActionFollow: order = new COrder_Follow; break;
+		case UnitActionMove: order = new COrder_Move; break;
+		case UnitActionAttack: order = new COrder_Attack(false); break;
+		case UnitActionAttackGround: order = new COrder_Attack(true); break;
+		case UnitActionDie: order = new COrder_Die; break;
+		case UnitActionSpellCast: order = new COrder_SpellCast; break;
+		case UnitActionTrain: order = new COrder_Train; break;
+		case UnitActionUpgradeTo: order = new COrder_UpgradeTo; break;
+		case UnitActionResearch: order = new COrder_Research; break;
+		case UnitActionBuilt: order = new COrder_Built; break;
+		case UnitActionBoard: order = new COrder_Board; break;
+		case UnitActionUnload: order = new COrder_Unload; break;
+		case UnitActionPatrol: order = new COrder_Patrol; break;
+		case UnitActionBuild: order = new COrder_Build; break;
+		case UnitActionRepair: order = new COrder_Repair; break;
+		case UnitActionResource: order = new COrder_Resource(unit); break;
+		case UnitActionTransformInto: order = new COrder_TransformInto; break;
+		case UnitActionDefend: order = new COrder_Defend; break;
+		default:
+			fprintf(stderr, "LoadOrder: Unsupported action\n");
+			snapshot.SetCorrupted();
+			order = new COrder_Still(false);
+			break;
+	}
+	order->Load(snapshot, unit);
+	return order;
+}
+
 
 /*----------------------------------------------------------------------------
 --  Actions
@@ -453,6 +528,63 @@ static void DumpUnitInfo(CUnit &unit)
 	fflush(NULL);
 }
 
+/**
+**  Check if the unit may ask for a new path when its action is handled.
+**
+**  Units of move orders follow the flow field of their goal, they are
+**  not included.
+*/
+static bool MaySearchPath(const CUnit &unit)
+{
+	if (unit.Destroyed || unit.Removed || unit.Orders.empty() || !unit.CanMove()
+		|| unit.Anim.Unbreakable || unit.Moving) {
+		return false;
+	}
+	// See DoActionMove.
+	if (unit.Type->Animations->Move == unit.Anim.CurrAnim && unit.Anim.Wait) {
+		return false;
+	}
+	switch (unit.CurrentAction()) {
+		case UnitActionFollow:
+		case UnitActionDefend:
+		case UnitActionAttack:
+		case UnitActionAttackGround:
+		case UnitActionSpellCast:
+		case UnitActionBoard:
+		case UnitActionUnload:
+		case UnitActionPatrol:
+		case UnitActionBuild:
+		case UnitActionRepair:
+		case UnitActionResource:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+**  Decide phase of the actions: search ahead, with the worker threads,
+**  the paths the units may ask for.
+**
+**  Nothing of the game is changed here, the units are handled
+**  afterwards by UnitActionsEachCycle, in the same order as before:
+**  a path searched ahead is only used if the same search done at that
+**  time finds it too, so the game does not depend on the threads.
+*/
+template <typename UNITP_ITERATOR>
+static void UnitActionsDecide(UNITP_ITERATOR begin, UNITP_ITERATOR end)
+{
+	StartPathPrefetch();
+	for (UNITP_ITERATOR it = begin; it != end; ++it) {
+		CUnit &unit = **it;
+
+		if (MaySearchPath(unit)) {
+			PrefetchPath(unit);
+		}
+	}
+	RunPathPrefetch();
+}
+
 template <typename UNITP_ITERATOR>
 static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 {
@@ -490,6 +622,7 @@ static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 		SyncHash = (SyncHash << 5) | (SyncHash >> 27);
 		SyncHash ^= unit.Orders.empty() == false ? unit.CurrentAction() << 18 : 0;
 		SyncHash ^= unit.Refs << 3;
+		UpdateSyncDigest(unit);
 	}
 }
 
@@ -507,7 +640,10 @@ void UnitActions()
 	if (isASecondCycle) {
 		UnitActionsEachSecond(table.begin(), table.end());
 	}
-	// Do all actions
+	// Search ahead the paths, then do all actions
+	if (PathfinderThreads > 1) {
+		UnitActionsDecide(table.begin(), table.end());
+	}
 	UnitActionsEachCycle(table.begin(), table.end());
 }
 
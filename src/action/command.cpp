@@ -892,21 +892,25 @@ void CommandSharedVision(int player, bool state, int opponent)
 	if (before && !after) {
 		// Don't share vision anymore. Give each other explored terrain for good-bye.
 
+		unsigned short *playerVisible = Map.Visible[player];
+		unsigned short *opponentVisible = Map.Visible[opponent];
+
 		for (int i = 0; i != Map.Info.MapWidth * Map.Info.MapHeight; ++i) {
 			CMapField &mf = *Map.Field(i);
-			CMapFieldPlayerInfo &mfp = mf.playerInfo;
 
-			if (mfp.Visible[player] && !mfp.Visible[opponent]) {
-				mfp.Visible[opponent] = 1;
+			if (playerVisible[i] && !opponentVisible[i]) {
+				opponentVisible[i] = 1;
 				if (opponent == ThisPlayer->Index) {
 					Map.MarkSeenTile(mf);
 				}
+				UI.Minimap.UpdateSeenXY(i);
 			}
-			if (mfp.Visible[opponent] && !mfp.Visible[player]) {
-				mfp.Visible[player] = 1;
+			if (opponentVisible[i] && !playerVisible[i]) {
+				playerVisible[i] = 1;
 				if (player == ThisPlayer->Index) {
 					Map.MarkSeenTile(mf);
 				}
+				UI.Minimap.UpdateSeenXY(i);
 			}
 		}
 	}
@@ -208,15 +208,25 @@ int AiEnemyUnitsInDistance(const CPlayer &player,
 {
 	const Vec2i offset(range, range);
 	std::vector<CUnit *> units;
+	// Players which have player as enemy, to skip the buckets without any.
+	unsigned int enemies = 0;
 
+	for (int i = 0; i != PlayerMax; ++i) {
+		if (Players[i].IsEnemy(player)) {
+			enemies |= 1 << i;
+		}
+	}
+	if (enemies == 0) {
+		return 0;
+	}
 	if (type == NULL) {
-		Select(pos - offset, pos + offset, units, IsAEnemyUnitOf(player));
+		SelectOfPlayers(pos - offset, pos + offset, enemies, units, IsAEnemyUnitOf(player));
 		return static_cast<int>(units.size());
 	} else {
 		const Vec2i typeSize(type->TileWidth - 1, type->TileHeight - 1);
 		const IsAEnemyUnitWhichCanCounterAttackOf pred(player, *type);
 
-		Select(pos - offset, pos + typeSize + offset, units, pred);
+		SelectOfPlayers(pos - offset, pos + typeSize + offset, enemies, units, pred);
 		return static_cast<int>(units.size());
 	}
 }
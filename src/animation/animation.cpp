@@ -65,6 +65,7 @@
 #include "iolib.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "spells.h"
 #include "unit.h"
 #include "unittype.h"
@@ -259,6 +260,143 @@ int ParseAnimInt(const CUnit &unit, const char *parseint)
 	return atoi(parseint);
 }
 
+/**
+**  Parse an operand of an animation when the animation is defined.
+**
+**  @param s  Operand to parse, as for ParseAnimInt.
+*/
+void CAnimOperand::Init(const std::string &s)
+{
+	this->Text = s;
+	this->Kind = OperandText;
+	this->Goal = false;
+
+	if (s.empty()) {
+		this->Kind = OperandConstant;
+		this->Value = 0;
+		return;
+	}
+	if (isdigit(s[0]) || s[0] == '-') {
+		this->Kind = OperandConstant;
+		this->Value = atoi(s.c_str());
+		return;
+	}
+	if (s.size() < 2) {
+		return;
+	}
+	const std::string cur(s, 2);
+
+	if (s[0] == 'v' || s[0] == 't') { //unit variable detected
+		const size_t dot = cur.find('.');
+		if (dot == std::string::npos) {
+			return;
+		}
+		const std::string name(cur, 0, dot);
+		const std::string component(cur, dot + 1);
+
+		this->Goal = s[0] == 't';
+		this->Index = UnitTypeVar.VariableNameLookup[name.c_str()];// User variables
+		if (this->Index == -1) {
+			if (name == "ResourcesHeld") {
+				this->Kind = OperandResourcesHeld;
+			} else if (name == "ResourceActive") {
+				this->Kind = OperandResourceActive;
+			} else if (name == "_Distance") {
+				this->Kind = OperandDistance;
+			}
+			return;
+		}
+		this->Kind = OperandVariable;
+		if (component == "Value") {
+			this->Component = ComponentValue;
+		} else if (component == "Max") {
+			this->Component = ComponentMax;
+		} else if (component == "Increase") {
+			this->Component = ComponentIncrease;
+		} else if (component == "Enable") {
+			this->Component = ComponentEnable;
+		} else if (component == "Percent") {
+			this->Component = ComponentPercent;
+		} else {
+			this->Kind = OperandConstant;
+			this->Value = 0;
+		}
+	} else if (s[0] == 'b' || s[0] == 'g') { //unit bool flag detected
+		this->Index = UnitTypeVar.BoolFlagNameLookup[cur.c_str()];// User bool flags
+		if (this->Index != -1) {
+			this->Kind = OperandBoolFlag;
+			this->Goal = s[0] == 'g';
+		}
+	} else if (s[0] == 'r') { //random value
+		const size_t dot = cur.find('.');
+		this->Kind = OperandRandom;
+		if (dot == std::string::npos) {
+			this->Value = 0;
+			this->Max = atoi(cur.c_str());
+		} else {
+			this->Value = atoi(cur.substr(0, dot).c_str());
+			this->Max = atoi(cur.substr(dot + 1).c_str());
+		}
+	} else if (s[0] == 'l') { //player number
+		if (cur == "this") {
+			this->Kind = OperandPlayer;
+		} else {
+			Init(cur);
+			this->Text = s;
+		}
+	}
+}
+
+/**
+**  Get the value of an operand of an animation.
+**
+**  @param unit  Unit of the animation.
+**
+**  @return  The value of the operand.
+*/
+int CAnimOperand::Eval(const CUnit &unit) const
+{
+	const CUnit *goal = &unit;
+
+	if (this->Goal) {
+		if (!unit.CurrentOrder()->HasGoal()) {
+			return 0;
+		}
+		goal = unit.CurrentOrder()->GetGoal();
+	}
+	switch (this->Kind) {
+		case OperandConstant:
+			return this->Value;
+		case OperandVariable: {
+			const CVariable &var = goal->Variable[this->Index];
+
+			switch (this->Component) {
+				case ComponentValue: return var.Value;
+				case ComponentMax: return var.Max;
+				case ComponentIncrease: return var.Increase;
+				case ComponentEnable: return var.Enable;
+				case ComponentPercent: return var.Value * 100 / var.Max;
+			}
+			return 0;
+		}
+		case OperandBoolFlag:
+			return goal->Type->BoolFlag[this->Index].value;
+		case OperandResourcesHeld:
+			return goal->ResourcesHeld;
+		case OperandResourceActive:
+			return goal->Resource.Active;
+		case OperandDistance:
+			return unit.MapDistanceTo(*goal);
+		case OperandRandom:
+			return this->Value + SyncRand(this->Max - this->Value + 1);
+		case OperandPlayer:
+			return unit.Player->Index;
+		case OperandText:
+			break;
+	}
+	return ParseAnimInt(unit, this->Text.c_str());
+}
+
 /**
 **  Parse flags list in animation frame.
 **
@@ -268,6 +406,19 @@ int ParseAnimInt(const CUnit &unit, const char *parseint)
 **  @return The parsed value.
 */
 int ParseAnimFlags(const CUnit &unit, const char *parseflag)
+{
+	return ParseAnimFlags(unit.Anim.Anim->Type, parseflag);
+}
+
+/**
+**  Parse flags list of an animation.
+**
+**  @param type       Type of the animation.
+**  @param parseflag  Flag list to parse.
+**
+**  @return The parsed value.
+*/
+int ParseAnimFlags(AnimationType type, const char *parseflag)
 {
 	char s[100];
 	int flags = 0;
@@ -281,7 +432,7 @@ int ParseAnimFlags(const CUnit &unit, const char *parseflag)
 			*next = '\0';
 			++next;
 		}
-		if (unit.Anim.Anim->Type == AnimationSpawnMissile) {
+		if (type == AnimationSpawnMissile) {
 			if (!strcmp(cur, "none")) {
 				flags = SM_None;
 				return flags;
@@ -301,7 +452,7 @@ int ParseAnimFlags(const CUnit &unit, const char *parseflag)
 				fprintf(stderr, "Unknown animation flag: %s\n", cur);
 				ExitFatal(1);
 			}
-		} else if (unit.Anim.Anim->Type == AnimationSpawnUnit) {
+		} else if (type == AnimationSpawnUnit) {
 			if (!strcmp(cur, "none")) {
 				flags = SU_None;
 				return flags;
@@ -464,6 +615,44 @@ static const CAnimation *Advance(const CAnimation *anim, int n)
 	}
 }
 
+/* static */ void CAnimations::SaveUnitAnim(CSnapshotWriter &snapshot, const CUnit &unit)
+{
+	int animIndex = -1;
+
+	for (int i = 0; i < NumAnimations; ++i) {
+		if (AnimationsArray[i] == unit.Anim.CurrAnim) {
+			animIndex = i;
+			break;
+		}
+	}
+	snapshot.Int(unit.Anim.Wait);
+	snapshot.Int(animIndex);
+	if (animIndex != -1) {
+		snapshot.Int(GetAdvanceIndex(unit.Anim.CurrAnim, unit.Anim.Anim));
+	}
+	snapshot.Bool(unit.Anim.Unbreakable);
+}
+
+/* static */ void CAnimations::LoadUnitAnim(CSnapshotReader &snapshot, CUnit &unit)
+{
+	unit.Anim.Wait = snapshot.Int();
+	const int animIndex = snapshot.Int();
+	if (animIndex >= NumAnimations) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	if (animIndex >= 0) {
+		const int advance = snapshot.Int();
+		if (advance < 0) {
+			snapshot.SetCorrupted();
+			return;
+		}
+		unit.Anim.CurrAnim = AnimationsArray[animIndex];
+		unit.Anim.Anim = Advance(unit.Anim.CurrAnim, advance);
+	}
+	unit.Anim.Unbreakable = snapshot.Bool();
+}
+
 /**
 **  Add a label
 */
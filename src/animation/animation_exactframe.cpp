@@ -47,15 +47,15 @@
 
 /* virtual */ void CAnimation_ExactFrame::Init(const char *s, lua_State *)
 {
-	this->frame = s;
+	this->frame.Init(s);
 }
 
 int CAnimation_ExactFrame::ParseAnimInt(const CUnit *unit) const
 {
 	if (unit == NULL) {
-		return atoi(this->frame.c_str());
+		return atoi(this->frame.GetText().c_str());
 	} else {
-		return ::ParseAnimInt(*unit, this->frame.c_str());
+		return this->frame.Eval(*unit);
 	}
 }
 
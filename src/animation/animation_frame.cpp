@@ -48,15 +48,15 @@
 
 /* virtual */ void CAnimation_Frame::Init(const char *s, lua_State *)
 {
-	this->frame = s;
+	this->frame.Init(s);
 }
 
 int CAnimation_Frame::ParseAnimInt(const CUnit *unit) const
 {
 	if (unit == NULL) {
-		return atoi(this->frame.c_str());
+		return atoi(this->frame.GetText().c_str());
 	} else {
-		return ::ParseAnimInt(*unit, this->frame.c_str());
+		return this->frame.Eval(*unit);
 	}
 }
 
@@ -61,8 +61,8 @@ static bool returnFalse(int, int) { return false; }
 {
 	Assert(unit.Anim.Anim == this);
 
-	const int lop = ParseAnimInt(unit, this->leftVar.c_str());
-	const int rop = ParseAnimInt(unit, this->rightVar.c_str());
+	const int lop = this->leftVar.Eval(unit);
+	const int rop = this->rightVar.Eval(unit);
 	const bool cond = this->binOpFunc(lop, rop);
 
 	if (cond) {
@@ -80,7 +80,7 @@ static bool returnFalse(int, int) { return false; }
 
 	size_t begin = 0;
 	size_t end = std::min(len, str.find(' ', begin));
-	this->leftVar.assign(str, begin, end - begin);
+	this->leftVar.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
@@ -114,7 +114,7 @@ static bool returnFalse(int, int) { return false; }
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->rightVar.assign(str, begin, end - begin);
+	this->rightVar.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
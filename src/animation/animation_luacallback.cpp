@@ -47,10 +47,8 @@
 	Assert(cb);
 
 	cb->pushPreamble();
-	for (std::vector<std::string>::const_iterator it = cbArgs.begin(); it != cbArgs.end(); ++it) {
-		const std::string str = *it;
-
-		const int arg = ParseAnimInt(unit, str.c_str());
+	for (std::vector<CAnimOperand>::const_iterator it = cbArgs.begin(); it != cbArgs.end(); ++it) {
+		const int arg = it->Eval(unit);
 		cb->pushInteger(arg);
 	}
 	cb->run();
@@ -76,7 +74,8 @@
 		 begin != std::string::npos;) {
 		end = std::min(len, str.find(' ', begin));
 
-		this->cbArgs.push_back(str.substr(begin, end - begin));
+		this->cbArgs.push_back(CAnimOperand());
+		this->cbArgs.back().Init(str.substr(begin, end - begin));
 		begin = str.find_first_not_of(' ', end);
 	}
 }
@@ -43,8 +43,8 @@
 {
 	Assert(unit.Anim.Anim == this);
 
-	const int arg1 = ParseAnimInt(unit, this->minWait.c_str());
-	const int arg2 = ParseAnimInt(unit, this->maxWait.c_str());
+	const int arg1 = this->minWait.Eval(unit);
+	const int arg2 = this->maxWait.Eval(unit);
 
 	unit.Anim.Wait = arg1 + SyncRand() % (arg2 - arg1 + 1);
 }
@@ -59,11 +59,11 @@
 
 	size_t begin = 0;
 	size_t end = str.find(' ', begin);
-	this->minWait.assign(str, begin, end - begin);
+	this->minWait.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->maxWait.assign(str, begin, end - begin);
+	this->maxWait.Init(str.substr(begin, end - begin));
 }
 
 //@}
@@ -178,8 +178,8 @@ static void SetPlayerData(const int player, const char *prop, const char *arg, i
 
 	const char *var = this->varStr.c_str();
 	const char *arg = this->argStr.c_str();
-	const int playerId = ParseAnimInt(unit, this->playerStr.c_str());
-	int rop = ParseAnimInt(unit, this->valueStr.c_str());
+	const int playerId = this->player.Eval(unit);
+	int rop = this->value.Eval(unit);
 	int data = GetPlayerData(playerId, var, arg);
 
 	switch (this->mod) {
@@ -235,7 +235,7 @@ static void SetPlayerData(const int player, const char *prop, const char *arg, i
 
 	size_t begin = 0;
 	size_t end = str.find(' ', begin);
-	this->playerStr.assign(str, begin, end - begin);
+	this->player.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
@@ -270,7 +270,7 @@ static void SetPlayerData(const int player, const char *prop, const char *arg, i
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->valueStr.assign(str, begin, end - begin);
+	this->value.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
@@ -95,7 +95,7 @@
 		return;
 	}
 
-	const int rop = ParseAnimInt(unit, this->valueStr.c_str());
+	const int rop = this->value.Eval(unit);
 	int value = 0;
 	if (!strcmp(next + 1, "Value")) {
 		value = goal->Variable[index].Value;
@@ -206,6 +206,7 @@
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
 	this->valueStr.assign(str, begin, end - begin);
+	this->value.Init(this->valueStr);
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
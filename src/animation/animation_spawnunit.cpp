@@ -107,11 +107,11 @@ found:
 {
 	Assert(unit.Anim.Anim == this);
 
-	const int offX = ParseAnimInt(unit, this->offXStr.c_str());
-	const int offY = ParseAnimInt(unit, this->offYStr.c_str());
-	const int range = ParseAnimInt(unit, this->rangeStr.c_str());
-	const int playerId = ParseAnimInt(unit, this->playerStr.c_str());
-	const SpawnUnit_Flags flags = (SpawnUnit_Flags)(ParseAnimFlags(unit, this->flagsStr.c_str()));
+	const int offX = this->offX.Eval(unit);
+	const int offY = this->offY.Eval(unit);
+	const int range = this->range.Eval(unit);
+	const int playerId = this->player.Eval(unit);
+	const SpawnUnit_Flags flags = (SpawnUnit_Flags)this->flags;
 
 	CPlayer &player = Players[playerId];
 	const Vec2i pos(unit.tilePos.x + offX, unit.tilePos.y + offY);
@@ -157,24 +157,25 @@ found:
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->offXStr.assign(str, begin, end - begin);
+	this->offX.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->offYStr.assign(str, begin, end - begin);
+	this->offY.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->rangeStr.assign(str, begin, end - begin);
+	this->range.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->playerStr.assign(str, begin, end - begin);
+	this->player.Init(str.substr(begin, end - begin));
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
 	if (begin != end) {
-		this->flagsStr.assign(str, begin, end - begin);
+		const std::string flagsStr(str, begin, end - begin);
+		this->flags = ParseAnimFlags(AnimationSpawnUnit, flagsStr.c_str());
 	}
 }
 
@@ -1785,7 +1785,7 @@ void CEditor::Init()
 			}
 		}
 
-		Map.Fields = new CMapField[Map.Info.MapWidth * Map.Info.MapHeight];
+		Map.Create();
 
 		const int defaultTile = Map.Tileset->getDefaultTileIndex();
 
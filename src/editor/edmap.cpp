@@ -36,6 +36,7 @@
 #include "stratagus.h"
 #include "editor.h"
 #include "map.h"
+#include "pathfinder.h"
 #include "tileset.h"
 #include "ui.h"
 #include "player.h"
@@ -102,6 +103,7 @@ static void EditorChangeTile(const Vec2i &pos, int tileIndex, int d)
 	CMapField &mf = *Map.Field(pos);
 	mf.setTileIndex(*Map.Tileset, tileIndex, 0);
 	mf.playerInfo.SeenTile = mf.getGraphicTile();
+	PathfinderMapChanged(pos);
 
 	UI.Minimap.UpdateSeenXY(pos);
 	UI.Minimap.UpdateXY(pos);
@@ -0,0 +1,404 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name benchmark.cpp - The headless benchmark. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "benchmark.h"
+
+#include "ai.h"
+#include "commands.h"
+#include "interface.h"
+#include "map.h"
+#include "network/loopback.h"
+#include "player.h"
+#include "unit.h"
+#include "unit_find.h"
+#include "unittype.h"
+#include "widgets.h"
+
+#include <stdint.h>
+
+#ifdef USE_WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+extern void StartMap(const std::string &filename, bool clean);
+extern void StartReplay(const std::string &filename, bool reveal);
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+unsigned long BenchmarkCycles;          /// Cycles of the headless benchmark, 0 if none
+std::string BenchmarkScenario = "map";  /// Scenario played by the benchmark
+
+/// Units created for each player by the scenarios
+static const int BenchmarkUnitCount = 100;
+
+/// Names of the timers in the report
+static const char *const BenchmarkTimerNames[BenchmarkTimerMax] = {
+	"Other",
+	"UnitActions",
+	"MissileActions",
+	"PlayersEachCycle",
+	"PlayersEachSecond"
+};
+
+static uint64_t BenchmarkTimes[BenchmarkTimerMax]; /// Time spent in each part, in us
+static BenchmarkTimer BenchmarkCurrent;            /// Timer charged at the next lap
+static uint64_t BenchmarkStartTime;                /// Time of the first cycle
+static uint64_t BenchmarkLastTime;                 /// Time of the last lap
+static unsigned long BenchmarkStartCycle;          /// Game cycle of the first cycle
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Get the time of a high resolution clock.
+**
+**  @return  Time in micro seconds.
+*/
+static uint64_t GetBenchmarkTime()
+{
+#ifdef USE_WIN32
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (uint64_t)(counter.QuadPart * 1000000.0 / frequency.QuadPart);
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/**
+**  Check if the player takes part in the scenario.
+*/
+static bool IsBenchmarkPlayer(const CPlayer &player)
+{
+	return player.Type != PlayerNobody && player.Type != PlayerNeutral;
+}
+
+/**
+**  Find the first unit type which can take part in the scenario.
+**
+**  @param harvester  Find a harvester, else a fighter.
+*/
+static CUnitType *FindBenchmarkUnitType(bool harvester)
+{
+	for (std::vector<CUnitType *>::iterator it = UnitTypes.begin(); it != UnitTypes.end(); ++it) {
+		CUnitType &type = **it;
+
+		if (type.Building || type.Vanishes || type.Neutral || type.GivesResource
+			|| type.UnitType != UnitTypeLand || !type.CanMove()) {
+			continue;
+		}
+		if (harvester ? type.Harvester != 0 : (type.CanAttack && !type.Harvester)) {
+			return &type;
+		}
+	}
+	return NULL;
+}
+
+/**
+**  Create a unit of the scenario, like CreateUnit does.
+*/
+static CUnit *CreateBenchmarkUnit(const CUnitType &type, CPlayer &player, const Vec2i &pos)
+{
+	CUnit *unit = MakeUnit(type, &player);
+
+	if (unit == NULL) {
+		return NULL;
+	}
+	if (UnitCanBeAt(*unit, pos) || (type.Building && CanBuildUnitType(NULL, type, pos, 0))) {
+		unit->Place(pos);
+	} else {
+		const int heading = SyncRand() % 256;
+
+		unit->tilePos = pos;
+		DropOutOnSide(*unit, heading, NULL);
+	}
+	UpdateForNewUnit(*unit, 0);
+	return unit;
+}
+
+/**
+**  Get the start position of the next player of the scenario.
+*/
+static Vec2i GetBenchmarkEnemyPos(const CPlayer &player)
+{
+	for (int i = 1; i < NumPlayers; ++i) {
+		const CPlayer &enemy = Players[(player.Index + i) % NumPlayers];
+
+		if (IsBenchmarkPlayer(enemy)) {
+			return enemy.StartPos;
+		}
+	}
+	return player.StartPos;
+}
+
+/**
+**  Large armies: each player attacks the start position of the next one.
+**
+**  @param attack  Attack on the way, else only move: long range pathing.
+*/
+static void SetupBenchmarkArmies(bool attack)
+{
+	const CUnitType *type = FindBenchmarkUnitType(false);
+
+	if (type == NULL) {
+		fprintf(stderr, "Benchmark: no unit type can fight\n");
+		return;
+	}
+	for (int i = 0; i < NumPlayers; ++i) {
+		CPlayer &player = Players[i];
+
+		if (!IsBenchmarkPlayer(player)) {
+			continue;
+		}
+		Vec2i goalPos = GetBenchmarkEnemyPos(player);
+		if (!attack) {
+			// The farthest corner of the map.
+			goalPos.x = player.StartPos.x < Map.Info.MapWidth / 2 ? Map.Info.MapWidth - 1 : 0;
+			goalPos.y = player.StartPos.y < Map.Info.MapHeight / 2 ? Map.Info.MapHeight - 1 : 0;
+		}
+		for (int j = 0; j < BenchmarkUnitCount; ++j) {
+			CUnit *unit = CreateBenchmarkUnit(*type, player, player.StartPos);
+
+			if (unit == NULL) {
+				break;
+			}
+			if (attack) {
+				CommandAttack(*unit, goalPos, NULL, FlushCommands);
+			} else {
+				CommandMove(*unit, goalPos, FlushCommands);
+			}
+		}
+	}
+}
+
+/**
+**  Many harvesters: each player mines from its own deposit.
+*/
+static void SetupBenchmarkHarvest()
+{
+	const CUnitType *type = FindBenchmarkUnitType(true);
+
+	if (type == NULL) {
+		fprintf(stderr, "Benchmark: no unit type can harvest\n");
+		return;
+	}
+	// Find a resource mined from units, and a deposit storing it.
+	int resource = 0;
+	const CUnitType *depotType = NULL;
+	for (int res = 1; res < MaxCosts && depotType == NULL; ++res) {
+		if (type->ResInfo[res] == NULL || type->ResInfo[res]->TerrainHarvester) {
+			continue;
+		}
+		for (std::vector<CUnitType *>::iterator it = UnitTypes.begin(); it != UnitTypes.end(); ++it) {
+			if ((*it)->Building && (*it)->CanStore[res]) {
+				resource = res;
+				depotType = *it;
+				break;
+			}
+		}
+	}
+	if (depotType == NULL) {
+		fprintf(stderr, "Benchmark: no deposit for the harvesters of '%s'\n", type->Ident.c_str());
+		return;
+	}
+	const int range = std::max(Map.Info.MapWidth, Map.Info.MapHeight);
+	for (int i = 0; i < NumPlayers; ++i) {
+		CPlayer &player = Players[i];
+
+		if (!IsBenchmarkPlayer(player)) {
+			continue;
+		}
+		CUnit *depot = CreateBenchmarkUnit(*depotType, player, player.StartPos);
+		if (depot == NULL) {
+			continue;
+		}
+		CUnit *mine = UnitFindResource(*depot, *depot, range, resource, false, depot);
+		if (mine == NULL) {
+			continue;
+		}
+		for (int j = 0; j < BenchmarkUnitCount; ++j) {
+			CUnit *unit = CreateBenchmarkUnit(*type, player, depot->tilePos);
+
+			if (unit == NULL) {
+				break;
+			}
+			CommandResource(*unit, *mine, FlushCommands);
+		}
+	}
+}
+
+/**
+**  Run the benchmark on a map or a replay.
+**
+**  Replaces the menus: the game is started at once, and the program
+**  exits with the report at the end of the benchmark.
+**
+**  The "lockstep" scenario runs no game: it runs the lockstep harness of
+**  the network, with the settings given instead of the map.
+**
+**  @param filename  Map, replay for the "replay" scenario, or settings
+**                   for the "lockstep" scenario.
+*/
+void BenchmarkMain(const std::string &filename)
+{
+	static const char *const scenarios[] = {
+		"map", "ai", "replay", "armies", "harvest", "pathing", "lockstep", NULL
+	};
+	const char *const *scenario = scenarios;
+
+	while (*scenario && BenchmarkScenario != *scenario) {
+		++scenario;
+	}
+	if (*scenario == NULL) {
+		fprintf(stderr, "Unknown benchmark scenario '%s'\n", BenchmarkScenario.c_str());
+		ExitFatal(-1);
+	}
+	if (BenchmarkScenario == "lockstep") {
+		CLockstepSettings settings;
+
+		if (!settings.Parse(filename)) {
+			fprintf(stderr, "Bad lockstep settings '%s'\n", filename.c_str());
+			ExitFatal(-1);
+		}
+		settings.Cycles = BenchmarkCycles;
+		Exit(RunLockstepHarness(settings) ? 1 : 0);
+	}
+	if (filename.empty()) {
+		fprintf(stderr, "The benchmark needs a map or a replay\n");
+		ExitFatal(-1);
+	}
+
+	initGuichan();
+	InterfaceState = IfaceStateMenu;
+
+	if (BenchmarkScenario == "replay") {
+		StartReplay(filename, false);
+	} else {
+		StartMap(filename, true);
+	}
+}
+
+/**
+**  Set up the scenario of the benchmark, and start the timers.
+**
+**  Called when the game starts, before its first cycle.
+*/
+void BenchmarkGameStarting()
+{
+	if (BenchmarkScenario == "ai") {
+		// The computer plays for the local player too.
+		if (ThisPlayer && !ThisPlayer->AiEnabled) {
+			ThisPlayer->AiEnabled = true;
+			AiInit(*ThisPlayer);
+		}
+	} else if (BenchmarkScenario == "armies") {
+		SetupBenchmarkArmies(true);
+	} else if (BenchmarkScenario == "pathing") {
+		SetupBenchmarkArmies(false);
+	} else if (BenchmarkScenario == "harvest") {
+		SetupBenchmarkHarvest();
+	}
+
+	memset(BenchmarkTimes, 0, sizeof(BenchmarkTimes));
+	BenchmarkCurrent = BenchmarkOther;
+	BenchmarkStartTime = GetBenchmarkTime();
+	BenchmarkLastTime = BenchmarkStartTime;
+	BenchmarkStartCycle = GameCycle;
+}
+
+/**
+**  Charge the time spent since the last lap and start the given timer.
+**
+**  @param timer  Part of the game cycle which starts now.
+*/
+void BenchmarkLap(BenchmarkTimer timer)
+{
+	if (!BenchmarkCycles) {
+		return;
+	}
+	const uint64_t now = GetBenchmarkTime();
+
+	BenchmarkTimes[BenchmarkCurrent] += now - BenchmarkLastTime;
+	BenchmarkLastTime = now;
+	BenchmarkCurrent = timer;
+}
+
+/**
+**  Stop the game once the cycles of the benchmark are done.
+*/
+void BenchmarkEachCycle()
+{
+	if (BenchmarkCycles && GameCycle - BenchmarkStartCycle >= BenchmarkCycles) {
+		GameRunning = false;
+	}
+}
+
+/**
+**  Print the timings of the benchmark.
+*/
+void BenchmarkReport()
+{
+	BenchmarkLap(BenchmarkOther);
+
+	const unsigned long cycles = GameCycle - BenchmarkStartCycle;
+	const uint64_t total = BenchmarkLastTime - BenchmarkStartTime;
+	const double seconds = total / 1000000.0;
+
+	printf("Benchmark '%s': %lu cycles in %.3f s, %.1f cycles/s\n",
+		   BenchmarkScenario.c_str(), cycles, seconds, seconds > 0 ? cycles / seconds : 0.0);
+	for (int i = 0; i != BenchmarkTimerMax; ++i) {
+		printf("  %-18s %10.3f ms %6.2f %% %10.1f us/cycle\n", BenchmarkTimerNames[i],
+			   BenchmarkTimes[i] / 1000.0,
+			   total ? BenchmarkTimes[i] * 100.0 / total : 0.0,
+			   cycles ? (double)BenchmarkTimes[i] / cycles : 0.0);
+	}
+	fflush(stdout);
+}
+
+//@}
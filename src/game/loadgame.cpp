@@ -48,6 +48,7 @@
 #include "pathfinder.h"
 #include "replay.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "sound_server.h"
 #include "spells.h"
@@ -181,6 +182,10 @@ void LoadModules()
 
 static void PlaceUnits()
 {
+	// Placing the units would lose the loaded enter cycles of the buckets.
+	std::vector<unsigned long> enterCycles;
+	Map.UnitBuckets.GetEnterCycles(enterCycles);
+
 	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
 		CUnit &unit = **it;
 		if (!unit.Removed) {
@@ -188,11 +193,59 @@ static void PlaceUnits()
 			unit.Place(unit.tilePos);
 		}
 	}
+	Map.UnitBuckets.SetEnterCycles(enterCycles);
+}
+
+/**
+**  Load the sections of a snapshot, in the order of the file.
+**
+**  @param data      Content of the snapshot.
+**  @param filename  File name of the snapshot.
+*/
+static void LoadGameSnapshot(const std::string &data, const std::string &filename)
+{
+	CSnapshotReader snapshot(data.data(), data.size());
+	int section;
+
+	while (snapshot.NextSection(section)) {
+		switch (section) {
+			case SnapshotSectionLua:
+				LuaLoadBuffer(snapshot.SectionData(), filename);
+				break;
+			case SnapshotSectionPlayers:
+				LoadPlayers(snapshot);
+				break;
+			case SnapshotSectionMap:
+				Map.Load(snapshot);
+				break;
+			case SnapshotSectionUnits:
+				UnitManager.Load(snapshot);
+				break;
+			case SnapshotSectionUnitBuckets:
+				Map.UnitBuckets.Load(snapshot);
+				break;
+			case SnapshotSectionMissiles:
+				LoadMissiles(snapshot);
+				break;
+			case SnapshotSectionPathfinder:
+				LoadPathfinder(snapshot);
+				break;
+			default:
+				DebugPrint("Skipping unknown section %d of the saved game\n" _C_ section);
+				break;
+		}
+	}
+	if (snapshot.IsCorrupted()) {
+		fprintf(stderr, "The saved game `%s' is corrupted\n", filename.c_str());
+		ExitFatal(-1);
+	}
 }
 
 /**
 **  Load a game to file.
 **
+**  The game is either a snapshot or a Lua script.
+**
 **  @param filename  File name to be loaded.
 */
 void LoadGame(const std::string &filename)
@@ -206,7 +259,12 @@ void LoadGame(const std::string &filename)
 
 	LuaGarbageCollect();
 	InitUnitTypes(1);
-	LuaLoadFile(filename);
+	std::string data;
+	if (ReadSnapshotFile(filename, data) == 0) {
+		LoadGameSnapshot(data, filename);
+	} else {
+		LuaLoadFile(filename);
+	}
 	LuaGarbageCollect();
 
 	PlaceUnits();
@@ -221,6 +279,7 @@ void LoadGame(const std::string &filename)
 	GameCycle = game_cycle;
 	SyncRandSeed = syncrand;
 	SyncHash = synchash;
+	PathfinderGameLoaded();
 	SelectionChanged();
 }
 
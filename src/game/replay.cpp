@@ -47,8 +47,10 @@
 #include "network.h"
 #include "parameters.h"
 #include "player.h"
+#include "results.h"
 #include "script.h"
 #include "settings.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "translate.h"
 #include "unit.h"
@@ -59,6 +61,10 @@
 #include <sstream>
 #include <time.h>
 
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
 extern void ExpandPath(std::string &newpath, const std::string &path);
 extern void StartMap(const std::string &filename, bool clean);
 
@@ -72,15 +78,15 @@ extern void StartMap(const std::string &filename, bool clean);
 class LogEntry
 {
 public:
-	LogEntry() : GameCycle(0), Flush(0), PosX(0), PosY(0), DestUnitNumber(0),
-		Num(0), SyncRandSeed(0), Next(NULL) {
-		UnitNumber = 0;
+	LogEntry() : GameCycle(0), UnitIdent(-1), Action(-1), Flush(0),
+		PosX(-1), PosY(-1), DestUnitNumber(-1), Num(-1), SyncRandSeed(0) {
+		UnitNumber = -1;
 	}
 
 	unsigned long GameCycle;
 	int UnitNumber;
-	std::string UnitIdent;
-	std::string Action;
+	int UnitIdent;       /// Index in FullReplay::Idents, -1 if none
+	int Action;          /// ReplayAction, -1 if unknown
 	int Flush;
 	int PosX;
 	int PosY;
@@ -88,7 +94,21 @@ public:
 	std::string Value;
 	int Num;
 	unsigned SyncRandSeed;
-	LogEntry *Next;
+};
+
+/**
+**  State of the game saved in the replay.
+*/
+class ReplayKeyframe
+{
+public:
+	ReplayKeyframe() : GameCycle(0), Commands(0), Size(0), Compressed(false) {}
+
+	unsigned long GameCycle;  /// Game cycle of the snapshot
+	size_t Commands;          /// Commands logged before the snapshot
+	size_t Size;              /// Size of the saved game
+	bool Compressed;          /// Data is compressed with zlib
+	std::string Data;         /// Saved game
 };
 
 /**
@@ -114,10 +134,13 @@ public:
 	FullReplay() :
 		MapId(0), Type(0), Race(0), LocalPlayer(0),
 		Resource(0), NumUnits(0), Difficulty(0), NoFow(false), RevealMap(0),
-		MapRichness(0), GameType(0), Opponents(0), Commands(NULL) {
+		MapRichness(0), GameType(0), Opponents(0) {
 		memset(Engine, 0, sizeof(Engine));
 		memset(Network, 0, sizeof(Network));
 	}
+
+	int GetIdent(const std::string &ident);
+
 	std::string Comment1;
 	std::string Comment2;
 	std::string Comment3;
@@ -141,13 +164,91 @@ public:
 	int Opponents;
 	int Engine[3];
 	int Network[3];
-	LogEntry *Commands;
+	std::vector<std::string> Idents;        /// Unit type idents of the commands
+	std::vector<LogEntry> Commands;
+	std::vector<ReplayKeyframe> Keyframes;  /// Only loaded from binary replays
 };
 
 //----------------------------------------------------------------------------
 // Constants
 //----------------------------------------------------------------------------
 
+/**
+**  Actions of the logged commands, their index is the replay action ID.
+*/
+enum ReplayAction {
+	ReplayActionStop,
+	ReplayActionStandGround,
+	ReplayActionDefend,
+	ReplayActionFollow,
+	ReplayActionMove,
+	ReplayActionRepair,
+	ReplayActionAutoRepair,
+	ReplayActionAttack,
+	ReplayActionAttackGround,
+	ReplayActionPatrol,
+	ReplayActionBoard,
+	ReplayActionUnload,
+	ReplayActionBuild,
+	ReplayActionDismiss,
+	ReplayActionResourceLoc,
+	ReplayActionResource,
+	ReplayActionReturn,
+	ReplayActionTrain,
+	ReplayActionCancelTrain,
+	ReplayActionUpgradeTo,
+	ReplayActionCancelUpgradeTo,
+	ReplayActionResearch,
+	ReplayActionCancelResearch,
+	ReplayActionSpellCast,
+	ReplayActionAutoSpellCast,
+	ReplayActionDiplomacy,
+	ReplayActionSharedVision,
+	ReplayActionInput,
+	ReplayActionChat,
+	ReplayActionQuit,
+	ReplayActionMax
+};
+
+/// Names of the actions in the commands, by replay action ID
+static const char *const ReplayActionNames[ReplayActionMax] = {
+	"stop", "stand-ground", "defend", "follow", "move", "repair", "auto-repair",
+	"attack", "attack-ground", "patrol", "board", "unload", "build", "dismiss",
+	"resource-loc", "resource", "return", "train", "cancel-train", "upgrade-to",
+	"cancel-upgrade-to", "research", "cancel-research", "spell-cast",
+	"auto-spell-cast", "diplomacy", "shared-vision", "input", "chat", "quit"
+};
+
+/**
+**  Records of a binary replay.
+**
+**  The file starts with ReplayMagic and the format version, followed by
+**  the records: a tag and its fields. Numbers are varints, signed ones
+**  zigzag encoded, strings are prefixed by their length.
+*/
+enum ReplayRecord {
+	ReplayRecordHeader = 1,  /// Replay definition
+	ReplayRecordIdent,       /// Next unit type ident of the commands
+	ReplayRecordCommand,     /// Logged command
+	ReplayRecordKeyframe     /// Saved game
+};
+
+/// Fields present in a command record
+enum {
+	ReplayCommandUnit = 0x01,   /// Unit number and ident
+	ReplayCommandFlush = 0x02,  /// Flush is set
+	ReplayCommandPos = 0x04,    /// Position, or arguments
+	ReplayCommandDest = 0x08,   /// Destination unit
+	ReplayCommandValue = 0x10,  /// Value string
+	ReplayCommandNum = 0x20     /// Number argument
+};
+
+/// First bytes of a binary replay
+static const char ReplayMagic[8] = { 'S', 't', 'r', 'a', 'R', 'p', 'l', '\032' };
+/// Version of the binary replay format
+static const unsigned long ReplayVersion = 1;
+/// Game cycles between two keyframes, five minutes
+static const unsigned long ReplayKeyframeCycles = CYCLES_PER_SECOND * 60 * 5;
 
 //----------------------------------------------------------------------------
 // Variables
@@ -157,10 +258,15 @@ bool CommandLogDisabled;           /// True if command log is off
 ReplayType ReplayGameType;         /// Replay game type
 static bool DisabledLog;           /// Disabled log for replay
 static CFile *LogFile;             /// Replay log file
+static size_t LogIdentsWritten;    /// Idents of CurrentReplay already in LogFile
 static unsigned long NextLogCycle; /// Next log cycle number
 static int InitReplay;             /// Initialize replay
 static FullReplay *CurrentReplay;
-static LogEntry *ReplayStep;
+static size_t ReplayStep;          /// Next command of CurrentReplay to replay
+static size_t ReplayStartStep;     /// First command to replay, after a keyframe
+static bool ReplaySeekPending;        /// The game stopped to seek in the replay
+static int ReplaySeekKeyframe;        /// Keyframe to restart from, -1 for the start
+static unsigned long ReplaySeekCycle; /// Cycle to fast forward to
 
 //----------------------------------------------------------------------------
 // Log commands
@@ -272,14 +378,36 @@ static void ApplyReplaySettings()
 */
 static void DeleteReplay(FullReplay *replay)
 {
-	LogEntry *log = replay->Commands;
+	delete replay;
+}
+
+/**
+**  Get the index of a unit type ident, add it if needed.
+*/
+int FullReplay::GetIdent(const std::string &ident)
+{
+	for (size_t i = 0; i != Idents.size(); ++i) {
+		if (Idents[i] == ident) {
+			return i;
+		}
+	}
+	Idents.push_back(ident);
+	return Idents.size() - 1;
+}
 
-	while (log) {
-		LogEntry *next = log->Next;
-		delete log;
-		log = next;
+/**
+**  Get the replay action ID of an action name.
+**
+**  @return  The ID, or -1 if the action is unknown.
+*/
+static int GetReplayAction(const char *action)
+{
+	for (int i = 0; i != ReplayActionMax; ++i) {
+		if (!strcmp(action, ReplayActionNames[i])) {
+			return i;
+		}
 	}
-	delete replay;
+	return -1;
 }
 
 static void PrintLogCommand(const LogEntry &log, CFile &file)
@@ -289,10 +417,10 @@ static void PrintLogCommand(const LogEntry &log, CFile &file)
 	if (log.UnitNumber != -1) {
 		file.printf("UnitNumber = %d, ", log.UnitNumber);
 	}
-	if (!log.UnitIdent.empty()) {
-		file.printf("UnitIdent = \"%s\", ", log.UnitIdent.c_str());
+	if (log.UnitIdent != -1) {
+		file.printf("UnitIdent = \"%s\", ", CurrentReplay->Idents[log.UnitIdent].c_str());
 	}
-	file.printf("Action = \"%s\", ", log.Action.c_str());
+	file.printf("Action = \"%s\", ", log.Action != -1 ? ReplayActionNames[log.Action] : "");
 	file.printf("Flush = %d, ", log.Flush);
 	if (log.PosX != -1 || log.PosY != -1) {
 		file.printf("PosX = %d, PosY = %d, ", log.PosX, log.PosY);
@@ -356,34 +484,173 @@ static void SaveFullLog(CFile &file)
 	file.printf("  Network = { %d, %d, %d }\n",
 				CurrentReplay->Network[0], CurrentReplay->Network[1], CurrentReplay->Network[2]);
 	file.printf("} )\n");
-	const LogEntry *log = CurrentReplay->Commands;
-	while (log) {
-		PrintLogCommand(*log, file);
-		log = log->Next;
+	for (size_t i = 0; i != CurrentReplay->Commands.size(); ++i) {
+		PrintLogCommand(CurrentReplay->Commands[i], file);
+	}
+}
+
+/**
+**  Write the record of a command to the binary log.
+**
+**  The idents not yet in the log are written before it.
+**
+**  @param log   Command to write.
+**  @param prev  Game cycle of the previous command.
+**  @param file  The file to output to
+*/
+static void WriteLogCommand(const LogEntry &log, unsigned long prev, CFile &file)
+{
+	CBinaryWriter record;
+
+	for (; LogIdentsWritten < CurrentReplay->Idents.size(); ++LogIdentsWritten) {
+		record.Varint(ReplayRecordIdent);
+		record.String(CurrentReplay->Idents[LogIdentsWritten]);
+	}
+
+	const int fields = (log.UnitNumber != -1 ? ReplayCommandUnit : 0)
+					   | (log.Flush ? ReplayCommandFlush : 0)
+					   | (log.PosX != -1 || log.PosY != -1 ? ReplayCommandPos : 0)
+					   | (log.DestUnitNumber != -1 ? ReplayCommandDest : 0)
+					   | (!log.Value.empty() ? ReplayCommandValue : 0)
+					   | (log.Num != -1 ? ReplayCommandNum : 0);
+
+	record.Varint(ReplayRecordCommand);
+	record.Varint(log.GameCycle - prev);
+	record.Varint(log.Action + 1);
+	record.Varint(fields);
+	if (fields & ReplayCommandUnit) {
+		record.Varint(log.UnitNumber);
+		record.Varint(log.UnitIdent + 1);
+	}
+	if (fields & ReplayCommandPos) {
+		record.Int(log.PosX);
+		record.Int(log.PosY);
+	}
+	if (fields & ReplayCommandDest) {
+		record.Varint(log.DestUnitNumber);
 	}
+	if (fields & ReplayCommandValue) {
+		record.String(log.Value);
+	}
+	if (fields & ReplayCommandNum) {
+		record.Int(log.Num);
+	}
+	record.Fixed32(log.SyncRandSeed);
+	record.Write(file);
+}
+
+/**
+**  Output the FullReplay to a binary log file
+**
+**  @param file  The file to output to
+*/
+static void SaveBinaryLog(CFile &file)
+{
+	CBinaryWriter record;
+
+	record.Bytes(ReplayMagic, sizeof(ReplayMagic));
+	record.Varint(ReplayVersion);
+	record.Varint(ReplayRecordHeader);
+	record.String(CurrentReplay->Comment1);
+	record.String(CurrentReplay->Comment2);
+	record.String(CurrentReplay->Comment3);
+	record.String(CurrentReplay->Date);
+	record.String(CurrentReplay->Map);
+	record.String(CurrentReplay->MapPath);
+	record.Varint(CurrentReplay->MapId);
+	record.Int(CurrentReplay->Type);
+	record.Int(CurrentReplay->Race);
+	record.Int(CurrentReplay->LocalPlayer);
+	for (int i = 0; i < PlayerMax; ++i) {
+		record.String(CurrentReplay->Players[i].Name);
+		record.Int(CurrentReplay->Players[i].Race);
+		record.Int(CurrentReplay->Players[i].Team);
+		record.Int(CurrentReplay->Players[i].Type);
+	}
+	record.Int(CurrentReplay->Resource);
+	record.Int(CurrentReplay->NumUnits);
+	record.Int(CurrentReplay->Difficulty);
+	record.Varint(CurrentReplay->NoFow);
+	record.Int(CurrentReplay->RevealMap);
+	record.Int(CurrentReplay->GameType);
+	record.Int(CurrentReplay->Opponents);
+	record.Int(CurrentReplay->MapRichness);
+	for (int i = 0; i < 3; ++i) {
+		record.Int(CurrentReplay->Engine[i]);
+	}
+	for (int i = 0; i < 3; ++i) {
+		record.Int(CurrentReplay->Network[i]);
+	}
+	record.Write(file);
+
+	LogIdentsWritten = 0;
+	unsigned long prev = 0;
+	for (size_t i = 0; i != CurrentReplay->Commands.size(); ++i) {
+		WriteLogCommand(CurrentReplay->Commands[i], prev, file);
+		prev = CurrentReplay->Commands[i].GameCycle;
+	}
+	file.flush();
 }
 
 /**
 **  Append the LogEntry structure at the end of currentLog, and to LogFile
 **
-**  @param log   Pointer the replay log entry to be added
+**  @param log   The replay log entry to be added
 **  @param dest  The file to output to
 */
-static void AppendLog(LogEntry *log, CFile &file)
+static void AppendLog(const LogEntry &log, CFile &file)
+{
+	const unsigned long prev = CurrentReplay->Commands.empty() ? 0 : CurrentReplay->Commands.back().GameCycle;
+
+	CurrentReplay->Commands.push_back(log);
+
+	WriteLogCommand(log, prev, file);
+	file.flush();
+}
+
+/**
+**  Get the directory of the replay logs, create it if needed.
+*/
+static std::string GetReplayLogDir()
 {
-	LogEntry **last;
+	struct stat tmp;
+	std::string path(Parameters::Instance.GetUserDirectory());
 
-	// Append to linked list
-	last = &CurrentReplay->Commands;
-	while (*last) {
-		last = &(*last)->Next;
+	if (!GameName.empty()) {
+		path += "/";
+		path += GameName;
 	}
+	path += "/logs";
 
-	*last = log;
-	log->Next = 0;
+	if (stat(path.c_str(), &tmp) < 0) {
+		makedir(path.c_str(), 0777);
+	}
+	return path;
+}
 
-	PrintLogCommand(*log, file);
-	file.flush();
+/**
+**  Read a whole file.
+**
+**  @param name  Name of the file, compressed files are decompressed.
+**  @param data  Content of the file.
+**
+**  @return      0 for success, -1 for failure
+*/
+static int ReadReplayFile(const std::string &name, std::string &data)
+{
+	CFile file;
+
+	if (file.open(name.c_str(), CL_OPEN_READ) == -1) {
+		return -1;
+	}
+	char buf[4096];
+	int size;
+	data.clear();
+	while ((size = file.read(buf, sizeof(buf))) > 0) {
+		data.append(buf, size);
+	}
+	file.close();
+	return 0;
 }
 
 /**
@@ -411,18 +678,8 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 	// to the save file name, to test more than one player on one computer.
 	//
 	if (!LogFile) {
-		struct stat tmp;
 		char buf[16];
-		std::string path(Parameters::Instance.GetUserDirectory());
-		if (!GameName.empty()) {
-			path += "/";
-			path += GameName;
-		}
-		path += "/logs";
-
-		if (stat(path.c_str(), &tmp) < 0) {
-			makedir(path.c_str(), 0777);
-		}
+		std::string path(GetReplayLogDir());
 
 		snprintf(buf, sizeof(buf), "%d", ThisPlayer->Index);
 
@@ -440,67 +697,120 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 		}
 
 		if (CurrentReplay) {
-			SaveFullLog(*LogFile);
+			SaveBinaryLog(*LogFile);
 		}
 	}
 
 	if (!CurrentReplay) {
 		CurrentReplay = StartReplay();
 
-		SaveFullLog(*LogFile);
+		SaveBinaryLog(*LogFile);
 	}
 
 	if (!action) {
 		return;
 	}
+	const int replayAction = GetReplayAction(action);
+	if (replayAction == -1) {
+		fprintf(stderr, "Unknown replay action `%s', the command is not logged\n", action);
+		return;
+	}
 
-	LogEntry *log = new LogEntry;
+	LogEntry log;
 
 	//
 	// Frame, unit, (type-ident only to be better readable).
 	//
-	log->GameCycle = GameCycle;
+	log.GameCycle = GameCycle;
 
-	log->UnitNumber = (unit ? UnitNumber(*unit) : -1);
-	log->UnitIdent = (unit ? unit->Type->Ident.c_str() : "");
+	log.UnitNumber = (unit ? UnitNumber(*unit) : -1);
+	log.UnitIdent = (unit ? CurrentReplay->GetIdent(unit->Type->Ident) : -1);
 
-	log->Action = action;
-	log->Flush = flush;
+	log.Action = replayAction;
+	log.Flush = flush;
 
 	//
 	// Coordinates given.
 	//
-	log->PosX = x;
-	log->PosY = y;
+	log.PosX = x;
+	log.PosY = y;
 
 	//
 	// Destination given.
 	//
-	log->DestUnitNumber = (dest ? UnitNumber(*dest) : -1);
+	log.DestUnitNumber = (dest ? UnitNumber(*dest) : -1);
 
 	//
 	// Value given.
 	//
-	log->Value = (value ? value : "");
+	log.Value = (value ? value : "");
 
 	//
 	// Number given.
 	//
-	log->Num = num;
+	log.Num = num;
 
-	log->SyncRandSeed = SyncRandSeed;
+	log.SyncRandSeed = SyncRandSeed;
 
 	// Append it to ReplayLog list
 	AppendLog(log, *LogFile);
 }
 
+/**
+**  Save a keyframe of the game state in the replay log, when it is due.
+**
+**  Called at the start of the game cycle, once the commands of the
+**  previous cycles are done: the replay restarts from the keyframe
+**  with the commands logged after it.
+**
+**  The paths and flow fields cached by the pathfinder are saved with
+**  the keyframe, so a replay started from it finds the same paths as
+**  the recorded game.
+*/
+void SaveReplayKeyframe()
+{
+	if (!GameCycle || GameCycle % ReplayKeyframeCycles) {
+		return;
+	}
+	if (!LogFile || !CurrentReplay) {
+		return;
+	}
+	std::string data;
+	CFile file;
+
+	file.open(data);
+	const int res = SaveGameSnapshot(file, "keyframe", false);
+	file.close();
+	if (res == -1) {
+		return;
+	}
+
+	CBinaryWriter record;
+	record.Varint(ReplayRecordKeyframe);
+	record.Varint(GameCycle);
+	record.Varint(CurrentReplay->Commands.size());
+	record.Varint(data.size());
+#ifdef USE_ZLIB
+	uLongf size = compressBound(data.size());
+	std::vector<Bytef> buf(size);
+	if (compress2(&buf[0], &size, (const Bytef *)data.data(), data.size(), Z_BEST_SPEED) == Z_OK) {
+		record.Varint(1);
+		record.String(std::string((const char *)&buf[0], size));
+	} else
+#endif
+	{
+		record.Varint(0);
+		record.String(data);
+	}
+	record.Write(*LogFile);
+	LogFile->flush();
+}
+
 /**
 ** Parse log
 */
 static int CclLog(lua_State *l)
 {
-	LogEntry *log;
-	LogEntry **last;
 	const char *value;
 
 	LuaCheckArgs(l, 1);
@@ -510,51 +820,40 @@ static int CclLog(lua_State *l)
 
 	Assert(CurrentReplay);
 
-	log = new LogEntry;
-	log->UnitNumber = -1;
-	log->PosX = -1;
-	log->PosY = -1;
-	log->DestUnitNumber = -1;
-	log->Num = -1;
+	LogEntry log;
 
 	lua_pushnil(l);
 	while (lua_next(l, 1)) {
 		value = LuaToString(l, -2);
 		if (!strcmp(value, "GameCycle")) {
-			log->GameCycle = LuaToNumber(l, -1);
+			log.GameCycle = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "UnitNumber")) {
-			log->UnitNumber = LuaToNumber(l, -1);
+			log.UnitNumber = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "UnitIdent")) {
-			log->UnitIdent = LuaToString(l, -1);
+			log.UnitIdent = CurrentReplay->GetIdent(LuaToString(l, -1));
 		} else if (!strcmp(value, "Action")) {
-			log->Action = LuaToString(l, -1);
+			log.Action = GetReplayAction(LuaToString(l, -1));
 		} else if (!strcmp(value, "Flush")) {
-			log->Flush = LuaToNumber(l, -1);
+			log.Flush = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "PosX")) {
-			log->PosX = LuaToNumber(l, -1);
+			log.PosX = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "PosY")) {
-			log->PosY = LuaToNumber(l, -1);
+			log.PosY = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "DestUnitNumber")) {
-			log->DestUnitNumber = LuaToNumber(l, -1);
+			log.DestUnitNumber = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "Value")) {
-			log->Value = LuaToString(l, -1);
+			log.Value = LuaToString(l, -1);
 		} else if (!strcmp(value, "Num")) {
-			log->Num = LuaToNumber(l, -1);
+			log.Num = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "SyncRandSeed")) {
-			log->SyncRandSeed = LuaToUnsignedNumber(l, -1);
+			log.SyncRandSeed = LuaToUnsignedNumber(l, -1);
 		} else {
 			LuaError(l, "Unsupported key: %s" _C_ value);
 		}
 		lua_pop(l, 1);
 	}
 
-	// Append to linked list
-	last = &CurrentReplay->Commands;
-	while (*last) {
-		last = &(*last)->Next;
-	}
-
-	*last = log;
+	CurrentReplay->Commands.push_back(log);
 
 	return 0;
 }
@@ -696,9 +995,177 @@ void SaveReplayList(CFile &file)
 	SaveFullLog(file);
 }
 
+/**
+**  Read the header record of a binary replay.
+*/
+static bool ReadReplayHeader(CBinaryReader &reader, FullReplay &replay)
+{
+	replay.Comment1 = reader.String();
+	replay.Comment2 = reader.String();
+	replay.Comment3 = reader.String();
+	replay.Date = reader.String();
+	replay.Map = reader.String();
+	replay.MapPath = reader.String();
+	replay.MapId = reader.Varint();
+	replay.Type = reader.Int();
+	replay.Race = reader.Int();
+	replay.LocalPlayer = reader.Int();
+	for (int i = 0; i < PlayerMax; ++i) {
+		replay.Players[i].Name = reader.String();
+		replay.Players[i].Race = reader.Int();
+		replay.Players[i].Team = reader.Int();
+		replay.Players[i].Type = reader.Int();
+	}
+	replay.Resource = reader.Int();
+	replay.NumUnits = reader.Int();
+	replay.Difficulty = reader.Int();
+	replay.NoFow = reader.Varint() != 0;
+	replay.RevealMap = reader.Int();
+	replay.GameType = reader.Int();
+	replay.Opponents = reader.Int();
+	replay.MapRichness = reader.Int();
+	for (int i = 0; i < 3; ++i) {
+		replay.Engine[i] = reader.Int();
+	}
+	for (int i = 0; i < 3; ++i) {
+		replay.Network[i] = reader.Int();
+	}
+	return !reader.IsCorrupted();
+}
+
+/**
+**  Read a command record of a binary replay.
+*/
+static bool ReadReplayCommand(CBinaryReader &reader, FullReplay &replay, LogEntry &log)
+{
+	const unsigned long delta = reader.Varint();
+	const unsigned long action = reader.Varint();
+	const unsigned long fields = reader.Varint();
+
+	log.GameCycle = (replay.Commands.empty() ? 0 : replay.Commands.back().GameCycle) + delta;
+	log.Action = action <= ReplayActionMax ? (int)action - 1 : -1;
+	log.Flush = (fields & ReplayCommandFlush) ? 1 : 0;
+	if (fields & ReplayCommandUnit) {
+		log.UnitNumber = reader.Varint();
+		const unsigned long ident = reader.Varint();
+		if (ident > replay.Idents.size()) {
+			return false;
+		}
+		log.UnitIdent = (int)ident - 1;
+	}
+	if (fields & ReplayCommandPos) {
+		log.PosX = reader.Int();
+		log.PosY = reader.Int();
+	}
+	if (fields & ReplayCommandDest) {
+		log.DestUnitNumber = reader.Varint();
+	}
+	if (fields & ReplayCommandValue) {
+		log.Value = reader.String();
+	}
+	if (fields & ReplayCommandNum) {
+		log.Num = reader.Int();
+	}
+	log.SyncRandSeed = reader.Fixed32();
+	return !reader.IsCorrupted();
+}
+
+/**
+**  Read a keyframe record of a binary replay.
+*/
+static bool ReadReplayKeyframe(CBinaryReader &reader, ReplayKeyframe &keyframe)
+{
+	keyframe.GameCycle = reader.Varint();
+	keyframe.Commands = reader.Varint();
+	keyframe.Size = reader.Varint();
+	keyframe.Compressed = reader.Varint() != 0;
+	keyframe.Data = reader.String();
+	return !reader.IsCorrupted();
+}
+
+/**
+**  Load a binary replay.
+**
+**  The log is written while the game runs: a record cut at the end of
+**  the file, by a crash, ends the replay.
+**
+**  @param data  Content of the replay file.
+**
+**  @return      0 for success, -1 for failure
+*/
+static int LoadBinaryReplay(const std::string &data)
+{
+	CBinaryReader reader(data.data() + sizeof(ReplayMagic), data.size() - sizeof(ReplayMagic));
+	const unsigned long version = reader.Varint();
+
+	if (version != ReplayVersion || reader.Varint() != ReplayRecordHeader || reader.IsCorrupted()) {
+		fprintf(stderr, "Unsupported replay format\n");
+		return -1;
+	}
+	Assert(CurrentReplay == NULL);
+
+	FullReplay *replay = new FullReplay;
+
+	if (!ReadReplayHeader(reader, *replay)) {
+		fprintf(stderr, "Corrupted replay header\n");
+		delete replay;
+		return -1;
+	}
+	bool cut = false;
+	while (!reader.AtEnd() && !cut) {
+		const unsigned long tag = reader.Varint();
+
+		if (tag == ReplayRecordIdent) {
+			const std::string ident = reader.String();
+
+			if (reader.IsCorrupted()) {
+				cut = true;
+			} else {
+				replay->Idents.push_back(ident);
+			}
+		} else if (tag == ReplayRecordCommand) {
+			LogEntry log;
+
+			if (!ReadReplayCommand(reader, *replay, log)) {
+				cut = true;
+			} else {
+				replay->Commands.push_back(log);
+			}
+		} else if (tag == ReplayRecordKeyframe) {
+			ReplayKeyframe keyframe;
+
+			if (!ReadReplayKeyframe(reader, keyframe)) {
+				cut = true;
+			} else {
+				replay->Keyframes.push_back(keyframe);
+			}
+		} else {
+			if (!reader.IsCorrupted()) {
+				fprintf(stderr, "Unknown replay record %lu\n", tag);
+			}
+			cut = true;
+		}
+	}
+	if (cut) {
+		fprintf(stderr, "Replay cut after %lu commands\n", (unsigned long)replay->Commands.size());
+	}
+
+	CurrentReplay = replay;
+
+	// Apply CurrentReplay settings.
+	if (!SaveGameLoading) {
+		ApplyReplaySettings();
+	} else {
+		CommandLogDisabled = false;
+	}
+	return 0;
+}
+
 /**
 **  Load a log file to replay a game
 **
+**  The log is a binary replay, or Lua for the older ones.
+**
 **  @param name  name of file to load.
 */
 int LoadReplay(const std::string &name)
@@ -706,7 +1173,16 @@ int LoadReplay(const std::string &name)
 	CleanReplayLog();
 	ReplayGameType = ReplaySinglePlayer;
 
-	LuaLoadFile(name);
+	std::string data;
+	if (ReadReplayFile(name, data) == 0 && data.size() >= sizeof(ReplayMagic)
+		&& !memcmp(data.data(), ReplayMagic, sizeof(ReplayMagic))) {
+		if (LoadBinaryReplay(data) == -1) {
+			return -1;
+		}
+	} else {
+		LuaLoadFile(name);
+	}
+	ReplayStartStep = 0;
 
 	NextLogCycle = ~0UL;
 	if (!CommandLogDisabled) {
@@ -733,7 +1209,7 @@ void EndReplayLog()
 		DeleteReplay(CurrentReplay);
 		CurrentReplay = NULL;
 	}
-	ReplayStep = NULL;
+	ReplayStep = 0;
 }
 
 /**
@@ -745,7 +1221,7 @@ void CleanReplayLog()
 		DeleteReplay(CurrentReplay);
 		CurrentReplay = 0;
 	}
-	ReplayStep = NULL;
+	ReplayStep = 0;
 
 	// if (DisabledLog) {
 	CommandLogDisabled = false;
@@ -756,140 +1232,188 @@ void CleanReplayLog()
 	ReplayGameType = ReplayNone;
 }
 
+/**
+**  Get the next command to replay.
+**
+**  @return  The command, or NULL at the end of the replay.
+*/
+static const LogEntry *GetReplayStep()
+{
+	if (!CurrentReplay || ReplayStep >= CurrentReplay->Commands.size()) {
+		return NULL;
+	}
+	return &CurrentReplay->Commands[ReplayStep];
+}
+
 /**
 **  Do next replay
 */
 static void DoNextReplay()
 {
-	Assert(ReplayStep != 0);
+	const LogEntry *step = GetReplayStep();
+	Assert(step != NULL);
 
-	NextLogCycle = ReplayStep->GameCycle;
+	NextLogCycle = step->GameCycle;
 
 	if (NextLogCycle != GameCycle) {
 		return;
 	}
 
-	const int unitSlot = ReplayStep->UnitNumber;
-	const char *action = ReplayStep->Action.c_str();
-	const int flags = ReplayStep->Flush;
-	const Vec2i pos(ReplayStep->PosX, ReplayStep->PosY);
-	const int arg1 = ReplayStep->PosX;
-	const int arg2 = ReplayStep->PosY;
+	const int unitSlot = step->UnitNumber;
+	const int flags = step->Flush;
+	const Vec2i pos(step->PosX, step->PosY);
+	const int arg1 = step->PosX;
+	const int arg2 = step->PosY;
 	CUnit *unit = unitSlot != -1 ? &UnitManager.GetSlotUnit(unitSlot) : NULL;
-	CUnit *dunit = (ReplayStep->DestUnitNumber != -1 ? &UnitManager.GetSlotUnit(ReplayStep->DestUnitNumber) : NULL);
-	const char *val = ReplayStep->Value.c_str();
-	const int num = ReplayStep->Num;
+	CUnit *dunit = (step->DestUnitNumber != -1 ? &UnitManager.GetSlotUnit(step->DestUnitNumber) : NULL);
+	const char *val = step->Value.c_str();
+	const int num = step->Num;
 
-	Assert(unitSlot == -1 || ReplayStep->UnitIdent == unit->Type->Ident);
+	Assert(unitSlot == -1 || CurrentReplay->Idents[step->UnitIdent] == unit->Type->Ident);
 
-	if (SyncRandSeed != ReplayStep->SyncRandSeed) {
+	if (SyncRandSeed != step->SyncRandSeed) {
 #ifdef DEBUG
-		if (!ReplayStep->SyncRandSeed) {
+		if (!step->SyncRandSeed) {
 			// Replay without the 'sync info
 			ThisPlayer->Notify("%s", _("No sync info for this replay !"));
 		} else {
 			ThisPlayer->Notify(_("Replay got out of sync (%lu) !"), GameCycle);
-			DebugPrint("OUT OF SYNC %u != %u\n" _C_ SyncRandSeed _C_ ReplayStep->SyncRandSeed);
+			DebugPrint("OUT OF SYNC %u != %u\n" _C_ SyncRandSeed _C_ step->SyncRandSeed);
 			DebugPrint("OUT OF SYNC GameCycle %lu \n" _C_ GameCycle);
 			Assert(0);
-			// ReplayStep = 0;
+			// ReplayStep = CurrentReplay->Commands.size();
 			// NextLogCycle = ~0UL;
 			// return;
 		}
 #else
 		ThisPlayer->Notify("%s", _("Replay got out of sync !"));
-		ReplayStep = 0;
+		ReplayStep = CurrentReplay->Commands.size();
 		NextLogCycle = ~0UL;
 		return;
 #endif
 	}
 
-	if (!strcmp(action, "stop")) {
-		SendCommandStopUnit(*unit);
-	} else if (!strcmp(action, "stand-ground")) {
-		SendCommandStandGround(*unit, flags);
-	} else if (!strcmp(action, "defend")) {
-		SendCommandDefend(*unit, *dunit, flags);
-	} else if (!strcmp(action, "follow")) {
-		SendCommandFollow(*unit, *dunit, flags);
-	} else if (!strcmp(action, "move")) {
-		SendCommandMove(*unit, pos, flags);
-	} else if (!strcmp(action, "repair")) {
-		SendCommandRepair(*unit, pos, dunit, flags);
-	} else if (!strcmp(action, "auto-repair")) {
-		SendCommandAutoRepair(*unit, arg1);
-	} else if (!strcmp(action, "attack")) {
-		SendCommandAttack(*unit, pos, dunit, flags);
-	} else if (!strcmp(action, "attack-ground")) {
-		SendCommandAttackGround(*unit, pos, flags);
-	} else if (!strcmp(action, "patrol")) {
-		SendCommandPatrol(*unit, pos, flags);
-	} else if (!strcmp(action, "board")) {
-		SendCommandBoard(*unit, *dunit, flags);
-	} else if (!strcmp(action, "unload")) {
-		SendCommandUnload(*unit, pos, dunit, flags);
-	} else if (!strcmp(action, "build")) {
-		SendCommandBuildBuilding(*unit, pos, *UnitTypeByIdent(val), flags);
-	} else if (!strcmp(action, "dismiss")) {
-		SendCommandDismiss(*unit);
-	} else if (!strcmp(action, "resource-loc")) {
-		SendCommandResourceLoc(*unit, pos, flags);
-	} else if (!strcmp(action, "resource")) {
-		SendCommandResource(*unit, *dunit, flags);
-	} else if (!strcmp(action, "return")) {
-		SendCommandReturnGoods(*unit, dunit, flags);
-	} else if (!strcmp(action, "train")) {
-		SendCommandTrainUnit(*unit, *UnitTypeByIdent(val), flags);
-	} else if (!strcmp(action, "cancel-train")) {
-		SendCommandCancelTraining(*unit, num, (val && *val) ? UnitTypeByIdent(val) : NULL);
-	} else if (!strcmp(action, "upgrade-to")) {
-		SendCommandUpgradeTo(*unit, *UnitTypeByIdent(val), flags);
-	} else if (!strcmp(action, "cancel-upgrade-to")) {
-		SendCommandCancelUpgradeTo(*unit);
-	} else if (!strcmp(action, "research")) {
-		SendCommandResearch(*unit, *CUpgrade::Get(val), flags);
-	} else if (!strcmp(action, "cancel-research")) {
-		SendCommandCancelResearch(*unit);
-	} else if (!strcmp(action, "spell-cast")) {
-		SendCommandSpellCast(*unit, pos, dunit, num, flags);
-	} else if (!strcmp(action, "auto-spell-cast")) {
-		SendCommandAutoSpellCast(*unit, num, arg1);
-	} else if (!strcmp(action, "diplomacy")) {
-		int state;
-		if (!strcmp(val, "neutral")) {
-			state = DiplomacyNeutral;
-		} else if (!strcmp(val, "allied")) {
-			state = DiplomacyAllied;
-		} else if (!strcmp(val, "enemy")) {
-			state = DiplomacyEnemy;
-		} else if (!strcmp(val, "crazy")) {
-			state = DiplomacyCrazy;
-		} else {
-			DebugPrint("Invalid diplomacy command: %s" _C_ val);
-			state = -1;
+	switch (step->Action) {
+		case ReplayActionStop:
+			SendCommandStopUnit(*unit);
+			break;
+		case ReplayActionStandGround:
+			SendCommandStandGround(*unit, flags);
+			break;
+		case ReplayActionDefend:
+			SendCommandDefend(*unit, *dunit, flags);
+			break;
+		case ReplayActionFollow:
+			SendCommandFollow(*unit, *dunit, flags);
+			break;
+		case ReplayActionMove:
+			SendCommandMove(*unit, pos, flags);
+			break;
+		case ReplayActionRepair:
+			SendCommandRepair(*unit, pos, dunit, flags);
+			break;
+		case ReplayActionAutoRepair:
+			SendCommandAutoRepair(*unit, arg1);
+			break;
+		case ReplayActionAttack:
+			SendCommandAttack(*unit, pos, dunit, flags);
+			break;
+		case ReplayActionAttackGround:
+			SendCommandAttackGround(*unit, pos, flags);
+			break;
+		case ReplayActionPatrol:
+			SendCommandPatrol(*unit, pos, flags);
+			break;
+		case ReplayActionBoard:
+			SendCommandBoard(*unit, *dunit, flags);
+			break;
+		case ReplayActionUnload:
+			SendCommandUnload(*unit, pos, dunit, flags);
+			break;
+		case ReplayActionBuild:
+			SendCommandBuildBuilding(*unit, pos, *UnitTypeByIdent(val), flags);
+			break;
+		case ReplayActionDismiss:
+			SendCommandDismiss(*unit);
+			break;
+		case ReplayActionResourceLoc:
+			SendCommandResourceLoc(*unit, pos, flags);
+			break;
+		case ReplayActionResource:
+			SendCommandResource(*unit, *dunit, flags);
+			break;
+		case ReplayActionReturn:
+			SendCommandReturnGoods(*unit, dunit, flags);
+			break;
+		case ReplayActionTrain:
+			SendCommandTrainUnit(*unit, *UnitTypeByIdent(val), flags);
+			break;
+		case ReplayActionCancelTrain:
+			SendCommandCancelTraining(*unit, num, (val && *val) ? UnitTypeByIdent(val) : NULL);
+			break;
+		case ReplayActionUpgradeTo:
+			SendCommandUpgradeTo(*unit, *UnitTypeByIdent(val), flags);
+			break;
+		case ReplayActionCancelUpgradeTo:
+			SendCommandCancelUpgradeTo(*unit);
+			break;
+		case ReplayActionResearch:
+			SendCommandResearch(*unit, *CUpgrade::Get(val), flags);
+			break;
+		case ReplayActionCancelResearch:
+			SendCommandCancelResearch(*unit);
+			break;
+		case ReplayActionSpellCast:
+			SendCommandSpellCast(*unit, pos, dunit, num, flags);
+			break;
+		case ReplayActionAutoSpellCast:
+			SendCommandAutoSpellCast(*unit, num, arg1);
+			break;
+		case ReplayActionDiplomacy: {
+			int state;
+			if (!strcmp(val, "neutral")) {
+				state = DiplomacyNeutral;
+			} else if (!strcmp(val, "allied")) {
+				state = DiplomacyAllied;
+			} else if (!strcmp(val, "enemy")) {
+				state = DiplomacyEnemy;
+			} else if (!strcmp(val, "crazy")) {
+				state = DiplomacyCrazy;
+			} else {
+				DebugPrint("Invalid diplomacy command: %s" _C_ val);
+				state = -1;
+			}
+			SendCommandDiplomacy(arg1, state, arg2);
+			break;
 		}
-		SendCommandDiplomacy(arg1, state, arg2);
-	} else if (!strcmp(action, "shared-vision")) {
-		bool state;
-		state = atoi(val) ? true : false;
-		SendCommandSharedVision(arg1, state, arg2);
-	} else if (!strcmp(action, "input")) {
-		if (val[0] == '-') {
-			CclCommand(val + 1, false);
-		} else {
-			HandleCheats(val);
+		case ReplayActionSharedVision: {
+			bool state;
+			state = atoi(val) ? true : false;
+			SendCommandSharedVision(arg1, state, arg2);
+			break;
 		}
-	} else if (!strcmp(action, "chat")) {
-		SetMessage("%s", val);
-		PlayGameSound(GameSounds.ChatMessage.Sound, MaxSampleVolume);
-	} else if (!strcmp(action, "quit")) {
-		CommandQuit(arg1);
-	} else {
-		DebugPrint("Invalid action: %s" _C_ action);
+		case ReplayActionInput:
+			if (val[0] == '-') {
+				CclCommand(val + 1, false);
+			} else {
+				HandleCheats(val);
+			}
+			break;
+		case ReplayActionChat:
+			SetMessage("%s", val);
+			PlayGameSound(GameSounds.ChatMessage.Sound, MaxSampleVolume);
+			break;
+		case ReplayActionQuit:
+			CommandQuit(arg1);
+			break;
+		default:
+			DebugPrint("Invalid action: %d" _C_ step->Action);
+			break;
 	}
 
-	ReplayStep = ReplayStep->Next;
-	NextLogCycle = ReplayStep ? (unsigned)ReplayStep->GameCycle : ~0UL;
+	++ReplayStep;
+	step = GetReplayStep();
+	NextLogCycle = step ? step->GameCycle : ~0UL;
 }
 
 /**
@@ -906,12 +1430,17 @@ static void ReplayEachCycle()
 				Players[i].SetName(CurrentReplay->Players[i].Name);
 			}
 		}
-		ReplayStep = CurrentReplay->Commands;
-		NextLogCycle = (ReplayStep ? (unsigned)ReplayStep->GameCycle : ~0UL);
+		// After a keyframe, its commands are already done.
+		ReplayStep = ReplayStartStep;
+		NextLogCycle = (GetReplayStep() ? GetReplayStep()->GameCycle : ~0UL);
+		if (ReplaySeekCycle) {
+			FastForwardCycle = ReplaySeekCycle;
+			ReplaySeekCycle = 0;
+		}
 		InitReplay = 0;
 	}
 
-	if (!ReplayStep) {
+	if (!GetReplayStep()) {
 		SetMessage("%s", _("End of replay"));
 		GameObserve = false;
 		return;
@@ -923,9 +1452,9 @@ static void ReplayEachCycle()
 
 	do {
 		DoNextReplay();
-	} while (ReplayStep && (NextLogCycle == ~0UL || NextLogCycle == GameCycle));
+	} while (GetReplayStep() && (NextLogCycle == ~0UL || NextLogCycle == GameCycle));
 
-	if (!ReplayStep) {
+	if (!GetReplayStep()) {
 		SetMessage("%s", _("End of replay"));
 		GameObserve = false;
 	}
@@ -1008,6 +1537,58 @@ int SaveReplay(const std::string &filename)
 	return 0;
 }
 
+/**
+**  Start the game from a keyframe of the replay.
+**
+**  @param index  Keyframe of CurrentReplay.
+**
+**  @return       0 for success, -1 for failure
+*/
+static int StartReplayKeyframe(int index)
+{
+	const ReplayKeyframe &keyframe = CurrentReplay->Keyframes[index];
+	std::string data;
+
+	if (keyframe.Compressed) {
+#ifdef USE_ZLIB
+		uLongf size = keyframe.Size;
+
+		data.resize(size);
+		if (size == 0 || uncompress((Bytef *)&data[0], &size, (const Bytef *)keyframe.Data.data(),
+									keyframe.Data.size()) != Z_OK || size != keyframe.Size) {
+			fprintf(stderr, "Corrupted replay keyframe\n");
+			return -1;
+		}
+#else
+		fprintf(stderr, "Compressed replay keyframes need zlib\n");
+		return -1;
+#endif
+	} else {
+		data = keyframe.Data;
+	}
+
+	const std::string path = GetReplayLogDir() + "/keyframe.tmp";
+	FILE *fd = fopen(path.c_str(), "wb");
+	if (!fd) {
+		fprintf(stderr, "Can't write the replay keyframe to `%s'\n", path.c_str());
+		return -1;
+	}
+	const size_t size = fwrite(data.data(), 1, data.size(), fd);
+	fclose(fd);
+	if (size != data.size()) {
+		unlink(path.c_str());
+		return -1;
+	}
+
+	ReplayStartStep = keyframe.Commands;
+	SaveGameLoading = true;
+	LoadGame(path);
+	unlink(path.c_str());
+
+	StartMap(path, false);
+	return 0;
+}
+
 void StartReplay(const std::string &filename, bool reveal)
 {
 	std::string replay;
@@ -1019,6 +1600,53 @@ void StartReplay(const std::string &filename, bool reveal)
 	ReplayRevealMap = reveal;
 
 	StartMap(CurrentMapPath, false);
+
+	// The game stopped to seek: restart it from the keyframe.
+	while (ReplaySeekPending) {
+		ReplaySeekPending = false;
+
+		CleanPlayers();
+		LoadReplay(replay);
+
+		ReplayRevealMap = reveal;
+
+		if (ReplaySeekKeyframe == -1 || StartReplayKeyframe(ReplaySeekKeyframe) == -1) {
+			StartMap(CurrentMapPath, false);
+		}
+	}
+}
+
+/**
+**  Seek to a game cycle of the replay.
+**
+**  Forward, the game is simulated up to the cycle. Backward, or when
+**  a keyframe is nearer, the game stops and restarts from the last
+**  keyframe before the cycle, or from the start of the replay.
+**
+**  @param cycle  Game cycle to reach.
+*/
+void SeekReplay(unsigned long cycle)
+{
+	if (ReplayGameType == ReplayNone || !CurrentReplay) {
+		return;
+	}
+	int keyframe = -1;
+	for (size_t i = 0; i != CurrentReplay->Keyframes.size(); ++i) {
+		if (CurrentReplay->Keyframes[i].GameCycle > cycle) {
+			break;
+		}
+		keyframe = i;
+	}
+	const unsigned long start = keyframe == -1 ? 0 : CurrentReplay->Keyframes[keyframe].GameCycle;
+
+	if (cycle >= GameCycle && start <= GameCycle) {
+		FastForwardCycle = cycle;
+		return;
+	}
+	ReplaySeekPending = true;
+	ReplaySeekKeyframe = keyframe;
+	ReplaySeekCycle = cycle;
+	StopGame(GameNoResult);
 }
 
 /**
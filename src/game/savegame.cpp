@@ -44,8 +44,10 @@
 #include "map.h"
 #include "missile.h"
 #include "parameters.h"
+#include "pathfinder.h"
 #include "player.h"
 #include "replay.h"
+#include "snapshot.h"
 #include "spells.h"
 #include "trigger.h"
 #include "ui.h"
@@ -64,6 +66,8 @@ extern void StartMap(const std::string &filename, bool clean);
 --  Variables
 ----------------------------------------------------------------------------*/
 
+bool SaveGameAsLua = false;  /// Save the games as Lua scripts, not as snapshots
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
@@ -101,25 +105,14 @@ static std::string GetSaveDir()
 }
 
 /**
-**  Save a game to file.
-**
-**  @param filename  File name to be stored.
-**  @return  -1 if saving failed, 0 if all OK
+**  Save the header of a saved game: the map without its units, the
+**  information of the saved game and the game cycle.
 **
-**  @note  Later we want to store in a more compact binary format.
+**  @param file      File to save to.
+**  @param filename  File name of the saved game.
 */
-int SaveGame(const std::string &filename)
+static void SaveGameHeader(CFile &file, const std::string &filename)
 {
-	CFile file;
-	std::string fullpath(GetSaveDir());
-
-	fullpath += "/";
-	fullpath += filename;
-	if (file.open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
-		fprintf(stderr, "Can't save to `%s'\n", filename.c_str());
-		return -1;
-	}
-
 	time_t now;
 	char dateStr[64];
 
@@ -160,7 +153,38 @@ int SaveGame(const std::string &filename)
 	file.printf("GameCycle = %lu\n", GameCycle);
 
 	file.printf("SetGodMode(%s)\n", GodMode ? "true" : "false");
+}
 
+/**
+**  Save the settings and the Lua state, the end of a saved game.
+**
+**  @param file    File to save to.
+**  @param replay  Save the replay log too.
+*/
+static void SaveGameSettingsAndGlobals(CFile &file, bool replay)
+{
+	if (replay) {
+		SaveReplayList(file);
+	}
+	SaveGameSettings(file);
+	// FIXME: find all state information which must be saved.
+	const std::string s = SaveGlobal(Lua);
+	if (!s.empty()) {
+		file.printf("-- Lua state\n\n %s\n", s.c_str());
+	}
+	SaveTriggers(file); //Triggers are saved in SaveGlobal, so load it after Global
+}
+
+/**
+**  Save the state of the game.
+**
+**  @param file      File to save to.
+**  @param filename  File name of the saved game.
+**  @param replay    Save the replay log too.
+*/
+void SaveGameState(CFile &file, const std::string &filename, bool replay)
+{
+	SaveGameHeader(file, filename);
 	SaveUnitTypes(file);
 	SaveUpgrades(file);
 	SavePlayers(file);
@@ -171,16 +195,106 @@ int SaveGame(const std::string &filename)
 	SaveSelections(file);
 	SaveGroups(file);
 	SaveMissiles(file);
-	SaveReplayList(file);
-	SaveGameSettings(file);
-	// FIXME: find all state information which must be saved.
-	const std::string s = SaveGlobal(Lua);
-	if (!s.empty()) {
-		file.printf("-- Lua state\n\n %s\n", s.c_str());
+	SavePathfinder(file);
+	SaveGameSettingsAndGlobals(file, replay);
+}
+
+/**
+**  Save the state of the game as a snapshot.
+**
+**  Players, map, units, missiles and the paths and flow fields kept by
+**  the pathfinder are saved in binary sections. What is only known to
+**  Lua (unit types, upgrades, user interface, AI, triggers and the Lua
+**  globals) is saved in Lua sections, run in the order of the file by
+**  LoadGame.
+**
+**  @param file      File to save to.
+**  @param filename  File name of the saved game.
+**  @param replay    Save the replay log too.
+**
+**  @return  -1 if saving failed, 0 if all OK
+*/
+int SaveGameSnapshot(CFile &file, const std::string &filename, bool replay)
+{
+	CSnapshotWriter snapshot;
+	std::string script;
+	CFile scriptFile;
+
+	scriptFile.open(script);
+	SaveGameHeader(scriptFile, filename);
+	scriptFile.printf("LoadTileModels(\"%s\")\n", Map.TileModelsFileName.c_str());
+	SaveUnitTypes(scriptFile);
+	SaveUpgrades(scriptFile);
+	scriptFile.close();
+	snapshot.BeginSection(SnapshotSectionLua);
+	snapshot.Bytes(script.data(), script.size());
+	snapshot.EndSection();
+
+	snapshot.BeginSection(SnapshotSectionPlayers);
+	SavePlayers(snapshot);
+	snapshot.EndSection();
+	snapshot.BeginSection(SnapshotSectionMap);
+	Map.Save(snapshot);
+	snapshot.EndSection();
+	snapshot.BeginSection(SnapshotSectionUnits);
+	UnitManager.Save(snapshot);
+	snapshot.EndSection();
+	snapshot.BeginSection(SnapshotSectionUnitBuckets);
+	Map.UnitBuckets.Save(snapshot);
+	snapshot.EndSection();
+	snapshot.BeginSection(SnapshotSectionMissiles);
+	SaveMissiles(snapshot);
+	snapshot.EndSection();
+	snapshot.BeginSection(SnapshotSectionPathfinder);
+	SavePathfinder(snapshot);
+	snapshot.EndSection();
+
+	script.clear();
+	scriptFile.open(script);
+	SaveUserInterface(scriptFile);
+	SaveAi(scriptFile);
+	SaveSelections(scriptFile);
+	SaveGroups(scriptFile);
+	SaveGameSettingsAndGlobals(scriptFile, replay);
+	scriptFile.close();
+	snapshot.BeginSection(SnapshotSectionLua);
+	snapshot.Bytes(script.data(), script.size());
+	snapshot.EndSection();
+
+	return snapshot.Write(file);
+}
+
+/**
+**  Save a game to file.
+**
+**  @param filename  File name to be stored.
+**  @return  -1 if saving failed, 0 if all OK
+**
+**  @note  The game is saved as a snapshot, or as a Lua script
+**         if SaveGameAsLua is set.
+*/
+int SaveGame(const std::string &filename)
+{
+	CFile file;
+	std::string fullpath(GetSaveDir());
+
+	fullpath += "/";
+	fullpath += filename;
+	if (file.open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
+		fprintf(stderr, "Can't save to `%s'\n", filename.c_str());
+		return -1;
+	}
+	int ret = 0;
+	if (SaveGameAsLua) {
+		SaveGameState(file, filename, true);
+	} else {
+		ret = SaveGameSnapshot(file, filename, true);
 	}
-	SaveTriggers(file); //Triggers are saved in SaveGlobal, so load it after Global
 	file.close();
-	return 0;
+	if (ret == -1) {
+		fprintf(stderr, "Can't save to `%s'\n", filename.c_str());
+	}
+	return ret;
 }
 
 /**
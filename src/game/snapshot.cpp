@@ -0,0 +1,308 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name snapshot.cpp - The binary saved games. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "snapshot.h"
+
+#include "iolib.h"
+#include "unit.h"
+#include "unit_manager.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/// First bytes of a snapshot
+static const char SnapshotMagic[8] = { 'S', 't', 'r', 'a', 'S', 'a', 'v', '\032' };
+/// Version of the snapshot format
+static const unsigned long SnapshotVersion = 2;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+void CBinaryWriter::Varint(unsigned long value)
+{
+	while (value >= 0x80) {
+		Data += (char)(value | 0x80);
+		value >>= 7;
+	}
+	Data += (char)value;
+}
+
+/**
+**  Write the 32 low bits of value, least significant byte first.
+*/
+void CBinaryWriter::Fixed32(unsigned long value)
+{
+	for (int i = 0; i != 4; ++i) {
+		Data += (char)(value >> (8 * i));
+	}
+}
+
+void CBinaryWriter::String(const std::string &value)
+{
+	Varint(value.size());
+	Data += value;
+}
+
+/**
+**  Write the output to the file in one go.
+**
+**  @return  0 if all OK, -1 if writing failed.
+*/
+int CBinaryWriter::Write(CFile &file) const
+{
+	return file.write(Data.data(), Data.size()) > 0 ? 0 : -1;
+}
+
+unsigned long CBinaryReader::Varint()
+{
+	unsigned long value = 0;
+
+	for (int shift = 0; Cur != Limit && shift < (int)sizeof(value) * 8; shift += 7) {
+		const unsigned char c = *Cur++;
+
+		value |= (unsigned long)(c & 0x7F) << shift;
+		if (!(c & 0x80)) {
+			return value;
+		}
+	}
+	Corrupted = true;
+	return 0;
+}
+
+int CBinaryReader::Int()
+{
+	const unsigned long u = Varint();
+
+	return (int)((long)(u >> 1) ^ -(long)(u & 1));
+}
+
+bool CBinaryReader::Bool()
+{
+	if (Cur == Limit) {
+		Corrupted = true;
+		return false;
+	}
+	return *Cur++ != 0;
+}
+
+Vec2i CBinaryReader::Pos()
+{
+	Vec2i pos;
+
+	pos.x = Int();
+	pos.y = Int();
+	return pos;
+}
+
+unsigned long CBinaryReader::Fixed32()
+{
+	unsigned char bytes[4];
+	unsigned long value = 0;
+
+	Bytes(bytes, sizeof(bytes));
+	for (int i = 0; i != 4; ++i) {
+		value |= (unsigned long)bytes[i] << (8 * i);
+	}
+	return value;
+}
+
+std::string CBinaryReader::String()
+{
+	const unsigned long size = Varint();
+
+	if (size > (unsigned long)(Limit - Cur)) {
+		Corrupted = true;
+		return std::string();
+	}
+	Cur += size;
+	return std::string(Cur - size, size);
+}
+
+void CBinaryReader::Bytes(void *data, size_t size)
+{
+	if (size > (size_t)(Limit - Cur)) {
+		Corrupted = true;
+		memset(data, 0, size);
+		return;
+	}
+	memcpy(data, Cur, size);
+	Cur += size;
+}
+
+CSnapshotWriter::CSnapshotWriter() : SectionStart(0)
+{
+	Data.append(SnapshotMagic, sizeof(SnapshotMagic));
+	Varint(SnapshotVersion);
+}
+
+/**
+**  Write a unit reference: its slot plus one, 0 for no unit.
+*/
+void CSnapshotWriter::Unit(const CUnit *unit)
+{
+	Varint(unit ? UnitNumber(*unit) + 1 : 0);
+}
+
+/**
+**  Start a section, its size is written by EndSection.
+*/
+void CSnapshotWriter::BeginSection(SnapshotSection section)
+{
+	Varint(section);
+	SectionStart = Data.size();
+	Data.append(4, '\0');
+}
+
+void CSnapshotWriter::EndSection()
+{
+	const size_t size = Data.size() - SectionStart - 4;
+
+	for (int i = 0; i != 4; ++i) {
+		Data[SectionStart + i] = (char)(size >> (8 * i));
+	}
+}
+
+/**
+**  Start reading a snapshot, a snapshot of another version is corrupted.
+*/
+CSnapshotReader::CSnapshotReader(const char *data, size_t size) :
+	CBinaryReader(data, size), End(data + size)
+{
+	if (size < sizeof(SnapshotMagic) || memcmp(data, SnapshotMagic, sizeof(SnapshotMagic))) {
+		Corrupted = true;
+		return;
+	}
+	Cur += sizeof(SnapshotMagic);
+	if (Varint() != SnapshotVersion) {
+		fprintf(stderr, "Unsupported version of the saved game\n");
+		Corrupted = true;
+	}
+	// No section is read yet.
+	Limit = Cur;
+}
+
+/**
+**  Read a unit reference.
+**
+**  @return  The unit of the slot, NULL for no unit.
+*/
+CUnit *CSnapshotReader::Unit()
+{
+	const unsigned long slot = Varint();
+
+	if (slot == 0) {
+		return NULL;
+	}
+	if (slot > UnitManager.GetUsedSlotCount()) {
+		Corrupted = true;
+		return NULL;
+	}
+	return &UnitManager.GetSlotUnit(slot - 1);
+}
+
+/**
+**  Go to the next section, skipping what is left of the current one.
+**
+**  @param section  OUT: tag of the section.
+**
+**  @return  false at the end of the snapshot, or if it is corrupted.
+*/
+bool CSnapshotReader::NextSection(int &section)
+{
+	Cur = Limit;
+	Limit = End;
+	if (Corrupted || Cur == End) {
+		return false;
+	}
+	section = Varint();
+	unsigned char size[4];
+	Bytes(size, sizeof(size));
+	const size_t length = size[0] | (size[1] << 8) | (size[2] << 16) | ((size_t)size[3] << 24);
+	if (Corrupted || length > (size_t)(End - Cur)) {
+		Corrupted = true;
+		return false;
+	}
+	Limit = Cur + length;
+	return true;
+}
+
+/**
+**  Read what is left of the current section.
+*/
+std::string CSnapshotReader::SectionData()
+{
+	const std::string data(Cur, Limit - Cur);
+
+	Cur = Limit;
+	return data;
+}
+
+/**
+**  Read a snapshot file.
+**
+**  @param filename  File name of the saved game.
+**  @param data      OUT: content of the file.
+**
+**  @return  0 if all OK, -1 if the file can't be read or isn't a snapshot.
+*/
+int ReadSnapshotFile(const std::string &filename, std::string &data)
+{
+	CFile file;
+
+	if (file.open(filename.c_str(), CL_OPEN_READ) == -1) {
+		return -1;
+	}
+	char buf[4096];
+	int size = file.read(buf, sizeof(SnapshotMagic));
+
+	data.clear();
+	if (size != sizeof(SnapshotMagic) || memcmp(buf, SnapshotMagic, sizeof(SnapshotMagic))) {
+		file.close();
+		return -1;
+	}
+	data.append(buf, size);
+	while ((size = file.read(buf, sizeof(buf))) > 0) {
+		data.append(buf, size);
+	}
+	file.close();
+	return 0;
+}
+
+//@}
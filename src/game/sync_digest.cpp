@@ -0,0 +1,205 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name sync_digest.cpp - The sync digest. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "sync_digest.h"
+
+#include "actions.h"
+#include "map.h"
+#include "missile.h"
+#include "player.h"
+#include "tileset.h"
+#include "unit.h"
+#include "unit_manager.h"
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+unsigned int SyncDigest[SyncDigestPartMax];  /// Digest of each part
+
+/// Name of each part, for the out of sync messages
+const char *const SyncDigestPartNames[SyncDigestPartMax] = {
+	"units", "players", "map", "missiles"
+};
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Add a value to a hash.
+*/
+static inline unsigned int SyncDigestMix(unsigned int hash, unsigned int value)
+{
+	hash ^= value * 0xCC9E2D51;
+	hash = (hash << 13) | (hash >> 19);
+	return hash * 5 + 0xE6546B64;
+}
+
+/**
+**  Spread the bits of a hash, as the hashes of a part are summed.
+*/
+static inline unsigned int SyncDigestFinish(unsigned int hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35;
+	return hash ^ (hash >> 16);
+}
+
+/**
+**  Replace the value an object adds to the digest of its part.
+**
+**  @param part    Part of the object.
+**  @param cached  IN: value added so far, OUT: value.
+**  @param value   New value of the object.
+*/
+static inline void SyncDigestChange(SyncDigestPart part, unsigned int &cached, unsigned int value)
+{
+	SyncDigest[part] += value - cached;
+	cached = value;
+}
+
+static inline unsigned int SyncDigestPos(int x, int y)
+{
+	return (x & 0xFFFF) | (y << 16);
+}
+
+void UpdateSyncDigest(CUnit &unit)
+{
+	unsigned int value = 0;
+
+	if (!unit.Destroyed && unit.Type) {
+		unsigned int hash = UnitNumber(unit);
+
+		hash = SyncDigestMix(hash, unit.Player->Index);
+		hash = SyncDigestMix(hash, SyncDigestPos(unit.tilePos.x, unit.tilePos.y));
+		hash = SyncDigestMix(hash, SyncDigestPos(unit.IX, unit.IY));
+		hash = SyncDigestMix(hash, unit.Variable[HP_INDEX].Value);
+		hash = SyncDigestMix(hash, unit.ResourcesHeld);
+		hash = SyncDigestMix(hash, unit.Orders.size());
+		if (!unit.Orders.empty()) {
+			const COrder &order = *unit.CurrentOrder();
+			const Vec2i goalPos = order.GetGoalPos();
+
+			hash = SyncDigestMix(hash, unit.CurrentAction());
+			hash = SyncDigestMix(hash, SyncDigestPos(goalPos.x, goalPos.y));
+		}
+		value = SyncDigestFinish(hash);
+	}
+	SyncDigestChange(SyncDigestUnits, unit.SyncValue, value);
+}
+
+void UpdateSyncDigest(CPlayer &player)
+{
+	unsigned int hash = player.Index;
+
+	for (int i = 0; i != MaxCosts; ++i) {
+		hash = SyncDigestMix(hash, player.Resources[i]);
+		hash = SyncDigestMix(hash, player.StoredResources[i]);
+	}
+	SyncDigestChange(SyncDigestPlayers, player.SyncValue, SyncDigestFinish(hash));
+}
+
+/**
+**  Update the digest with the terrain of a field: its tile, its value and
+**  its flags but the units on it, which are in the digest of the units.
+*/
+void UpdateSyncDigest(CMapField &mf)
+{
+	const unsigned int unitFlags = MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit | MapFieldBuilding;
+	unsigned int hash = mf.playerInfo.Index;
+
+	hash = SyncDigestMix(hash, mf.getGraphicTile());
+	hash = SyncDigestMix(hash, mf.Value);
+	hash = SyncDigestMix(hash, mf.getFlag() & ~unitFlags);
+	SyncDigestChange(SyncDigestMap, mf.SyncValue, SyncDigestFinish(hash));
+}
+
+/**
+**  Update the digest with a missile. The local missiles are only on this
+**  computer, they aren't in the digest.
+*/
+void UpdateSyncDigest(Missile &missile)
+{
+	if (missile.Local) {
+		return;
+	}
+	unsigned int hash = SyncDigestPos(missile.position.x, missile.position.y);
+
+	hash = SyncDigestMix(hash, SyncDigestPos(missile.destination.x, missile.destination.y));
+	hash = SyncDigestMix(hash, missile.Damage);
+	hash = SyncDigestMix(hash, missile.TTL);
+	hash = SyncDigestMix(hash, missile.CurrentStep);
+	SyncDigestChange(SyncDigestMissiles, missile.SyncValue, SyncDigestFinish(hash));
+}
+
+void RemoveSyncDigest(Missile &missile)
+{
+	SyncDigestChange(SyncDigestMissiles, missile.SyncValue, 0);
+}
+
+/**
+**  Compute the digests of the whole game.
+**
+**  Called when the game starts, once the map, units and players are
+**  made or loaded: the game then updates the digests as it changes.
+*/
+void InitSyncDigest()
+{
+	for (int i = 0; i != SyncDigestPartMax; ++i) {
+		SyncDigest[i] = 0;
+	}
+	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
+		(*it)->SyncValue = 0;
+		UpdateSyncDigest(**it);
+	}
+	for (int i = 0; i != PlayerMax; ++i) {
+		Players[i].SyncValue = 0;
+		UpdateSyncDigest(Players[i]);
+	}
+	if (Map.Fields) {
+		const unsigned int size = Map.Info.MapWidth * Map.Info.MapHeight;
+
+		for (unsigned int i = 0; i != size; ++i) {
+			Map.Fields[i].SyncValue = 0;
+			UpdateSyncDigest(Map.Fields[i]);
+		}
+	}
+	InitMissilesSyncDigest();
+}
+
+//@}
@@ -49,6 +49,8 @@ public:
 
 	virtual void Save(CFile &file, const CUnit &unit) const;
 	virtual bool ParseSpecificData(lua_State *l, int &j, const char *value, const CUnit &unit);
+	virtual void Save(CSnapshotWriter &snapshot, const CUnit &unit) const;
+	virtual void Load(CSnapshotReader &snapshot, const CUnit &unit);
 
 	virtual void Execute(CUnit &unit);
 	virtual PixelPos Show(const CViewport &vp, const PixelPos &lastScreenPos) const;
@@ -79,6 +79,8 @@ enum UnitAction {
 class CAnimation;
 class CConstructionFrame;
 class CFile;
+class CSnapshotReader;
+class CSnapshotWriter;
 class CUnit;
 class CUnitType;
 class CUpgrade;
@@ -110,6 +112,11 @@ public:
 	bool ParseGenericData(lua_State *l, int &j, const char *value);
 	virtual bool ParseSpecificData(lua_State *l, int &j, const char *value, const CUnit &unit) = 0;
 
+	virtual void Save(CSnapshotWriter &snapshot, const CUnit &unit) const = 0;
+	void SaveGenericData(CSnapshotWriter &snapshot) const;
+	void LoadGenericData(CSnapshotReader &snapshot);
+	virtual void Load(CSnapshotReader &snapshot, const CUnit &unit) = 0;
+
 	virtual void UpdateUnitVariables(CUnit &unit) const {}
 	virtual void FillSeenValues(CUnit &unit) const;
 	virtual void AiUnitKilled(CUnit &unit);
@@ -189,6 +196,10 @@ extern void AnimateActionAttack(CUnit &unit, COrder &order);
 
 /// Parse order
 extern void CclParseOrder(lua_State *l, CUnit &unit, COrderPtr *order);
+/// Save an order, or no order, to a snapshot
+extern void SaveOrder(const COrder *order, const CUnit &unit, CSnapshotWriter &snapshot);
+/// Load an order, or no order, from a snapshot
+extern COrder *LoadOrder(CSnapshotReader &snapshot, CUnit &unit);
 
 /// Handle the actions of all units each game cycle
 extern void UnitActions();
@@ -39,6 +39,8 @@
 #define ANIMATIONS_DEATHTYPES 40
 
 class CFile;
+class CSnapshotReader;
+class CSnapshotWriter;
 class CUnit;
 struct lua_State;
 
@@ -90,6 +92,52 @@ enum SetVar_ModifyTypes {
 	modNot,          /// Bitwise NOT
 };
 
+/**
+**  Integer operand of an animation.
+**
+**  The operand is parsed when the animation is defined, running the
+**  animation only reads the value. Spells, player data and the names
+**  not known yet are kept as text, parsed by ParseAnimInt each time.
+*/
+class CAnimOperand
+{
+public:
+	CAnimOperand() : Kind(OperandConstant), Goal(false), Index(0), Component(ComponentValue), Value(0), Max(0) {}
+
+	void Init(const std::string &s);
+	int Eval(const CUnit &unit) const;
+
+	const std::string &GetText() const { return Text; }
+
+private:
+	enum OperandKind {
+		OperandConstant,        /// Value
+		OperandVariable,        /// Component of the variable Index
+		OperandBoolFlag,        /// Bool flag Index of the unit type
+		OperandResourcesHeld,   /// Resources held
+		OperandResourceActive,  /// Active resource
+		OperandDistance,        /// Distance from the unit to its goal
+		OperandRandom,          /// Random number from Value to Max
+		OperandPlayer,          /// Player of the unit
+		OperandText             /// Parsed by ParseAnimInt
+	};
+	enum OperandComponent {
+		ComponentValue,         /// Value of the variable
+		ComponentMax,           /// Max of the variable
+		ComponentIncrease,      /// Increase of the variable
+		ComponentEnable,        /// Enable of the variable
+		ComponentPercent        /// Value in percent of Max
+	};
+
+	std::string Text;            /// Operand as defined
+	OperandKind Kind;            /// What the operand reads
+	bool Goal;                   /// Read the goal of the unit instead of the unit
+	int Index;                   /// Index of the variable or bool flag
+	OperandComponent Component;  /// Component of the variable
+	int Value;                   /// Constant or minimum of the random number
+	int Max;                     /// Maximum of the random number
+};
+
 class CAnimation
 {
 public:
@@ -135,6 +183,8 @@ public:
 
 	static void SaveUnitAnim(CFile &file, const CUnit &unit);
 	static void LoadUnitAnim(lua_State *l, CUnit &unit, int luaIndex);
+	static void SaveUnitAnim(CSnapshotWriter &snapshot, const CUnit &unit);
+	static void LoadUnitAnim(CSnapshotReader &snapshot, CUnit &unit);
 
 public:
 	CAnimation *Attack;
@@ -169,6 +219,7 @@ extern int UnitShowAnimation(CUnit &unit, const CAnimation *anim);
 
 extern int ParseAnimInt(const CUnit &unit, const char *parseint);
 extern int ParseAnimFlags(const CUnit &unit, const char *parseflag);
+extern int ParseAnimFlags(AnimationType type, const char *parseflag);
 
 extern void FindLabelLater(CAnimation **anim, const std::string &name);
 
@@ -45,7 +45,7 @@ public:
 
 	int ParseAnimInt(const CUnit *unit) const;
 private:
-	std::string frame;
+	CAnimOperand frame;
 };
 
 //@}
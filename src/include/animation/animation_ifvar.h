@@ -47,8 +47,8 @@ private:
 	typedef bool BinOpFunc(int lhs, int rhs);
 
 private:
-	std::string leftVar;
-	std::string rightVar;
+	CAnimOperand leftVar;
+	CAnimOperand rightVar;
 	BinOpFunc *binOpFunc;
 	CAnimation *gotoLabel;
 };
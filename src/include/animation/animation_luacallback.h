@@ -49,7 +49,7 @@ public:
 private:
 	LuaCallback *cb;
 	std::string cbName;
-	std::vector<std::string> cbArgs;
+	std::vector<CAnimOperand> cbArgs;
 };
 
 //@}
@@ -44,8 +44,8 @@ public:
 	virtual void Init(const char *s, lua_State *l);
 
 private:
-	std::string minWait;
-	std::string maxWait;
+	CAnimOperand minWait;
+	CAnimOperand maxWait;
 };
 
 //@}
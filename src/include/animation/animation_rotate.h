@@ -38,13 +38,14 @@
 class CAnimation_Rotate : public CAnimation
 {
 public:
-	CAnimation_Rotate() : CAnimation(AnimationRotate) {}
+	CAnimation_Rotate() : CAnimation(AnimationRotate), toTarget(false) {}
 
 	virtual void Action(CUnit &unit, int &move, int scale) const;
 	virtual void Init(const char *s, lua_State *l);
 
 private:
-	std::string rotateStr;
+	bool toTarget;
+	CAnimOperand rotate;
 };
 
 extern void UnitRotate(CUnit &unit, int rotate);
@@ -45,10 +45,10 @@ public:
 
 private:
 	SetVar_ModifyTypes mod;
-	std::string playerStr;
+	CAnimOperand player;
 	std::string varStr;
 	std::string argStr;
-	std::string valueStr;
+	CAnimOperand value;
 };
 
 extern int GetPlayerData(const int player, const char *prop, const char *arg);
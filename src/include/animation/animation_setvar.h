@@ -47,6 +47,7 @@ private:
 	SetVar_ModifyTypes mod;
 	std::string varStr;
 	std::string valueStr;
+	CAnimOperand value;
 	std::string unitSlotStr;
 };
 
@@ -45,18 +45,18 @@ enum SpawnUnit_Flags {
 class CAnimation_SpawnUnit : public CAnimation
 {
 public:
-	CAnimation_SpawnUnit() : CAnimation(AnimationSpawnUnit) {}
+	CAnimation_SpawnUnit() : CAnimation(AnimationSpawnUnit), flags(0) {}
 
 	virtual void Action(CUnit &unit, int &move, int scale) const;
 	virtual void Init(const char *s, lua_State *l);
 
 private:
 	std::string unitTypeStr;
-	std::string offXStr;
-	std::string offYStr;
-	std::string rangeStr;
-	std::string playerStr;
-	std::string flagsStr;
+	CAnimOperand offX;
+	CAnimOperand offY;
+	CAnimOperand range;
+	CAnimOperand player;
+	int flags;
 };
 
 //@}
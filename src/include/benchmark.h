@@ -0,0 +1,78 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name benchmark.h - The headless benchmark header file. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <string>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Parts of the game cycle timed by the benchmark.
+*/
+enum BenchmarkTimer {
+	BenchmarkOther,              /// Replay, network, timers, triggers, ...
+	BenchmarkUnitActions,        /// UnitActions
+	BenchmarkMissileActions,     /// MissileActions
+	BenchmarkPlayersEachCycle,   /// PlayersEachCycle, the AI of each cycle
+	BenchmarkPlayersEachSecond,  /// PlayersEachSecond, the AI of each second
+	BenchmarkTimerMax            /// Number of timers
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+extern unsigned long BenchmarkCycles;  /// Cycles of the headless benchmark, 0 if none
+extern std::string BenchmarkScenario;  /// Scenario played by the benchmark
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Run the benchmark on a map or a replay
+extern void BenchmarkMain(const std::string &filename);
+/// Set up the scenario of the benchmark
+extern void BenchmarkGameStarting();
+/// Charge the time spent since the last lap and start the given timer
+extern void BenchmarkLap(BenchmarkTimer timer);
+/// Stop the game once the cycles of the benchmark are done
+extern void BenchmarkEachCycle();
+/// Print the timings of the benchmark
+extern void BenchmarkReport();
+
+//@}
+
+#endif // !__BENCHMARK_H__
@@ -35,8 +35,11 @@ class CFile;
 
 extern void LoadGame(const std::string &filename); /// Load saved game
 extern int SaveGame(const std::string &filename); /// Save game
+extern void SaveGameState(CFile &file, const std::string &filename, bool replay); /// Save game state
+extern int SaveGameSnapshot(CFile &file, const std::string &filename, bool replay); /// Save game state as a snapshot
 extern void DeleteSaveGame(const std::string &filename); /// Delete save game
 extern bool SaveGameLoading;                 /// Save game is in progress of loading
+extern bool SaveGameAsLua;                   /// Save the games as Lua scripts
 
 extern void InitModules();              /// Initialize all modules
 extern void LuaRegisterModules();       /// Register lua script of each modules
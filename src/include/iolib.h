@@ -104,9 +104,11 @@ public:
 	~CFile();
 
 	int open(const char *name, long flags);
+	int open(std::string &buffer);
 	int close();
 	void flush();
 	int read(void *buf, size_t len);
+	int write(const void *buf, size_t len);
 	int seek(long offset, int whence);
 	long tell();
 
@@ -123,7 +125,8 @@ enum {
 	CLF_TYPE_INVALID,  /// invalid file handle
 	CLF_TYPE_PLAIN,    /// plain text file handle
 	CLF_TYPE_GZIP,     /// gzip file handle
-	CLF_TYPE_BZIP2     /// bzip2 file handle
+	CLF_TYPE_BZIP2,    /// bzip2 file handle
+	CLF_TYPE_BUFFER    /// memory buffer handle
 };
 
 #define CL_OPEN_READ 0x1
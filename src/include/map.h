@@ -52,6 +52,31 @@
 **    An array CMap::Info::Width * CMap::Info::Height of all fields
 **    belonging to this map.
 **
+**  CMap::Visible[]
+**
+**    For each player a plane of CMap::Info::Width * CMap::Info::Height
+**    counters, how many units of the player can see the field. 0 the
+**    field is not explored, 1 explored, n-1 unit see it. The planes
+**    are indexed like CMap::Fields, so a sight row is one contiguous
+**    span of counters.
+**
+**  CMap::VisCloak[]
+**
+**    Per player planes of the cloak detection counters.
+**
+**  CMap::Radar[]
+**
+**    Per player planes of the radar vision counters.
+**
+**  CMap::RadarJammer[]
+**
+**    Per player planes of the radar jamming counters.
+**
+**  CMap::UnitBuckets
+**
+**    Coarse grid of the units on the map, for range queries.
+**    See ::CUnitBucketGrid.
+**
 **  CMap::NoFogOfWar
 **
 **    Flag if true, the fog of war is disabled.
@@ -83,6 +108,7 @@
 ----------------------------------------------------------------------------*/
 
 #include <string>
+#include <vector>
 
 #ifndef __MAP_TILE_H__
 #include "tile.h"
@@ -98,6 +124,8 @@
 class CGraphic;
 class CPlayer;
 class CFile;
+class CSnapshotReader;
+class CSnapshotWriter;
 class CTileset;
 class CUnit;
 class CUnitType;
@@ -170,6 +198,8 @@ public:
 
 	/// Alocate and initialise map table.
 	void Create();
+	/// Free the map table and the player planes.
+	void FreeFields();
 	/// Build tables for map
 	void Init();
 	/// Clean the map
@@ -191,6 +221,10 @@ public:
 
 	/// Mark a tile as seen by the player.
 	void MarkSeenTile(CMapField &mf);
+	/// Mark the terrain of a field to be redrawn by the viewports.
+	void MarkTerrainChanged(const CMapField &mf);
+	/// Forget the changed terrain, once all the viewports are drawn.
+	void ClearTerrainChanges();
 
 	/// Regenerate the forest.
 	void RegenerateForest();
@@ -198,6 +232,10 @@ public:
 	void Reveal();
 	/// Save the map.
 	void Save(CFile &file) const;
+	/// Save the map to a snapshot.
+	void Save(CSnapshotWriter &snapshot) const;
+	/// Load the map from a snapshot.
+	void Load(CSnapshotReader &snapshot);
 
 	//
 	// Wall
@@ -247,10 +285,20 @@ private:
 	/// Regenerate the forest.
 	void RegenerateForestTile(const Vec2i &pos);
 
+	std::vector<bool> TerrainChangedFlags; /// fields in ChangedTerrain
+
 public:
 	CMapField *Fields;              /// fields on map
+	unsigned short *Visible[PlayerMax];    /// seen counters of each player, 0 unexplored
+	unsigned char *VisCloak[PlayerMax];    /// cloak detection counters of each player
+	unsigned char *Radar[PlayerMax];       /// radar vision counters of each player
+	unsigned char *RadarJammer[PlayerMax]; /// radar jamming counters of each player
+	CUnitBucketGrid UnitBuckets;    /// coarse grid of the units on map
 	bool NoFogOfWar;           /// fog of war disabled
 
+	std::vector<unsigned int> ChangedTerrain; /// fields whose terrain changed since the last draw
+	unsigned int TerrainGeneration; /// changed each time the fields are created
+
 	CTileset *Tileset;          /// tileset data
 	std::string TileModelsFileName; /// lua filename that loads all tilemodels
 	CGraphic *TileGraphic;     /// graphic for all the tiles
@@ -307,6 +355,9 @@ extern MapMarkerFunc MapUnmarkTileDetectCloak;
 /// Mark sight changes
 extern void MapSight(const CPlayer &player, const Vec2i &pos, int w,
 					 int h, int range, MapMarkerFunc *marker);
+/// Move sight, only (un)marking the changed edge
+extern void MapSightMove(const CPlayer &player, const Vec2i &oldPos, const Vec2i &newPos,
+						 int w, int h, int range, MapMarkerFunc *unmarker, MapMarkerFunc *marker);
 /// Update fog of war
 extern void UpdateFogOfWarChange();
 
@@ -54,13 +54,16 @@ class CMinimap
 	template <const int BPP>
 	void UpdateSeen(void *const pixels, const int pitch);
 
+	void UpdateRows(bool all);
+
 public:
 	CMinimap() : X(0), Y(0), W(0), H(0), XOffset(0), YOffset(0),
 		WithTerrain(false), ShowSelected(false),
 		Transparent(false), UpdateCache(false) {}
 
 	void UpdateXY(const Vec2i &pos);
-	void UpdateSeenXY(const Vec2i &) {}
+	void UpdateSeenXY(const Vec2i &pos);
+	void UpdateSeenXY(unsigned int index);
 	void Update();
 	void Create();
 #if defined(USE_OPENGL) || defined(USE_GLES)
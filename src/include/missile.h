@@ -309,6 +309,8 @@ class CGraphic;
 class CUnit;
 class CViewport;
 class CFile;
+class CSnapshotReader;
+class CSnapshotWriter;
 class LuaCallback;
 
 /*----------------------------------------------------------------------------
@@ -420,10 +422,15 @@ public:
 
 	static Missile *Init(const MissileType &mtype, const PixelPos &startPos, const PixelPos &destPos);
 
+	/// Missiles are taken from a pool
+	static void *operator new(size_t size);
+	static void operator delete(void *p, size_t size);
+
 	virtual void Action() = 0;
 
 	void DrawMissile(const CViewport &vp) const;
 	void SaveMissile(CFile &file) const;
+	void SaveMissile(CSnapshotWriter &snapshot) const;
 	void MissileHit(CUnit *unit = NULL);
 	bool NextMissileFrame(char sign, char longAnimation);
 	void NextMissileFrameCycle();
@@ -458,6 +465,7 @@ public:
 
 	unsigned  Local: 1;     /// missile is a local missile
 	unsigned int Slot;      /// unique number for draw level.
+	unsigned int SyncValue; /// value added to the sync digest
 
 	static unsigned int Count; /// slot number generator.
 };
@@ -607,6 +615,8 @@ extern void FindAndSortMissiles(const CViewport &vp, std::vector<Missile *> &tab
 
 /// handle all missiles
 extern void MissileActions();
+/// Add the global missiles to the sync digest
+extern void InitMissilesSyncDigest();
 /// distance from view point to missile
 extern int ViewPointDistanceToMissile(const Missile &missile);
 
@@ -615,6 +625,10 @@ extern MissileType *MissileBurningBuilding(int percent);
 
 /// Save missiles
 extern void SaveMissiles(CFile &file);
+/// Save missiles to a snapshot
+extern void SaveMissiles(CSnapshotWriter &snapshot);
+/// Load missiles from a snapshot
+extern void LoadMissiles(CSnapshotReader &snapshot);
 
 /// Initialize missile-types
 extern void InitMissileTypes();
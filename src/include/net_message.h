@@ -34,6 +34,8 @@
 #include <stdint.h>
 #include <vector>
 
+#include "sync_digest.h"
+
 /*----------------------------------------------------------------------------
 --  Declarations
 ----------------------------------------------------------------------------*/
@@ -46,6 +48,8 @@
 
 #define MaxNetworkCommands 9  /// Max Commands In A Packet
 
+#define MaxNetworkGroupSize 96  /// Max bytes of a group command, fills a packet with MaxNetworkCommands
+
 /**
 **  Network systems active in current game.
 */
@@ -271,6 +275,9 @@ public:
 /**
 **  Network message types.
 **
+**  The values are sent: adding a type before MessageCommandSpellCast
+**  needs a new NetworkProtocolRevision.
+**
 **  @todo cleanup the message types.
 */
 enum _message_type_ {
@@ -285,6 +292,10 @@ enum _message_type_ {
 
 	MessageChat,                   /// Chat message
 
+	MessagePing,                   /// Round-trip time request
+	MessagePong,                   /// Round-trip time answer
+	MessageLag,                    /// Network lag wanted by a player
+
 	MessageCommandStop,            /// Unit command stop
 	MessageCommandStand,           /// Unit command stand ground
 	MessageCommandDefend,          /// Unit command defend
@@ -309,6 +320,8 @@ enum _message_type_ {
 	MessageCommandResearch,        /// Unit command research
 	MessageCommandCancelResearch,  /// Unit command cancel research
 
+	MessageCommandGroup,           /// Same unit command for several units
+
 	MessageExtendedCommand,        /// Command is the next byte
 
 	// ATTN: __MUST__ be last due to spellid encoding!!!
@@ -343,6 +356,31 @@ public:
 	uint16_t Dest;         /// Destination unit
 };
 
+/**
+**  Network command message for several units.
+**
+**  All units get the same command. The unit slots are kept sorted and
+**  sent as the differences between them, 7 bits a byte.
+*/
+class CNetworkCommandGroup
+{
+public:
+	CNetworkCommandGroup() : Type(0), X(0), Y(0), Dest(0) {}
+
+	size_t Serialize(unsigned char *buf) const;
+	size_t Deserialize(const unsigned char *buf, size_t len);
+	size_t Size() const;
+
+	bool AddUnit(uint16_t unit);
+
+public:
+	uint8_t  Type;                /// Command type of the units
+	uint16_t X;                   /// Map position X
+	uint16_t Y;                   /// Map position Y
+	uint16_t Dest;                /// Destination unit
+	std::vector<uint16_t> Units;  /// Sorted slots of the units
+};
+
 /**
 **  Extended network command message.
 */
@@ -377,19 +415,22 @@ public:
 };
 
 /**
-**  Network sync message.
+**  Network sync message, with the sync digest of each part of the game.
 */
 class CNetworkCommandSync
 {
 public:
-	CNetworkCommandSync() : syncSeed(0), syncHash(0) {}
+	CNetworkCommandSync() : syncSeed(0), syncHash(0) {
+		memset(syncDigest, 0, sizeof(syncDigest));
+	}
 	size_t Serialize(unsigned char *buf) const;
 	size_t Deserialize(const unsigned char *buf);
-	static size_t Size() { return 4 + 4; };
+	static size_t Size() { return 4 + 4 + 4 * SyncDigestPartMax; };
 
 public:
 	uint32_t syncSeed;
 	uint32_t syncHash;
+	uint32_t syncDigest[SyncDigestPartMax];
 };
 
 /**
@@ -407,6 +448,37 @@ public:
 	uint16_t player;
 };
 
+/**
+**  Network ping message, answered with a pong of the same time.
+*/
+class CNetworkPing
+{
+public:
+	CNetworkPing() : Time(0) {}
+	size_t Serialize(unsigned char *buf) const;
+	size_t Deserialize(const unsigned char *buf);
+	static size_t Size() { return 4; };
+
+public:
+	uint32_t Time;  /// Ticks of the sender of the ping
+};
+
+/**
+**  Network lag message.
+*/
+class CNetworkCommandLag
+{
+public:
+	CNetworkCommandLag() : player(0), Lag(0) {}
+	size_t Serialize(unsigned char *buf) const;
+	size_t Deserialize(const unsigned char *buf);
+	static size_t Size() { return 2 + 2; };
+
+public:
+	uint16_t player;
+	uint16_t Lag;  /// Lag wanted by the player (# game cycles)
+};
+
 /**
 **  Network Selection Update
 */
@@ -45,15 +45,17 @@ class CHost;
 #define NetworkProtocolMinorVersion StratagusMinorVersion
 /// Network protocol patch level (maximal 99)
 #define NetworkProtocolPatchLevel   StratagusPatchLevel
-/// Network protocol version (1,2,3) -> 10203
+/// Network protocol revision, increased when the messages change (maximal 99)
+#define NetworkProtocolRevision     3
+/// Network protocol version (1,2,3) revision 4 -> 4010203
 #define NetworkProtocolVersion \
-	(NetworkProtocolMajorVersion * 10000 + NetworkProtocolMinorVersion * 100 + \
-	 NetworkProtocolPatchLevel)
+	(NetworkProtocolRevision * 1000000 + NetworkProtocolMajorVersion * 10000 + \
+	 NetworkProtocolMinorVersion * 100 + NetworkProtocolPatchLevel)
 
 /// Network protocol printf format string
-#define NetworkProtocolFormatString "%d.%d.%d"
+#define NetworkProtocolFormatString "%d.%d.%d-%d"
 /// Network protocol printf format arguments
-#define NetworkProtocolFormatArgs(v) (v) / 10000, ((v) / 100) % 100, (v) % 100
+#define NetworkProtocolFormatArgs(v) ((v) / 10000) % 100, ((v) / 100) % 100, (v) % 100, (v) / 1000000
 
 /*----------------------------------------------------------------------------
 --  Declarations
@@ -35,12 +35,15 @@
 --  Includes
 ----------------------------------------------------------------------------*/
 
+#include <vector>
+
 #include "network/udpsocket.h"
 
 /*----------------------------------------------------------------------------
 --  Declarations
 ----------------------------------------------------------------------------*/
 
+class CNetworkContext;
 class CUnit;
 class CUnitType;
 
@@ -68,6 +71,10 @@ public:
 
 extern CUDPSocket NetworkFildes;  /// Network file descriptor
 extern bool NetworkInSync;        /// Network is in sync
+extern unsigned long NetworkResendCount;  /// Resend requests sent
+extern unsigned long (*NetworkGetTicks)(); /// Clock of the pings
+/// Runs the game commands instead of executing them, if set
+extern void (*NetworkCommandHook)(int player, unsigned char type, const std::vector<unsigned char> &data);
 
 /*----------------------------------------------------------------------------
 --  Functions
@@ -94,6 +101,13 @@ extern void NetworkSendSelection(CUnit **units, int count);
 
 extern void NetworkCclRegister();
 
+/// Create the network state of one more player, for the lockstep harness
+extern CNetworkContext *NetworkNewContext();
+/// Free a network state
+extern void NetworkDeleteContext(CNetworkContext *context);
+/// Exchange the network state with the one of the context
+extern void NetworkSwapContext(CNetworkContext &context);
+
 //@}
 
 #endif // !__NETWORK_H__
@@ -0,0 +1,117 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name loopback.h - The loopback network header file. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <string>
+#include <vector>
+
+#include "network/udpsocket.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+class CLoopbackSocket;
+
+/**
+**  In-memory network, shared by the loopback sockets of one process.
+**
+**  A datagram is delivered after Latency plus a random part of Jitter
+**  milliseconds of the clock of the network, which is moved by hand.
+**  Some datagrams are held back for one more latency, so they arrive
+**  after the next ones, and some are lost.
+*/
+class CLoopbackNetwork
+{
+public:
+	explicit CLoopbackNetwork(unsigned int seed = 1);
+	~CLoopbackNetwork();
+
+	CUDPSocket_Impl *NewSocket();
+
+	unsigned long GetTime() const { return Now; }
+	void SetTime(unsigned long time) { Now = time; }
+
+public:
+	int Latency;              /// Delay of a datagram (ms)
+	int Jitter;               /// Random extra delay, up to (ms)
+	int Reorder;              /// Chance of a datagram to be held back (%)
+	int Loss;                 /// Chance of a datagram to be lost (%)
+
+	unsigned long SentCount;  /// Datagrams sent
+	unsigned long LostCount;  /// Datagrams lost
+
+private:
+	friend class CLoopbackSocket;
+
+	void Send(const CHost &from, const CHost &to, const void *buf, unsigned int len);
+	int Random(int n);
+
+	std::vector<CLoopbackSocket *> Sockets;  /// Open sockets
+	unsigned long Now;                        /// Clock of the network (ms)
+	unsigned int Seed;                        /// Random seed of the network
+};
+
+/**
+**  Settings of the lockstep harness.
+*/
+class CLockstepSettings
+{
+public:
+	CLockstepSettings() : Clients(4), Cycles(3000), Latency(20), Jitter(0),
+		Reorder(0), Loss(0), CommandEvery(30), Seed(1) {}
+
+	bool Parse(const std::string &settings);
+
+public:
+	int Clients;          /// Number of players
+	unsigned long Cycles; /// Game cycles to run
+	int Latency;          /// Delay of a datagram (ms)
+	int Jitter;           /// Random extra delay, up to (ms)
+	int Reorder;          /// Chance of a datagram to be held back (%)
+	int Loss;             /// Chance of a datagram to be lost (%)
+	int CommandEvery;     /// Each player sends a command every # game cycles
+	unsigned int Seed;    /// Random seed of the network
+};
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Run players on the loopback network and report the lockstep statistics
+extern int RunLockstepHarness(const CLockstepSettings &settings);
+
+//@}
+
+#endif // !LOOPBACK_H
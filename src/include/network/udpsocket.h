@@ -51,13 +51,32 @@ private:
 	int port;
 };
 
-class CUDPSocket_Impl;
+/**
+**  Transport of the datagrams of a CUDPSocket.
+**
+**  The socket of the system by default, or an in-memory one as the
+**  loopback network (see network/loopback.h).
+*/
+class CUDPSocket_Impl
+{
+public:
+	virtual ~CUDPSocket_Impl() {}
+	virtual bool Open(const CHost &host) = 0;
+	virtual void Close() = 0;
+	virtual void Send(const CHost &host, const void *buf, unsigned int len) = 0;
+	virtual int Recv(void *buf, int len, CHost *hostFrom) = 0;
+	virtual void SetNonBlocking() = 0;
+	virtual int HasDataToRead(int timeout) = 0;
+	virtual bool IsValid() const = 0;
+};
 
 class CUDPSocket
 {
 public:
 	CUDPSocket();
 	~CUDPSocket();
+	void SetTransport(CUDPSocket_Impl *impl);
+	void SwapTransport(CUDPSocket &other);
 	bool Open(const CHost &host);
 	void Close();
 	void Send(const CHost &host, const void *buf, unsigned int len);
@@ -93,6 +112,9 @@ private:
 #endif
 
 private:
+	CUDPSocket(const CUDPSocket &); // not implemented
+	CUDPSocket &operator = (const CUDPSocket &); // not implemented
+
 	CUDPSocket_Impl *m_impl;
 };
 
@@ -47,6 +47,8 @@
 
 class CUnit;
 class CFile;
+class CSnapshotReader;
+class CSnapshotWriter;
 struct lua_State;
 
 /**
@@ -86,6 +88,8 @@ public:
 
 	void Save(CFile &file) const;
 	void Load(lua_State *l);
+	void Save(CSnapshotWriter &snapshot) const;
+	void Load(CSnapshotReader &snapshot);
 
 private:
 	CUnit *unit;
@@ -105,6 +109,8 @@ public:
 	PathFinderOutput();
 	void Save(CFile &file) const;
 	void Load(lua_State *l);
+	void Save(CSnapshotWriter &snapshot) const;
+	void Load(CSnapshotReader &snapshot);
 public:
 	unsigned short int Cycles;  /// how much Cycles we move.
 	char Fast;                  /// Flag fast move (one step)
@@ -114,9 +120,12 @@ public:
 
 class PathFinderData
 {
+public:
+	PathFinderData() : prefetch(-1) {}
 public:
 	PathFinderInput input;
 	PathFinderOutput output;
+	int prefetch;               /// path searched ahead of the unit, -1 for none
 };
 
 
@@ -199,6 +208,8 @@ extern int AStarMovingUnitCrossingCost;
 extern bool AStarKnowUnseenTerrain;
 /// Cost of using a square we haven't seen before.
 extern int AStarUnknownTerrainCost;
+/// Number of threads searching the paths ahead of the units, 1 for none
+extern int PathfinderThreads;
 
 //
 //  Convert heading into direction.
@@ -215,9 +226,30 @@ extern const int XY2Heading[3][3];
 extern void InitPathfinder();
 /// Free the pathfinder
 extern void FreePathfinder();
+/// Save the state of the pathfinder
+extern void SavePathfinder(CFile &file);
+/// Save the state of the pathfinder to a snapshot
+extern void SavePathfinder(CSnapshotWriter &snapshot);
+/// Load the state of the pathfinder from a snapshot
+extern void LoadPathfinder(CSnapshotReader &snapshot);
+/// Restore the loaded state of the pathfinder, once the units are placed
+extern void PathfinderGameLoaded();
+
+/// Tell the pathfinder that passability of a map field changed
+extern void PathfinderMapChanged(const Vec2i &pos);
+/// Number of changes of the passability of the map
+extern unsigned long PathfinderMapGeneration;
+/// Get the connected component of a position for a movement mask
+extern int GetTileComponent(int movementMask, const Vec2i &pos);
 
 /// Returns the next element of the path
 extern int NextPathElement(CUnit &unit, short int *xdp, short int *ydp);
+/// Forget the paths searched ahead of the units
+extern void StartPathPrefetch();
+/// Select the unit for a path search ahead of its action
+extern void PrefetchPath(CUnit &unit);
+/// Search the paths of the selected units with the worker threads
+extern void RunPathPrefetch();
 /// Return distance to unit.
 extern int UnitReachable(const CUnit &unit, const CUnit &dst, int range);
 /// Can the unit 'src' reach the place x,y
@@ -62,6 +62,8 @@ class CUnit;
 class CUnitType;
 class PlayerAi;
 class CFile;
+class CSnapshotReader;
+class CSnapshotWriter;
 struct lua_State;
 
 /*----------------------------------------------------------------------------
@@ -97,6 +99,7 @@ public:
 	int MaxResources[MaxCosts];   /// max resources can be stored
 	int StoredResources[MaxCosts];/// resources in store buildings (can't exceed MaxResources)
 	int LastResources[MaxCosts];  /// last values for revenue
+	unsigned int SyncValue;       /// value of the resources added to the sync digest
 	int Incomes[MaxCosts];        /// income of the resources
 	int Revenue[MaxCosts];        /// income rate of the resources
 
@@ -227,6 +230,8 @@ public:
 	void Init(/* PlayerTypes */ int type);
 	void Save(CFile &file) const;
 	void Load(lua_State *l);
+	void Save(CSnapshotWriter &snapshot) const;
+	void Load(CSnapshotReader &snapshot);
 
 private:
 	std::vector<CUnit *> Units; /// units of this player
@@ -350,6 +355,10 @@ extern void InitPlayers();
 extern void CleanPlayers();
 /// Save players
 extern void SavePlayers(CFile &file);
+/// Save players to a snapshot
+extern void SavePlayers(CSnapshotWriter &snapshot);
+/// Load players from a snapshot
+extern void LoadPlayers(CSnapshotReader &snapshot);
 
 /// Create a new player
 extern void CreatePlayer(int type);
@@ -70,6 +70,10 @@ extern void SinglePlayerReplayEachCycle();
 extern void MultiPlayerReplayEachCycle();
 /// Load replay
 extern int LoadReplay(const std::string &name);
+/// Save a keyframe of the game in the replay log when due
+extern void SaveReplayKeyframe();
+/// Seek to a game cycle of the replay
+extern void SeekReplay(unsigned long cycle);
 /// End logging
 extern void EndReplayLog();
 /// Clean replay
@@ -69,6 +69,7 @@ enum {
 extern lua_State *Lua;
 
 extern int LuaLoadFile(const std::string &file);
+extern int LuaLoadBuffer(const std::string &content, const std::string &name);
 extern int LuaCall(int narg, int clear, bool exitOnError = true);
 
 #define LuaError(l, args) \
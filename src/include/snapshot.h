@@ -0,0 +1,168 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name snapshot.h - The binary saved game header file. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <string>
+
+#include "vec2i.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+class CFile;
+class CUnit;
+
+/**
+**  Sections of a snapshot, the binary saved game.
+**
+**  The file starts with SnapshotMagic and the format version, followed
+**  by the sections: a tag, the size of the section and its data. The
+**  sections are loaded in the order of the file, a section of an unknown
+**  tag is skipped. Numbers are varints, signed ones zigzag encoded,
+**  strings are prefixed by their length.
+**
+**  What has no binary form (unit types, upgrades, user interface, AI,
+**  triggers and the Lua globals) is saved in Lua sections, which are
+**  run like the Lua saved games.
+*/
+enum SnapshotSection {
+	SnapshotSectionLua = 1,     /// Lua chunk
+	SnapshotSectionPlayers,     /// Players and ThisPlayer
+	SnapshotSectionMap,         /// Map fields and the explored tiles
+	SnapshotSectionUnits,       /// Unit slots, units and their orders
+	SnapshotSectionMissiles,    /// Global and local missiles
+	SnapshotSectionUnitBuckets, /// Enter cycles of the unit buckets
+	SnapshotSectionPathfinder   /// Paths and flow fields kept by the pathfinder
+};
+
+/**
+**  Binary output, kept in memory until it is written at once.
+**
+**  Numbers are varints, signed ones zigzag encoded, strings are
+**  prefixed by their length. Used by the snapshots and the replays.
+*/
+class CBinaryWriter
+{
+public:
+	void Varint(unsigned long value);
+	void Int(long value) { Varint(value < 0 ? ~((unsigned long)value << 1) : (unsigned long)value << 1); }
+	void Bool(bool value) { Data += value ? '\1' : '\0'; }
+	void Pos(const Vec2i &pos) { Int(pos.x); Int(pos.y); }
+	void Fixed32(unsigned long value);
+	void String(const std::string &value);
+	void Bytes(const void *data, size_t size) { Data.append(static_cast<const char *>(data), size); }
+
+	int Write(CFile &file) const;
+
+protected:
+	std::string Data;      /// Output
+};
+
+/**
+**  Binary input.
+**
+**  A read past the end fails: it returns 0 and the input is marked as
+**  corrupted, checked once the reading is done.
+*/
+class CBinaryReader
+{
+public:
+	CBinaryReader(const char *data, size_t size) : Cur(data), Limit(data + size), Corrupted(false) {}
+
+	unsigned long Varint();
+	int Int();
+	bool Bool();
+	Vec2i Pos();
+	unsigned long Fixed32();
+	std::string String();
+	void Bytes(void *data, size_t size);
+
+	size_t Remaining() const { return Limit - Cur; }
+	bool AtEnd() const { return Cur == Limit; }
+	bool IsCorrupted() const { return Corrupted; }
+	void SetCorrupted() { Corrupted = true; }
+
+protected:
+	const char *Cur;         /// Next byte to read
+	const char *Limit;       /// End of what can be read
+	bool Corrupted;          /// A read failed
+};
+
+/**
+**  Output of a snapshot.
+*/
+class CSnapshotWriter : public CBinaryWriter
+{
+public:
+	CSnapshotWriter();
+
+	void Unit(const CUnit *unit);
+
+	void BeginSection(SnapshotSection section);
+	void EndSection();
+
+private:
+	size_t SectionStart;   /// Start of the size of the current section
+};
+
+/**
+**  Input of a snapshot, read by section.
+**
+**  A read past the end of the section fails.
+*/
+class CSnapshotReader : public CBinaryReader
+{
+public:
+	CSnapshotReader(const char *data, size_t size);
+
+	CUnit *Unit();
+
+	bool NextSection(int &section);
+	std::string SectionData();
+
+private:
+	const char *End;         /// End of the snapshot
+};
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Read a snapshot file, return -1 if the file is not a snapshot
+extern int ReadSnapshotFile(const std::string &filename, std::string &data);
+
+//@}
+
+#endif // !__SNAPSHOT_H__
@@ -0,0 +1,87 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name sync_digest.h - The sync digest header file. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+
+#ifndef __SYNC_DIGEST_H__
+#define __SYNC_DIGEST_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+class CMapField;
+class CPlayer;
+class CUnit;
+class Missile;
+
+/**
+**  Parts of the game state in the sync digest.
+**
+**  Each unit, player, map field and global missile keeps the value it
+**  adds to the digest of its part. The value is computed again when the
+**  object changes, and the digest is corrected by the difference, so the
+**  digest is never computed over the whole game but at its start.
+**
+**  The digests are sent with the network syncs: a difference points to
+**  the part of the game which is out of sync.
+*/
+enum SyncDigestPart {
+	SyncDigestUnits,     /// Position, hit points and orders of the units
+	SyncDigestPlayers,   /// Resources of the players
+	SyncDigestMap,       /// Terrain of the map fields
+	SyncDigestMissiles,  /// Position and damage of the global missiles
+	SyncDigestPartMax    /// Number of parts
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+extern unsigned int SyncDigest[SyncDigestPartMax];             /// Digest of each part
+extern const char *const SyncDigestPartNames[SyncDigestPartMax]; /// Name of each part
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Compute the digests of the whole game, when the game starts
+extern void InitSyncDigest();
+
+/// Update the digest with the current state of a unit
+extern void UpdateSyncDigest(CUnit &unit);
+/// Update the digest with the current resources of a player
+extern void UpdateSyncDigest(CPlayer &player);
+/// Update the digest with the current terrain of a field
+extern void UpdateSyncDigest(CMapField &mf);
+/// Update the digest with the current state of a missile
+extern void UpdateSyncDigest(Missile &missile);
+/// Remove a missile from the digest
+extern void RemoveSyncDigest(Missile &missile);
+
+//@}
+
+#endif // !__SYNC_DIGEST_H__
@@ -47,23 +47,12 @@
 **    This is the tile number, that the player sitting on the computer
 **    currently knows. Idea: Can be uses for illusions.
 **
-**  CMapFieldPlayerInfo::Visible[]
+**  CMapFieldPlayerInfo::Index
 **
-**    Counter how many units of the player can see this field. 0 the
-**    field is not explored, 1 explored, n-1 unit see it. Currently
-**    no more than 253 units can see a field.
-**
-**  CMapFieldPlayerInfo::VisCloak[]
-**
-**    Visiblity for cloaking.
-**
-**  CMapFieldPlayerInfo::Radar[]
-**
-**    Visiblity for radar.
-**
-**  CMapFieldPlayerInfo::RadarJammer[]
-**
-**    Jamming capabilities.
+**    Index of the field in the map. The per player counters for
+**    vision, cloak detection and radar are kept in dense per player
+**    planes in ::CMap (CMap::Visible, CMap::VisCloak, CMap::Radar and
+**    CMap::RadarJammer), this index selects the field in these planes.
 */
 
 /**
@@ -140,6 +129,8 @@
 
 class CFile;
 class CPlayer;
+class CSnapshotReader;
+class CSnapshotWriter;
 class CTileset;
 struct lua_State;
 
@@ -150,12 +141,7 @@ struct lua_State;
 class CMapFieldPlayerInfo
 {
 public:
-	CMapFieldPlayerInfo() : SeenTile(0) {
-		memset(Visible, 0, sizeof(Visible));
-		memset(VisCloak, 0, sizeof(VisCloak));
-		memset(Radar, 0, sizeof(Radar));
-		memset(RadarJammer, 0, sizeof(RadarJammer));
-	}
+	CMapFieldPlayerInfo() : SeenTile(0), Index(0) {}
 
 	/// Check if a field for the user is explored.
 	bool IsExplored(const CPlayer &player) const;
@@ -175,10 +161,7 @@ public:
 
 public:
 	unsigned short SeenTile;              /// last seen tile (FOW)
-	unsigned short Visible[PlayerMax];    /// Seen counter 0 unexplored
-	unsigned char VisCloak[PlayerMax];    /// Visiblity for cloaking.
-	unsigned char Radar[PlayerMax];       /// Visiblity for radar.
-	unsigned char RadarJammer[PlayerMax]; /// Jamming capabilities.
+	unsigned int Index;                   /// index in the player planes of the map
 };
 
 /// Describes a field of the map
@@ -189,6 +172,8 @@ public:
 
 	void Save(CFile &file) const;
 	void parse(lua_State *l);
+	void Save(CSnapshotWriter &snapshot) const;
+	void Load(CSnapshotReader &snapshot);
 
 	void setTileIndex(const CTileset &tileset, unsigned int tileIndex, int value);
 
@@ -219,7 +204,7 @@ public:
 
 	unsigned char getCost() const { return cost; }
 	unsigned int getFlag() const { return Flags; }
-	void setGraphicTile(unsigned int tile) { this->tile = tile; }
+	void setGraphicTile(unsigned int tile);
 private:
 #ifdef DEBUG
 	unsigned int tilesetTile;  /// tileset tile number
@@ -232,6 +217,7 @@ private:
 public:
 	// FIXME: Value should be removed, walls and regeneration can be handled differently.
 	unsigned char Value;       /// HP for walls/ Wood Regeneration
+	unsigned int SyncValue;    /// Value of the terrain added to the sync digest
 	CUnitCache UnitCache;      /// A unit on the map field.
 
 	CMapFieldPlayerInfo playerInfo; /// stuff related to player
@@ -60,6 +60,8 @@ class Missile;
 class CMapField;
 class COrder;
 class CPlayer;
+class CSnapshotReader;
+class CSnapshotWriter;
 class CUnit;
 class CUnitColors;
 class CUnitPtr;
@@ -296,25 +298,8 @@ public:
 		int unitSlot;       /// index in UnitManager::units
 	};
 public:
-	// @note int is faster than shorts
-	unsigned int     Refs;         /// Reference counter
-	unsigned int     ReleaseCycle; /// When this unit could be recycled
-	CUnitManagerData UnitManagerData;
-	size_t PlayerSlot;  /// index in Player->Units
-
-	int    InsideCount;   /// Number of units inside.
-	int    BoardCount;    /// Number of units transported inside.
-	CUnit *UnitInside;    /// Pointer to one of the units inside.
-	CUnit *Container;     /// Pointer to the unit containing it (or 0)
-	CUnit *NextContained; /// Next unit in the container.
-	CUnit *PrevContained; /// Previous unit in the container.
-
-	CUnit *NextWorker; //pointer to next assigned worker to "Goal" resource.
-	struct {
-		CUnit *Workers; /// pointer to first assigned worker to this resource.
-		int Assigned; /// how many units are assigned to harvesting from the resource.
-		int Active; /// how many units are harvesting from the resource.
-	} Resource; /// Resource still
+	// Data used by every simulation cycle, kept together at the start of
+	// the unit so that the update loops touch as few cache lines as possible.
 
 	Vec2i tilePos; /// Map position X
 
@@ -325,21 +310,22 @@ public:
 	const CUnitStats *Stats;       /// Current unit stats
 	int         CurrentSightRange; /// Unit's Current Sight Range
 
-	// Pathfinding stuff:
-	PathFinderData *pathFinderData;
+	std::vector<COrder *> Orders; /// orders to process
+	CVariable *Variable; /// array of User Defined variables.
 
-	// DISPLAY:
-	int         Frame;      /// Image frame: <0 is mirrored
-	CUnitColors *Colors;    /// Player colors
+	unsigned int Wait;          /// action counter
+	struct _unit_anim_ {
+		const CAnimation *Anim;      /// Anim
+		const CAnimation *CurrAnim;  /// CurrAnim
+		int Wait;                    /// Wait
+		int Unbreakable;             /// Unbreakable
+	} Anim;
 
+	int         Frame;      /// Image frame: <0 is mirrored
 	signed char IX;         /// X image displacement to map position
 	signed char IY;         /// Y image displacement to map position
 	unsigned char Direction; //: 8; /// angle (0-255) unit looking
-	unsigned char CurrentResource;
-	int ResourcesHeld;      /// Resources Held by a unit
 
-	unsigned char DamagedType;   /// Index of damage type of unit which damaged this unit
-	unsigned long Attacked;      /// gamecycle unit was last attacked
 	unsigned Blink : 3;          /// Let selection rectangle blink
 	unsigned Moving : 1;         /// The unit is moving
 	unsigned ReCast : 1;         /// Recast again next cycle
@@ -357,6 +343,42 @@ public:
 
 	unsigned Summoned : 1;       /// Unit is summoned using spells.
 
+	// Other data.
+
+	// @note int is faster than shorts
+	unsigned int     Refs;         /// Reference counter
+	unsigned int     ReleaseCycle; /// When this unit could be recycled
+	unsigned int     SyncValue;    /// Value added to the sync digest
+	CUnitManagerData UnitManagerData;
+	size_t PlayerSlot;  /// index in Player->Units
+
+	int    InsideCount;   /// Number of units inside.
+	int    BoardCount;    /// Number of units transported inside.
+	CUnit *UnitInside;    /// Pointer to one of the units inside.
+	CUnit *Container;     /// Pointer to the unit containing it (or 0)
+	CUnit *NextContained; /// Next unit in the container.
+	CUnit *PrevContained; /// Previous unit in the container.
+
+	CUnit *NextWorker; //pointer to next assigned worker to "Goal" resource.
+	struct {
+		CUnit *Workers; /// pointer to first assigned worker to this resource.
+		int Assigned; /// how many units are assigned to harvesting from the resource.
+		int Active; /// how many units are harvesting from the resource.
+	} Resource; /// Resource still
+
+	// Pathfinding stuff:
+	PathFinderData *pathFinderData;
+
+	// DISPLAY:
+	CUnitColors *Colors;    /// Player colors
+
+	unsigned char CurrentResource;
+	int ResourcesHeld;      /// Resources Held by a unit
+
+	unsigned char DamagedType;   /// Index of damage type of unit which damaged this unit
+	unsigned long Attacked;      /// gamecycle unit was last attacked
+	unsigned long TargetScanCycle; /// gamecycle unit last looked for a target
+
 	unsigned TeamSelected;  /// unit is selected by a team member.
 	CPlayer *RescuedFrom;        /// The original owner of a rescued unit.
 	/// NULL if the unit was not rescued.
@@ -376,25 +398,13 @@ public:
 		unsigned    ByPlayer : PlayerMax;   /// Track unit seen by player
 	} Seen;
 
-	CVariable *Variable; /// array of User Defined variables.
-
 	unsigned long TTL;  /// time to live
 
 	int GroupId;        /// unit belongs to this group id
 	int LastGroup;      /// unit belongs to this last group
 
-	unsigned int Wait;          /// action counter
 	int Threshold;              /// The counter while ai unit couldn't change target.
 
-	struct _unit_anim_ {
-		const CAnimation *Anim;      /// Anim
-		const CAnimation *CurrAnim;  /// CurrAnim
-		int Wait;                    /// Wait
-		int Unbreakable;             /// Unbreakable
-	} Anim;
-
-
-	std::vector<COrder *> Orders; /// orders to process
 	COrder *SavedOrder;         /// order to continue after current
 	COrder *NewOrder;           /// order for new trained units
 	COrder *CriticalOrder;      /// order to do as possible in breakable animation.
@@ -560,6 +570,10 @@ extern std::string UnitReference(const CUnitPtr &unit);
 
 /// save unit-structure
 extern void SaveUnit(const CUnit &unit, CFile &file);
+/// save unit-structure to a snapshot
+extern void SaveUnit(const CUnit &unit, CSnapshotWriter &snapshot);
+/// load unit-structure from a snapshot
+extern void LoadUnit(CSnapshotReader &snapshot);
 
 /// Initialize unit module
 extern void InitUnits();
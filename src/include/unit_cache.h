@@ -37,13 +37,17 @@
 
 #include <vector>
 #include <algorithm>
+#include <string.h>
 
 /*----------------------------------------------------------------------------
 --  Declarations
 ----------------------------------------------------------------------------*/
 
+class CFile;
 class CUnit;
 class CMap;
+class CSnapshotReader;
+class CSnapshotWriter;
 /**
 **  Unit cache
 */
@@ -217,6 +221,75 @@ public:
 	std::vector<CUnit *> Units;
 };
 
+/**
+**  Coarse grid of the units on the map.
+**
+**  The map is split in buckets of BucketSize x BucketSize tiles. Each
+**  bucket holds the units overlapping it, and how many of them belong to
+**  each player. Range queries can so skip whole buckets without any unit
+**  of the players they look for.
+**
+**  The grid is kept in sync by CMap::Insert and CMap::Remove.
+*/
+class CUnitBucketGrid
+{
+public:
+	/// Units of a bucket
+	class CBucket
+	{
+	public:
+		CBucket() : Units(), PlayerMask(0) {
+			memset(PlayerCount, 0, sizeof(PlayerCount));
+			memset(EnterCycle, 0, sizeof(EnterCycle));
+		}
+
+	public:
+		std::vector<CUnit *> Units;           /// units overlapping the bucket
+		unsigned short PlayerCount[PlayerMax]; /// number of units of each player
+		unsigned int PlayerMask;              /// bit field of the players with units
+		unsigned long EnterCycle[PlayerMax];  /// last cycle a unit of each player entered
+	};
+
+public:
+	CUnitBucketGrid() : Width(0), Height(0) {}
+
+	/// Allocate the grid for a map size
+	void Init(int mapWidth, int mapHeight);
+	/// Free the grid
+	void Clean();
+
+	/// Insert a unit into the buckets it overlaps
+	void Insert(CUnit &unit);
+	/// Remove a unit from the buckets it overlaps
+	void Remove(CUnit &unit);
+
+	/// Save the enter cycles of the buckets
+	void Save(CSnapshotWriter &snapshot) const;
+	/// Load the enter cycles of the buckets
+	void Load(CSnapshotReader &snapshot);
+	/// Save the enter cycles of the buckets in a Lua saved game
+	void Save(CFile &file) const;
+	/// Set the enter cycle of a player in a bucket of a loaded game
+	void SetEnterCycle(int x, int y, int player, unsigned long cycle);
+	/// Get the enter cycles of all the buckets
+	void GetEnterCycles(std::vector<unsigned long> &cycles) const;
+	/// Set the enter cycles of all the buckets, as got by GetEnterCycles
+	void SetEnterCycles(const std::vector<unsigned long> &cycles);
+
+	int GetWidth() const { return Width; }
+	int GetHeight() const { return Height; }
+	const CBucket &GetBucket(int x, int y) const { return Buckets[x + y * Width]; }
+
+public:
+	static const int BucketShift = 3;                /// log2 of BucketSize
+	static const int BucketSize = 1 << BucketShift;  /// side of a bucket in tiles
+
+private:
+	int Width;                    /// width of the grid in buckets
+	int Height;                   /// height of the grid in buckets
+	std::vector<CBucket> Buckets; /// the buckets
+};
+
 
 //@}
 
@@ -238,6 +238,80 @@ void Select(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units,
 	SelectFixed(minPos, maxPos, units, pred);
 }
 
+/**
+**  Select the units of some players in a rectangle, using the unit
+**  buckets of the map. Buckets without any unit of these players are
+**  skipped.
+**
+**  @param ltPos       Top left corner of the rectangle, on map.
+**  @param rbPos       Bottom right corner of the rectangle, on map.
+**  @param playerMask  Bit field of the players to select the units of.
+**  @param units       OUT: the selected units.
+**  @param pred        Predicate the selected units verify.
+*/
+template <typename Pred>
+void SelectFixedOfPlayers(const Vec2i &ltPos, const Vec2i &rbPos, unsigned int playerMask,
+						  std::vector<CUnit *> &units, Pred pred)
+{
+	Assert(Map.Info.IsPointOnMap(ltPos));
+	Assert(Map.Info.IsPointOnMap(rbPos));
+	Assert(units.empty());
+
+	const int shift = CUnitBucketGrid::BucketShift;
+
+	for (int by = ltPos.y >> shift; by <= rbPos.y >> shift; ++by) {
+		for (int bx = ltPos.x >> shift; bx <= rbPos.x >> shift; ++bx) {
+			const CUnitBucketGrid::CBucket &bucket = Map.UnitBuckets.GetBucket(bx, by);
+
+			if ((bucket.PlayerMask & playerMask) == 0) {
+				continue;
+			}
+			for (size_t i = 0; i != bucket.Units.size(); ++i) {
+				CUnit &unit = *bucket.Units[i];
+
+				if ((playerMask & (1 << unit.Player->Index)) == 0
+					|| unit.tilePos.x > rbPos.x || unit.tilePos.y > rbPos.y
+					|| unit.tilePos.x + unit.Type->TileWidth <= ltPos.x
+					|| unit.tilePos.y + unit.Type->TileHeight <= ltPos.y) {
+					continue;
+				}
+				// A unit over several buckets is only taken from the first
+				// one which overlaps the rectangle.
+				if ((std::max<int>(unit.tilePos.x, ltPos.x) >> shift) != bx
+					|| (std::max<int>(unit.tilePos.y, ltPos.y) >> shift) != by) {
+					continue;
+				}
+				if (pred(&unit)) {
+					units.push_back(&unit);
+				}
+			}
+		}
+	}
+}
+
+template <typename Pred>
+void SelectOfPlayers(const Vec2i &ltPos, const Vec2i &rbPos, unsigned int playerMask,
+					 std::vector<CUnit *> &units, Pred pred)
+{
+	Vec2i minPos = ltPos;
+	Vec2i maxPos = rbPos;
+
+	Map.FixSelectionArea(minPos, maxPos);
+	SelectFixedOfPlayers(minPos, maxPos, playerMask, units, pred);
+}
+
+template <typename Pred>
+void SelectAroundUnitOfPlayers(const CUnit &unit, int range, unsigned int playerMask,
+							   std::vector<CUnit *> &around, Pred pred)
+{
+	const Vec2i offset(range, range);
+	const Vec2i typeSize(unit.Type->TileWidth - 1, unit.Type->TileHeight - 1);
+
+	SelectOfPlayers(unit.tilePos - offset,
+					unit.tilePos + typeSize + offset, playerMask, around,
+					MakeAndPredicate(IsNotTheSameUnitAs(unit), pred));
+}
+
 template <typename Pred>
 CUnit *FindUnit_IfFixed(const Vec2i &ltPos, const Vec2i &rbPos, Pred pred)
 {
@@ -301,6 +375,8 @@ extern CUnit *AttackUnitsInDistance(const CUnit &unit, int range, bool onlyBuild
 extern CUnit *AttackUnitsInRange(const CUnit &unit);
 /// Find best enemy in reaction range to attack
 extern CUnit *AttackUnitsInReactRange(const CUnit &unit);
+/// Find best enemy in reaction range to attack, if the unit's scan is due
+extern CUnit *AcquireTargetInReactRange(CUnit &unit);
 
 //@}
 
@@ -45,6 +45,8 @@
 
 class CUnit;
 class CFile;
+class CSnapshotReader;
+class CSnapshotWriter;
 struct lua_State;
 
 class CUnitManager
@@ -59,6 +61,8 @@ public:
 	void ReleaseUnit(CUnit *unit);
 	void Save(CFile &file) const;
 	void Load(lua_State *Lua);
+	void Save(CSnapshotWriter &snapshot) const;
+	void Load(CSnapshotReader &snapshot);
 
 	// Following is for already allocated Unit (no specific order)
 	void Add(CUnit *unit);
@@ -72,11 +76,17 @@ public:
 	CUnit &GetSlotUnit(int index) const;
 	unsigned int GetUsedSlotCount() const;
 
+private:
+	CUnit *NewSlotUnit();
+
 private:
 	std::vector<CUnit *> units;
 	std::vector<CUnit *> unitSlots;
+	std::vector<CUnit *> unitSlabs;    /// blocks of UnitSlabSize contiguous units
 	std::list<CUnit *> releasedUnits;
 	CUnit *lastCreated;
+
+	static const unsigned int UnitSlabSize = 256; /// number of units in a slab
 };
 
 
@@ -34,6 +34,7 @@
 
 #include "vec2i.h"
 class CUnit;
+class CViewportTerrain;
 
 /**
 **  A map viewport.
@@ -121,6 +122,9 @@ public:
 	int MapHeight;            /// Height in map tiles
 
 	CUnit *Unit;              /// Bound to this unit
+
+private:
+	mutable CViewportTerrain *Terrain; /// Terrain drawn in the previous frames
 };
 
 //@}
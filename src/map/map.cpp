@@ -39,7 +39,10 @@
 #include "map.h"
 
 #include "iolib.h"
+#include "pathfinder.h"
 #include "player.h"
+#include "snapshot.h"
+#include "sync_digest.h"
 #include "tileset.h"
 #include "unit.h"
 #include "unit_manager.h"
@@ -76,6 +79,7 @@ void CMap::MarkSeenTile(CMapField &mf)
 		return;
 	}
 	mf.playerInfo.SeenTile = tile;
+	MarkTerrainChanged(mf);
 
 #ifdef MINIMAP_UPDATE
 	//rb - GRRRRRRRRRRRR
@@ -125,19 +129,50 @@ void CMap::MarkSeenTile(CMapField &mf)
 #endif
 }
 
+/**
+**  Mark the terrain of a field to be redrawn by the viewports, which
+**  keep the terrain drawn in the previous frames.
+**
+**  @param mf  Field whose graphic tile or seen tile changed.
+*/
+void CMap::MarkTerrainChanged(const CMapField &mf)
+{
+	const unsigned int index = mf.playerInfo.Index;
+
+	if (index < this->TerrainChangedFlags.size() && !this->TerrainChangedFlags[index]) {
+		this->TerrainChangedFlags[index] = true;
+		this->ChangedTerrain.push_back(index);
+	}
+}
+
+/**
+**  Forget the changed terrain, called once all the viewports are drawn.
+*/
+void CMap::ClearTerrainChanges()
+{
+	for (size_t i = 0; i != this->ChangedTerrain.size(); ++i) {
+		this->TerrainChangedFlags[this->ChangedTerrain[i]] = false;
+	}
+	this->ChangedTerrain.clear();
+}
+
 /**
 **  Reveal the entire map.
 */
 void CMap::Reveal()
 {
+	const int size = this->Info.MapWidth * this->Info.MapHeight;
+
 	//  Mark every explored tile as visible. 1 turns into 2.
-	for (int i = 0; i != this->Info.MapWidth * this->Info.MapHeight; ++i) {
-		CMapField &mf = *this->Field(i);
-		CMapFieldPlayerInfo &playerInfo = mf.playerInfo;
-		for (int p = 0; p < PlayerMax; ++p) {
-			playerInfo.Visible[p] = std::max<unsigned short>(1, playerInfo.Visible[p]);
+	for (int p = 0; p < PlayerMax; ++p) {
+		unsigned short *visible = this->Visible[p];
+		for (int i = 0; i != size; ++i) {
+			visible[i] = std::max<unsigned short>(1, visible[i]);
 		}
-		MarkSeenTile(mf);
+	}
+	for (int i = 0; i != size; ++i) {
+		MarkSeenTile(*this->Field(i));
+		UI.Minimap.UpdateSeenXY(i);
 	}
 	//  Global seen recount. Simple and effective.
 	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
@@ -281,6 +316,7 @@ void PreprocessMap()
 		for (int iy = 0; iy < Map.Info.MapHeight; ++iy) {
 			CMapField &mf = *Map.Field(ix, iy);
 			mf.playerInfo.SeenTile = mf.getGraphicTile();
+			Map.MarkTerrainChanged(mf);
 		}
 	}
 	// it is required for fixing the wood that all tiles are marked as seen!
@@ -308,8 +344,12 @@ void CMapInfo::Clear()
 	this->MapUID = 0;
 }
 
-CMap::CMap() : Fields(NULL), NoFogOfWar(false), TileGraphic(NULL)
+CMap::CMap() : Fields(NULL), NoFogOfWar(false), TerrainGeneration(0), TileGraphic(NULL)
 {
+	memset(Visible, 0, sizeof(Visible));
+	memset(VisCloak, 0, sizeof(VisCloak));
+	memset(Radar, 0, sizeof(Radar));
+	memset(RadarJammer, 0, sizeof(RadarJammer));
 	Tileset = new CTileset;
 }
 
@@ -325,7 +365,48 @@ void CMap::Create()
 {
 	Assert(!this->Fields);
 
-	this->Fields = new CMapField[this->Info.MapWidth * this->Info.MapHeight];
+	const unsigned int size = this->Info.MapWidth * this->Info.MapHeight;
+
+	this->Fields = new CMapField[size];
+	for (unsigned int i = 0; i != size; ++i) {
+		this->Fields[i].playerInfo.Index = i;
+	}
+	for (int p = 0; p != PlayerMax; ++p) {
+		this->Visible[p] = new unsigned short[size];
+		this->VisCloak[p] = new unsigned char[size];
+		this->Radar[p] = new unsigned char[size];
+		this->RadarJammer[p] = new unsigned char[size];
+		memset(this->Visible[p], 0, size * sizeof(unsigned short));
+		memset(this->VisCloak[p], 0, size);
+		memset(this->Radar[p], 0, size);
+		memset(this->RadarJammer[p], 0, size);
+	}
+	this->UnitBuckets.Init(this->Info.MapWidth, this->Info.MapHeight);
+	this->ChangedTerrain.clear();
+	this->TerrainChangedFlags.assign(size, false);
+	++this->TerrainGeneration;
+}
+
+/**
+**  Free the map table and the per player planes.
+*/
+void CMap::FreeFields()
+{
+	delete[] this->Fields;
+	this->Fields = NULL;
+	for (int p = 0; p != PlayerMax; ++p) {
+		delete[] this->Visible[p];
+		delete[] this->VisCloak[p];
+		delete[] this->Radar[p];
+		delete[] this->RadarJammer[p];
+		this->Visible[p] = NULL;
+		this->VisCloak[p] = NULL;
+		this->Radar[p] = NULL;
+		this->RadarJammer[p] = NULL;
+	}
+	this->UnitBuckets.Clean();
+	this->ChangedTerrain.clear();
+	this->TerrainChangedFlags.clear();
 }
 
 /**
@@ -342,12 +423,11 @@ void CMap::Init()
 */
 void CMap::Clean()
 {
-	delete[] this->Fields;
+	this->FreeFields();
 
 	// Tileset freed by Tileset?
 
 	this->Info.Clear();
-	this->Fields = NULL;
 	this->NoFogOfWar = false;
 	this->Tileset->clear();
 	this->TileModelsFileName.clear();
@@ -394,6 +474,69 @@ void CMap::Save(CFile &file) const
 	file.printf("}})\n");
 }
 
+/**
+**  Save the map to a snapshot.
+**
+**  The tile models are loaded by the Lua head of the snapshot. The
+**  explored tiles follow the fields, as one plane of bytes per player.
+**
+**  @param snapshot  Output snapshot.
+*/
+void CMap::Save(CSnapshotWriter &snapshot) const
+{
+	const int size = this->Info.MapWidth * this->Info.MapHeight;
+
+	snapshot.String(this->Info.Description);
+	snapshot.Pos(Vec2i(this->Info.MapWidth, this->Info.MapHeight));
+	snapshot.Bool(this->NoFogOfWar);
+	snapshot.String(this->Info.Filename);
+	for (int i = 0; i != size; ++i) {
+		this->Fields[i].Save(snapshot);
+	}
+	std::vector<unsigned char> explored(size);
+	for (int p = 0; p != PlayerMax; ++p) {
+		for (int i = 0; i != size; ++i) {
+			explored[i] = this->Visible[p][this->Fields[i].playerInfo.Index] == 1;
+		}
+		snapshot.Bytes(&explored[0], size);
+	}
+}
+
+/**
+**  Load the map from a snapshot.
+**
+**  @param snapshot  Input snapshot.
+*/
+void CMap::Load(CSnapshotReader &snapshot)
+{
+	this->Info.Description = snapshot.String();
+	const Vec2i mapSize = snapshot.Pos();
+	if (mapSize.x <= 0 || mapSize.x > MaxMapWidth || mapSize.y <= 0 || mapSize.y > MaxMapHeight) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	this->Info.MapWidth = mapSize.x;
+	this->Info.MapHeight = mapSize.y;
+	this->FreeFields();
+	this->Create();
+	this->NoFogOfWar = snapshot.Bool();
+	this->Info.Filename = snapshot.String();
+
+	const int size = this->Info.MapWidth * this->Info.MapHeight;
+	for (int i = 0; i != size; ++i) {
+		this->Fields[i].Load(snapshot);
+	}
+	std::vector<unsigned char> explored(size);
+	for (int p = 0; p != PlayerMax; ++p) {
+		snapshot.Bytes(&explored[0], size);
+		for (int i = 0; i != size; ++i) {
+			if (explored[i]) {
+				this->Visible[p][this->Fields[i].playerInfo.Index] = 1;
+			}
+		}
+	}
+}
+
 /*----------------------------------------------------------------------------
 -- Map Tile Update Functions
 ----------------------------------------------------------------------------*/
@@ -472,11 +615,14 @@ void CMap::FixTile(unsigned short type, int seen, const Vec2i &pos)
 	if (tile == -1) { // No valid wood remove it.
 		if (seen) {
 			mf.playerInfo.SeenTile = removedtile;
+			this->MarkTerrainChanged(mf);
 			this->FixNeighbors(type, seen, pos);
 		} else {
 			mf.setGraphicTile(removedtile);
 			mf.Flags &= ~flags;
 			mf.Value = 0;
+			UpdateSyncDigest(mf);
+			PathfinderMapChanged(pos);
 			UI.Minimap.UpdateXY(pos);
 		}
 	} else if (seen && this->Tileset->isEquivalentTile(tile, mf.playerInfo.SeenTile)) { //Same Type
@@ -484,6 +630,7 @@ void CMap::FixTile(unsigned short type, int seen, const Vec2i &pos)
 	} else {
 		if (seen) {
 			mf.playerInfo.SeenTile = tile;
+			this->MarkTerrainChanged(mf);
 		} else {
 			mf.setGraphicTile(tile);
 		}
@@ -524,6 +671,8 @@ void CMap::ClearWoodTile(const Vec2i &pos)
 	mf.setGraphicTile(this->Tileset->getRemovedTreeTile());
 	mf.Flags &= ~(MapFieldForest | MapFieldUnpassable);
 	mf.Value = 0;
+	UpdateSyncDigest(mf);
+	PathfinderMapChanged(pos);
 
 	UI.Minimap.UpdateXY(pos);
 	FixNeighbors(MapFieldForest, 0, pos);
@@ -542,6 +691,8 @@ void CMap::ClearRockTile(const Vec2i &pos)
 	mf.setGraphicTile(this->Tileset->getRemovedRockTile());
 	mf.Flags &= ~(MapFieldRocks | MapFieldUnpassable);
 	mf.Value = 0;
+	UpdateSyncDigest(mf);
+	PathfinderMapChanged(pos);
 
 	UI.Minimap.UpdateXY(pos);
 	FixNeighbors(MapFieldRocks, 0, pos);
@@ -575,12 +726,11 @@ void CMap::RegenerateForestTile(const Vec2i &pos)
 	//    Allow general updates to any tiletype that regrows
 
 	const unsigned int occupedFlag = (MapFieldWall | MapFieldUnpassable | MapFieldLandUnit | MapFieldBuilding);
-	++mf.Value;
 	if (mf.Value < ForestRegeneration) {
-		return;
+		++mf.Value;
+		UpdateSyncDigest(mf);
 	}
-	mf.Value = ForestRegeneration;
-	if ((mf.Flags & occupedFlag) || pos.y == 0) {
+	if (mf.Value < ForestRegeneration || (mf.Flags & occupedFlag) || pos.y == 0) {
 		return;
 	}
 	CMapField &topMf = *(&mf - this->Info.MapWidth);
@@ -595,6 +745,10 @@ void CMap::RegenerateForestTile(const Vec2i &pos)
 		mf.setGraphicTile(this->Tileset->getBottomOneTreeTile());
 		mf.Value = 0;
 		mf.Flags |= MapFieldForest | MapFieldUnpassable;
+		UpdateSyncDigest(topMf);
+		UpdateSyncDigest(mf);
+		PathfinderMapChanged(pos);
+		PathfinderMapChanged(pos + Vec2i(0, -1));
 		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 			MarkSeenTile(mf);
 		}
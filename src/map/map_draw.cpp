@@ -45,7 +45,184 @@
 #include "video.h"
 
 
-CViewport::CViewport() : MapWidth(0), MapHeight(0), Unit(NULL)
+/**
+**  Terrain of a viewport, kept between the frames in software mode.
+**
+**  The surface holds the tiles of the viewport. Only the tiles of
+**  CMap::ChangedTerrain and those uncovered by scrolling are drawn again,
+**  the rest of the terrain is blitted at once.
+*/
+class CViewportTerrain
+{
+public:
+	CViewportTerrain() : Surface(NULL), Back(NULL), Screen(NULL), Graphic(NULL),
+		Generation(0), RevealMap(false), Width(0), Height(0) {}
+	~CViewportTerrain() { Free(); }
+
+	void Draw(const CViewport &vp);
+
+private:
+	void Free();
+	void Create(int width, int height);
+	void ScrollTo(const Vec2i &mapPos);
+	void DrawTile(const Vec2i &tilePos);
+	void DrawTiles();
+
+	SDL_Surface *Surface;        /// Tiles of the viewport
+	SDL_Surface *Back;           /// Surface to scroll into
+	const SDL_Surface *Screen;   /// Screen the surfaces are made for
+	const CGraphic *Graphic;     /// Tile graphic drawn
+	unsigned int Generation;     /// Map fields drawn, see CMap::TerrainGeneration
+	bool RevealMap;              /// Drawn with ReplayRevealMap
+	Vec2i Pos;                   /// Map tile of the top-left corner
+	int Width;                   /// Width in tiles
+	int Height;                  /// Height in tiles
+};
+
+void CViewportTerrain::Free()
+{
+	if (Surface) {
+		SDL_FreeSurface(Surface);
+		Surface = NULL;
+	}
+	if (Back) {
+		SDL_FreeSurface(Back);
+		Back = NULL;
+	}
+}
+
+/**
+**  Create the surfaces for width x height tiles, in the screen format.
+*/
+void CViewportTerrain::Create(int width, int height)
+{
+	const SDL_PixelFormat *f = TheScreen->format;
+	const int w = width * PixelTileSize.x;
+	const int h = height * PixelTileSize.y;
+
+	Free();
+	Surface = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, f->BitsPerPixel, f->Rmask, f->Gmask, f->Bmask, 0);
+	Back = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, f->BitsPerPixel, f->Rmask, f->Gmask, f->Bmask, 0);
+	Screen = TheScreen;
+	Graphic = Map.TileGraphic;
+	Generation = Map.TerrainGeneration;
+	RevealMap = ReplayRevealMap != 0;
+	Width = width;
+	Height = height;
+}
+
+/**
+**  Draw a tile of the map into the surface.
+**
+**  @param tilePos  Map tile position, inside the surface.
+*/
+void CViewportTerrain::DrawTile(const Vec2i &tilePos)
+{
+	SDL_Rect drect = {Sint16((tilePos.x - Pos.x) * PixelTileSize.x), Sint16((tilePos.y - Pos.y) * PixelTileSize.y),
+					  Uint16(PixelTileSize.x), Uint16(PixelTileSize.y)
+					 };
+
+	SDL_FillRect(Surface, &drect, 0);
+	if (!Map.Info.IsPointOnMap(tilePos)) {
+		return;
+	}
+	const CMapField &mf = *Map.Field(tilePos);
+	const unsigned int tile = RevealMap ? mf.getGraphicTile() : mf.playerInfo.SeenTile;
+	SDL_Rect srect = {Graphic->frame_map[tile].x, Graphic->frame_map[tile].y,
+					  Uint16(Graphic->Width), Uint16(Graphic->Height)
+					 };
+
+	SDL_BlitSurface(Graphic->Surface, &srect, Surface, &drect);
+}
+
+/**
+**  Draw all the tiles of the surface.
+*/
+void CViewportTerrain::DrawTiles()
+{
+	for (int y = 0; y != Height; ++y) {
+		for (int x = 0; x != Width; ++x) {
+			DrawTile(Pos + Vec2i(x, y));
+		}
+	}
+}
+
+/**
+**  Move the surface to a new map position.
+**
+**  The tiles still inside are moved, only the uncovered tiles are drawn.
+**
+**  @param mapPos  Map tile of the new top-left corner.
+*/
+void CViewportTerrain::ScrollTo(const Vec2i &mapPos)
+{
+	const Vec2i delta = mapPos - Pos;
+
+	Pos = mapPos;
+	if (abs(delta.x) >= Width || abs(delta.y) >= Height) {
+		DrawTiles();
+		return;
+	}
+	SDL_Rect srect = {Sint16(std::max(0, (int)delta.x) * PixelTileSize.x), Sint16(std::max(0, (int)delta.y) * PixelTileSize.y),
+					  Uint16((Width - abs(delta.x)) * PixelTileSize.x), Uint16((Height - abs(delta.y)) * PixelTileSize.y)
+					 };
+	SDL_Rect drect = {Sint16(std::max(0, -delta.x) * PixelTileSize.x), Sint16(std::max(0, -delta.y) * PixelTileSize.y), 0, 0};
+
+	SDL_BlitSurface(Surface, &srect, Back, &drect);
+	std::swap(Surface, Back);
+
+	for (int y = 0; y != Height; ++y) {
+		for (int x = 0; x != Width; ++x) {
+			const int oldX = x + delta.x;
+			const int oldY = y + delta.y;
+
+			if (oldX < 0 || oldX >= Width || oldY < 0 || oldY >= Height) {
+				DrawTile(Pos + Vec2i(x, y));
+			}
+		}
+	}
+}
+
+/**
+**  Draw the terrain of the viewport.
+**
+**  The surface is made again when the viewport size, the screen, the
+**  tile graphic or the map changed.
+*/
+void CViewportTerrain::Draw(const CViewport &vp)
+{
+	// One more tile, for the last partly shown column and row.
+	const int width = vp.MapWidth + 1;
+	const int height = vp.MapHeight + 1;
+
+	if (Surface == NULL || Width != width || Height != height || Screen != TheScreen
+		|| Graphic != Map.TileGraphic || Generation != Map.TerrainGeneration
+		|| RevealMap != (ReplayRevealMap != 0)) {
+		Create(width, height);
+		Pos = vp.MapPos;
+		DrawTiles();
+	} else if (Pos != vp.MapPos) {
+		ScrollTo(vp.MapPos);
+	}
+	for (size_t i = 0; i != Map.ChangedTerrain.size(); ++i) {
+		const unsigned int index = Map.ChangedTerrain[i];
+		const Vec2i tilePos(index % Map.Info.MapWidth, index / Map.Info.MapWidth);
+
+		if (Pos.x <= tilePos.x && tilePos.x < Pos.x + Width
+			&& Pos.y <= tilePos.y && tilePos.y < Pos.y + Height) {
+			DrawTile(tilePos);
+		}
+	}
+
+	const PixelPos &topLeft = vp.GetTopLeftPos();
+	const PixelSize size = vp.GetBottomRightPos() - topLeft;
+	SDL_Rect srect = {Sint16(vp.Offset.x), Sint16(vp.Offset.y), Uint16(size.x + 1), Uint16(size.y + 1)};
+	SDL_Rect drect = {Sint16(topLeft.x), Sint16(topLeft.y), 0, 0};
+
+	SDL_BlitSurface(Surface, &srect, TheScreen, &drect);
+}
+
+CViewport::CViewport() : MapWidth(0), MapHeight(0), Unit(NULL), Terrain(NULL)
 {
 	this->TopLeftPos.x = this->TopLeftPos.y = 0;
 	this->BottomRightPos.x = this->BottomRightPos.y = 0;
@@ -55,6 +232,7 @@ CViewport::CViewport() : MapWidth(0), MapHeight(0), Unit(NULL)
 
 CViewport::~CViewport()
 {
+	delete Terrain;
 }
 
 bool CViewport::Contains(const PixelPos &screenPos) const
@@ -238,6 +416,16 @@ void CViewport::Center(const PixelPos &mapPixelPos)
 */
 void CViewport::DrawMapBackgroundInViewport() const
 {
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	if (!UseOpenGL)
+#endif
+	{
+		if (Terrain == NULL) {
+			Terrain = new CViewportTerrain;
+		}
+		Terrain->Draw(*this);
+		return;
+	}
 	int ex = this->BottomRightPos.x;
 	int ey = this->BottomRightPos.y;
 	int sy = this->MapPos.y;
@@ -67,6 +67,12 @@ static const int FogTable[16] = {
 
 static std::vector<unsigned short> VisibleTable;
 
+/**
+**  Half widths of the sight circle rows, for each sight range.
+**  CircleSpanTable[range][dy] is the column offset of row dy.
+*/
+static std::vector<std::vector<int> > CircleSpanTable;
+
 static SDL_Surface *OnlyFogSurface;
 static CGraphic *AlphaFogG;
 
@@ -213,7 +219,7 @@ static void UnitsOnTileUnmarkSeen(const CPlayer &player, CMapField &mf, int cloa
 void MapMarkTileSight(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned short *v = &(mf.playerInfo.Visible[player.Index]);
+	unsigned short *v = &Map.Visible[player.Index][index];
 	if (*v == 0 || *v == 1) { // Unexplored or unseen
 		// When there is no fog only unexplored tiles are marked.
 		if (!Map.NoFogOfWar || *v == 0) {
@@ -223,6 +229,7 @@ void MapMarkTileSight(const CPlayer &player, const unsigned int index)
 		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 			Map.MarkSeenTile(mf);
 		}
+		UI.Minimap.UpdateSeenXY(index);
 		return;
 	}
 	Assert(*v != 65535);
@@ -244,7 +251,7 @@ void MapMarkTileSight(const CPlayer &player, const Vec2i &pos)
 void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned short *v = &mf.playerInfo.Visible[player.Index];
+	unsigned short *v = &Map.Visible[player.Index][index];
 	switch (*v) {
 		case 0:  // Unexplored
 		case 1:
@@ -259,6 +266,7 @@ void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
 			if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 				Map.MarkSeenTile(mf);
 			}
+			UI.Minimap.UpdateSeenXY(index);
 		default:  // seen -> seen
 			--*v;
 			break;
@@ -280,7 +288,7 @@ void MapUnmarkTileSight(const CPlayer &player, const Vec2i &pos)
 void MapMarkTileDetectCloak(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned char *v = &mf.playerInfo.VisCloak[player.Index];
+	unsigned char *v = &Map.VisCloak[player.Index][index];
 	if (*v == 0) {
 		UnitsOnTileMarkSeen(player, mf, 1);
 	}
@@ -302,7 +310,7 @@ void MapMarkTileDetectCloak(const CPlayer &player, const Vec2i &pos)
 void MapUnmarkTileDetectCloak(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned char *v = &mf.playerInfo.VisCloak[player.Index];
+	unsigned char *v = &Map.VisCloak[player.Index][index];
 	Assert(*v != 0);
 	if (*v == 1) {
 		UnitsOnTileUnmarkSeen(player, mf, 1);
@@ -315,6 +323,117 @@ void MapUnmarkTileDetectCloak(const CPlayer &player, const Vec2i &pos)
 	MapUnmarkTileDetectCloak(player, Map.getIndex(pos));
 }
 
+/**
+**  Mark or unmark one row of a sight area.
+**
+**  Sight counters are kept in dense per player planes, so a row is a
+**  contiguous span. When no counter of the span is at an edge (where
+**  units get seen or unseen), the whole span is updated in one loop.
+**
+**  @param player  player to mark the sight for (not unit owner)
+**  @param y       row to mark
+**  @param minx    first column to mark
+**  @param maxx    column after the last one to mark
+**  @param marker  Function to mark or unmark sight
+*/
+static void MapSightRow(const CPlayer &player, int y, int minx, int maxx, MapMarkerFunc *marker)
+{
+#ifdef MARKER_ON_INDEX
+	const unsigned int index = y * Map.Info.MapWidth;
+	MapMarkerFunc *const markSight = MapMarkTileSight;
+	MapMarkerFunc *const unmarkSight = MapUnmarkTileSight;
+
+	if (minx < maxx && (marker == markSight || marker == unmarkSight)) {
+		unsigned short *v = Map.Visible[player.Index] + index;
+		unsigned short lowest = 65535;
+		unsigned short highest = 0;
+
+		for (int x = minx; x < maxx; ++x) {
+			lowest = std::min(lowest, v[x]);
+			highest = std::max(highest, v[x]);
+		}
+		if (marker == markSight && lowest >= 2 && highest != 65535) {
+			for (int x = minx; x < maxx; ++x) {
+				++v[x];
+			}
+			return;
+		}
+		if (marker == unmarkSight && lowest > 2) {
+			for (int x = minx; x < maxx; ++x) {
+				--v[x];
+			}
+			return;
+		}
+	}
+	for (int x = minx; x < maxx; ++x) {
+		marker(player, x + index);
+	}
+#else
+	for (Vec2i mpos(minx, y); mpos.x < maxx; ++mpos.x) {
+		marker(player, mpos);
+	}
+#endif
+}
+
+/**
+**  Get the half widths of the rows of a sight circle.
+**
+**  @param range  Radius of the circle.
+**
+**  @return       Table of range + 1 column offsets, indexed by row distance.
+*/
+static const int *GetCircleSpans(int range)
+{
+	if (CircleSpanTable.size() <= (size_t)range) {
+		CircleSpanTable.resize(range + 1);
+	}
+	std::vector<int> &spans = CircleSpanTable[range];
+	if (spans.empty()) {
+		spans.resize(range + 1);
+		for (int dy = 0; dy <= range; ++dy) {
+			spans[dy] = isqrt(square(range + 1) - square(dy) - 1);
+		}
+	}
+	return &spans[0];
+}
+
+/**
+**  Get the columns of a sight area in one row.
+**
+**  @param pos    location of the sight area
+**  @param w      width of the sight area, in square
+**  @param h      height of the sight area, in square
+**  @param range  Radius of the sight area.
+**  @param spans  Half widths of the circle, from GetCircleSpans.
+**  @param y      row to get.
+**  @param minx   OUT: first column of the row.
+**  @param maxx   OUT: column after the last one of the row.
+**
+**  @return       true if the row is part of the sight area.
+*/
+static bool GetSightSpan(const Vec2i &pos, int w, int h, int range, const int *spans,
+						 int y, int *minx, int *maxx)
+{
+	int offsetx;
+
+	if (y < pos.y) { // Up hemi-cyle
+		if (pos.y - y > range) {
+			return false;
+		}
+		offsetx = spans[pos.y - y];
+	} else if (y < pos.y + h) {
+		offsetx = range;
+	} else { // bottom hemi-cycle
+		if (y - pos.y - h >= range) {
+			return false;
+		}
+		offsetx = spans[y - pos.y - h];
+	}
+	*minx = std::max(0, pos.x - offsetx);
+	*maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
+	return *minx < *maxx;
+}
+
 /**
 **  Mark the sight of unit. (Explore and make visible.)
 **
@@ -331,59 +450,66 @@ void MapSight(const CPlayer &player, const Vec2i &pos, int w, int h, int range,
 	if (!range) {
 		return;
 	}
-	// Up hemi-cyle
-	const int miny = std::max(-range, 0 - pos.y);
-	for (int offsety = miny; offsety != 0; ++offsety) {
-		const int offsetx = isqrt(square(range + 1) - square(-offsety) - 1);
-		const int minx = std::max(0, pos.x - offsetx);
-		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
-		Vec2i mpos(minx, pos.y + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
+	const int *spans = GetCircleSpans(range);
+	const int miny = std::max(0, pos.y - range);
+	const int maxy = std::min(Map.Info.MapHeight, pos.y + h + range);
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
-		}
-	}
-	for (int offsety = 0; offsety < h; ++offsety) {
-		const int minx = std::max(0, pos.x - range);
-		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + range);
-		Vec2i mpos(minx, pos.y + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
+	for (int y = miny; y < maxy; ++y) {
+		int minx;
+		int maxx;
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
+		if (GetSightSpan(pos, w, h, range, spans, y, &minx, &maxx)) {
+			MapSightRow(player, y, minx, maxx, marker);
 		}
 	}
-	// bottom hemi-cycle
-	const int maxy = std::min(range, Map.Info.MapHeight - pos.y - h);
-	for (int offsety = 0; offsety < maxy; ++offsety) {
-		const int offsetx = isqrt(square(range + 1) - square(offsety) - 1);
-		const int minx = std::max(0, pos.x - offsetx);
-		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
-		Vec2i mpos(minx, pos.y + h + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
+}
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
+/**
+**  Move the sight of unit. Only the tiles which are left are unmarked
+**  and only the tiles which are entered are marked, so a step of a unit
+**  touches the edge of its sight instead of the whole area.
+**
+**  @param player    player to mark the sight for (not unit owner)
+**  @param oldPos    location the sight was marked at
+**  @param newPos    location to mark
+**  @param w         width to mark, in square
+**  @param h         height to mark, in square
+**  @param range     Radius to mark.
+**  @param unmarker  Function to unmark sight
+**  @param marker    Function to mark sight
+*/
+void MapSightMove(const CPlayer &player, const Vec2i &oldPos, const Vec2i &newPos, int w, int h,
+				  int range, MapMarkerFunc *unmarker, MapMarkerFunc *marker)
+{
+	// Units under construction have no sight range.
+	if (!range || oldPos == newPos) {
+		return;
+	}
+	const int *spans = GetCircleSpans(range);
+	const int miny = std::max(0, std::min(oldPos.y, newPos.y) - range);
+	const int maxy = std::min(Map.Info.MapHeight, std::max(oldPos.y, newPos.y) + h + range);
+
+	for (int y = miny; y < maxy; ++y) {
+		int oldMinx;
+		int oldMaxx;
+		int newMinx;
+		int newMaxx;
+
+		if (!GetSightSpan(oldPos, w, h, range, spans, y, &oldMinx, &oldMaxx)) {
+			oldMinx = oldMaxx = 0;
+		}
+		if (!GetSightSpan(newPos, w, h, range, spans, y, &newMinx, &newMaxx)) {
+			newMinx = newMaxx = oldMaxx;
+		}
+		// Left tiles: old row without the new one.
+		MapSightRow(player, y, oldMinx, std::min(oldMaxx, newMinx), unmarker);
+		MapSightRow(player, y, std::max(oldMinx, newMaxx), oldMaxx, unmarker);
+		if (oldMinx == oldMaxx) {
+			oldMinx = oldMaxx = newMaxx;
 		}
+		// Entered tiles: new row without the old one.
+		MapSightRow(player, y, newMinx, std::min(newMaxx, oldMinx), marker);
+		MapSightRow(player, y, std::max(newMinx, oldMaxx), newMaxx, marker);
 	}
 }
 
@@ -750,6 +876,7 @@ void CMap::InitFogOfWar()
 void CMap::CleanFogOfWar()
 {
 	VisibleTable.clear();
+	CircleSpanTable.clear();
 
 	CGraphic::Free(Map.FogGraphic);
 	FogGraphic = NULL;
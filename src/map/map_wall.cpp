@@ -37,6 +37,8 @@
 
 #include "stratagus.h"
 #include "map.h"
+#include "pathfinder.h"
+#include "sync_digest.h"
 #include "tileset.h"
 #include "ui.h"
 #include "player.h"
@@ -132,6 +134,7 @@ void MapFixSeenWallTile(const Vec2i &pos)
 
 	if (mf.playerInfo.SeenTile != wallTile) { // Already there!
 		mf.playerInfo.SeenTile = wallTile;
+		Map.MarkTerrainChanged(mf);
 		// FIXME: can this only happen if seen?
 		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 			UI.Minimap.UpdateSeenXY(pos);
@@ -214,6 +217,8 @@ void CMap::RemoveWall(const Vec2i &pos)
 
 	MapFixWallTile(pos);
 	mf.Flags &= ~(MapFieldHuman | MapFieldWall | MapFieldUnpassable);
+	UpdateSyncDigest(mf);
+	PathfinderMapChanged(pos);
 	MapFixWallNeighbors(pos);
 	UI.Minimap.UpdateXY(pos);
 
@@ -242,6 +247,8 @@ void CMap::SetWall(const Vec2i &pos, bool humanwall)
 		const int value = UnitTypeOrcWall->DefaultStat.Variables[HP_INDEX].Max;
 		mf.setTileIndex(*Tileset, Tileset->getOrcWallTileIndex(0), value);
 	}
+	UpdateSyncDigest(mf);
+	PathfinderMapChanged(pos);
 
 	UI.Minimap.UpdateXY(pos);
 	MapFixWallTile(pos);
@@ -267,6 +274,7 @@ void CMap::HitWall(const Vec2i &pos, unsigned damage)
 		RemoveWall(pos);
 	} else {
 		this->Field(pos)->Value = v - damage;
+		UpdateSyncDigest(*this->Field(pos));
 		MapFixWallTile(pos);
 	}
 }
@@ -41,6 +41,7 @@
 #include "map.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "tileset.h"
 #include "unit.h"
 #include "unit_manager.h"
@@ -53,6 +54,7 @@ CMapField::CMapField() :
 	Flags(0),
 	cost(0),
 	Value(0),
+	SyncValue(0),
 	UnitCache()
 {}
 
@@ -92,13 +94,20 @@ void CMapField::setTileIndex(const CTileset &tileset, unsigned int tileIndex, in
 #ifdef DEBUG
 	this->tilesetTile = tileIndex;
 #endif
+	Map.MarkTerrainChanged(*this);
+}
+
+void CMapField::setGraphicTile(unsigned int tile)
+{
+	this->tile = tile;
+	Map.MarkTerrainChanged(*this);
 }
 
 void CMapField::Save(CFile &file) const
 {
 	file.printf("  {%3d, %3d, %2d, %2d", tile, playerInfo.SeenTile, Value, cost);
 	for (int i = 0; i != PlayerMax; ++i) {
-		if (playerInfo.Visible[i] == 1) {
+		if (Map.Visible[i][playerInfo.Index] == 1) {
 			file.printf(", \"explored\", %d", i);
 		}
 	}
@@ -170,7 +179,7 @@ void CMapField::parse(lua_State *l)
 
 		if (!strcmp(value, "explored")) {
 			++j;
-			this->playerInfo.Visible[LuaToNumber(l, -1, j + 1)] = 1;
+			Map.Visible[LuaToNumber(l, -1, j + 1)][playerInfo.Index] = 1;
 		} else if (!strcmp(value, "human")) {
 			this->Flags |= MapFieldHuman;
 		} else if (!strcmp(value, "land")) {
@@ -203,6 +212,33 @@ void CMapField::parse(lua_State *l)
 	}
 }
 
+/// Flags of a field kept by the saved games
+static const unsigned short SavedFieldFlags = MapFieldHuman | MapFieldLandAllowed
+		| MapFieldCoastAllowed | MapFieldWaterAllowed | MapFieldNoBuilding
+		| MapFieldUnpassable | MapFieldWall | MapFieldRocks | MapFieldForest
+		| MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit | MapFieldBuilding;
+
+/**
+**  Save a field to a snapshot, the explored flags are saved by the map.
+*/
+void CMapField::Save(CSnapshotWriter &snapshot) const
+{
+	snapshot.Varint(tile);
+	snapshot.Varint(playerInfo.SeenTile);
+	snapshot.Varint(Value);
+	snapshot.Varint(cost);
+	snapshot.Varint(Flags & SavedFieldFlags);
+}
+
+void CMapField::Load(CSnapshotReader &snapshot)
+{
+	this->tile = snapshot.Varint();
+	this->playerInfo.SeenTile = snapshot.Varint();
+	this->Value = snapshot.Varint();
+	this->cost = snapshot.Varint();
+	this->Flags |= snapshot.Varint() & SavedFieldFlags;
+}
+
 /// Check if a field flags.
 bool CMapField::CheckMask(int mask) const
 {
@@ -268,10 +304,11 @@ unsigned char CMapFieldPlayerInfo::TeamVisibilityState(const CPlayer &player) co
 	}
 	for (int i = 0; i != PlayerMax ; ++i) {
 		if (player.IsBothSharedVision(Players[i])) {
-			maxVision = std::max<unsigned char>(maxVision, Visible[i]);
-			if (maxVision >= 2) {
+			const unsigned short visible = Map.Visible[i][Index];
+			if (visible >= 2) {
 				return 2;
 			}
+			maxVision = std::max<unsigned char>(maxVision, visible);
 		}
 	}
 	if (maxVision == 1 && Map.NoFogOfWar) {
@@ -282,13 +319,13 @@ unsigned char CMapFieldPlayerInfo::TeamVisibilityState(const CPlayer &player) co
 
 bool CMapFieldPlayerInfo::IsExplored(const CPlayer &player) const
 {
-	return Visible[player.Index] != 0;
+	return Map.Visible[player.Index][Index] != 0;
 }
 
 bool CMapFieldPlayerInfo::IsVisible(const CPlayer &player) const
 {
 	const bool fogOfWar = !Map.NoFogOfWar;
-	return Visible[player.Index] >= 2 || (!fogOfWar && IsExplored(player));
+	return Map.Visible[player.Index][Index] >= 2 || (!fogOfWar && IsExplored(player));
 }
 
 bool CMapFieldPlayerInfo::IsTeamVisible(const CPlayer &player) const
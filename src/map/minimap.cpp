@@ -34,6 +34,7 @@
 ----------------------------------------------------------------------------*/
 
 #include <string.h>
+#include <vector>
 
 #include "stratagus.h"
 
@@ -89,6 +90,23 @@ static int Map2MinimapY[MaxMapHeight];     /// fast conversion table
 static int MinimapScaleX;                  /// Minimap scale to fit into window
 static int MinimapScaleY;                  /// Minimap scale to fit into window
 
+// The minimap is made of layers: the terrain surface, the vision of the
+// tiles and the units drawn over them. Only the rows of the tiles whose
+// vision or terrain changed, and those of the units, are composed again.
+static std::vector<unsigned char> MinimapTileVision; /// vision of each map tile
+static std::vector<unsigned int> MinimapChangedTiles; /// tiles changed since the last update
+static std::vector<bool> MinimapTileChanged;       /// tiles in MinimapChangedTiles
+static std::vector<bool> MinimapMapRowChanged;     /// map rows to compose again
+static std::vector<bool> MinimapUnitRows;          /// minimap rows with units drawn
+static bool MinimapUpdateAll;                      /// compose the whole minimap
+
+/// State the vision of all the tiles depends on
+static const CPlayer *MinimapPlayer;
+static int MinimapRevealMap;
+static bool MinimapNoFogOfWar;
+static bool MinimapWithTerrain;
+static bool MinimapTransparent;
+
 #define MAX_MINIMAP_EVENTS 8
 
 struct MinimapEvent {
@@ -185,6 +203,14 @@ void CMinimap::Create()
 
 	UpdateTerrain();
 
+	const size_t size = Map.Info.MapWidth * Map.Info.MapHeight;
+	MinimapTileVision.assign(size, 0);
+	MinimapChangedTiles.clear();
+	MinimapTileChanged.assign(size, false);
+	MinimapMapRowChanged.assign(Map.Info.MapHeight, false);
+	MinimapUnitRows.assign(H, false);
+	MinimapUpdateAll = true;
+
 	NumMinimapEvents = 0;
 }
 
@@ -425,6 +451,44 @@ void CMinimap::UpdateXY(const Vec2i &pos)
 		SDL_UnlockSurface(MinimapTerrainSurface);
 	}
 	SDL_UnlockSurface(Map.TileGraphic->Surface);
+
+	UpdateSeenXY(pos);
+}
+
+/**
+**  Mark a tile whose vision changed, to draw it again at the next update.
+**
+**  @param pos  The map position to update in the minimap
+*/
+void CMinimap::UpdateSeenXY(const Vec2i &pos)
+{
+	UpdateSeenXY(Map.getIndex(pos));
+}
+
+/**
+**  Mark a tile whose vision changed, to draw it again at the next update.
+**
+**  @param index  Index of the map field
+*/
+void CMinimap::UpdateSeenXY(unsigned int index)
+{
+	if (index < MinimapTileChanged.size() && !MinimapTileChanged[index]) {
+		MinimapTileChanged[index] = true;
+		MinimapChangedTiles.push_back(index);
+	}
+}
+
+/**
+**  Vision of a tile shown on the minimap.
+**
+**  @return  0 unexplored, 1 explored, >1 visible.
+*/
+static unsigned char MinimapVision(unsigned int index)
+{
+	if (ReplayRevealMap) {
+		return 2;
+	}
+	return Map.Field(index)->playerInfo.TeamVisibilityState(*ThisPlayer);
 }
 
 /**
@@ -471,6 +535,9 @@ static void DrawUnitOn(CUnit &unit, int red_phase)
 	if (my + h0 >= UI.Minimap.H) { // clip bottom side
 		h0 = UI.Minimap.H - my;
 	}
+	for (int y = my; y <= my + h0 && y < UI.Minimap.H; ++y) {
+		MinimapUnitRows[y] = true;
+	}
 	int bpp = 0;
 #if defined(USE_OPENGL) || defined(USE_GLES)
 	if (!UseOpenGL)
@@ -501,26 +568,44 @@ static void DrawUnitOn(CUnit &unit, int red_phase)
 }
 
 /**
-**  Update the minimap with the current game information
+**  Compose the rows of the minimap from the terrain and the vision.
+**
+**  @param all  Compose all the rows, else only those of the changed map
+**              rows and those where units were drawn.
 */
-void CMinimap::Update()
+void CMinimap::UpdateRows(bool all)
 {
-	static int red_phase;
+	std::vector<bool> rows(H, all);
 
-	int red_phase_changed = red_phase != (int)((FrameCounter / FRAMES_PER_SECOND) & 1);
-	if (red_phase_changed) {
-		red_phase = !red_phase;
+	if (!all) {
+		for (int my = 0; my < H; ++my) {
+			rows[my] = MinimapUnitRows[my] || MinimapMapRowChanged[Minimap2MapY[my] / Map.Info.MapWidth];
+		}
 	}
 
-	// Clear Minimap background if not transparent
-	if (!Transparent) {
+	// Clear the rows if not transparent, then draw the terrain
+	for (int my = 0; my < H; ++my) {
+		if (!rows[my] || (Transparent && !WithTerrain)) {
+			continue;
+		}
 #if defined(USE_OPENGL) || defined(USE_GLES)
 		if (UseOpenGL) {
-			memset(MinimapSurfaceGL, 0, MinimapTextureWidth * MinimapTextureHeight * 4);
+			unsigned char *row = &MinimapSurfaceGL[my * MinimapTextureWidth * 4];
+			if (WithTerrain) {
+				memcpy(row, &MinimapTerrainSurfaceGL[my * MinimapTextureWidth * 4], MinimapTextureWidth * 4);
+			} else {
+				memset(row, 0, MinimapTextureWidth * 4);
+			}
 		} else
 #endif
 		{
-			SDL_FillRect(MinimapSurface, NULL, SDL_MapRGB(MinimapSurface->format, 0, 0, 0));
+			SDL_Rect rect = {0, Sint16(my), Uint16(W), 1};
+			if (WithTerrain) {
+				SDL_Rect drect = rect;
+				SDL_BlitSurface(MinimapTerrainSurface, &rect, MinimapSurface, &drect);
+			} else {
+				SDL_FillRect(MinimapSurface, &rect, SDL_MapRGB(MinimapSurface->format, 0, 0, 0));
+			}
 		}
 	}
 
@@ -532,40 +617,16 @@ void CMinimap::Update()
 #endif
 	{
 		bpp = MinimapSurface->format->BytesPerPixel;
-	}
-
-	//
-	// Draw the terrain
-	//
-	if (WithTerrain) {
-#if defined(USE_OPENGL) || defined(USE_GLES)
-		if (UseOpenGL) {
-			memcpy(MinimapSurfaceGL, MinimapTerrainSurfaceGL, MinimapTextureWidth * MinimapTextureHeight * 4);
-		} else
-#endif
-		{
-			SDL_BlitSurface(MinimapTerrainSurface, NULL, MinimapSurface, NULL);
-		}
-	}
-
-#if defined(USE_OPENGL) || defined(USE_GLES)
-	if (!UseOpenGL)
-#endif
-	{
 		SDL_LockSurface(MinimapSurface);
-		SDL_LockSurface(MinimapTerrainSurface);
 	}
 
 	for (int my = 0; my < H; ++my) {
+		if (!rows[my]) {
+			continue;
+		}
 		for (int mx = 0; mx < W; ++mx) {
-			int visiontype; // 0 unexplored, 1 explored, >1 visible.
-
-			if (ReplayRevealMap) {
-				visiontype = 2;
-			} else {
-				const Vec2i tilePos(Minimap2MapX[mx], Minimap2MapY[my] / Map.Info.MapWidth);
-				visiontype = Map.Field(tilePos)->playerInfo.TeamVisibilityState(*ThisPlayer);
-			}
+			// 0 unexplored, 1 explored, >1 visible.
+			const int visiontype = MinimapTileVision[Minimap2MapX[mx] + Minimap2MapY[my]];
 
 			if (visiontype == 0 || (visiontype == 1 && ((mx & 1) != (my & 1)))) {
 #if defined(USE_OPENGL) || defined(USE_GLES)
@@ -589,12 +650,72 @@ void CMinimap::Update()
 	if (!UseOpenGL)
 #endif
 	{
-		SDL_UnlockSurface(MinimapTerrainSurface);
+		SDL_UnlockSurface(MinimapSurface);
+	}
+}
+
+/**
+**  Update the minimap with the current game information
+**
+**  Only the tiles marked by UpdateXY and UpdateSeenXY since the last
+**  update are looked at again. Everything is drawn again when the vision
+**  of all the tiles may have changed: other player, map revealed, fog of
+**  war switched.
+*/
+void CMinimap::Update()
+{
+	static int red_phase;
+
+	int red_phase_changed = red_phase != (int)((FrameCounter / FRAMES_PER_SECOND) & 1);
+	if (red_phase_changed) {
+		red_phase = !red_phase;
+	}
+
+	if (MinimapPlayer != ThisPlayer || MinimapRevealMap != ReplayRevealMap
+		|| MinimapNoFogOfWar != Map.NoFogOfWar || MinimapWithTerrain != WithTerrain
+		|| MinimapTransparent != Transparent) {
+		MinimapPlayer = ThisPlayer;
+		MinimapRevealMap = ReplayRevealMap;
+		MinimapNoFogOfWar = Map.NoFogOfWar;
+		MinimapWithTerrain = WithTerrain;
+		MinimapTransparent = Transparent;
+		MinimapUpdateAll = true;
+	}
+
+	//
+	// Update the vision of the changed tiles
+	//
+	if (MinimapUpdateAll) {
+		for (size_t i = 0; i != MinimapTileVision.size(); ++i) {
+			MinimapTileVision[i] = MinimapVision(i);
+		}
+	} else {
+		for (size_t i = 0; i != MinimapChangedTiles.size(); ++i) {
+			const unsigned int index = MinimapChangedTiles[i];
+
+			MinimapTileVision[index] = MinimapVision(index);
+			MinimapMapRowChanged[index / Map.Info.MapWidth] = true;
+		}
+	}
+	for (size_t i = 0; i != MinimapChangedTiles.size(); ++i) {
+		MinimapTileChanged[MinimapChangedTiles[i]] = false;
 	}
+	MinimapChangedTiles.clear();
+
+	UpdateRows(MinimapUpdateAll);
+	MinimapUpdateAll = false;
+	MinimapMapRowChanged.assign(MinimapMapRowChanged.size(), false);
+	MinimapUnitRows.assign(MinimapUnitRows.size(), false);
 
 	//
 	// Draw units on map
 	//
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	if (!UseOpenGL)
+#endif
+	{
+		SDL_LockSurface(MinimapSurface);
+	}
 	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
 		CUnit &unit = **it;
 		if (unit.IsVisibleOnMinimap()) {
@@ -746,6 +867,11 @@ void CMinimap::Destroy()
 	Minimap2MapX = NULL;
 	delete[] Minimap2MapY;
 	Minimap2MapY = NULL;
+	MinimapTileVision.clear();
+	MinimapChangedTiles.clear();
+	MinimapTileChanged.clear();
+	MinimapMapRowChanged.clear();
+	MinimapUnitRows.clear();
 }
 
 /**
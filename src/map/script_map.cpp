@@ -38,7 +38,9 @@
 #include "map.h"
 
 #include "iolib.h"
+#include "pathfinder.h"
 #include "script.h"
+#include "sync_digest.h"
 #include "tileset.h"
 #include "translate.h"
 #include "ui.h"
@@ -88,9 +90,8 @@ static int CclStratagusMap(lua_State *l)
 					CclGetPos(l, &Map.Info.MapWidth, &Map.Info.MapHeight);
 					lua_pop(l, 1);
 
-					delete[] Map.Fields;
-					Map.Fields = new CMapField[Map.Info.MapWidth * Map.Info.MapHeight];
-					// FIXME: this should be CreateMap or InitMap?
+					Map.FreeFields();
+					Map.Create();
 				} else if (!strcmp(value, "fog-of-war")) {
 					Map.NoFogOfWar = false;
 					--k;
@@ -355,6 +356,8 @@ void SetTile(unsigned int tileIndex, const Vec2i &pos, int value)
 		CMapField &mf = *Map.Field(pos);
 
 		mf.setTileIndex(*Map.Tileset, tileIndex, value);
+		UpdateSyncDigest(mf);
+		PathfinderMapChanged(pos);
 	}
 }
 
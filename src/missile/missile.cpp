@@ -46,8 +46,10 @@
 #include "luacallback.h"
 #include "map.h"
 #include "player.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "spells.h"
+#include "sync_digest.h"
 #include "trigger.h"
 #include "ui.h"
 #include "unit.h"
@@ -65,6 +67,13 @@ unsigned int Missile::Count = 0;
 static std::vector<Missile *> GlobalMissiles;    /// all global missiles on map
 static std::vector<Missile *> LocalMissiles;     /// all local missiles on map
 
+/// Number of missiles allocated at once by the pool
+static const int MissilePoolChunkSize = 256;
+/// Size of a missile in the pool, aligned like the memory of new
+static const size_t MissileBlockSize = (sizeof(Missile) + 15) & ~size_t(15);
+static std::vector<char *> MissilePoolChunks;    /// memory of the missile pool
+static void *MissilePoolFree;                    /// first free block, the blocks are linked by their first word
+
 /// lookup table for missile names
 typedef std::map<std::string, MissileType *> MissileTypeMap;
 static MissileTypeMap MissileTypes;
@@ -148,7 +157,7 @@ Missile::Missile() :
 	Delay(0), SourceUnit(), TargetUnit(), Damage(0),
 	TTL(-1), Hidden(0), DestroyMissile(0),
 	CurrentStep(0), TotalStep(0),
-	Local(0)
+	Local(0), SyncValue(0)
 {
 	position.x = 0;
 	position.y = 0;
@@ -159,6 +168,55 @@ Missile::Missile() :
 	this->Slot = Missile::Count++;
 }
 
+/**
+**  Allocate a missile from the pool.
+**
+**  Thousands of missiles are made and freed every second in big fights,
+**  so their memory is reused instead of going through the allocator.
+**  A missile never moves in the pool: pointers to it stay valid.
+**
+**  @param size  Size of the missile class.
+*/
+void *Missile::operator new(size_t size)
+{
+	if (size != sizeof(Missile)) {
+		// A missile class with its own members.
+		return ::operator new(size);
+	}
+	if (MissilePoolFree == NULL) {
+		char *chunk = new char[MissileBlockSize * MissilePoolChunkSize];
+
+		MissilePoolChunks.push_back(chunk);
+		for (int i = MissilePoolChunkSize - 1; i >= 0; --i) {
+			void *block = chunk + i * MissileBlockSize;
+			*static_cast<void **>(block) = MissilePoolFree;
+			MissilePoolFree = block;
+		}
+	}
+	void *block = MissilePoolFree;
+	MissilePoolFree = *static_cast<void **>(block);
+	return block;
+}
+
+/**
+**  Give the memory of a missile back to the pool.
+**
+**  @param p     Freed missile.
+**  @param size  Size of the missile class.
+*/
+void Missile::operator delete(void *p, size_t size)
+{
+	if (p == NULL) {
+		return;
+	}
+	if (size != sizeof(Missile)) {
+		::operator delete(p);
+		return;
+	}
+	*static_cast<void **>(p) = MissilePoolFree;
+	MissilePoolFree = p;
+}
+
 /**
 **  Initialize a new made missile.
 **
@@ -1141,42 +1199,58 @@ void Missile::NextMissileFrameCycle()
 	}
 }
 
+/**
+**  Handle the action of a missile.
+**
+**  @param missile  Missile to handle.
+**
+**  @return         false if the missile is over and has to be freed.
+*/
+static bool MissileAction(Missile &missile)
+{
+	if (missile.Delay) {
+		missile.Delay--;
+		return true;  // delay start of missile
+	}
+	if (missile.TTL > 0) {
+		missile.TTL--;  // overall time to live if specified
+	}
+	if (missile.TTL == 0) {
+		return false;
+	}
+	Assert(missile.Wait);
+	if (--missile.Wait) {  // wait until time is over
+		return true;
+	}
+	missile.Action(); // may create other missiles, and so modifies the array
+	return missile.TTL != 0;
+}
+
 /**
 **  Handle all missile actions of global/local missiles.
 **
+**  Missiles are handled in creation order, the over ones are freed and
+**  the others are packed at the front of the table in the same pass.
+**
 **  @param missiles  Table of missiles.
 */
 static void MissilesActionLoop(std::vector<Missile *> &missiles)
 {
-	for (size_t i = 0; i != missiles.size(); /* empty */) {
-		Missile &missile = *missiles[i];
+	size_t kept = 0;
 
-		if (missile.Delay) {
-			missile.Delay--;
-			++i;
-			continue;  // delay start of missile
-		}
-		if (missile.TTL > 0) {
-			missile.TTL--;  // overall time to live if specified
-		}
-		if (missile.TTL == 0) {
-			delete &missile;
-			missiles.erase(missiles.begin() + i);
-			continue;
-		}
-		Assert(missile.Wait);
-		if (--missile.Wait) {  // wait until time is over
-			++i;
-			continue;
-		}
-		missile.Action(); // may create other missiles, and so modifies the array
-		if (missile.TTL == 0) {
-			delete &missile;
-			missiles.erase(missiles.begin() + i);
-			continue;
+	// Missiles made meanwhile are added at the end and handled too.
+	for (size_t i = 0; i != missiles.size(); ++i) {
+		Missile *missile = missiles[i];
+
+		if (MissileAction(*missile)) {
+			UpdateSyncDigest(*missile);
+			missiles[kept++] = missile;
+		} else {
+			RemoveSyncDigest(*missile);
+			delete missile;
 		}
-		++i;
 	}
+	missiles.resize(kept);
 }
 
 /**
@@ -1188,6 +1262,17 @@ void MissileActions()
 	MissilesActionLoop(LocalMissiles);
 }
 
+/**
+**  Add the global missiles to the sync digest, when the game starts.
+*/
+void InitMissilesSyncDigest()
+{
+	for (size_t i = 0; i != GlobalMissiles.size(); ++i) {
+		GlobalMissiles[i]->SyncValue = 0;
+		UpdateSyncDigest(*GlobalMissiles[i]);
+	}
+}
+
 /**
 **  Calculate distance from view-point to missile.
 **
@@ -1284,6 +1369,118 @@ void SaveMissiles(CFile &file)
 	}
 }
 
+static void SavePixelPos(CSnapshotWriter &snapshot, const PixelPos &pos)
+{
+	snapshot.Int(pos.x);
+	snapshot.Int(pos.y);
+}
+
+static PixelPos LoadPixelPos(CSnapshotReader &snapshot)
+{
+	PixelPos pos;
+
+	pos.x = snapshot.Int();
+	pos.y = snapshot.Int();
+	return pos;
+}
+
+/**
+**  Save the state of a missile to a snapshot.
+**
+**  @param snapshot  Output snapshot.
+*/
+void Missile::SaveMissile(CSnapshotWriter &snapshot) const
+{
+	snapshot.String(this->Type->Ident);
+	snapshot.Bool(this->Local);
+	SavePixelPos(snapshot, this->position);
+	SavePixelPos(snapshot, this->source);
+	SavePixelPos(snapshot, this->destination);
+	snapshot.Int(this->SpriteFrame);
+	snapshot.Int(this->State);
+	snapshot.Int(this->AnimWait);
+	snapshot.Int(this->Wait);
+	snapshot.Int(this->Delay);
+	snapshot.Unit(this->SourceUnit);
+	snapshot.Unit(this->TargetUnit);
+	snapshot.Int(this->Damage);
+	snapshot.Int(this->TTL);
+	snapshot.Bool(this->Hidden != 0);
+	snapshot.Int(this->CurrentStep);
+	snapshot.Int(this->TotalStep);
+}
+
+/**
+**  Save the state missiles to a snapshot.
+**
+**  @param snapshot  Output snapshot.
+*/
+void SaveMissiles(CSnapshotWriter &snapshot)
+{
+	snapshot.Varint(GlobalMissiles.size() + LocalMissiles.size());
+
+	std::vector<Missile *>::const_iterator i;
+
+	for (i = GlobalMissiles.begin(); i != GlobalMissiles.end(); ++i) {
+		(*i)->SaveMissile(snapshot);
+	}
+	for (i = LocalMissiles.begin(); i != LocalMissiles.end(); ++i) {
+		(*i)->SaveMissile(snapshot);
+	}
+}
+
+/**
+**  Load a missile from a snapshot, as the Lua Missile() does.
+**
+**  @param snapshot  Input snapshot.
+*/
+static void LoadMissile(CSnapshotReader &snapshot)
+{
+	const MissileType *type = MissileTypeByIdent(snapshot.String());
+	const bool local = snapshot.Bool();
+	const PixelPos position = LoadPixelPos(snapshot);
+	const PixelPos source = LoadPixelPos(snapshot);
+	const PixelPos destination = LoadPixelPos(snapshot);
+
+	if (type == NULL) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	Missile *missile = local ? MakeLocalMissile(*type, position, destination) : MakeMissile(*type, position, destination);
+
+	missile->Local = local;
+	missile->SpriteFrame = snapshot.Int();
+	missile->State = snapshot.Int();
+	missile->AnimWait = snapshot.Int();
+	missile->Wait = snapshot.Int();
+	missile->Delay = snapshot.Int();
+	missile->SourceUnit = snapshot.Unit();
+	missile->TargetUnit = snapshot.Unit();
+	missile->Damage = snapshot.Int();
+	missile->TTL = snapshot.Int();
+	missile->Hidden = snapshot.Bool();
+	missile->CurrentStep = snapshot.Int();
+	missile->TotalStep = snapshot.Int();
+
+	// InitMissile() computes the positions for a new missile,
+	// reset them to the saved ones.
+	missile->position = position;
+	missile->source = source;
+	missile->destination = destination;
+}
+
+/**
+**  Load the missiles from a snapshot.
+**
+**  @param snapshot  Input snapshot.
+*/
+void LoadMissiles(CSnapshotReader &snapshot)
+{
+	for (unsigned int count = snapshot.Varint(); count && !snapshot.IsCorrupted(); --count) {
+		LoadMissile(snapshot);
+	}
+}
+
 /**
 **  Initialize missile type.
 */
@@ -1382,6 +1579,13 @@ void CleanMissiles()
 		delete *i;
 	}
 	LocalMissiles.clear();
+
+	// All the missiles are freed, give the pool back.
+	for (size_t j = 0; j != MissilePoolChunks.size(); ++j) {
+		delete[] MissilePoolChunks[j];
+	}
+	MissilePoolChunks.clear();
+	MissilePoolFree = NULL;
 }
 
 #ifdef DEBUG
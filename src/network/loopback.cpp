@@ -0,0 +1,496 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name loopback.cpp - The loopback network and the lockstep harness. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "network/loopback.h"
+
+#include "net_lowlevel.h"
+#include "net_message.h"
+#include "netconnect.h"
+#include "network.h"
+#include "player.h"
+#include "video.h"
+
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Socket of the loopback network.
+*/
+class CLoopbackSocket : public CUDPSocket_Impl
+{
+public:
+	explicit CLoopbackSocket(CLoopbackNetwork &network);
+	~CLoopbackSocket();
+
+	bool Open(const CHost &host);
+	void Close();
+	void Send(const CHost &host, const void *buf, unsigned int len);
+	int Recv(void *buf, int len, CHost *hostFrom);
+	void SetNonBlocking() {}
+	int HasDataToRead(int timeout);
+	bool IsValid() const { return Opened; }
+
+public:
+	/// Datagram on its way
+	struct Datagram {
+		CHost From;                       /// Sender
+		std::vector<unsigned char> Data;  /// Content
+	};
+
+	CLoopbackNetwork &Network;                  /// Network of the socket
+	CHost Host;                                 /// Address of the socket
+	bool Opened;                                /// Socket is open
+	std::multimap<unsigned long, Datagram> In;  /// Datagrams by time of arrival
+};
+
+/// Command sent by a player of the harness
+struct LockstepCommand {
+	unsigned long Cycle;  /// Game cycle it was sent at
+	unsigned long Time;   /// Network time it was sent at
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+static CLoopbackNetwork *LockstepNetwork;                    /// Network of the harness
+static std::vector<std::vector<LockstepCommand> > LockstepSent; /// Commands sent by each player
+static int LockstepPlayer;                                   /// Player whose turn it is
+static unsigned long LockstepRunCount;                       /// Commands run by their sender
+static unsigned long LockstepCycles;                         /// Total latency of the commands (cycles)
+static unsigned long LockstepMaxCycles;                      /// Biggest latency of a command (cycles)
+static unsigned long LockstepTime;                           /// Total latency of the commands (ms)
+static unsigned long LockstepMaxTime;                        /// Biggest latency of a command (ms)
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+//
+// CLoopbackSocket
+//
+
+CLoopbackSocket::CLoopbackSocket(CLoopbackNetwork &network) : Network(network), Opened(false)
+{
+	Network.Sockets.push_back(this);
+}
+
+CLoopbackSocket::~CLoopbackSocket()
+{
+	Network.Sockets.erase(std::find(Network.Sockets.begin(), Network.Sockets.end(), this));
+}
+
+/**
+**  Bind the socket to an address, the any address is 127.0.0.1.
+**
+**  @return  false if the address is used by another socket.
+*/
+bool CLoopbackSocket::Open(const CHost &host)
+{
+	const CHost address(host.getIp() ? host.getIp() : htonl(0x7F000001), host.getPort());
+
+	for (size_t i = 0; i != Network.Sockets.size(); ++i) {
+		if (Network.Sockets[i]->Opened && Network.Sockets[i]->Host == address) {
+			return false;
+		}
+	}
+	Host = address;
+	Opened = true;
+	return true;
+}
+
+void CLoopbackSocket::Close()
+{
+	Opened = false;
+	In.clear();
+}
+
+void CLoopbackSocket::Send(const CHost &host, const void *buf, unsigned int len)
+{
+	if (Opened) {
+		Network.Send(Host, host, buf, len);
+	}
+}
+
+/**
+**  Read the next datagram arrived.
+**
+**  @return  Size read, -1 if no datagram arrived yet.
+*/
+int CLoopbackSocket::Recv(void *buf, int len, CHost *hostFrom)
+{
+	if (!HasDataToRead(0)) {
+		return -1;
+	}
+	const Datagram &datagram = In.begin()->second;
+	const int size = std::min<int>(len, datagram.Data.size());
+
+	memcpy(buf, &datagram.Data[0], size);
+	*hostFrom = datagram.From;
+	In.erase(In.begin());
+	return size;
+}
+
+/**
+**  Check if a datagram arrived. The clock of the network is moved by
+**  hand, so there is nothing to wait for.
+*/
+int CLoopbackSocket::HasDataToRead(int)
+{
+	return !In.empty() && In.begin()->first <= Network.Now;
+}
+
+//
+// CLoopbackNetwork
+//
+
+CLoopbackNetwork::CLoopbackNetwork(unsigned int seed) :
+	Latency(0), Jitter(0), Reorder(0), Loss(0), SentCount(0), LostCount(0),
+	Now(0), Seed(seed)
+{
+}
+
+CLoopbackNetwork::~CLoopbackNetwork()
+{
+	Assert(Sockets.empty());
+}
+
+/**
+**  Create a socket of the network, it must be freed before the network.
+*/
+CUDPSocket_Impl *CLoopbackNetwork::NewSocket()
+{
+	return new CLoopbackSocket(*this);
+}
+
+/**
+**  Random number in [0, n), the same for each run of a seed.
+*/
+int CLoopbackNetwork::Random(int n)
+{
+	Seed = Seed * 1103515245 + 12345;
+	return n > 0 ? (Seed >> 16) % n : 0;
+}
+
+/**
+**  Queue a datagram for the socket of its address, if it isn't lost.
+*/
+void CLoopbackNetwork::Send(const CHost &from, const CHost &to, const void *buf, unsigned int len)
+{
+	++SentCount;
+	if (Random(100) < Loss) {
+		++LostCount;
+		return;
+	}
+	unsigned long delay = Latency + Random(Jitter + 1);
+	if (Random(100) < Reorder) {
+		delay += std::max(Latency, 1);
+	}
+	for (size_t i = 0; i != Sockets.size(); ++i) {
+		CLoopbackSocket &socket = *Sockets[i];
+
+		if (socket.Opened && socket.Host == to) {
+			CLoopbackSocket::Datagram &datagram =
+				socket.In.insert(std::make_pair(Now + delay, CLoopbackSocket::Datagram()))->second;
+
+			datagram.From = from;
+			datagram.Data.assign(static_cast<const unsigned char *>(buf),
+								 static_cast<const unsigned char *>(buf) + len);
+			return;
+		}
+	}
+	// Nobody there: lost, as with UDP.
+	++LostCount;
+}
+
+//
+// CLockstepSettings
+//
+
+/**
+**  Parse settings of the form "clients=4,latency=40,loss=2".
+**
+**  The keys are clients, latency, jitter, reorder, loss, every (game
+**  cycles between the commands of a player) and seed.
+**
+**  @return  false if a setting is unknown.
+*/
+bool CLockstepSettings::Parse(const std::string &settings)
+{
+	size_t pos = 0;
+
+	while (pos < settings.size()) {
+		size_t end = settings.find(',', pos);
+		if (end == std::string::npos) {
+			end = settings.size();
+		}
+		const std::string setting = settings.substr(pos, end - pos);
+		const size_t equal = setting.find('=');
+		pos = end + 1;
+		if (equal == std::string::npos) {
+			return false;
+		}
+		const std::string key = setting.substr(0, equal);
+		const int value = atoi(setting.c_str() + equal + 1);
+
+		if (key == "clients") {
+			Clients = value;
+		} else if (key == "latency") {
+			Latency = value;
+		} else if (key == "jitter") {
+			Jitter = value;
+		} else if (key == "reorder") {
+			Reorder = value;
+		} else if (key == "loss") {
+			Loss = value;
+		} else if (key == "every") {
+			CommandEvery = value;
+		} else if (key == "seed") {
+			Seed = value;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+//
+// Lockstep harness
+//
+
+static unsigned long LockstepGetTicks()
+{
+	return LockstepNetwork->GetTime();
+}
+
+/**
+**  Address of a player of the harness.
+*/
+static CHost LockstepHost(int player)
+{
+	return CHost(htonl(0x7F000001), htons(CNetworkParameter::defaultPort + player));
+}
+
+/**
+**  Measure the latency of the commands of the harness, run by their sender.
+*/
+static void LockstepCommandHook(int player, unsigned char type, const std::vector<unsigned char> &data)
+{
+	if ((type & 0x7F) != MessageChat || player != LockstepPlayer || data.empty()) {
+		return;
+	}
+	CNetworkChat nc;
+	nc.Deserialize(&data[0]);
+	int sender;
+	unsigned int number;
+	if (sscanf(nc.Text.c_str(), "lockstep %d %u", &sender, &number) != 2
+		|| sender != player || number >= LockstepSent[sender].size()) {
+		return;
+	}
+	const LockstepCommand &command = LockstepSent[sender][number];
+	const unsigned long cycles = GameCycle - command.Cycle;
+	const unsigned long time = LockstepNetwork->GetTime() - command.Time;
+
+	++LockstepRunCount;
+	LockstepCycles += cycles;
+	LockstepMaxCycles = std::max(LockstepMaxCycles, cycles);
+	LockstepTime += time;
+	LockstepMaxTime = std::max(LockstepMaxTime, time);
+}
+
+/**
+**  Start the network of a player of the harness, in its context.
+*/
+static void LockstepStartPlayer(int player, int players)
+{
+	NetworkFildes.SetTransport(LockstepNetwork->NewSocket());
+	NetworkFildes.Open(LockstepHost(player));
+	ThisPlayer = &Players[player];
+	HostsCount = 0;
+	for (int i = 0; i != players; ++i) {
+		if (i == player) {
+			continue;
+		}
+		const CHost host = LockstepHost(i);
+		char name[NetPlayerNameSize];
+
+		snprintf(name, sizeof(name), "Player %d", i);
+		Hosts[HostsCount].Clear();
+		Hosts[HostsCount].Host = host.getIp();
+		Hosts[HostsCount].Port = host.getPort();
+		Hosts[HostsCount].PlyNr = i;
+		Hosts[HostsCount].SetName(name);
+		++HostsCount;
+	}
+	GameCycle = 0;
+	NetworkOnStartGame();
+}
+
+/**
+**  Run the next game cycle of a player of the harness, in its context,
+**  as GameLogicLoop does, without the game itself.
+**
+**  @return  false if the player is waiting for the others.
+*/
+static bool LockstepPlayerFrame(int player, int commandEvery)
+{
+	const bool inSync = NetworkInSync;
+	if (inSync) {
+		++GameCycle;
+		if (commandEvery > 0 && GameCycle % commandEvery == 0) {
+			char text[64];
+			LockstepCommand command = { GameCycle, LockstepNetwork->GetTime() };
+
+			snprintf(text, sizeof(text), "lockstep %d %u", player, (unsigned int)LockstepSent[player].size());
+			LockstepSent[player].push_back(command);
+			NetworkSendChatMessage(text);
+		}
+		NetworkCommands();
+	}
+	if (!NetworkInSync) {
+		NetworkRecover();
+	}
+	return inSync;
+}
+
+/**
+**  Run players on the loopback network and report the lockstep statistics.
+**
+**  Each player is a network state (see NetworkSwapContext) which runs
+**  NetworkEvent, NetworkCommands and NetworkRecover as a game would. The
+**  game commands aren't run, the players send chat messages whose delay
+**  from sending to running is measured. A frame of each player is run
+**  for each frame of network time.
+**
+**  @return  0 if all players ran all the cycles, -1 if they got stuck.
+*/
+int RunLockstepHarness(const CLockstepSettings &settings)
+{
+	const int players = settings.Clients;
+
+	if (players < 2 || players >= PlayerMax) {
+		fprintf(stderr, "The lockstep harness needs 2 to %d clients\n", PlayerMax - 1);
+		return -1;
+	}
+	CLoopbackNetwork network(settings.Seed);
+	network.Latency = settings.Latency;
+	network.Jitter = settings.Jitter;
+	network.Reorder = settings.Reorder;
+	network.Loss = settings.Loss;
+
+	LockstepNetwork = &network;
+	LockstepSent.assign(players, std::vector<LockstepCommand>());
+	LockstepRunCount = LockstepCycles = LockstepMaxCycles = LockstepTime = LockstepMaxTime = 0;
+	unsigned long (*getTicks)() = NetworkGetTicks;
+	const int numPlayers = NumPlayers;
+	NetworkGetTicks = LockstepGetTicks;
+	NetworkCommandHook = LockstepCommandHook;
+	NumPlayers = players;
+	CNetworkParameter::Instance.FixValues();
+
+	std::vector<CNetworkContext *> contexts(players);
+	std::vector<unsigned long> stalls(players, 0);
+	for (int i = 0; i != players; ++i) {
+		contexts[i] = NetworkNewContext();
+		NetworkSwapContext(*contexts[i]);
+		LockstepStartPlayer(i, players);
+		NetworkSwapContext(*contexts[i]);
+	}
+
+	const unsigned long frameTime = 1000 / CYCLES_PER_SECOND;
+	const unsigned long maxFrames = settings.Cycles * 20 + 1000;
+	unsigned long frames = 0;
+	bool done = false;
+	while (!done && frames < maxFrames) {
+		network.SetTime(network.GetTime() + frameTime);
+		++FrameCounter;
+		++frames;
+		done = true;
+		for (int i = 0; i != players; ++i) {
+			NetworkSwapContext(*contexts[i]);
+			LockstepPlayer = i;
+			// A player done still answers the resend requests of the others.
+			while (NetworkFildes.HasDataToRead(0) > 0) {
+				NetworkEvent();
+			}
+			if (GameCycle < settings.Cycles) {
+				done = false;
+				if (!LockstepPlayerFrame(i, settings.CommandEvery)) {
+					++stalls[i];
+				}
+			}
+			NetworkSwapContext(*contexts[i]);
+		}
+	}
+
+	printf("Lockstep: %d clients, %lu cycles, %lu frames (%.1f s of network time)\n",
+		   players, settings.Cycles, frames, network.GetTime() / 1000.0);
+	printf("  network: latency %d ms, jitter %d ms, reorder %d %%, loss %d %%, %lu datagrams, %lu lost\n",
+		   network.Latency, network.Jitter, network.Reorder, network.Loss,
+		   network.SentCount, network.LostCount);
+	for (int i = 0; i != players; ++i) {
+		NetworkSwapContext(*contexts[i]);
+		printf("  client %d: cycle %lu, %lu stalled frames, %lu resends, lag %u cycles\n",
+			   i, GameCycle, stalls[i], NetworkResendCount, CNetworkParameter::Instance.NetworkLag);
+		NetworkFildes.Close();
+		NetworkFildes.SetTransport(NULL);
+		NetworkSwapContext(*contexts[i]);
+		NetworkDeleteContext(contexts[i]);
+	}
+	if (LockstepRunCount) {
+		printf("  commands: %lu run, latency %.1f cycles (max %lu), %.1f ms (max %lu)\n",
+			   LockstepRunCount, (double)LockstepCycles / LockstepRunCount, LockstepMaxCycles,
+			   (double)LockstepTime / LockstepRunCount, LockstepMaxTime);
+	} else {
+		printf("  commands: none run\n");
+	}
+	fflush(stdout);
+
+	NetworkGetTicks = getTicks;
+	NetworkCommandHook = NULL;
+	NumPlayers = numPlayers;
+	LockstepNetwork = NULL;
+	LockstepSent.clear();
+	return done ? 0 : -1;
+}
+
+//@}
@@ -578,6 +578,119 @@ size_t CNetworkCommand::Deserialize(const unsigned char *buf)
 	return p - buf;
 }
 
+//
+// CNetworkCommandGroup
+//
+
+/**
+**  Size of a difference between unit slots, 7 bits a byte.
+*/
+static size_t GroupDeltaSize(unsigned int delta)
+{
+	return delta < 0x80 ? 1 : delta < 0x4000 ? 2 : 3;
+}
+
+size_t CNetworkCommandGroup::Serialize(unsigned char *buf) const
+{
+	unsigned char *p = buf;
+	p += serialize8(p, this->Type);
+	p += serialize16(p, this->X);
+	p += serialize16(p, this->Y);
+	p += serialize16(p, this->Dest);
+	p += serialize16(p, uint16_t(this->Units.size()));
+	unsigned int last = 0;
+	for (size_t i = 0; i != this->Units.size(); ++i) {
+		unsigned int delta = this->Units[i] - last;
+
+		last = this->Units[i];
+		while (delta >= 0x80) {
+			p += serialize8(p, uint8_t(delta | 0x80));
+			delta >>= 7;
+		}
+		p += serialize8(p, uint8_t(delta));
+	}
+	return p - buf;
+}
+
+/**
+**  Read a group command.
+**
+**  @return  Bytes read, 0 if the group doesn't fit in len bytes.
+*/
+size_t CNetworkCommandGroup::Deserialize(const unsigned char *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	const unsigned char *end = buf + len;
+
+	if (len < 1 + 2 + 2 + 2 + 2) {
+		return 0;
+	}
+	uint16_t size;
+	p += deserialize8(p, &this->Type);
+	p += deserialize16(p, &this->X);
+	p += deserialize16(p, &this->Y);
+	p += deserialize16(p, &this->Dest);
+	p += deserialize16(p, &size);
+	this->Units.resize(size);
+	unsigned int last = 0;
+	for (size_t i = 0; i != this->Units.size(); ++i) {
+		unsigned int delta = 0;
+
+		for (int shift = 0;; shift += 7) {
+			if (p == end || shift > 14) {
+				return 0;
+			}
+			const unsigned char c = *p++;
+			delta |= (c & 0x7F) << shift;
+			if (!(c & 0x80)) {
+				break;
+			}
+		}
+		last += delta;
+		if (last > 0xFFFF) {
+			return 0;
+		}
+		this->Units[i] = uint16_t(last);
+	}
+	return p - buf;
+}
+
+size_t CNetworkCommandGroup::Size() const
+{
+	size_t size = 1 + 2 + 2 + 2 + 2;
+	unsigned int last = 0;
+
+	for (size_t i = 0; i != this->Units.size(); ++i) {
+		size += GroupDeltaSize(this->Units[i] - last);
+		last = this->Units[i];
+	}
+	return size;
+}
+
+/**
+**  Add a unit to the group, keeping the slots sorted.
+**
+**  @return  false if the group would get bigger than MaxNetworkGroupSize.
+*/
+bool CNetworkCommandGroup::AddUnit(uint16_t unit)
+{
+	std::vector<uint16_t>::iterator it = std::lower_bound(Units.begin(), Units.end(), unit);
+
+	if (it != Units.end() && *it == unit) {
+		return true;
+	}
+	const unsigned int prev = it == Units.begin() ? 0 : *(it - 1);
+	size_t size = Size() + GroupDeltaSize(unit - prev);
+	if (it != Units.end()) {
+		size += GroupDeltaSize(*it - unit) - GroupDeltaSize(*it - prev);
+	}
+	if (size > MaxNetworkGroupSize) {
+		return false;
+	}
+	Units.insert(it, unit);
+	return true;
+}
+
 //
 // CNetworkExtendedCommand
 //
@@ -638,6 +751,9 @@ size_t CNetworkCommandSync::Serialize(unsigned char *buf) const
 	unsigned char *p = buf;
 	p += serialize32(p, this->syncSeed);
 	p += serialize32(p, this->syncHash);
+	for (int i = 0; i != SyncDigestPartMax; ++i) {
+		p += serialize32(p, this->syncDigest[i]);
+	}
 	return p - buf;
 }
 
@@ -646,6 +762,9 @@ size_t CNetworkCommandSync::Deserialize(const unsigned char *buf)
 	const unsigned char *p = buf;
 	p += deserialize32(p, &this->syncSeed);
 	p += deserialize32(p, &this->syncHash);
+	for (int i = 0; i != SyncDigestPartMax; ++i) {
+		p += deserialize32(p, &this->syncDigest[i]);
+	}
 	return p - buf;
 }
 
@@ -667,6 +786,44 @@ size_t CNetworkCommandQuit::Deserialize(const unsigned char *buf)
 	return p - buf;
 }
 
+//
+// CNetworkPing
+//
+
+size_t CNetworkPing::Serialize(unsigned char *buf) const
+{
+	unsigned char *p = buf;
+	p += serialize32(p, this->Time);
+	return p - buf;
+}
+
+size_t CNetworkPing::Deserialize(const unsigned char *buf)
+{
+	const unsigned char *p = buf;
+	p += deserialize32(p, &this->Time);
+	return p - buf;
+}
+
+//
+// CNetworkCommandLag
+//
+
+size_t CNetworkCommandLag::Serialize(unsigned char *buf) const
+{
+	unsigned char *p = buf;
+	p += serialize16(p, this->player);
+	p += serialize16(p, this->Lag);
+	return p - buf;
+}
+
+size_t CNetworkCommandLag::Deserialize(const unsigned char *buf)
+{
+	const unsigned char *p = buf;
+	p += deserialize16(p, &this->player);
+	p += deserialize16(p, &this->Lag);
+	return p - buf;
+}
+
 //
 // CNetworkSelection
 //
@@ -290,6 +290,10 @@ void CNetworkParameter::FixValues()
 }
 
 bool NetworkInSync = true;                 /// Network is in sync
+unsigned long NetworkResendCount;          /// Resend requests sent
+unsigned long (*NetworkGetTicks)() = GetTicks; /// Clock of the pings
+/// Runs the game commands instead of NetworkExecCommand, if set
+void (*NetworkCommandHook)(int player, unsigned char type, const std::vector<unsigned char> &data);
 
 CUDPSocket NetworkFildes;                  /// Network file descriptor
 
@@ -297,6 +301,7 @@ static unsigned long NetworkLastFrame[PlayerMax]; /// Last frame received packet
 
 static int NetworkSyncSeeds[256];          /// Network sync seeds.
 static int NetworkSyncHashs[256];          /// Network sync hashs.
+static uint32_t NetworkSyncDigests[256][SyncDigestPartMax]; /// Network sync digests.
 static CNetworkCommandQueue NetworkIn[256][PlayerMax][MaxNetworkCommands]; /// Per-player network packet input queue
 static std::deque<CNetworkCommandQueue> CommandsIn;    /// Network command input queue
 static std::deque<CNetworkCommandQueue> MsgCommandsIn; /// Network message input queue
@@ -333,6 +338,17 @@ static CNetworkStat NetworkStat;
 
 static int PlayerQuit[PlayerMax];          /// Player quit
 
+/// Network lag limit (# game cycles), well below the 256 cycles of NetworkIn
+#define MaxNetworkLag 96
+
+static unsigned long NetworkLastSentCycle;      /// Last game cycle we sent commands for
+static unsigned int NetworkLagStart;            /// Network lag the game started with
+static unsigned int NetworkLagWanted[PlayerMax]; /// Network lag wanted by each player
+static unsigned int NetworkLagAnnounced;        /// Network lag last wanted by us
+static int NetworkRtt[PlayerMax];               /// Smoothed round-trip time to each player (ms), 0 if unknown
+static int NetworkRttVar[PlayerMax];            /// Variation of the round-trip time (ms)
+static unsigned long NetworkLastPing;           /// Ticks of the last pings
+
 //----------------------------------------------------------------------------
 //  Mid-Level api functions
 //----------------------------------------------------------------------------
@@ -381,6 +397,43 @@ static void NetworkSendPacket(const CNetworkCommandQueue(&ncq)[MaxNetworkCommand
 	NetworkBroadcast(packet, numcommands);
 }
 
+/**
+**  Send a ping or a pong to a host, outside of the game cycles.
+**
+**  @param host  Host to send to.
+**  @param type  MessagePing or MessagePong.
+**  @param time  Ticks of the ping.
+*/
+static void NetworkSendPing(const CHost &host, uint8_t type, uint32_t time)
+{
+	CNetworkPing ping;
+	ping.Time = time;
+
+	CNetworkPacket packet;
+	packet.Header.Type[0] = type;
+	packet.Header.Type[1] = MessageNone;
+	packet.Command[0].resize(ping.Size());
+	ping.Serialize(&packet.Command[0][0]);
+
+	const unsigned int size = packet.Size(1);
+	unsigned char *buf = new unsigned char[size];
+	packet.Serialize(buf, 1);
+	NetworkFildes.Send(host, buf, size);
+	delete[] buf;
+}
+
+/**
+**  Round a network lag to whole network updates, inside the allowed range.
+*/
+static unsigned int NetworkClampLag(unsigned int lag)
+{
+	const unsigned int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	const unsigned int maxLag = std::max(MaxNetworkLag / gameCyclesPerUpdate, 2u) * gameCyclesPerUpdate;
+
+	lag = (lag + gameCyclesPerUpdate - 1) / gameCyclesPerUpdate * gameCyclesPerUpdate;
+	return std::min(std::max(lag, 2 * gameCyclesPerUpdate), maxLag);
+}
+
 //----------------------------------------------------------------------------
 //  API init..
 //----------------------------------------------------------------------------
@@ -443,6 +496,12 @@ void ExitNetwork1()
 	NetworkFildes.Close();
 	NetExit(); // machine dependent setup
 
+	// The lag measured in this game isn't the one of the next game.
+	if (NetworkLagStart) {
+		CNetworkParameter::Instance.NetworkLag = NetworkLagStart;
+		NetworkLagStart = 0;
+	}
+
 	NetworkInSync = true;
 	NetPlayers = 0;
 	HostsCount = 0;
@@ -490,14 +549,73 @@ void NetworkOnStartGame()
 	}
 	memset(NetworkSyncSeeds, 0, sizeof(NetworkSyncSeeds));
 	memset(NetworkSyncHashs, 0, sizeof(NetworkSyncHashs));
+	memset(NetworkSyncDigests, 0, sizeof(NetworkSyncDigests));
 	memset(PlayerQuit, 0, sizeof(PlayerQuit));
 	memset(NetworkLastFrame, 0, sizeof(NetworkLastFrame));
+
+	const unsigned int lag = CNetworkParameter::Instance.NetworkLag;
+	NetworkLastSentCycle = lag - CNetworkParameter::Instance.gameCyclesPerUpdate;
+	if (!NetworkLagStart) {
+		NetworkLagStart = lag;
+	}
+	NetworkLagAnnounced = lag;
+	for (int i = 0; i != PlayerMax; ++i) {
+		NetworkLagWanted[i] = lag;
+	}
+	memset(NetworkRtt, 0, sizeof(NetworkRtt));
+	memset(NetworkRttVar, 0, sizeof(NetworkRttVar));
+	NetworkLastPing = NetworkGetTicks();
 }
 
 //----------------------------------------------------------------------------
 //  Commands input
 //----------------------------------------------------------------------------
 
+/**
+**  Add a unit command to the last queued command, when it gives the same
+**  order in the same cycle, as for the selected units of one input event.
+**  The queued command becomes a group command, so the orders of a big
+**  army are sent in one packet.
+**
+**  @param last  Last command of the output queue.
+**  @param type  Command type of nc.
+**  @param nc    Unit command to add.
+**
+**  @return  true if nc was added to last.
+*/
+static bool NetworkGroupCommand(CNetworkCommandQueue &last, uint8_t type, const CNetworkCommand &nc)
+{
+	if (last.Time != GameCycle) {
+		return false;
+	}
+	CNetworkCommandGroup group;
+
+	if (last.Type == MessageCommandGroup) {
+		group.Deserialize(&last.Data[0], last.Data.size());
+		if (group.Type != type) {
+			return false;
+		}
+	} else if (last.Type == type && last.Data.size() == CNetworkCommand::Size()) {
+		CNetworkCommand lastnc;
+
+		lastnc.Deserialize(&last.Data[0]);
+		group.Type = type;
+		group.X = lastnc.X;
+		group.Y = lastnc.Y;
+		group.Dest = lastnc.Dest;
+		group.Units.push_back(lastnc.Unit);
+	} else {
+		return false;
+	}
+	if (group.X != nc.X || group.Y != nc.Y || group.Dest != nc.Dest || !group.AddUnit(nc.Unit)) {
+		return false;
+	}
+	last.Type = MessageCommandGroup;
+	last.Data.resize(group.Size());
+	group.Serialize(&last.Data[0]);
+	return true;
+}
+
 /**
 **  Prepare send of command message.
 **
@@ -541,6 +659,9 @@ void NetworkSendCommand(int command, const CUnit &unit, int x, int y,
 	if (std::find(CommandsIn.begin(), CommandsIn.end(), ncq) != CommandsIn.end()) {
 		return;
 	}
+	if (!CommandsIn.empty() && NetworkGroupCommand(CommandsIn.back(), ncq.Type, nc)) {
+		return;
+	}
 	CommandsIn.push_back(ncq);
 }
 
@@ -709,13 +830,57 @@ static void ParseResendCommand(const CNetworkPacket &packet)
 	}
 }
 
-static bool IsAValidCommand_Command(const CNetworkPacket &packet, int index, const int player)
+/**
+**  Answer a ping, or measure the round-trip time to a player from a pong.
+**
+**  The round-trip time and its variation are smoothed the way TCP does.
+*/
+static void ParsePingCommand(const CNetworkPacket &packet, int index, const CHost &host, int player)
 {
-	CNetworkCommand nc;
+	if (packet.Command[index].size() < CNetworkPing::Size()) {
+		return;
+	}
+	CNetworkPing ping;
+	ping.Deserialize(&packet.Command[index][0]);
+	if (packet.Header.Type[index] == MessagePing) {
+		NetworkSendPing(host, MessagePong, ping.Time);
+		return;
+	}
+	const uint32_t rtt = uint32_t(NetworkGetTicks()) - ping.Time;
+	if (rtt > 60000) { // Not one of our pings
+		return;
+	}
+	if (NetworkRtt[player] == 0) {
+		NetworkRtt[player] = std::max<int>(rtt, 1);
+		NetworkRttVar[player] = rtt / 2;
+	} else {
+		NetworkRttVar[player] += (abs(NetworkRtt[player] - int(rtt)) - NetworkRttVar[player]) / 4;
+		NetworkRtt[player] = std::max(NetworkRtt[player] + (int(rtt) - NetworkRtt[player]) / 8, 1);
+	}
+}
+
+static bool IsAValidCommand_Sync(const CNetworkPacket &packet, int index)
+{
+	return packet.Command[index].size() >= CNetworkCommandSync::Size();
+}
+
+static bool IsAValidCommand_Lag(const CNetworkPacket &packet, int index, const int player)
+{
+	CNetworkCommandLag nc;
+	if (packet.Command[index].size() < nc.Size()) {
+		return false;
+	}
 	nc.Deserialize(&packet.Command[index][0]);
-	const unsigned int slot = nc.Unit;
+	return nc.player == player;
+}
+
+static bool IsAValidCommand_Unit(unsigned int slot, const int player, bool dismiss)
+{
 	const CUnit *unit = slot < UnitManager.GetUsedSlotCount() ? &UnitManager.GetSlotUnit(slot) : NULL;
 
+	if (unit && dismiss && unit->Type->ClicksToExplode) {
+		return true;
+	}
 	if (unit && (unit->Player->Index == player
 				 || Players[player].IsTeamed(*unit))) {
 		return true;
@@ -724,30 +889,53 @@ static bool IsAValidCommand_Command(const CNetworkPacket &packet, int index, con
 	}
 }
 
+static bool IsAValidCommand_Command(const CNetworkPacket &packet, int index, const int player)
+{
+	CNetworkCommand nc;
+	nc.Deserialize(&packet.Command[index][0]);
+	return IsAValidCommand_Unit(nc.Unit, player, false);
+}
+
 static bool IsAValidCommand_Dismiss(const CNetworkPacket &packet, int index, const int player)
 {
 	CNetworkCommand nc;
 	nc.Deserialize(&packet.Command[index][0]);
-	const unsigned int slot = nc.Unit;
-	const CUnit *unit = slot < UnitManager.GetUsedSlotCount() ? &UnitManager.GetSlotUnit(slot) : NULL;
+	return IsAValidCommand_Unit(nc.Unit, player, true);
+}
 
-	if (unit && unit->Type->ClicksToExplode) {
-		return true;
+static bool IsAValidCommand_Group(const CNetworkPacket &packet, int index, const int player)
+{
+	CNetworkCommandGroup group;
+	if (packet.Command[index].empty()
+		|| group.Deserialize(&packet.Command[index][0], packet.Command[index].size()) == 0) {
+		return false;
+	}
+	const int type = group.Type & 0x7F;
+	if ((type < MessageCommandStop || type > MessageCommandCancelResearch) && type < MessageCommandSpellCast) {
+		return false;
 	}
-	return IsAValidCommand_Command(packet, index, player);
+	const bool dismiss = type == MessageCommandDismiss;
+	for (size_t i = 0; i != group.Units.size(); ++i) {
+		if (!IsAValidCommand_Unit(group.Units[i], player, dismiss)) {
+			return false;
+		}
+	}
+	return true;
 }
 
 static bool IsAValidCommand(const CNetworkPacket &packet, int index, const int player)
 {
 	switch (packet.Header.Type[index] & 0x7F) {
 		case MessageExtendedCommand: // FIXME: ensure the sender is part of the command
-		case MessageSync: // Sync does not matter
 		case MessageSelection: // FIXME: ensure it's from the right player
 		case MessageQuit:      // FIXME: ensure it's from the right player
 		case MessageResend:    // FIXME: ensure it's from the right player
 		case MessageChat:      // FIXME: ensure it's from the right player
 			return true;
+		case MessageSync: return IsAValidCommand_Sync(packet, index);
+		case MessageLag: return IsAValidCommand_Lag(packet, index, player);
 		case MessageCommandDismiss: return IsAValidCommand_Dismiss(packet, index, player);
+		case MessageCommandGroup: return IsAValidCommand_Group(packet, index, player);
 		default: return IsAValidCommand_Command(packet, index, player);
 	}
 	// FIXME: not all values in nc have been validated
@@ -788,6 +976,10 @@ static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHo
 			ParseResendCommand(packet);
 			return;
 		}
+		if (packet.Header.Type[i] == MessagePing || packet.Header.Type[i] == MessagePong) {
+			ParsePingCommand(packet, i, host, player);
+			return;
+		}
 		// Receive statistic
 		NetworkLastFrame[player] = FrameCounter;
 
@@ -865,7 +1057,9 @@ void NetworkQuitGame()
 	}
 	const int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
 	const int NetworkLag = CNetworkParameter::Instance.NetworkLag;
-	const int n = (GameCycle + gameCyclesPerUpdate) / gameCyclesPerUpdate * gameCyclesPerUpdate + NetworkLag;
+	// After the lag shrank, the cycles up to NetworkLastSentCycle are already sent.
+	const int n = std::max<unsigned long>((GameCycle + gameCyclesPerUpdate) / gameCyclesPerUpdate * gameCyclesPerUpdate + NetworkLag,
+										  NetworkLastSentCycle + gameCyclesPerUpdate);
 	CNetworkCommandQueue(&ncqs)[MaxNetworkCommands] = NetworkIn[n & 0xFF][ThisPlayer->Index];
 	CNetworkCommandQuit nc;
 	nc.player = ThisPlayer->Index;
@@ -889,14 +1083,30 @@ static void NetworkExecCommand_Sync(const CNetworkCommandQueue &ncq)
 	const unsigned long gameNetCycle = GameCycle;
 	const int syncSeed = nc.syncSeed;
 	const int syncHash = nc.syncHash;
-
-	if (syncSeed != NetworkSyncSeeds[gameNetCycle & 0xFF]
-		|| syncHash != NetworkSyncHashs[gameNetCycle & 0xFF]) {
+	const uint32_t *syncDigest = NetworkSyncDigests[gameNetCycle & 0xFF];
+	std::string parts;
+
+	for (int i = 0; i != SyncDigestPartMax; ++i) {
+		if (nc.syncDigest[i] != syncDigest[i]) {
+			DebugPrint("Network out of sync: %s %x!=%x\n" _C_ SyncDigestPartNames[i]
+					   _C_ nc.syncDigest[i] _C_ syncDigest[i]);
+			parts += parts.empty() ? "" : ", ";
+			parts += SyncDigestPartNames[i];
+		}
+	}
+	if (parts.empty() && syncSeed == NetworkSyncSeeds[gameNetCycle & 0xFF]
+		&& syncHash == NetworkSyncHashs[gameNetCycle & 0xFF]) {
+		return;
+	}
+	if (parts.empty()) {
 		SetMessage("%s", _("Network out of sync"));
-		DebugPrint("\nNetwork out of sync %x!=%x! %d!=%d! Cycle %lu\n\n" _C_
-				   syncSeed _C_ NetworkSyncSeeds[gameNetCycle & 0xFF] _C_
-				   syncHash _C_ NetworkSyncHashs[gameNetCycle & 0xFF] _C_ GameCycle);
+	} else {
+		// Name the parts of the game which differ.
+		SetMessage(_("Network out of sync: %s"), parts.c_str());
 	}
+	DebugPrint("\nNetwork out of sync %x!=%x! %d!=%d! Cycle %lu\n\n" _C_
+			   syncSeed _C_ NetworkSyncSeeds[gameNetCycle & 0xFF] _C_
+			   syncHash _C_ NetworkSyncHashs[gameNetCycle & 0xFF] _C_ GameCycle);
 }
 
 static void NetworkExecCommand_Selection(const CNetworkCommandQueue &ncq)
@@ -950,6 +1160,35 @@ static void NetworkExecCommand_ExtendedCommand(const CNetworkCommandQueue &ncq)
 						nec.Arg1, nec.Arg2, nec.Arg3, nec.Arg4);
 }
 
+/**
+**  A player wants another network lag.
+**
+**  All the players run this at the same cycle, so they all switch to the
+**  biggest lag wanted together. NetworkCommands fills or skips the cycles
+**  between the old and the new lag.
+*/
+static void NetworkExecCommand_Lag(const CNetworkCommandQueue &ncq)
+{
+	Assert((ncq.Type & 0x7F) == MessageLag);
+	CNetworkCommandLag nc;
+
+	nc.Deserialize(&ncq.Data[0]);
+	if (nc.player >= PlayerMax) {
+		return;
+	}
+	NetworkLagWanted[nc.player] = NetworkClampLag(nc.Lag);
+
+	unsigned int lag = NetworkLagWanted[ThisPlayer->Index];
+	for (int i = 0; i != HostsCount; ++i) {
+		lag = std::max(lag, NetworkLagWanted[Hosts[i].PlyNr]);
+	}
+	if (lag != CNetworkParameter::Instance.NetworkLag) {
+		DebugPrint("Network lag %d -> %d at cycle %lu\n" _C_
+				   CNetworkParameter::Instance.NetworkLag _C_ lag _C_ GameCycle);
+		CNetworkParameter::Instance.NetworkLag = lag;
+	}
+}
+
 static void NetworkExecCommand_Command(const CNetworkCommandQueue &ncq)
 {
 	CNetworkCommand nc;
@@ -958,6 +1197,17 @@ static void NetworkExecCommand_Command(const CNetworkCommandQueue &ncq)
 	ExecCommand(ncq.Type, nc.Unit, nc.X, nc.Y, nc.Dest);
 }
 
+static void NetworkExecCommand_Group(const CNetworkCommandQueue &ncq)
+{
+	Assert((ncq.Type & 0x7F) == MessageCommandGroup);
+	CNetworkCommandGroup group;
+
+	group.Deserialize(&ncq.Data[0], ncq.Data.size());
+	for (size_t i = 0; i != group.Units.size(); ++i) {
+		ExecCommand(group.Type, group.Units[i], group.X, group.Y, group.Dest);
+	}
+}
+
 /**
 **  Execute a network command.
 **
@@ -970,7 +1220,9 @@ static void NetworkExecCommand(const CNetworkCommandQueue &ncq)
 		case MessageSelection: NetworkExecCommand_Selection(ncq); break;
 		case MessageChat: NetworkExecCommand_Chat(ncq); break;
 		case MessageQuit: NetworkExecCommand_Quit(ncq); break;
+		case MessageLag: NetworkExecCommand_Lag(ncq); break;
 		case MessageExtendedCommand: NetworkExecCommand_ExtendedCommand(ncq); break;
+		case MessageCommandGroup: NetworkExecCommand_Group(ncq); break;
 		case MessageNone:
 			// Nothing to Do, This Message Should Never be Executed
 			Assert(0);
@@ -981,18 +1233,22 @@ static void NetworkExecCommand(const CNetworkCommandQueue &ncq)
 
 /**
 **  Network send commands.
+**
+**  @param gameNetCycle  Game cycle to run the commands at.
+**  @param withCommands  Send the queued commands, else only a sync.
 */
-static void NetworkSendCommands(unsigned long gameNetCycle)
+static void NetworkSendCommands(unsigned long gameNetCycle, bool withCommands)
 {
 	// No command available, send sync.
 	int numcommands = 0;
 	CNetworkCommandQueue(&ncq)[MaxNetworkCommands] = NetworkIn[gameNetCycle & 0xFF][ThisPlayer->Index];
 	ncq[0].Clear();
-	if (CommandsIn.empty() && MsgCommandsIn.empty()) {
+	if (!withCommands || (CommandsIn.empty() && MsgCommandsIn.empty())) {
 		CNetworkCommandSync nc;
 		ncq[0].Type = MessageSync;
 		nc.syncHash = SyncHash;
 		nc.syncSeed = SyncRandSeed;
+		memcpy(nc.syncDigest, SyncDigest, sizeof(nc.syncDigest));
 		ncq[0].Data.resize(nc.Size());
 		nc.Serialize(&ncq[0].Data[0]);
 		ncq[0].Time = gameNetCycle;
@@ -1001,7 +1257,8 @@ static void NetworkSendCommands(unsigned long gameNetCycle)
 		while (!CommandsIn.empty() && numcommands < MaxNetworkCommands) {
 			const CNetworkCommandQueue &incommand = CommandsIn.front();
 #ifdef DEBUG
-			if (incommand.Type != MessageExtendedCommand) {
+			if (incommand.Type != MessageExtendedCommand && incommand.Type != MessageCommandGroup
+				&& incommand.Type != MessageLag) {
 				CNetworkCommand nc;
 				nc.Deserialize(&incommand.Data[0]);
 
@@ -1030,6 +1287,7 @@ static void NetworkSendCommands(unsigned long gameNetCycle)
 	}
 	NetworkSyncSeeds[gameNetCycle & 0xFF] = SyncRandSeed;
 	NetworkSyncHashs[gameNetCycle & 0xFF] = SyncHash;
+	memcpy(NetworkSyncDigests[gameNetCycle & 0xFF], SyncDigest, sizeof(SyncDigest));
 	NetworkSendPacket(ncq);
 }
 
@@ -1047,13 +1305,69 @@ static void NetworkExecCommands(unsigned long gameNetCycle)
 				break;
 			}
 			if (ncq.Time) {
-				Assert(ncq.Time == gameNetCycle * CNetworkParameter::Instance.gameCyclesPerUpdate);
-				NetworkExecCommand(ncq);
+				Assert(ncq.Time == gameNetCycle);
+				const int type = ncq.Type & 0x7F;
+				if (NetworkCommandHook && type != MessageSync && type != MessageLag && type != MessageQuit) {
+					NetworkCommandHook(i, ncq.Type, ncq.Data);
+				} else {
+					NetworkExecCommand(ncq);
+				}
 			}
 		}
 	}
 }
 
+/**
+**  Ping the other players and ask for the network lag their round-trip
+**  times need, once a second.
+**
+**  A command must reach the other players before they run its cycle: the
+**  lag covers half of the worst round-trip time, four times its variation
+**  and one network update. A bigger lag is asked for at once, a smaller
+**  one only when it saves at least two network updates.
+*/
+static void NetworkUpdateLag()
+{
+	const unsigned long ticks = NetworkGetTicks();
+
+	if (ticks - NetworkLastPing < 1000) {
+		return;
+	}
+	NetworkLastPing = ticks;
+
+	int delay = 0;
+	bool measured = true;
+	for (int i = 0; i != HostsCount; ++i) {
+		const int ply = Hosts[i].PlyNr;
+
+		NetworkSendPing(CHost(Hosts[i].Host, Hosts[i].Port), MessagePing, uint32_t(ticks));
+		if (NetworkRtt[ply] == 0) {
+			measured = false;
+		}
+		delay = std::max(delay, NetworkRtt[ply] / 2 + 4 * NetworkRttVar[ply]);
+	}
+	if (!measured || HostsCount == 0) {
+		return;
+	}
+	const unsigned int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	const int cycleMs = std::max(1, 100000 / (CYCLES_PER_SECOND * std::max(VideoSyncSpeed, 1)));
+	const unsigned int lag = NetworkClampLag((delay + cycleMs - 1) / cycleMs + gameCyclesPerUpdate);
+
+	if (lag > NetworkLagAnnounced || lag + 2 * gameCyclesPerUpdate <= NetworkLagAnnounced) {
+		NetworkLagAnnounced = lag;
+
+		CNetworkCommandLag nc;
+		nc.player = ThisPlayer->Index;
+		nc.Lag = lag;
+		CNetworkCommandQueue ncq;
+		ncq.Time = GameCycle;
+		ncq.Type = MessageLag;
+		ncq.Data.resize(nc.Size());
+		nc.Serialize(&ncq.Data[0]);
+		CommandsIn.push_back(ncq);
+	}
+}
+
 /**
 **  Handle network commands.
 */
@@ -1066,8 +1380,20 @@ void NetworkCommands()
 		return;
 	}
 	const unsigned long gameNetCycle = GameCycle;
+	const unsigned int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	const unsigned long sendCycle = gameNetCycle + CNetworkParameter::Instance.NetworkLag;
+
+	NetworkUpdateLag();
+	// The lag grew: the cycles up to the new one get only a sync.
+	for (unsigned long cycle = NetworkLastSentCycle + gameCyclesPerUpdate; cycle < sendCycle; cycle += gameCyclesPerUpdate) {
+		NetworkSendCommands(cycle, false);
+	}
 	// Send messages to all clients (other players)
-	NetworkSendCommands(gameNetCycle + CNetworkParameter::Instance.NetworkLag);
+	// The lag shrank: the commands wait until the cycles already sent are passed.
+	if (sendCycle > NetworkLastSentCycle) {
+		NetworkSendCommands(sendCycle, true);
+		NetworkLastSentCycle = sendCycle;
+	}
 	NetworkExecCommands(gameNetCycle);
 	NetworkInSync = IsNetworkCommandReady(gameNetCycle + CNetworkParameter::Instance.gameCyclesPerUpdate);
 }
@@ -1088,11 +1414,12 @@ static void CheckPlayerThatTimeOut(int hostIndex)
 				   (timeoutInS - secs) / 60, (timeoutInS - secs) % 60);
 	}
 	if (secs >= timeoutInS) {
-		const unsigned int nextGameNetCycle = GameCycle / CNetworkParameter::Instance.gameCyclesPerUpdate + 1;
+		const int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+		const unsigned long nextGameNetCycle = (GameCycle / gameCyclesPerUpdate + 1) * gameCyclesPerUpdate;
 		CNetworkCommandQuit nc;
 		nc.player = playerIndex;
 		CNetworkCommandQueue *ncq = &NetworkIn[nextGameNetCycle & 0xFF][playerIndex][0];
-		ncq->Time = nextGameNetCycle * CNetworkParameter::Instance.gameCyclesPerUpdate;
+		ncq->Time = nextGameNetCycle;
 		ncq->Type = MessageQuit;
 		ncq->Data.resize(nc.Size());
 		nc.Serialize(&ncq->Data[0]);
@@ -1120,6 +1447,7 @@ static void NetworkResendCommands()
 #ifdef DEBUG
 	++NetworkStat.resentPacketCount;
 #endif
+	++NetworkResendCount;
 
 	const int networkUpdates = CNetworkParameter::Instance.gameCyclesPerUpdate;
 	const int nextGameCycle = ((GameCycle / networkUpdates) + 1) * networkUpdates;
@@ -1132,6 +1460,120 @@ static void NetworkResendCommands()
 	NetworkBroadcast(packet, 1);
 }
 
+//----------------------------------------------------------------------------
+//  Network contexts
+//----------------------------------------------------------------------------
+
+/**
+**  Network state of one player.
+**
+**  The lockstep harness runs several players in one process: it swaps
+**  the state of each player in and out of the globals around its turn.
+*/
+class CNetworkContext
+{
+public:
+	CNetworkContext() : LastSentCycle(0), LagStart(0), LagAnnounced(0), LastPing(0),
+		ResendCount(0), InSync(true), GameCycle(0), ThisPlayer(NULL), HostsCount(0),
+		Lag(CNetworkParameter::Instance.NetworkLag) {
+		memset(LastFrame, 0, sizeof(LastFrame));
+		memset(SyncSeeds, 0, sizeof(SyncSeeds));
+		memset(SyncHashs, 0, sizeof(SyncHashs));
+		memset(SyncDigests, 0, sizeof(SyncDigests));
+		memset(PlayerQuit, 0, sizeof(PlayerQuit));
+		memset(LagWanted, 0, sizeof(LagWanted));
+		memset(Rtt, 0, sizeof(Rtt));
+		memset(RttVar, 0, sizeof(RttVar));
+	}
+
+	unsigned long LastFrame[PlayerMax];
+	int SyncSeeds[256];
+	int SyncHashs[256];
+	uint32_t SyncDigests[256][SyncDigestPartMax];
+	CNetworkCommandQueue In[256][PlayerMax][MaxNetworkCommands];
+	std::deque<CNetworkCommandQueue> CommandsIn;
+	std::deque<CNetworkCommandQueue> MsgCommandsIn;
+	int PlayerQuit[PlayerMax];
+	unsigned long LastSentCycle;
+	unsigned int LagStart;
+	unsigned int LagWanted[PlayerMax];
+	unsigned int LagAnnounced;
+	int Rtt[PlayerMax];
+	int RttVar[PlayerMax];
+	unsigned long LastPing;
+	unsigned long ResendCount;
+
+	CUDPSocket Socket;
+	bool InSync;
+	unsigned long GameCycle;
+	CPlayer *ThisPlayer;
+	int HostsCount;
+	CNetworkHost Hosts[PlayerMax];
+	unsigned int Lag;
+};
+
+CNetworkContext *NetworkNewContext()
+{
+	return new CNetworkContext;
+}
+
+void NetworkDeleteContext(CNetworkContext *context)
+{
+	delete context;
+}
+
+template <typename T, size_t N>
+static void SwapArray(T(&a)[N], T(&b)[N])
+{
+	std::swap_ranges(a, a + N, b);
+}
+
+/**
+**  Exchange the network state with the one of a context.
+**
+**  Called once to make the context current, and once more to put back
+**  the previous state.
+*/
+void NetworkSwapContext(CNetworkContext &context)
+{
+	SwapArray(NetworkLastFrame, context.LastFrame);
+	SwapArray(NetworkSyncSeeds, context.SyncSeeds);
+	SwapArray(NetworkSyncHashs, context.SyncHashs);
+	std::swap_ranges(&NetworkSyncDigests[0][0], &NetworkSyncDigests[0][0] + 256 * SyncDigestPartMax,
+					 &context.SyncDigests[0][0]);
+	for (int i = 0; i != 256; ++i) {
+		for (int p = 0; p != PlayerMax; ++p) {
+			for (int c = 0; c != MaxNetworkCommands; ++c) {
+				CNetworkCommandQueue &a = NetworkIn[i][p][c];
+				CNetworkCommandQueue &b = context.In[i][p][c];
+
+				std::swap(a.Time, b.Time);
+				std::swap(a.Type, b.Type);
+				a.Data.swap(b.Data);
+			}
+		}
+	}
+	CommandsIn.swap(context.CommandsIn);
+	MsgCommandsIn.swap(context.MsgCommandsIn);
+	SwapArray(PlayerQuit, context.PlayerQuit);
+	std::swap(NetworkLastSentCycle, context.LastSentCycle);
+	std::swap(NetworkLagStart, context.LagStart);
+	SwapArray(NetworkLagWanted, context.LagWanted);
+	std::swap(NetworkLagAnnounced, context.LagAnnounced);
+	SwapArray(NetworkRtt, context.Rtt);
+	SwapArray(NetworkRttVar, context.RttVar);
+	std::swap(NetworkLastPing, context.LastPing);
+	std::swap(NetworkResendCount, context.ResendCount);
+
+	NetworkFildes.SwapTransport(context.Socket);
+	std::swap(NetworkInSync, context.InSync);
+	std::swap(GameCycle, context.GameCycle);
+	std::swap(ThisPlayer, context.ThisPlayer);
+	std::swap(HostsCount, context.HostsCount);
+	SwapArray(Hosts, context.Hosts);
+	std::swap(CNetworkParameter::Instance.NetworkLag, context.Lag);
+}
+
 /**
 **  Recover network.
 */
@@ -1148,7 +1590,8 @@ void NetworkRecover()
 		CheckPlayerThatTimeOut(i);
 	}
 	NetworkResendCommands();
-	const unsigned int nextGameNetCycle = GameCycle / CNetworkParameter::Instance.gameCyclesPerUpdate + 1;
+	const int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	const unsigned long nextGameNetCycle = (GameCycle / gameCyclesPerUpdate + 1) * gameCyclesPerUpdate;
 	NetworkInSync = IsNetworkCommandReady(nextGameNetCycle);
 }
 
@@ -63,14 +63,17 @@ bool CHost::isValid() const
 }
 
 //
-// CUDPSocket_Impl
+// CUDPSocket_Native
 //
 
-class CUDPSocket_Impl
+/**
+**  Transport through a socket of the system.
+*/
+class CUDPSocket_Native : public CUDPSocket_Impl
 {
 public:
-	CUDPSocket_Impl() : socket(Socket(-1)) {}
-	~CUDPSocket_Impl() { if (IsValid()) { Close(); } }
+	CUDPSocket_Native() : socket(Socket(-1)) {}
+	~CUDPSocket_Native() { if (IsValid()) { Close(); } }
 	bool Open(const CHost &host) { socket = NetOpenUDP(host.getIp(), host.getPort()); return socket != INVALID_SOCKET; }
 	void Close() { NetCloseUDP(socket); socket = Socket(-1); }
 	void Send(const CHost &host, const void *buf, unsigned int len) { NetSendUDP(socket, host.getIp(), host.getPort(), buf, len); }
@@ -115,7 +118,7 @@ void CUDPSocket::CStatistic::clear()
 
 CUDPSocket::CUDPSocket()
 {
-	m_impl = new CUDPSocket_Impl();
+	m_impl = new CUDPSocket_Native();
 }
 
 CUDPSocket::~CUDPSocket()
@@ -123,6 +126,28 @@ CUDPSocket::~CUDPSocket()
 	delete m_impl;
 }
 
+/**
+**  Use another transport, the socket takes the ownership of impl.
+**
+**  @param impl  New transport, NULL for the socket of the system.
+*/
+void CUDPSocket::SetTransport(CUDPSocket_Impl *impl)
+{
+	delete m_impl;
+	m_impl = impl ? impl : new CUDPSocket_Native();
+}
+
+/**
+**  Exchange the transports, and their state, of two sockets.
+*/
+void CUDPSocket::SwapTransport(CUDPSocket &other)
+{
+	std::swap(m_impl, other.m_impl);
+#ifdef DEBUG
+	std::swap(m_statistic, other.m_statistic);
+#endif
+}
+
 bool CUDPSocket::Open(const CHost &host)
 {
 	return m_impl->Open(host);
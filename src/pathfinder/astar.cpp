@@ -42,6 +42,7 @@
 #include "unit_find.h"
 
 #include "pathfinder.h"
+#include "pathfinder_local.h"
 
 #include <stdio.h>
 
@@ -49,17 +50,21 @@
 --  Declarations
 ----------------------------------------------------------------------------*/
 
-struct Node {
+struct CAStarContext::Node {
 	int CostFromStart;  /// Real costs to reach this point
 	short int CostToGoal;     /// Estimated cost to goal
 	char InGoal;        /// is this point in the goal
 	char Direction;     /// Direction for trace back
+	int OpenIndex;      /// Slot in the open set heap (only valid while in the open set)
+	unsigned int Generation; /// Search which last wrote this node
 };
 
-struct Open {
+struct CAStarContext::Open {
 	Vec2i pos;
 	short int Costs; /// complete costs to goal
-	unsigned short int O;     /// Offset into matrix
+	short int CostToGoal; /// Estimated cost to goal (tie break)
+	short int Dist;  /// Manhattan distance to goal (tie break)
+	int O;           /// Offset into matrix
 };
 
 //for 32 bit signed int
@@ -83,16 +88,6 @@ const int Heading2Y[9] = { -1, -1, 0, +1, +1, +1, 0, -1, 0 };
 int Heading2O[9];//heading to offset
 const int XY2Heading[3][3] = { {7, 6, 5}, {0, 0, 4}, {1, 2, 3}};
 
-/// cost matrix
-static Node *AStarMatrix;
-
-/// a list of close nodes, helps to speed up the matrix cleaning
-static int *CloseSet;
-static int CloseSetSize;
-static int Threshold;
-static int OpenSetMaxSize;
-static int AStarMatrixSize;
-#define MAX_CLOSE_SET_RATIO 4
 #define MAX_OPEN_SET_RATIO 8 // 10,16 to small
 
 /// see pathfinder.h
@@ -104,21 +99,16 @@ int AStarUnknownTerrainCost = 2;
 static int AStarMapWidth;
 static int AStarMapHeight;
 
-static int AStarGoalX;
-static int AStarGoalY;
-
-/**
-**  The Open set is handled by a stored array
-**  the end of the array holds the item with the smallest cost.
-*/
+struct CAStarContext::CostMoveToCacheEntry {
+	int Cost;                /// Cached result of CostMoveToCallBack_Default
+	unsigned int Generation; /// Search which computed Cost
+};
 
-/// The set of Open nodes
-static Open *OpenSet;
-/// The size of the open node set
-static int OpenSetSize;
+/// Under this distance to goal, the search is not restricted to a corridor
+static const int AStarCorridorMinDistance = 2 * CRegionGraph::RegionClusterSize;
 
-static int *CostMoveToCache;
-static const int CacheNotSet = -5;
+/// Context of the searches done by the game logic
+static CAStarContext AStarDefaultContext;
 
 /*----------------------------------------------------------------------------
 --  Profile
@@ -244,32 +234,74 @@ inline void ProfilePrint()
 --  Functions
 ----------------------------------------------------------------------------*/
 
+CAStarContext::CAStarContext() :
+	Matrix(NULL), MatrixSize(0), CurrentGeneration(0),
+	OpenSet(NULL), OpenSetMaxSize(0), OpenSetSize(0),
+	CostMoveToCache(NULL), CostMoveToCacheSize(0),
+	UseRegions(false), UseCorridor(false), PathCache(NULL), CostLog(NULL)
+{
+}
+
+CAStarContext::~CAStarContext()
+{
+	Free();
+}
+
 /**
-**  Init A* data structures
+**  Allocate the data structures of the context for the current map.
+**
+**  The open set is handled by a binary heap: the first item of the array
+**  holds the item with the smallest cost. Each node of Matrix knows its
+**  slot in the heap (Node::OpenIndex).
 */
-void InitAStar(int mapWidth, int mapHeight)
+void CAStarContext::Init()
 {
 	// Should only be called once
-	Assert(!AStarMatrix);
-
-	AStarMapWidth = mapWidth;
-	AStarMapHeight = mapHeight;
-
-	AStarMatrixSize = sizeof(Node) * AStarMapWidth * AStarMapHeight;
-	AStarMatrix = new Node[AStarMapWidth * AStarMapHeight];
-	memset(AStarMatrix, 0, AStarMatrixSize);
+	Assert(!Matrix);
 
-	Threshold = AStarMapWidth * AStarMapHeight / MAX_CLOSE_SET_RATIO;
-	CloseSet = new int[Threshold];
+	MatrixSize = sizeof(Node) * AStarMapWidth * AStarMapHeight;
+	Matrix = new Node[AStarMapWidth * AStarMapHeight];
+	memset(Matrix, 0, MatrixSize);
 
 	OpenSetMaxSize = AStarMapWidth * AStarMapHeight / MAX_OPEN_SET_RATIO;
 	OpenSet = new Open[OpenSetMaxSize];
+	OpenSetSize = 0;
+
+	CostMoveToCacheSize = sizeof(CostMoveToCacheEntry) * AStarMapWidth * AStarMapHeight;
+	CostMoveToCache = new CostMoveToCacheEntry[AStarMapWidth * AStarMapHeight];
+	memset(CostMoveToCache, 0, CostMoveToCacheSize);
+	CurrentGeneration = 0;
+}
 
-	CostMoveToCache = new int[AStarMapWidth * AStarMapHeight];
+/**
+**  Free the data structures of the context.
+*/
+void CAStarContext::Free()
+{
+	delete[] Matrix;
+	Matrix = NULL;
+	delete[] OpenSet;
+	OpenSet = NULL;
+	OpenSetSize = 0;
+	delete[] CostMoveToCache;
+	CostMoveToCache = NULL;
+	UseRegions = false;
+	UseCorridor = false;
+}
+
+/**
+**  Init A* data structures
+*/
+void InitAStar(int mapWidth, int mapHeight)
+{
+	AStarMapWidth = mapWidth;
+	AStarMapHeight = mapHeight;
 
 	for (int i = 0; i < 9; ++i) {
 		Heading2O[i] = Heading2Y[i] * AStarMapWidth;
 	}
+	AStarDefaultContext.Init();
+	AStarDefaultContext.SetPathCache(&PathCache);
 
 	ProfileInit();
 }
@@ -279,105 +311,143 @@ void InitAStar(int mapWidth, int mapHeight)
 */
 void FreeAStar()
 {
-	delete[] AStarMatrix;
-	AStarMatrix = NULL;
-	delete[] CloseSet;
-	CloseSet = NULL;
-	CloseSetSize = 0;
-	delete[] OpenSet;
-	OpenSet = NULL;
-	OpenSetSize = 0;
-	delete[] CostMoveToCache;
-	CostMoveToCache = NULL;
+	AStarDefaultContext.Free();
+	FreePathPrefetch();
+	PathCache.Clear();
+	FreeRegionGraphs();
+	FreeFlowFields();
 
 	ProfilePrint();
 }
 
 /**
-**  Prepare pathfinder.
+**  Prepare pathfinder for a new search.
+**
+**  Only bump the generation: nodes and cache entries stamped with an older
+**  generation are read as unset, so nothing has to be cleared.
 */
-static void AStarPrepare()
+void CAStarContext::Prepare()
 {
-	memset(AStarMatrix, 0, AStarMatrixSize);
+	ProfileBegin("AStarPrepare");
+
+	++CurrentGeneration;
+	if (CurrentGeneration == 0) {
+		// Wrapped around, old stamps could look current again.
+		memset(Matrix, 0, MatrixSize);
+		memset(CostMoveToCache, 0, CostMoveToCacheSize);
+		CurrentGeneration = 1;
+	}
+	ProfileEnd("AStarPrepare");
 }
 
 /**
-**  Clean up A*
+**  Get the node at offset o, reset it first if it belongs to an older search.
 */
-static void AStarCleanUp()
+inline CAStarContext::Node &CAStarContext::GetNode(int o)
 {
-	ProfileBegin("AStarCleanUp");
+	Node &node = Matrix[o];
 
-	if (CloseSetSize >= Threshold) {
-		AStarPrepare();
-	} else {
-		for (int i = 0; i < CloseSetSize; ++i) {
-			AStarMatrix[CloseSet[i]].CostFromStart = 0;
-			AStarMatrix[CloseSet[i]].InGoal = 0;
-		}
+	if (node.Generation != CurrentGeneration) {
+		node.CostFromStart = 0;
+		node.InGoal = 0;
+		node.Generation = CurrentGeneration;
 	}
-	ProfileEnd("AStarCleanUp");
+	return node;
 }
 
-static void CostMoveToCacheCleanUp()
+/**
+**  Compare two nodes of the open set.
+**
+**  Cheapest costs first, then the nearest estimated cost to goal,
+**  then the nearest Manhattan distance to goal.
+**  Offset into matrix is used as last resort to keep the order total.
+**
+**  @return  true if lhs has to be handled before rhs.
+*/
+inline bool CAStarContext::OpenLess(const Open &lhs, const Open &rhs)
 {
-	ProfileBegin("CostMoveToCacheCleanUp");
-	int AStarMapMax =  AStarMapWidth * AStarMapHeight;
-#if 1
-	int *ptr = CostMoveToCache;
-#ifdef __x86_64__
-	union {
-		intptr_t d;
-		int i[2];
-	} conv;
-	conv.i[0] = CacheNotSet;
-	conv.i[1] = CacheNotSet;
-
-	if (((uintptr_t)ptr) & 4) {
-		*ptr++ = CacheNotSet;
-		--AStarMapMax;
+	if (lhs.Costs != rhs.Costs) {
+		return lhs.Costs < rhs.Costs;
 	}
-#endif
-	while (AStarMapMax > 3) {
-#ifdef __x86_64__
-		*((intptr_t *)ptr) = conv.d;
-		*((intptr_t *)(ptr + 2)) = conv.d;
-		ptr += 4;
-#else
-		*ptr++ = CacheNotSet;
-		*ptr++ = CacheNotSet;
-		*ptr++ = CacheNotSet;
-		*ptr++ = CacheNotSet;
-#endif
-		AStarMapMax -= 4;
-	};
-	while (AStarMapMax) {
-		*ptr++ = CacheNotSet;
-		--AStarMapMax;
+	if (lhs.CostToGoal != rhs.CostToGoal) {
+		return lhs.CostToGoal < rhs.CostToGoal;
 	}
-#else
-	for (int i = 0; i < AStarMapMax; ++i) {
-		CostMoveToCache[i] = CacheNotSet;
+	if (lhs.Dist != rhs.Dist) {
+		return lhs.Dist < rhs.Dist;
 	}
-#endif
-	ProfileEnd("CostMoveToCacheCleanUp");
+	return lhs.O < rhs.O;
+}
+
+/**
+**  Store node at position pos of the open set and keep the matrix index up to date.
+*/
+inline void CAStarContext::SetOpen(int pos, const Open &node)
+{
+	OpenSet[pos] = node;
+	Matrix[node.O].OpenIndex = pos;
+}
+
+/**
+**  Move the node at position pos toward the top of the heap.
+*/
+void CAStarContext::SiftUp(int pos)
+{
+	const Open node = OpenSet[pos];
+
+	while (pos > 0) {
+		const int parent = (pos - 1) >> 1;
+		if (!OpenLess(node, OpenSet[parent])) {
+			break;
+		}
+		SetOpen(pos, OpenSet[parent]);
+		pos = parent;
+	}
+	SetOpen(pos, node);
+}
+
+/**
+**  Move the node at position pos toward the bottom of the heap.
+*/
+void CAStarContext::SiftDown(int pos)
+{
+	const Open node = OpenSet[pos];
+
+	while (1) {
+		int child = 2 * pos + 1;
+		if (child >= OpenSetSize) {
+			break;
+		}
+		if (child + 1 < OpenSetSize && OpenLess(OpenSet[child + 1], OpenSet[child])) {
+			++child;
+		}
+		if (!OpenLess(OpenSet[child], node)) {
+			break;
+		}
+		SetOpen(pos, OpenSet[child]);
+		pos = child;
+	}
+	SetOpen(pos, node);
 }
 
 /**
 **  Find the best node in the current open node set
 **  Returns the position of this node in the open node set
 */
-#define AStarFindMinimum() (OpenSetSize - 1)
+#define AStarFindMinimum() (0)
 
 
 /**
 **  Remove the minimum from the open node set
 */
-static void AStarRemoveMinimum(int pos)
+void CAStarContext::RemoveMinimum(int pos)
 {
-	Assert(pos == OpenSetSize - 1);
+	Assert(pos == 0);
 
 	OpenSetSize--;
+	if (OpenSetSize > 0) {
+		OpenSet[0] = OpenSet[OpenSetSize];
+		SiftDown(0);
+	}
 }
 
 /**
@@ -385,17 +455,10 @@ static void AStarRemoveMinimum(int pos)
 **
 **  @return  0 or PF_FAILED
 */
-static inline int AStarAddNode(const Vec2i &pos, int o, int costs)
+int CAStarContext::AddNode(const Vec2i &pos, int o, int costs)
 {
 	ProfileBegin("AStarAddNode");
 
-	int bigi = 0, smalli = OpenSetSize;
-	int midcost;
-	int midi;
-	int midCostToGoal;
-	int midDist;
-	const Open *open;
-
 	if (OpenSetSize + 1 >= OpenSetMaxSize) {
 		fprintf(stderr, "A* internal error: raise Open Set Max Size "
 				"(current value %d)\n", OpenSetMaxSize);
@@ -403,46 +466,17 @@ static inline int AStarAddNode(const Vec2i &pos, int o, int costs)
 		return PF_FAILED;
 	}
 
-	const int costToGoal = AStarMatrix[o].CostToGoal;
-	const int dist = MyAbs(pos.x - AStarGoalX) + MyAbs(pos.y - AStarGoalY);
-
-	// find where we should insert this node.
-	// binary search where to insert the new node
-	while (bigi < smalli) {
-		midi = (smalli + bigi) >> 1;
-		open = &OpenSet[midi];
-		midcost = open->Costs;
-		midCostToGoal = AStarMatrix[open->O].CostToGoal;
-		midDist = MyAbs(open->pos.x - AStarGoalX) + MyAbs(open->pos.y - AStarGoalY);
-		if (costs > midcost || (costs == midcost
-								&& (costToGoal > midCostToGoal || (costToGoal == midCostToGoal
-																   && dist > midDist)))) {
-			smalli = midi;
-		} else if (costs < midcost || (costs == midcost
-									   && (costToGoal < midCostToGoal || (costToGoal == midCostToGoal
-											   && dist < midDist)))) {
-			if (bigi == midi) {
-				bigi++;
-			} else {
-				bigi = midi;
-			}
-		} else {
-			bigi = midi;
-			smalli = midi;
-		}
-	}
-
-	if (OpenSetSize > bigi) {
-		// free a the slot for our node
-		memmove(&OpenSet[bigi + 1], &OpenSet[bigi], (OpenSetSize - bigi) * sizeof(Open));
-	}
-
-	// fill our new node
-	OpenSet[bigi].pos = pos;
-	OpenSet[bigi].O = o;
-	OpenSet[bigi].Costs = costs;
+	// fill our new node at the bottom of the heap
+	Open &node = OpenSet[OpenSetSize];
+	node.pos = pos;
+	node.O = o;
+	node.Costs = costs;
+	node.CostToGoal = Matrix[o].CostToGoal;
+	node.Dist = MyAbs(pos.x - GoalPos.x) + MyAbs(pos.y - GoalPos.y);
 	++OpenSetSize;
 
+	SiftUp(OpenSetSize - 1);
+
 	ProfileEnd("AStarAddNode");
 
 	return 0;
@@ -450,23 +484,17 @@ static inline int AStarAddNode(const Vec2i &pos, int o, int costs)
 
 /**
 **  Change the cost associated to an open node.
-**  Can be further optimised knowing that the new cost MUST BE LOWER
-**  than the old one.
+**  The new cost MUST BE LOWER than the old one.
 */
-static void AStarReplaceNode(int pos)
+void CAStarContext::ReplaceNode(int pos, int costs)
 {
 	ProfileBegin("AStarReplaceNode");
 
-	Open node;
-
-	// Remove the outdated node
-	node = OpenSet[pos];
-	OpenSetSize--;
-	//memmove(&OpenSet[pos], &OpenSet[pos+1], sizeof(Open) * (OpenSetSize-pos));
-	memcpy(&OpenSet[pos], &OpenSet[pos + 1], sizeof(Open) * (OpenSetSize - pos));
+	Assert(costs <= OpenSet[pos].Costs);
+	OpenSet[pos].Costs = costs;
+	OpenSet[pos].CostToGoal = Matrix[OpenSet[pos].O].CostToGoal;
+	SiftUp(pos);
 
-	// Re-add the node with the new cost
-	AStarAddNode(node.pos, node.O, node.Costs);
 	ProfileEnd("AStarReplaceNode");
 }
 
@@ -476,30 +504,20 @@ static void AStarReplaceNode(int pos)
 **
 **  @return  -1 if not found and the position of the node in the table if found.
 */
-static int AStarFindNode(int eo)
+int CAStarContext::FindNode(int eo) const
 {
 	ProfileBegin("AStarFindNode");
 
-	for (int i = 0; i < OpenSetSize; ++i) {
-		if (OpenSet[i].O == eo) {
-			ProfileEnd("AStarFindNode");
-			return i;
-		}
+	// OpenIndex may be outdated, so check that the slot really holds our node.
+	const int i = Matrix[eo].OpenIndex;
+	if (i < OpenSetSize && OpenSet[i].O == eo) {
+		ProfileEnd("AStarFindNode");
+		return i;
 	}
 	ProfileEnd("AStarFindNode");
 	return -1;
 }
 
-/**
-**  Add a node to the closed set
-*/
-static void AStarAddToClose(int node)
-{
-	if (CloseSetSize < Threshold) {
-		CloseSet[CloseSetSize++] = node;
-	}
-}
-
 #define GetIndex(x, y) (x) + (y) * AStarMapWidth
 
 /* build-in costmoveto code */
@@ -574,186 +592,48 @@ static int CostMoveToCallBack_Default(unsigned int index, const CUnit &unit)
 **                0 -> no induced cost, except move
 **               >0 -> costly tile
 */
-static inline int CostMoveTo(unsigned int index, const CUnit &unit)
+inline int CAStarContext::CostMoveTo(unsigned int index, const CUnit &unit)
 {
-	int *c = &CostMoveToCache[index];
-	if (*c != CacheNotSet) {
-		return *c;
+	CostMoveToCacheEntry &c = CostMoveToCache[index];
+	if (c.Generation == CurrentGeneration) {
+		return c.Cost;
 	}
-	*c = CostMoveToCallBack_Default(index, unit);
-	return *c;
+	c.Cost = CostMoveToCallBack_Default(index, unit);
+	c.Generation = CurrentGeneration;
+	if (CostLog) {
+		const CPathPrefetch::Cost cost = {index, c.Cost};
+		CostLog->push_back(cost);
+	}
+	return c.Cost;
 }
 
-class AStarGoalMarker
+class CAStarContext::GoalMarker
 {
 public:
-	AStarGoalMarker(const CUnit &unit, bool *goal_reachable) :
-		unit(unit), goal_reachable(goal_reachable)
+	GoalMarker(CAStarContext &context, const CUnit &unit, bool *goal_reachable) :
+		context(context), unit(unit), goal_reachable(goal_reachable)
 	{}
 
 	void operator()(int offset) const {
-		if (CostMoveTo(offset, unit) >= 0) {
-			AStarMatrix[offset].InGoal = 1;
+		if (context.CostMoveTo(offset, unit) >= 0) {
+			context.GetNode(offset).InGoal = 1;
+			if (context.UseRegions) {
+				context.RegionSearch.MarkGoal(offset);
+			}
 			*goal_reachable = true;
 		}
-		AStarAddToClose(offset);
 	}
 private:
+	CAStarContext &context;
 	const CUnit &unit;
 	bool *goal_reachable;
 };
 
-
-template <typename T>
-class MinMaxRangeVisitor
-{
-public:
-	explicit MinMaxRangeVisitor(const T &func) : func(func), minrange(0), maxrange(0) {}
-
-	void SetGoal(Vec2i goalTopLeft, Vec2i goalBottomRight) {
-		this->goalTopLeft = goalTopLeft;
-		this->goalBottomRight = goalBottomRight;
-	}
-
-	void SetRange(int minrange, int maxrange) {
-		this->minrange = minrange;
-		this->maxrange = maxrange;
-	}
-
-	void SetUnitSize(const Vec2i &tileSize) {
-		this->unitExtraTileSize.x = tileSize.x - 1;
-		this->unitExtraTileSize.y = tileSize.y - 1;
-	}
-
-	void Visit() const {
-		TopHemicycle();
-		TopHemicycleNoMinRange();
-		Center();
-		BottomHemicycleNoMinRange();
-		BottomHemicycle();
-	}
-
-private:
-	int GetMaxOffsetX(int dy, int range) const {
-		return isqrt(square(range + 1) - square(dy) - 1);
-	}
-
-	// Distance are computed between bottom of unit and top of goal
-	void TopHemicycle() const {
-		const int miny = std::max(0, goalTopLeft.y - maxrange - unitExtraTileSize.y);
-		const int maxy = std::min(goalTopLeft.y - minrange - unitExtraTileSize.y, goalTopLeft.y - 1 - unitExtraTileSize.y);
-		for (int y = miny; y <= maxy; ++y) {
-			const int offsetx = GetMaxOffsetX(y - goalTopLeft.y, maxrange);
-			const int minx = std::max(0, goalTopLeft.x - offsetx - unitExtraTileSize.x);
-			const int maxx = std::min(Map.Info.MapWidth - 1 - unitExtraTileSize.x, goalBottomRight.x + offsetx);
-			Vec2i mpos(minx, y);
-			const unsigned int offset = mpos.y * Map.Info.MapWidth;
-
-			for (mpos.x = minx; mpos.x <= maxx; ++mpos.x) {
-				func(offset + mpos.x);
-			}
-		}
-	}
-
-	void HemiCycleRing(int y, int offsetminx, int offsetmaxx) const {
-		const int minx = std::max(0, goalTopLeft.x - offsetmaxx - unitExtraTileSize.x);
-		const int maxx = std::min(Map.Info.MapWidth - 1 - unitExtraTileSize.x, goalBottomRight.x + offsetmaxx);
-		Vec2i mpos(minx, y);
-		const unsigned int offset = mpos.y * Map.Info.MapWidth;
-
-		for (mpos.x = minx; mpos.x <= goalTopLeft.x - offsetminx - unitExtraTileSize.x; ++mpos.x) {
-			func(offset + mpos.x);
-		}
-		for (mpos.x = goalBottomRight.x + offsetminx; mpos.x <= maxx; ++mpos.x) {
-			func(offset + mpos.x);
-		}
-	}
-
-	void TopHemicycleNoMinRange() const {
-		const int miny = std::max(0, goalTopLeft.y - (minrange - 1) - unitExtraTileSize.y);
-		const int maxy = goalTopLeft.y - 1 - unitExtraTileSize.y;
-		for (int y = miny; y <= maxy; ++y) {
-			const int offsetmaxx = GetMaxOffsetX(y - goalTopLeft.y, maxrange);
-			const int offsetminx = GetMaxOffsetX(y - goalTopLeft.y, minrange - 1) + 1;
-
-			HemiCycleRing(y, offsetminx, offsetmaxx);
-		}
-	}
-
-	void Center() const {
-		const int miny = std::max(0, goalTopLeft.y - unitExtraTileSize.y);
-		const int maxy = std::min<int>(Map.Info.MapHeight - 1 - unitExtraTileSize.y, goalBottomRight.y);
-		const int minx = std::max(0, goalTopLeft.x - maxrange - unitExtraTileSize.x);
-		const int maxx = std::min<int>(Map.Info.MapWidth - 1 - unitExtraTileSize.x, goalBottomRight.x + maxrange);
-
-		if (minrange == 0) {
-			for (int y = miny; y <= maxy; ++y) {
-				Vec2i mpos(minx, y);
-				const unsigned int offset = mpos.y * Map.Info.MapWidth;
-
-				for (mpos.x = minx; mpos.x <= maxx; ++mpos.x) {
-					func(offset + mpos.x);
-				}
-			}
-		} else {
-			for (int y = miny; y <= maxy; ++y) {
-				Vec2i mpos(minx, y);
-				const unsigned int offset = mpos.y * Map.Info.MapWidth;
-
-				for (mpos.x = minx; mpos.x <= goalTopLeft.x - minrange - unitExtraTileSize.x; ++mpos.x) {
-					func(offset + mpos.x);
-				}
-				for (mpos.x = goalBottomRight.x + minrange; mpos.x <= maxx; ++mpos.x) {
-					func(offset + mpos.x);
-				}
-			}
-		}
-	}
-
-	void BottomHemicycleNoMinRange() const {
-		const int miny = goalBottomRight.y + 1;
-		const int maxy = std::min(Map.Info.MapHeight - 1 - unitExtraTileSize.y, goalBottomRight.y + (minrange - 1));
-
-		for (int y = miny; y <= maxy; ++y) {
-			const int offsetmaxx = GetMaxOffsetX(y - goalBottomRight.y, maxrange);
-			const int offsetminx = GetMaxOffsetX(y - goalBottomRight.y, minrange - 1) + 1;
-
-			HemiCycleRing(y, offsetminx, offsetmaxx);
-		}
-	}
-
-	void BottomHemicycle() const {
-		const int miny = std::max(goalBottomRight.y + minrange, goalBottomRight.y + 1);
-		const int maxy = std::min(Map.Info.MapHeight - 1 - unitExtraTileSize.y, goalBottomRight.y + maxrange);
-		for (int y = miny; y <= maxy; ++y) {
-			const int offsetx = GetMaxOffsetX(y - goalBottomRight.y, maxrange);
-			const int minx = std::max(0, goalTopLeft.x - offsetx - unitExtraTileSize.x);
-			const int maxx = std::min(Map.Info.MapWidth - 1 - unitExtraTileSize.x, goalBottomRight.x + offsetx);
-			Vec2i mpos(minx, y);
-			const unsigned int offset = mpos.y * Map.Info.MapWidth;
-
-			for (mpos.x = minx; mpos.x <= maxx; ++mpos.x) {
-				func(offset + mpos.x);
-			}
-		}
-	}
-
-private:
-	T func;
-	Vec2i goalTopLeft;
-	Vec2i goalBottomRight;
-	Vec2i unitExtraTileSize;
-	int minrange;
-	int maxrange;
-};
-
-
-
 /**
 **  MarkAStarGoal
 */
-static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
-						 int tilesizex, int tilesizey, int minrange, int maxrange, const CUnit &unit)
+int CAStarContext::MarkGoal(const Vec2i &goal, int gw, int gh,
+							 int tilesizex, int tilesizey, int minrange, int maxrange, const CUnit &unit)
 {
 	ProfileBegin("AStarMarkGoal");
 
@@ -764,7 +644,10 @@ static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
 		}
 		unsigned int offset = GetIndex(goal.x, goal.y);
 		if (CostMoveTo(offset, unit) >= 0) {
-			AStarMatrix[offset].InGoal = 1;
+			GetNode(offset).InGoal = 1;
+			if (UseRegions) {
+				RegionSearch.MarkGoal(offset);
+			}
 			ProfileEnd("AStarMarkGoal");
 			return 1;
 		} else {
@@ -778,8 +661,8 @@ static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
 	gw = std::max(gw, 1);
 	gh = std::max(gh, 1);
 
-	AStarGoalMarker aStarGoalMarker(unit, &goal_reachable);
-	MinMaxRangeVisitor<AStarGoalMarker> visitor(aStarGoalMarker);
+	GoalMarker goalMarker(*this, unit, &goal_reachable);
+	MinMaxRangeVisitor<GoalMarker> visitor(goalMarker);
 
 	const Vec2i goalBottomRigth(goal.x + gw - 1, goal.y + gh - 1);
 	visitor.SetGoal(goal, goalBottomRigth);
@@ -800,7 +683,7 @@ static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
 **
 **  @return  The length of the path
 */
-static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path, int pathLen)
+int CAStarContext::SavePath(const Vec2i &startPos, const Vec2i &endPos, char *path, int pathLen) const
 {
 	ProfileBegin("AStarSavePath");
 
@@ -813,7 +696,7 @@ static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path,
 	Vec2i curr = endPos;
 	int currO = curr.y * AStarMapWidth;
 	while (curr != startPos) {
-		direction = AStarMatrix[currO + curr.x].Direction;
+		direction = Matrix[currO + curr.x].Direction;
 		curr.x -= Heading2X[direction];
 		curr.y -= Heading2Y[direction];
 		currO -= Heading2O[direction];
@@ -827,7 +710,7 @@ static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path,
 		curr = endPos;
 		currO = curr.y * AStarMapWidth;
 		while (curr != startPos) {
-			direction = AStarMatrix[currO + curr.x].Direction;
+			direction = Matrix[currO + curr.x].Direction;
 			curr.x -= Heading2X[direction];
 			curr.y -= Heading2Y[direction];
 			currO -= Heading2O[direction];
@@ -846,9 +729,9 @@ static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path,
 **  Optimization to find a simple path
 **  Check if we're at the goal or if it's 1 tile away
 */
-static int AStarFindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw, int gh,
-							   int, int, int minrange, int maxrange,
-							   char *path, const CUnit &unit)
+int CAStarContext::FindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw, int gh,
+								  int, int, int minrange, int maxrange,
+								  char *path, const CUnit &unit)
 {
 	ProfileBegin("AStarFindSimplePath");
 	// At exact destination point already
@@ -891,60 +774,32 @@ static int AStarFindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw,
 }
 
 /**
-**  Find path.
+**  Search the path once the goal is marked.
 */
-int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
-				  int tilesizex, int tilesizey, int minrange, int maxrange,
-				  char *path, int pathlen, const CUnit &unit)
+int CAStarContext::Search(const Vec2i &startPos, const Vec2i &goalPos,
+						  int tilesizex, int tilesizey, char *path, int pathlen, const CUnit &unit)
 {
-	Assert(Map.Info.IsPointOnMap(startPos));
-
-	ProfileBegin("AStarFindPath");
-
-	AStarGoalX = goalPos.x;
-	AStarGoalY = goalPos.y;
-
-	//  Check for simple cases first
-	int ret = AStarFindSimplePath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
-								  minrange, maxrange, path, unit);
-	if (ret != PF_FAILED) {
-		ProfileEnd("AStarFindPath");
-		return ret;
-	}
-
-	//  Initialize
-	AStarCleanUp();
-	CostMoveToCacheCleanUp();
-
-	OpenSetSize = 0;
-	CloseSetSize = 0;
-
-	if (!AStarMarkGoal(goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, unit)) {
-		// goal is not reachable
-		ret = PF_UNREACHABLE;
-		ProfileEnd("AStarFindPath");
-		return ret;
-	}
+	ProfileBegin("AStarSearch");
 
+	int ret;
 	int eo = startPos.y * AStarMapWidth + startPos.x;
 	// it is quite important to start from 1 rather than 0, because we use
 	// 0 as a way to represent nodes that we have not visited yet.
-	AStarMatrix[eo].CostFromStart = 1;
+	GetNode(eo).CostFromStart = 1;
 	// 8 to say we are came from nowhere.
-	AStarMatrix[eo].Direction = 8;
+	Matrix[eo].Direction = 8;
 
 	// place start point in open, it that failed, try another pathfinder
 	int costToGoal = AStarCosts(startPos, goalPos);
-	AStarMatrix[eo].CostToGoal = costToGoal;
-	if (AStarAddNode(startPos, eo, 1 + costToGoal) == PF_FAILED) {
+	Matrix[eo].CostToGoal = costToGoal;
+	if (AddNode(startPos, eo, 1 + costToGoal) == PF_FAILED) {
 		ret = PF_FAILED;
-		ProfileEnd("AStarFindPath");
+		ProfileEnd("AStarSearch");
 		return ret;
 	}
-	AStarAddToClose(OpenSet[0].O);
-	if (AStarMatrix[eo].InGoal) {
+	if (Matrix[eo].InGoal) {
 		ret = PF_REACHED;
-		ProfileEnd("AStarFindPath");
+		ProfileEnd("AStarSearch");
 		return ret;
 	}
 	Vec2i endPos;
@@ -957,10 +812,10 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 		const int y = OpenSet[shortest].pos.y;
 		const int o = OpenSet[shortest].O;
 
-		AStarRemoveMinimum(shortest);
+		RemoveMinimum(shortest);
 
 		// If we have reached the goal, then exit.
-		if (AStarMatrix[o].InGoal == 1) {
+		if (Matrix[o].InGoal == 1) {
 			endPos.x = x;
 			endPos.y = y;
 			break;
@@ -973,7 +828,7 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 			// Nearest point to goal.
 			AstarDebugPrint("way too long\n");
 			ret = PF_FAILED;
-			ProfileEnd("AStarFindPath");
+			ProfileEnd("AStarSearch");
 			return ret;
 		}
 #endif
@@ -981,8 +836,8 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 		// Generate successors of this node.
 
 		// Node that this node was generated from.
-		const int px = x - Heading2X[(int)AStarMatrix[o].Direction];
-		const int py = y - Heading2Y[(int)AStarMatrix[o].Direction];
+		const int px = x - Heading2X[(int)Matrix[o].Direction];
+		const int py = y - Heading2Y[(int)Matrix[o].Direction];
 
 		for (int i = 0; i < 8; ++i) {
 			endPos.x = x + Heading2X[i];
@@ -1004,6 +859,11 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 			//eo = GetIndex(ex, ey);
 			eo = endPos.x + (o - x) + Heading2O[i];
 
+			// Outside the corridor given by the region graph.
+			if (UseCorridor && !RegionSearch.IsInCorridor(eo)) {
+				continue;
+			}
+
 			// if the point is "move to"-able and
 			// if we have not reached this point before,
 			// or if we have a better path to it, we add it to open set
@@ -1015,58 +875,377 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 
 			// Add a cost for walking to make paths more realistic for the user.
 			new_cost++;
-			new_cost += AStarMatrix[o].CostFromStart;
-			if (AStarMatrix[eo].CostFromStart == 0) {
+			new_cost += Matrix[o].CostFromStart;
+			if (GetNode(eo).CostFromStart == 0) {
 				// we are sure the current node has not been already visited
-				AStarMatrix[eo].CostFromStart = new_cost;
-				AStarMatrix[eo].Direction = i;
+				Matrix[eo].CostFromStart = new_cost;
+				Matrix[eo].Direction = i;
 				costToGoal = AStarCosts(endPos, goalPos);
-				AStarMatrix[eo].CostToGoal = costToGoal;
-				if (AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
+				Matrix[eo].CostToGoal = costToGoal;
+				if (AddNode(endPos, eo, Matrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
 					ret = PF_FAILED;
-					ProfileEnd("AStarFindPath");
+					ProfileEnd("AStarSearch");
 					return ret;
 				}
-				// we add the point to the close set
-				AStarAddToClose(eo);
-			} else if (new_cost < AStarMatrix[eo].CostFromStart) {
+			} else if (new_cost < Matrix[eo].CostFromStart) {
 				// Already visited node, but we have here a better path
 				// I know, it's redundant (but simpler like this)
-				AStarMatrix[eo].CostFromStart = new_cost;
-				AStarMatrix[eo].Direction = i;
+				Matrix[eo].CostFromStart = new_cost;
+				Matrix[eo].Direction = i;
 				// this point might be already in the OpenSet
-				const int j = AStarFindNode(eo);
+				const int j = FindNode(eo);
 				if (j == -1) {
 					costToGoal = AStarCosts(endPos, goalPos);
-					AStarMatrix[eo].CostToGoal = costToGoal;
-					if (AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
+					Matrix[eo].CostToGoal = costToGoal;
+					if (AddNode(endPos, eo, Matrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
 						ret = PF_FAILED;
-						ProfileEnd("AStarFindPath");
+						ProfileEnd("AStarSearch");
 						return ret;
 					}
 				} else {
 					costToGoal = AStarCosts(endPos, goalPos);
-					AStarMatrix[eo].CostToGoal = costToGoal;
-					AStarReplaceNode(j);
+					Matrix[eo].CostToGoal = costToGoal;
+					ReplaceNode(j, Matrix[eo].CostFromStart + costToGoal);
 				}
-				// we don't have to add this point to the close set
 			}
 		}
 		if (OpenSetSize <= 0) { // no new nodes generated
 			ret = PF_UNREACHABLE;
-			ProfileEnd("AStarFindPath");
+			ProfileEnd("AStarSearch");
 			return ret;
 		}
 	}
 
-	const int path_length = AStarSavePath(startPos, endPos, path, pathlen);
+	const int path_length = SavePath(startPos, endPos, path, pathlen);
 
 	ret = path_length;
 
+	ProfileEnd("AStarSearch");
+	return ret;
+}
+
+/**
+**  Look for the path in the path cache.
+**
+**  The cached steps are checked against the units now on the map. A
+**  request without path only asks if the goal is reachable: all the
+**  steps to the goal are checked then.
+**
+**  @return  PF_FAILED if the path has to be searched.
+*/
+int CAStarContext::FindCachedPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+								  int minrange, int maxrange, char *path, int pathlen, const CUnit &unit)
+{
+	const CPathCache::Entry *entry = PathCache->Find(startPos, goalPos, Vec2i(gw, gh), minrange, maxrange, unit);
+
+	if (entry == NULL) {
+		return PF_FAILED;
+	}
+	const int stepCount = path ? std::min(entry->Length, pathlen) : entry->Length;
+	if (stepCount > entry->StepCount) {
+		return PF_FAILED;
+	}
+	Vec2i pos = startPos;
+	for (int i = 0; i != stepCount; ++i) {
+		const int direction = entry->Steps[i];
+
+		pos.x += Heading2X[direction];
+		pos.y += Heading2Y[direction];
+		if (CostMoveTo(GetIndex(pos.x, pos.y), unit) == -1) {
+			return PF_FAILED;
+		}
+		if (path) {
+			path[stepCount - 1 - i] = direction;
+		}
+	}
+	return entry->Length;
+}
+
+/**
+**  Look for the path searched ahead of the unit.
+**
+**  The costs of move read by the search are checked against the map.
+**
+**  @return  PF_FAILED if the path has to be searched.
+*/
+int CAStarContext::FindPrefetchedPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+									  int tilesizex, int tilesizey, int minrange, int maxrange,
+									  char *path, int pathlen, const CUnit &unit)
+{
+	const CPathPrefetch *prefetch = FindPathPrefetch(unit);
+
+	if (prefetch == NULL || path == NULL
+		|| !prefetch->Match(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+							minrange, maxrange, pathlen, unit)) {
+		return PF_FAILED;
+	}
+	for (size_t i = 0; i != prefetch->Costs.size(); ++i) {
+		const CPathPrefetch::Cost &cost = prefetch->Costs[i];
+
+		if (CostMoveTo(cost.Index, unit) != cost.Value) {
+			return PF_FAILED;
+		}
+	}
+	const int stepCount = std::min(prefetch->Result, pathlen);
+	for (int i = 0; i < stepCount; ++i) {
+		path[i] = prefetch->Path[i];
+	}
+	return prefetch->Result;
+}
+
+/**
+**  Search a path ahead of the unit.
+**
+**  Only the context and prefetch are written, the map is read: several
+**  contexts may search at the same time. The costs of move read by the
+**  search are kept in prefetch.
+**
+**  @param prefetch  Request, the result and the costs are stored there.
+*/
+void CAStarContext::Prefetch(CPathPrefetch &prefetch)
+{
+	const CUnit &unit = *prefetch.Unit;
+
+	GoalPos = prefetch.GoalPos;
+	prefetch.Costs.clear();
+	CostLog = &prefetch.Costs;
+
+	Prepare();
+	int ret = FindSimplePath(prefetch.StartPos, prefetch.GoalPos,
+							 prefetch.GoalSize.x, prefetch.GoalSize.y,
+							 prefetch.TileSize.x, prefetch.TileSize.y,
+							 prefetch.MinRange, prefetch.MaxRange, prefetch.Path, unit);
+	if (ret == PF_FAILED) {
+		ret = SearchPath(prefetch.StartPos, prefetch.GoalPos,
+						 prefetch.GoalSize.x, prefetch.GoalSize.y,
+						 prefetch.TileSize.x, prefetch.TileSize.y,
+						 prefetch.MinRange, prefetch.MaxRange,
+						 prefetch.Path, PathFinderOutput::MAX_PATH_LENGTH, unit);
+	} else {
+		// The unit finds this one by itself.
+		ret = PF_FAILED;
+	}
+	prefetch.Result = ret;
+	CostLog = NULL;
+}
+
+/**
+**  Find path.
+*/
+int CAStarContext::FindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+							 int tilesizex, int tilesizey, int minrange, int maxrange,
+							 char *path, int pathlen, const CUnit &unit)
+{
+	Assert(Map.Info.IsPointOnMap(startPos));
+
+	ProfileBegin("AStarFindPath");
+
+	GoalPos = goalPos;
+
+	//  Initialize
+	Prepare();
+
+	//  Check for simple cases first
+	int ret = FindSimplePath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+							 minrange, maxrange, path, unit);
+	if (ret != PF_FAILED) {
+		ProfileEnd("AStarFindPath");
+		return ret;
+	}
+
+	if (PathCache) {
+		ret = FindCachedPath(startPos, goalPos, gw, gh, minrange, maxrange, path, pathlen, unit);
+		if (ret != PF_FAILED) {
+			ProfileEnd("AStarFindPath");
+			return ret;
+		}
+		ret = FindPrefetchedPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+								 minrange, maxrange, path, pathlen, unit);
+	}
+	if (ret == PF_FAILED) {
+		ret = SearchPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+						 minrange, maxrange, path, pathlen, unit);
+	}
+
+	if (PathCache && ret > 0 && path) {
+		PathCache->Store(startPos, goalPos, Vec2i(gw, gh), minrange, maxrange, unit,
+						 ret, path, std::min(ret, pathlen));
+	}
 	ProfileEnd("AStarFindPath");
 	return ret;
 }
 
+/**
+**  Search the path once the simple cases are handled.
+*/
+int CAStarContext::SearchPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+							  int tilesizex, int tilesizey, int minrange, int maxrange,
+							  char *path, int pathlen, const CUnit &unit)
+{
+	int ret;
+
+	// The region graph only knows the real terrain,
+	// so it cannot be used when unexplored tiles are crossable.
+	UseRegions = false;
+	UseCorridor = false;
+	if (AStarKnowUnseenTerrain) {
+		CRegionGraph &regions = GetRegionGraph(unit.Type->MovementMask, Vec2i(tilesizex, tilesizey));
+
+		regions.Update();
+		const int startRegion = regions.GetRegion(GetIndex(startPos.x, startPos.y));
+		if (startRegion != CRegionGraph::RegionNone) {
+			RegionSearch.Begin(regions, startRegion);
+			UseRegions = true;
+		}
+	}
+
+	OpenSetSize = 0;
+
+	if (!MarkGoal(goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, unit)) {
+		// goal is not reachable
+		return PF_UNREACHABLE;
+	}
+
+	if (UseRegions) {
+		if (!RegionSearch.IsGoalConnected()) {
+			// no goal in the area connected to the unit
+			return PF_UNREACHABLE;
+		}
+		// Long paths are searched only in the corridor of the region path.
+		UseCorridor = AStarCosts(startPos, goalPos) > AStarCorridorMinDistance
+					  && RegionSearch.FindCorridor(goalPos);
+	}
+
+	ret = Search(startPos, goalPos, tilesizex, tilesizey, path, pathlen, unit);
+
+	if (ret == PF_UNREACHABLE && UseCorridor) {
+		// Units may block the corridor, try again on the whole map.
+		Prepare();
+		UseRegions = false;
+		UseCorridor = false;
+		OpenSetSize = 0;
+		MarkGoal(goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, unit);
+		ret = Search(startPos, goalPos, tilesizex, tilesizey, path, pathlen, unit);
+	}
+
+	return ret;
+}
+
+/**
+**  Find path by following the flow field of the goal.
+**
+**  The flow field is shared by all the units sent to the same goal,
+**  it is used for group move orders.
+**
+**  @return  PF_FAILED if there is no flow field for this goal yet,
+**           the caller should use AStarFindPath.
+*/
+int CAStarContext::FlowFieldFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+									 int tilesizex, int tilesizey, int minrange, int maxrange,
+									 char *path, int pathlen, const CUnit &unit)
+{
+	Assert(Map.Info.IsPointOnMap(startPos));
+
+	ProfileBegin("FlowFieldFindPath");
+
+	Prepare();
+
+	//  Check for simple cases first
+	int ret = FindSimplePath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+							 minrange, maxrange, path, unit);
+	if (ret != PF_FAILED) {
+		ProfileEnd("FlowFieldFindPath");
+		return ret;
+	}
+
+	const CFlowField *field = GetFlowField(unit, goalPos, Vec2i(gw, gh), minrange, maxrange);
+	if (field == NULL) {
+		ProfileEnd("FlowFieldFindPath");
+		return PF_FAILED;
+	}
+	const int startIndex = GetIndex(startPos.x, startPos.y);
+	if (field->GetCost(startIndex) == CFlowField::Unreachable) {
+		// Not even reachable without units
+		ProfileEnd("FlowFieldFindPath");
+		return PF_UNREACHABLE;
+	}
+	if (field->GetCost(startIndex) == 0) {
+		ProfileEnd("FlowFieldFindPath");
+		return PF_REACHED;
+	}
+
+	// The field ignores units, choose the first step among the free positions.
+	int firstDirection = -1;
+	int bestCost = CFlowField::Unreachable;
+	for (int i = 0; i < 8; ++i) {
+		const Vec2i pos(startPos.x + Heading2X[i], startPos.y + Heading2Y[i]);
+
+		if (pos.x < 0 || pos.x + tilesizex - 1 >= AStarMapWidth
+			|| pos.y < 0 || pos.y + tilesizey - 1 >= AStarMapHeight) {
+			continue;
+		}
+		const int o = GetIndex(pos.x, pos.y);
+		const int fieldCost = field->GetCost(o);
+		if (fieldCost >= field->GetCost(startIndex)) {
+			continue;
+		}
+		const int moveCost = CostMoveTo(o, unit);
+		if (moveCost != -1 && fieldCost + moveCost < bestCost) {
+			bestCost = fieldCost + moveCost;
+			firstDirection = i;
+		}
+	}
+	if (firstDirection == -1) {
+		// Blocked by units, let A* find a way around.
+		ProfileEnd("FlowFieldFindPath");
+		return PF_FAILED;
+	}
+
+	// The costs decrease along the directions down to 0 in the goal.
+	const Vec2i firstPos(startPos.x + Heading2X[firstDirection], startPos.y + Heading2Y[firstDirection]);
+	int fullPathLength = 1;
+	for (int o = GetIndex(firstPos.x, firstPos.y); field->GetCost(o) != 0; ++fullPathLength) {
+		const int direction = field->GetDirection(o);
+		o += Heading2X[direction] + Heading2O[direction];
+	}
+
+	if (path) {
+		pathlen = std::min(fullPathLength, pathlen);
+		path[pathlen - 1] = firstDirection;
+		int o = GetIndex(firstPos.x, firstPos.y);
+		for (int i = pathlen - 2; i >= 0; --i) {
+			const int direction = field->GetDirection(o);
+
+			path[i] = direction;
+			o += Heading2X[direction] + Heading2O[direction];
+		}
+	}
+	ProfileEnd("FlowFieldFindPath");
+	return fullPathLength;
+}
+
+/**
+**  Find path, with the context of the game logic.
+*/
+int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+				  int tilesizex, int tilesizey, int minrange, int maxrange,
+				  char *path, int pathlen, const CUnit &unit)
+{
+	return AStarDefaultContext.FindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+										minrange, maxrange, path, pathlen, unit);
+}
+
+/**
+**  Find path by following a flow field, with the context of the game logic.
+*/
+int FlowFieldFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+					  int tilesizex, int tilesizey, int minrange, int maxrange,
+					  char *path, int pathlen, const CUnit &unit)
+{
+	return AStarDefaultContext.FlowFieldFindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+												 minrange, maxrange, path, pathlen, unit);
+}
+
 struct StatsNode {
 	StatsNode() : Direction(0), InGoal(0), CostFromStart(0), Costs(0), CostToGoal(0) {}
 
@@ -1077,14 +1256,20 @@ struct StatsNode {
 	int CostToGoal;
 };
 
-StatsNode *AStarGetStats()
+StatsNode *CAStarContext::GetStats() const
 {
 	StatsNode *stats = new StatsNode[AStarMapWidth * AStarMapHeight];
 	StatsNode *s = stats;
-	Node *m = AStarMatrix;
+	const Node *m = Matrix;
 
 	for (int j = 0; j < AStarMapHeight; ++j) {
 		for (int i = 0; i < AStarMapWidth; ++i) {
+			if (m->Generation != CurrentGeneration) {
+				// Not touched by the last search
+				++s;
+				++m;
+				continue;
+			}
 			s->Direction = m->Direction;
 			s->InGoal = m->InGoal;
 			s->CostFromStart = m->CostFromStart;
@@ -1100,6 +1285,11 @@ StatsNode *AStarGetStats()
 	return stats;
 }
 
+StatsNode *AStarGetStats()
+{
+	return AStarDefaultContext.GetStats();
+}
+
 void AStarFreeStats(StatsNode *stats)
 {
 	delete[] stats;
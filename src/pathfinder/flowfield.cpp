@@ -0,0 +1,637 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name flowfield.cpp - The flow fields of the pathfinder. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "pathfinder_local.h"
+
+#include "iolib.h"
+#include "map.h"
+#include "pathfinder.h"
+#include "player.h"
+#include "script.h"
+#include "snapshot.h"
+#include "tileset.h"
+#include "unit.h"
+#include "unittype.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+const int CFlowField::Unreachable;
+
+/// Number of game cycles a flow field is kept
+static const unsigned long FlowFieldLifetime = CYCLES_PER_SECOND;
+/// Maximum number of flow fields kept at the same time
+static const size_t MaxFlowFields = 8;
+/// Number of different units asking for a field before it is computed
+static const size_t FlowFieldMinUsers = 4;
+
+/// Flow fields of the last move orders, oldest first
+static std::vector<CFlowField *> FlowFields;
+/// Flow fields of a loaded game, used once its units are placed
+static std::vector<CFlowField *> LoadedFlowFields;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Open position of the integration field computation: (cost, map index)
+typedef std::pair<int, unsigned int> FlowFieldOpen;
+typedef std::priority_queue<FlowFieldOpen, std::vector<FlowFieldOpen>, std::greater<FlowFieldOpen> > FlowFieldOpenSet;
+
+/**
+**  Put the goal positions in the open set.
+*/
+class FlowFieldGoalMarker
+{
+public:
+	FlowFieldGoalMarker(std::vector<int> &cost, std::vector<int> &tileCost, FlowFieldOpenSet &open) :
+		cost(cost), tileCost(tileCost), open(open)
+	{}
+
+	void operator()(int offset) const {
+		if (tileCost[offset] != -1) {
+			cost[offset] = 0;
+			open.push(FlowFieldOpen(0, offset));
+		}
+	}
+private:
+	std::vector<int> &cost;
+	std::vector<int> &tileCost;
+	FlowFieldOpenSet &open;
+};
+
+CFlowField::CFlowField(const CUnit &unit, const Vec2i &goalPos, const Vec2i &goalSize, int minrange, int maxrange) :
+	MovementMask(unit.Type->MovementMask),
+	BlockMask(unit.Type->MovementMask & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit)),
+	UnitSize(unit.Type->TileWidth, unit.Type->TileHeight),
+	PlayerIndex(AStarKnowUnseenTerrain ? -1 : unit.Player->Index),
+	GoalPos(goalPos), GoalSize(goalSize), MinRange(minrange), MaxRange(maxrange),
+	Cycle(GameCycle), Dirty(true), Shared(false)
+{
+}
+
+CFlowField::CFlowField() :
+	MovementMask(0), BlockMask(0), UnitSize(1, 1), PlayerIndex(-1),
+	GoalPos(0, 0), GoalSize(0, 0), MinRange(0), MaxRange(0),
+	Cycle(0), Dirty(true), Shared(false)
+{
+}
+
+/**
+**  Count a unit asking for the field.
+**
+**  A unit asking again, as when it is blocked, is counted once.
+**
+**  @return  true if the field is shared by enough units to be computed.
+*/
+bool CFlowField::AddUser(const CUnit &unit)
+{
+	if (Shared) {
+		return true;
+	}
+	const int slot = UnitNumber(unit);
+
+	if (std::find(Users.begin(), Users.end(), slot) == Users.end()) {
+		Users.push_back(slot);
+	}
+	if (Users.size() < FlowFieldMinUsers) {
+		return false;
+	}
+	Shared = true;
+	Users.clear();
+	return true;
+}
+
+/**
+**  Check if the field leads this unit to this goal.
+*/
+bool CFlowField::Match(const CUnit &unit, const Vec2i &goalPos, const Vec2i &goalSize, int minrange, int maxrange) const
+{
+	return MovementMask == unit.Type->MovementMask
+		   && UnitSize.x == unit.Type->TileWidth && UnitSize.y == unit.Type->TileHeight
+		   && PlayerIndex == (AStarKnowUnseenTerrain ? -1 : unit.Player->Index)
+		   && GoalPos == goalPos && GoalSize == goalSize
+		   && MinRange == minrange && MaxRange == maxrange;
+}
+
+/**
+**  Cost of moving a unit to pos, units on the map are ignored.
+**
+**  Same as the A* cost for a map without units. The explored tiles are
+**  the ones of the last ReadExplored.
+**
+**  @return  -1 if the position can't be crossed.
+*/
+int CFlowField::CostMoveTo(const Vec2i &pos) const
+{
+	if (pos.x + UnitSize.x > Map.Info.MapWidth || pos.y + UnitSize.y > Map.Info.MapHeight) {
+		return -1;
+	}
+	unsigned int index = Map.getIndex(pos);
+	int cost = 0;
+
+	for (int y = 0; y < UnitSize.y; ++y) {
+		const CMapField *mf = Map.Field(index);
+		for (int x = 0; x < UnitSize.x; ++x) {
+			const bool explored = Explored.empty() || Explored[index + x];
+
+			if ((mf->Flags & BlockMask) && explored) {
+				return -1;
+			}
+			if (!explored) {
+				cost += AStarUnknownTerrainCost;
+			}
+			cost += mf->getCost();
+			++mf;
+		}
+		index += Map.Info.MapWidth;
+	}
+	return cost;
+}
+
+/**
+**  Compute the field.
+**
+**  Dijkstra from the goal positions toward the whole map: the cost of a
+**  position is the cost of the best path from it to the goal, and its
+**  direction is the first step of this path.
+**
+**  A loaded field which was computed in the saved game is computed again
+**  with the explored tiles of the saved game.
+*/
+void CFlowField::Build()
+{
+	if (Dirty) {
+		ReadExplored();
+	}
+	const unsigned int size = Map.Info.MapWidth * Map.Info.MapHeight;
+	std::vector<int> tileCost(size);
+	FlowFieldOpenSet open;
+
+	Cost.assign(size, Unreachable);
+	Direction.assign(size, 8);
+
+	Vec2i pos;
+	for (pos.y = 0; pos.y < Map.Info.MapHeight; ++pos.y) {
+		for (pos.x = 0; pos.x < Map.Info.MapWidth; ++pos.x) {
+			tileCost[Map.getIndex(pos)] = CostMoveTo(pos);
+		}
+	}
+
+	// Mark the goal, the same way as AStarMarkGoal does.
+	FlowFieldGoalMarker marker(Cost, tileCost, open);
+	if (MinRange == 0 && MaxRange == 0 && GoalSize.x == 0 && GoalSize.y == 0) {
+		if (Map.Info.IsPointOnMap(GoalPos)) {
+			marker(Map.getIndex(GoalPos));
+		}
+	} else {
+		MinMaxRangeVisitor<FlowFieldGoalMarker> visitor(marker);
+		const Vec2i goalSize(std::max<int>(GoalSize.x, 1), std::max<int>(GoalSize.y, 1));
+
+		visitor.SetGoal(GoalPos, GoalPos + goalSize - Vec2i(1, 1));
+		visitor.SetRange(MinRange, MaxRange);
+		visitor.SetUnitSize(UnitSize);
+		visitor.Visit();
+	}
+
+	while (!open.empty()) {
+		const int cost = open.top().first;
+		const unsigned int index = open.top().second;
+		open.pop();
+
+		if (cost != Cost[index]) {
+			// outdated entry
+			continue;
+		}
+		// Moving onto a position costs as much as in A*.
+		const int newCost = cost + tileCost[index] + 1;
+		const Vec2i curr(index % Map.Info.MapWidth, index / Map.Info.MapWidth);
+
+		for (int i = 0; i != 8; ++i) {
+			const Vec2i n(curr.x + Heading2X[i], curr.y + Heading2Y[i]);
+
+			if (!Map.Info.IsPointOnMap(n)) {
+				continue;
+			}
+			const unsigned int nIndex = Map.getIndex(n);
+			if (tileCost[nIndex] == -1 || Cost[nIndex] <= newCost) {
+				continue;
+			}
+			Cost[nIndex] = newCost;
+			// Going back from n to curr.
+			Direction[nIndex] = XY2Heading[1 - Heading2X[i]][1 - Heading2Y[i]];
+			open.push(FlowFieldOpen(newCost, nIndex));
+		}
+	}
+	Dirty = false;
+}
+
+/**
+**  Read the explored tiles of the player from the map.
+**
+**  A field keeps the tiles it was computed with: computed again in a
+**  loaded game, it finds the same directions.
+*/
+void CFlowField::ReadExplored()
+{
+	Explored.clear();
+	if (PlayerIndex == -1) {
+		return;
+	}
+	const CPlayer &player = Players[PlayerIndex];
+	const unsigned int size = Map.Info.MapWidth * Map.Info.MapHeight;
+
+	Explored.resize(size);
+	for (unsigned int i = 0; i != size; ++i) {
+		Explored[i] = Map.Field(i)->playerInfo.IsExplored(player);
+	}
+}
+
+/**
+**  Get the explored tiles as the lengths of the runs of unexplored and
+**  explored tiles, starting with unexplored ones.
+*/
+void CFlowField::GetExploredRuns(std::vector<unsigned long> &runs) const
+{
+	runs.clear();
+	bool explored = false;
+	unsigned long length = 0;
+
+	for (size_t i = 0; i != Explored.size(); ++i) {
+		if (Explored[i] != explored) {
+			runs.push_back(length);
+			explored = !explored;
+			length = 0;
+		}
+		++length;
+	}
+	if (!Explored.empty()) {
+		runs.push_back(length);
+	}
+}
+
+/**
+**  Set the explored tiles from the lengths of the runs.
+**
+**  @return  false if the runs don't cover the map.
+*/
+bool CFlowField::SetExploredRuns(const std::vector<unsigned long> &runs)
+{
+	Explored.clear();
+	if (runs.empty()) {
+		return true;
+	}
+	const unsigned long size = Map.Info.MapWidth * Map.Info.MapHeight;
+	bool explored = false;
+
+	for (size_t i = 0; i != runs.size(); ++i) {
+		if (runs[i] > size - Explored.size()) {
+			return false;
+		}
+		Explored.insert(Explored.end(), runs[i], explored);
+		explored = !explored;
+	}
+	return Explored.size() == size;
+}
+
+/**
+**  Save the field.
+**
+**  The directions are not saved: a computed field is computed again
+**  when the game is loaded.
+**
+**  @param file  Output file.
+*/
+void CFlowField::Save(CFile &file) const
+{
+	file.printf("FlowField({%u, %d, %d, %d, %d, %d, %d, %d, %d, %d, %lu, %s, %s,\n  {",
+				MovementMask, UnitSize.x, UnitSize.y, PlayerIndex,
+				GoalPos.x, GoalPos.y, GoalSize.x, GoalSize.y, MinRange, MaxRange,
+				Cycle, Dirty ? "true" : "false", Shared ? "true" : "false");
+	for (size_t i = 0; i != Users.size(); ++i) {
+		file.printf("%s%d", i ? ", " : "", Users[i]);
+	}
+	file.printf("},\n  {");
+	std::vector<unsigned long> runs;
+	GetExploredRuns(runs);
+	for (size_t i = 0; i != runs.size(); ++i) {
+		file.printf("%s%lu", i ? ", " : "", runs[i]);
+	}
+	file.printf("}})\n");
+}
+
+/**
+**  Save the field to a snapshot.
+**
+**  @param snapshot  Output snapshot.
+*/
+void CFlowField::Save(CSnapshotWriter &snapshot) const
+{
+	snapshot.Varint(MovementMask);
+	snapshot.Pos(UnitSize);
+	snapshot.Int(PlayerIndex);
+	snapshot.Pos(GoalPos);
+	snapshot.Pos(GoalSize);
+	snapshot.Int(MinRange);
+	snapshot.Int(MaxRange);
+	snapshot.Varint(Cycle);
+	snapshot.Bool(Dirty);
+	snapshot.Bool(Shared);
+	snapshot.Varint(Users.size());
+	for (size_t i = 0; i != Users.size(); ++i) {
+		snapshot.Varint(Users[i]);
+	}
+	std::vector<unsigned long> runs;
+	GetExploredRuns(runs);
+	snapshot.Varint(runs.size());
+	for (size_t i = 0; i != runs.size(); ++i) {
+		snapshot.Varint(runs[i]);
+	}
+}
+
+/**
+**  Load the field from a snapshot.
+**
+**  @param snapshot  Input snapshot.
+*/
+void CFlowField::Load(CSnapshotReader &snapshot)
+{
+	MovementMask = snapshot.Varint();
+	BlockMask = MovementMask & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit);
+	UnitSize = snapshot.Pos();
+	PlayerIndex = snapshot.Int();
+	GoalPos = snapshot.Pos();
+	GoalSize = snapshot.Pos();
+	MinRange = snapshot.Int();
+	MaxRange = snapshot.Int();
+	Cycle = snapshot.Varint();
+	Dirty = snapshot.Bool();
+	Shared = snapshot.Bool();
+	const unsigned long userCount = snapshot.Varint();
+	if (userCount >= FlowFieldMinUsers || PlayerIndex < -1 || PlayerIndex >= PlayerMax
+		|| UnitSize.x <= 0 || UnitSize.y <= 0) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	Users.resize(userCount);
+	for (size_t i = 0; i != Users.size(); ++i) {
+		Users[i] = snapshot.Varint();
+	}
+	const unsigned long runCount = snapshot.Varint();
+	if (runCount > snapshot.Remaining()) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	std::vector<unsigned long> runs(runCount);
+	for (size_t i = 0; i != runs.size(); ++i) {
+		runs[i] = snapshot.Varint();
+	}
+	if (!SetExploredRuns(runs)) {
+		snapshot.SetCorrupted();
+	}
+}
+
+/**
+**  Load the field from the Lua table at the top of the stack.
+**
+**  @param l  Lua state.
+*/
+void CFlowField::Load(lua_State *l)
+{
+	if (!lua_istable(l, -1) || lua_rawlen(l, -1) != 15) {
+		LuaError(l, "incorrect argument");
+	}
+	MovementMask = LuaToUnsignedNumber(l, -1, 1);
+	BlockMask = MovementMask & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit);
+	UnitSize.x = LuaToNumber(l, -1, 2);
+	UnitSize.y = LuaToNumber(l, -1, 3);
+	PlayerIndex = LuaToNumber(l, -1, 4);
+	GoalPos.x = LuaToNumber(l, -1, 5);
+	GoalPos.y = LuaToNumber(l, -1, 6);
+	GoalSize.x = LuaToNumber(l, -1, 7);
+	GoalSize.y = LuaToNumber(l, -1, 8);
+	MinRange = LuaToNumber(l, -1, 9);
+	MaxRange = LuaToNumber(l, -1, 10);
+	Cycle = LuaToUnsignedNumber(l, -1, 11);
+	Dirty = LuaToBoolean(l, -1, 12);
+	Shared = LuaToBoolean(l, -1, 13);
+	if (PlayerIndex < -1 || PlayerIndex >= PlayerMax || UnitSize.x <= 0 || UnitSize.y <= 0) {
+		LuaError(l, "incorrect argument");
+	}
+
+	lua_rawgeti(l, -1, 14);
+	if (!lua_istable(l, -1)) {
+		LuaError(l, "incorrect argument");
+	}
+	Users.resize(lua_rawlen(l, -1));
+	for (size_t i = 0; i != Users.size(); ++i) {
+		Users[i] = LuaToNumber(l, -1, i + 1);
+	}
+	lua_pop(l, 1);
+
+	lua_rawgeti(l, -1, 15);
+	if (!lua_istable(l, -1)) {
+		LuaError(l, "incorrect argument");
+	}
+	std::vector<unsigned long> runs(lua_rawlen(l, -1));
+	for (size_t i = 0; i != runs.size(); ++i) {
+		runs[i] = LuaToUnsignedNumber(l, -1, i + 1);
+	}
+	lua_pop(l, 1);
+	if (!SetExploredRuns(runs)) {
+		LuaError(l, "Explored tiles don't fit the map");
+	}
+}
+
+/**
+**  Get the flow field shared by the units going to a goal.
+**
+**  A single unit finds its path faster with A*: the field is only
+**  computed when FlowFieldMinUsers different units ask for the same
+**  goal within a few game cycles, as the units of a group order do.
+**  Until then the units use A*.
+**
+**  @return  The field, or NULL if the units should use A*.
+*/
+CFlowField *GetFlowField(const CUnit &unit, const Vec2i &goalPos, const Vec2i &goalSize,
+						 int minrange, int maxrange)
+{
+	// Forget the old fields.
+	size_t expired = 0;
+	while (expired != FlowFields.size() && FlowFields[expired]->GetCycle() + FlowFieldLifetime < GameCycle) {
+		delete FlowFields[expired];
+		++expired;
+	}
+	FlowFields.erase(FlowFields.begin(), FlowFields.begin() + expired);
+
+	for (size_t i = 0; i != FlowFields.size(); ++i) {
+		CFlowField &field = *FlowFields[i];
+
+		if (field.Match(unit, goalPos, goalSize, minrange, maxrange)) {
+			if (!field.AddUser(unit)) {
+				return NULL;
+			}
+			if (field.IsDirty()) {
+				field.Build();
+			}
+			return &field;
+		}
+	}
+	// First request: just remember it.
+	if (FlowFields.size() == MaxFlowFields) {
+		delete FlowFields.front();
+		FlowFields.erase(FlowFields.begin());
+	}
+	FlowFields.push_back(new CFlowField(unit, goalPos, goalSize, minrange, maxrange));
+	FlowFields.back()->AddUser(unit);
+	return NULL;
+}
+
+/**
+**  Tell the flow fields that the map has changed.
+*/
+void FlowFieldsMapChanged()
+{
+	for (size_t i = 0; i != FlowFields.size(); ++i) {
+		FlowFields[i]->MarkDirty();
+	}
+}
+
+/**
+**  Free all flow fields.
+*/
+void FreeFlowFields()
+{
+	for (size_t i = 0; i != FlowFields.size(); ++i) {
+		delete FlowFields[i];
+	}
+	FlowFields.clear();
+	for (size_t i = 0; i != LoadedFlowFields.size(); ++i) {
+		delete LoadedFlowFields[i];
+	}
+	LoadedFlowFields.clear();
+}
+
+/**
+**  Save the flow fields.
+**
+**  A field gives other steps than A*, and it is kept between the
+**  searches: the fields are saved with the game, so a loaded game moves
+**  its units as the saved one.
+**
+**  @param file  Output file.
+*/
+void SaveFlowFields(CFile &file)
+{
+	for (size_t i = 0; i != FlowFields.size(); ++i) {
+		FlowFields[i]->Save(file);
+	}
+}
+
+/**
+**  Save the flow fields to a snapshot.
+**
+**  @param snapshot  Output snapshot.
+*/
+void SaveFlowFields(CSnapshotWriter &snapshot)
+{
+	snapshot.Varint(FlowFields.size());
+	for (size_t i = 0; i != FlowFields.size(); ++i) {
+		FlowFields[i]->Save(snapshot);
+	}
+}
+
+/**
+**  Load the flow fields from a snapshot.
+**
+**  @param snapshot  Input snapshot.
+*/
+void LoadFlowFields(CSnapshotReader &snapshot)
+{
+	const unsigned long count = snapshot.Varint();
+	if (count > MaxFlowFields) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	for (unsigned long i = 0; i != count && !snapshot.IsCorrupted(); ++i) {
+		LoadedFlowFields.push_back(new CFlowField);
+		LoadedFlowFields.back()->Load(snapshot);
+	}
+}
+
+/**
+**  Load a flow field of a saved game.
+**
+**  @param l  Lua state, with the field at the top of the stack.
+*/
+void LoadFlowField(lua_State *l)
+{
+	if (LoadedFlowFields.size() == MaxFlowFields) {
+		LuaError(l, "Too many flow fields");
+	}
+	LoadedFlowFields.push_back(new CFlowField);
+	LoadedFlowFields.back()->Load(l);
+}
+
+/**
+**  Use the loaded flow fields.
+**
+**  Placing the units of the loaded game marked the fields as dirty:
+**  they are only used once the units are placed. The fields computed
+**  in the saved game are computed again.
+*/
+void RestoreLoadedFlowFields()
+{
+	if (LoadedFlowFields.empty()) {
+		return;
+	}
+	for (size_t i = 0; i != FlowFields.size(); ++i) {
+		delete FlowFields[i];
+	}
+	FlowFields.swap(LoadedFlowFields);
+	LoadedFlowFields.clear();
+	for (size_t i = 0; i != FlowFields.size(); ++i) {
+		if (!FlowFields[i]->IsDirty()) {
+			FlowFields[i]->Build();
+		}
+	}
+}
+
+//@}
@@ -0,0 +1,289 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name pathcache.cpp - The path cache of the pathfinder. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "pathfinder_local.h"
+
+#include "iolib.h"
+#include "pathfinder.h"
+#include "player.h"
+#include "snapshot.h"
+#include "unit.h"
+#include "unittype.h"
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+const int CPathCache::CacheSize;
+
+CPathCache PathCache;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Forget all the paths.
+*/
+void CPathCache::Clear()
+{
+	Entries.clear();
+	Loaded.clear();
+	Epoch = 1;
+}
+
+/**
+**  Allocate the entries, all unused.
+*/
+void CPathCache::Allocate()
+{
+	Entries.resize(CacheSize);
+	for (size_t i = 0; i != Entries.size(); ++i) {
+		Entries[i].Epoch = 0;
+	}
+}
+
+/**
+**  The passability of the map has changed: no path can be trusted anymore.
+*/
+void CPathCache::MapChanged()
+{
+	++Epoch;
+	if (Epoch == 0) {
+		// Wrapped around, old entries could look current again.
+		Clear();
+	}
+}
+
+/**
+**  Slot of a request in the cache.
+*/
+unsigned int CPathCache::Hash(const Vec2i &startPos, const Vec2i &goalPos, const Vec2i &goalSize,
+							  int minrange, int maxrange, unsigned movementMask) const
+{
+	unsigned int hash = startPos.x;
+	hash = hash * 31 + startPos.y;
+	hash = hash * 31 + goalPos.x;
+	hash = hash * 31 + goalPos.y;
+	hash = hash * 31 + goalSize.x;
+	hash = hash * 31 + goalSize.y;
+	hash = hash * 31 + minrange;
+	hash = hash * 31 + maxrange;
+	hash = hash * 31 + movementMask;
+	hash ^= hash >> 13;
+	return hash & (CacheSize - 1);
+}
+
+/**
+**  Find a path.
+**
+**  @return  The entry of the request if it was found during the current
+**           epoch, NULL otherwise.
+*/
+const CPathCache::Entry *CPathCache::Find(const Vec2i &startPos, const Vec2i &goalPos, const Vec2i &goalSize,
+										  int minrange, int maxrange, const CUnit &unit) const
+{
+	if (Entries.empty()) {
+		return NULL;
+	}
+	const Entry &entry = Entries[Hash(startPos, goalPos, goalSize, minrange, maxrange, unit.Type->MovementMask)];
+
+	if (entry.Epoch != Epoch
+		|| entry.StartPos != startPos || entry.GoalPos != goalPos || entry.GoalSize != goalSize
+		|| entry.MinRange != minrange || entry.MaxRange != maxrange
+		|| entry.MovementMask != unit.Type->MovementMask
+		|| entry.UnitSize.x != unit.Type->TileWidth || entry.UnitSize.y != unit.Type->TileHeight
+		|| entry.PlayerIndex != (AStarKnowUnseenTerrain ? -1 : unit.Player->Index)) {
+		return NULL;
+	}
+	return &entry;
+}
+
+/**
+**  Remember a path.
+**
+**  @param length   Full length of the path.
+**  @param path     Directions, the first step is at path[pathlen - 1].
+**  @param pathlen  Number of directions in path.
+*/
+void CPathCache::Store(const Vec2i &startPos, const Vec2i &goalPos, const Vec2i &goalSize,
+					   int minrange, int maxrange, const CUnit &unit,
+					   int length, const char *path, int pathlen)
+{
+	if (Entries.empty()) {
+		Allocate();
+	}
+	Entry &entry = Entries[Hash(startPos, goalPos, goalSize, minrange, maxrange, unit.Type->MovementMask)];
+
+	entry.StartPos = startPos;
+	entry.GoalPos = goalPos;
+	entry.GoalSize = goalSize;
+	entry.UnitSize.x = unit.Type->TileWidth;
+	entry.UnitSize.y = unit.Type->TileHeight;
+	entry.MovementMask = unit.Type->MovementMask;
+	entry.PlayerIndex = AStarKnowUnseenTerrain ? -1 : unit.Player->Index;
+	entry.MinRange = minrange;
+	entry.MaxRange = maxrange;
+	entry.Epoch = Epoch;
+	entry.Length = length;
+	entry.StepCount = std::min<int>(pathlen, PathFinderOutput::MAX_PATH_LENGTH);
+	for (int i = 0; i != entry.StepCount; ++i) {
+		entry.Steps[i] = path[pathlen - 1 - i];
+	}
+}
+
+/**
+**  Save the paths of the current epoch.
+**
+**  @param file  Output file.
+*/
+void CPathCache::Save(CFile &file) const
+{
+	for (size_t i = 0; i != Entries.size(); ++i) {
+		const Entry &entry = Entries[i];
+
+		if (entry.Epoch != Epoch) {
+			continue;
+		}
+		std::string steps;
+		for (int j = 0; j != entry.StepCount; ++j) {
+			steps += char('0' + entry.Steps[j]);
+		}
+		file.printf("PathCacheEntry({%d, %d, %d, %d, %d, %d, %d, %d, %u, %d, %d, %d, %d, \"%s\"})\n",
+					entry.StartPos.x, entry.StartPos.y, entry.GoalPos.x, entry.GoalPos.y,
+					entry.GoalSize.x, entry.GoalSize.y, entry.UnitSize.x, entry.UnitSize.y,
+					entry.MovementMask, entry.PlayerIndex, entry.MinRange, entry.MaxRange,
+					entry.Length, steps.c_str());
+	}
+}
+
+/**
+**  Save the paths of the current epoch to a snapshot.
+**
+**  @param snapshot  Output snapshot.
+*/
+void CPathCache::Save(CSnapshotWriter &snapshot) const
+{
+	unsigned long count = 0;
+	for (size_t i = 0; i != Entries.size(); ++i) {
+		count += Entries[i].Epoch == Epoch;
+	}
+	snapshot.Varint(count);
+	for (size_t i = 0; i != Entries.size(); ++i) {
+		const Entry &entry = Entries[i];
+
+		if (entry.Epoch != Epoch) {
+			continue;
+		}
+		snapshot.Pos(entry.StartPos);
+		snapshot.Pos(entry.GoalPos);
+		snapshot.Pos(entry.GoalSize);
+		snapshot.Pos(entry.UnitSize);
+		snapshot.Varint(entry.MovementMask);
+		snapshot.Int(entry.PlayerIndex);
+		snapshot.Int(entry.MinRange);
+		snapshot.Int(entry.MaxRange);
+		snapshot.Int(entry.Length);
+		snapshot.Varint(entry.StepCount);
+		snapshot.Bytes(entry.Steps, entry.StepCount);
+	}
+}
+
+/**
+**  Load the paths from a snapshot.
+**
+**  They are only added to the cache by RestoreLoaded: placing the
+**  units of the loaded game changes the epoch.
+**
+**  @param snapshot  Input snapshot.
+*/
+void CPathCache::Load(CSnapshotReader &snapshot)
+{
+	const unsigned long count = snapshot.Varint();
+	if (count > CacheSize) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	for (unsigned long i = 0; i != count && !snapshot.IsCorrupted(); ++i) {
+		Entry entry;
+
+		entry.StartPos = snapshot.Pos();
+		entry.GoalPos = snapshot.Pos();
+		entry.GoalSize = snapshot.Pos();
+		entry.UnitSize = snapshot.Pos();
+		entry.MovementMask = snapshot.Varint();
+		entry.PlayerIndex = snapshot.Int();
+		entry.MinRange = snapshot.Int();
+		entry.MaxRange = snapshot.Int();
+		entry.Length = snapshot.Int();
+		entry.StepCount = snapshot.Varint();
+		if (entry.StepCount < 0 || entry.StepCount > PathFinderOutput::MAX_PATH_LENGTH) {
+			snapshot.SetCorrupted();
+			return;
+		}
+		snapshot.Bytes(entry.Steps, entry.StepCount);
+		for (int j = 0; j != entry.StepCount; ++j) {
+			if (entry.Steps[j] < 0 || entry.Steps[j] >= 8) {
+				snapshot.SetCorrupted();
+				return;
+			}
+		}
+		Load(entry);
+	}
+}
+
+/**
+**  Add the loaded paths to the cache, at the current epoch.
+*/
+void CPathCache::RestoreLoaded()
+{
+	if (Loaded.empty()) {
+		return;
+	}
+	if (Entries.empty()) {
+		Allocate();
+	}
+	for (size_t i = 0; i != Loaded.size(); ++i) {
+		const Entry &loaded = Loaded[i];
+		Entry &entry = Entries[Hash(loaded.StartPos, loaded.GoalPos, loaded.GoalSize,
+									loaded.MinRange, loaded.MaxRange, loaded.MovementMask)];
+
+		entry = loaded;
+		entry.Epoch = Epoch;
+	}
+	Loaded.clear();
+}
+
+//@}
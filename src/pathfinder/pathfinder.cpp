@@ -38,8 +38,10 @@
 #include "stratagus.h"
 
 #include "pathfinder.h"
+#include "pathfinder_local.h"
 
 #include "actions.h"
+#include "iolib.h"
 #include "map.h"
 #include "unittype.h"
 #include "unit.h"
@@ -57,6 +59,11 @@ extern int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, in
 						 int tilesizex, int tilesizey, int minrange,
 						 int maxrange, char *path, int pathlen, const CUnit &unit);
 
+/// Find a path for a unit by following the flow field of its goal
+extern int FlowFieldFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+							 int tilesizex, int tilesizey, int minrange,
+							 int maxrange, char *path, int pathlen, const CUnit &unit);
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
@@ -167,6 +174,53 @@ void FreePathfinder()
 	FreeAStar();
 }
 
+/**
+**  Save the state of the pathfinder kept between the searches.
+**
+**  @param file  Output file.
+*/
+void SavePathfinder(CFile &file)
+{
+	file.printf("\n--- -----------------------------------------\n");
+	file.printf("--- MODULE: pathfinder\n\n");
+	PathCache.Save(file);
+	SaveFlowFields(file);
+}
+
+/**
+**  Save the state of the pathfinder kept between the searches to a snapshot.
+**
+**  @param snapshot  Output snapshot.
+*/
+void SavePathfinder(CSnapshotWriter &snapshot)
+{
+	PathCache.Save(snapshot);
+	SaveFlowFields(snapshot);
+}
+
+/**
+**  Load the state of the pathfinder from a snapshot.
+**
+**  @param snapshot  Input snapshot.
+*/
+void LoadPathfinder(CSnapshotReader &snapshot)
+{
+	PathCache.Load(snapshot);
+	LoadFlowFields(snapshot);
+}
+
+/**
+**  Restore the loaded state of the pathfinder.
+**
+**  Called once the units of the loaded game are placed: placing them
+**  tells the pathfinder that the map changed.
+*/
+void PathfinderGameLoaded()
+{
+	PathCache.RestoreLoaded();
+	RestoreLoadedFlowFields();
+}
+
 /*----------------------------------------------------------------------------
 --  PATH-FINDER USE
 ----------------------------------------------------------------------------*/
@@ -327,13 +381,26 @@ PathFinderOutput::PathFinderOutput()
 static int NewPath(PathFinderInput &input, PathFinderOutput &output)
 {
 	char *path = output.Path;
-	int i = AStarFindPath(input.GetUnitPos(),
+	int i = PF_FAILED;
+	// Units of a group move order share the same flow field.
+	if (input.GetUnit()->CurrentAction() == UnitActionMove) {
+		i = FlowFieldFindPath(input.GetUnitPos(),
+							  input.GetGoalPos(),
+							  input.GetGoalSize().x, input.GetGoalSize().y,
+							  input.GetUnitSize().x, input.GetUnitSize().y,
+							  input.GetMinRange(), input.GetMaxRange(),
+							  path, PathFinderOutput::MAX_PATH_LENGTH,
+							  *input.GetUnit());
+	}
+	if (i == PF_FAILED) {
+		i = AStarFindPath(input.GetUnitPos(),
 						  input.GetGoalPos(),
 						  input.GetGoalSize().x, input.GetGoalSize().y,
 						  input.GetUnitSize().x, input.GetUnitSize().y,
 						  input.GetMinRange(), input.GetMaxRange(),
 						  path, PathFinderOutput::MAX_PATH_LENGTH,
 						  *input.GetUnit());
+	}
 	input.PathRacalculated();
 	if (i == PF_FAILED) {
 		i = PF_UNREACHABLE;
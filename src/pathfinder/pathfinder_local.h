@@ -0,0 +1,673 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name pathfinder_local.h - The local pathfinder header file. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __PATHFINDER_LOCAL_H__
+#define __PATHFINDER_LOCAL_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <vector>
+
+#include "map.h"
+#include "pathfinder.h"
+#include "vec2i.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+class CUnit;
+struct StatsNode;
+
+/**
+**  @class CRegionGraph pathfinder_local.h
+**
+**  Hierarchical view of the static passability of the map for one
+**  movement mask and one unit size.
+**
+**  The map is cut in clusters of RegionClusterSize x RegionClusterSize
+**  tiles. Inside a cluster, the positions a unit can stand on are grouped
+**  in regions (8-connected sets of positions, as A* moves diagonally).
+**  Two regions are neighbours when a unit can step from one to the other
+**  across a cluster border.
+**
+**  Only static obstacles (terrain, walls, buildings) are taken into
+**  account, units are ignored: the graph tells where a path may exist,
+**  A* still finds the real one.
+**
+**  Clusters are rebuilt lazily: changing a map field only marks the
+**  clusters touching it as dirty.
+**
+**  Regions are also labelled by connected component: two positions
+**  with different components can never be linked by a path, whatever
+**  the units do, so such requests are rejected without any search.
+**
+**  The graph is only read by the searches, see CRegionSearch.
+*/
+class CRegionGraph
+{
+public:
+	CRegionGraph(int movementMask, const Vec2i &unitSize);
+
+	/// Check if the graph handles this movement mask and unit size
+	bool Match(int movementMask, const Vec2i &unitSize) const {
+		return this->MovementMask == movementMask && this->UnitSize == unitSize;
+	}
+
+	/// The map field at pos has changed
+	void MarkDirty(const Vec2i &pos);
+	/// Rebuild the dirty clusters
+	void Update();
+
+	/// Region of the unit position at map index, RegionNone if not passable
+	int GetRegion(unsigned int index) const { return TileRegion[index]; }
+
+	/// Connected component of the unit position at map index, -1 if not passable
+	int GetComponent(unsigned int index) const {
+		const int region = TileRegion[index];
+		return region == RegionNone ? -1 : Component[region];
+	}
+
+	/// Number of region slots
+	int GetRegionCount() const { return Regions.size(); }
+	/// Connected component of a region
+	int GetRegionComponent(int region) const { return Component[region]; }
+	/// Mean position of a region
+	const Vec2i &GetRegionCenter(int region) const { return Regions[region].Center; }
+	/// Regions reachable in one step from a region
+	const std::vector<int> &GetRegionNeighbors(int region) const { return Regions[region].Neighbors; }
+
+public:
+	static const int RegionClusterSize = 16;  /// Tiles per cluster side
+	/// 8-connected sets in a cluster are separated by one tile at least
+	static const int MaxRegionsPerCluster = (RegionClusterSize / 2) * (RegionClusterSize / 2);
+	static const int RegionNone = 0xFFFF;      /// No region (unpassable)
+
+private:
+	/// A region of a cluster
+	struct Region {
+		Region() : TileCount(0) {}
+
+		int TileCount;              /// Number of positions in the region
+		Vec2i Center;               /// Mean position of the region
+		std::vector<int> Neighbors; /// Regions reachable in one step
+	};
+
+	/// A cluster of the map
+	struct Cluster {
+		Cluster() : RegionCount(0), Dirty(true) {}
+
+		int RegionCount; /// Number of regions in the cluster
+		bool Dirty;      /// Regions have to be rebuilt
+	};
+
+private:
+	bool IsPassable(const Vec2i &pos) const;
+	void BuildClusterRegions(int cluster);
+	void LinkClusterRegions(int cluster);
+	void AddNeighbor(int region, int neighbor);
+	void LabelComponents();
+	int ClusterIndex(const Vec2i &pos) const {
+		return (pos.y / RegionClusterSize) * ClusterColumns + pos.x / RegionClusterSize;
+	}
+
+private:
+	int MovementMask;                      /// Movement mask of the units
+	int BlockMask;                         /// Static map flags blocking the units
+	Vec2i UnitSize;                        /// Size of the units in tiles
+	int ClusterColumns;                    /// Number of clusters in a row
+	int ClusterRows;                       /// Number of clusters in a column
+	bool Dirty;                            /// Some clusters are dirty
+	std::vector<unsigned short> TileRegion; /// Region of each map position
+	std::vector<Cluster> Clusters;         /// All clusters
+	std::vector<Region> Regions;           /// MaxRegionsPerCluster slots per cluster
+	std::vector<int> Component;            /// Connected component of each region
+};
+
+/**
+**  @class CRegionSearch pathfinder_local.h
+**
+**  State of one query on a region graph: the goal regions, and the
+**  corridor of regions where the real search is done.
+**
+**  Each A* context has its own, so the region graphs stay read-only
+**  during the searches.
+*/
+class CRegionSearch
+{
+public:
+	CRegionSearch() : Graph(NULL), SearchStamp(0), StartRegion(0), StartComponent(-1), GoalConnected(false) {}
+
+	/// Start a new query from startRegion, forget goal and corridor marks
+	void Begin(const CRegionGraph &graph, int startRegion);
+	/// Mark the region of map index as a goal of the current query
+	void MarkGoal(unsigned int index);
+	/// Check if a goal of the current query is connected to the start region
+	bool IsGoalConnected() const { return GoalConnected; }
+	/// Find the regions to cross to go from the start region to a goal region
+	bool FindCorridor(const Vec2i &goalPos);
+	/// Check if the map index lies in the corridor of the current query
+	bool IsInCorridor(unsigned int index) const {
+		const int region = Graph->GetRegion(index);
+		return region != CRegionGraph::RegionNone && CorridorStamp[region] == SearchStamp;
+	}
+
+private:
+	const CRegionGraph *Graph;             /// Graph of the current query
+	unsigned int SearchStamp;              /// Current query
+	int StartRegion;                       /// Start region of query
+	int StartComponent;                    /// Component of the start region of query
+	bool GoalConnected;                    /// A goal of query is in StartComponent
+	std::vector<unsigned int> GoalStamp;   /// Region is a goal of query
+	std::vector<unsigned int> CorridorStamp; /// Region is in corridor of query
+	std::vector<unsigned int> VisitStamp;  /// Region was visited by query
+	std::vector<int> Cost;                 /// Cost from start region
+	std::vector<int> Parent;               /// Region we come from
+};
+
+/**
+**  @class CPathCache pathfinder_local.h
+**
+**  Last paths found by A*, keyed by start position, goal rectangle,
+**  ranges, unit size and movement mask (and player when the unexplored
+**  terrain is unknown).
+**
+**  Workers walk the same routes all game long: a repeated request is
+**  answered by a lookup, the caller still checks that the stored steps
+**  are free. Any change of the map passability bumps the epoch, which
+**  invalidates all the entries.
+**
+**  A hit gives the stored path, not the one a new search would find:
+**  the paths are saved with the game, so a loaded game moves its units
+**  as the saved one.
+*/
+class CPathCache
+{
+public:
+	/// A cached path
+	struct Entry {
+		Vec2i StartPos;      /// Start of the path
+		Vec2i GoalPos;       /// Top left corner of the goal
+		Vec2i GoalSize;      /// Size of the goal
+		Vec2i UnitSize;      /// Size of the unit
+		unsigned MovementMask; /// Movement mask of the unit
+		int PlayerIndex;     /// Player whose explored map is used, -1 for all the map
+		int MinRange;        /// Minimal distance to the goal
+		int MaxRange;        /// Maximal distance to the goal
+		unsigned int Epoch;  /// Epoch of the map when the path was found, 0 for unused
+		int Length;          /// Full length of the path
+		int StepCount;       /// Number of stored steps
+		char Steps[PathFinderOutput::MAX_PATH_LENGTH]; /// First directions, from start
+	};
+
+public:
+	CPathCache() : Epoch(1) {}
+
+	/// Forget all the paths
+	void Clear();
+	/// The passability of the map has changed
+	void MapChanged();
+	/// Current epoch of the map
+	unsigned int GetEpoch() const { return Epoch; }
+
+	/// Find a path, NULL if it is not known
+	const Entry *Find(const Vec2i &startPos, const Vec2i &goalPos, const Vec2i &goalSize,
+					  int minrange, int maxrange, const CUnit &unit) const;
+	/// Remember a path, stored in reverse order like in PathFinderOutput
+	void Store(const Vec2i &startPos, const Vec2i &goalPos, const Vec2i &goalSize,
+			   int minrange, int maxrange, const CUnit &unit,
+			   int length, const char *path, int pathlen);
+
+	/// Save the paths of the current epoch
+	void Save(CFile &file) const;
+	/// Save the paths of the current epoch to a snapshot
+	void Save(CSnapshotWriter &snapshot) const;
+	/// Load the paths from a snapshot, kept until RestoreLoaded
+	void Load(CSnapshotReader &snapshot);
+	/// Load a path of a saved game, kept until RestoreLoaded
+	void Load(const Entry &entry) { Loaded.push_back(entry); }
+	/// Add the loaded paths to the cache, at the current epoch
+	void RestoreLoaded();
+
+public:
+	static const int CacheSize = 4096; /// Number of entries, a power of two
+
+private:
+	unsigned int Hash(const Vec2i &startPos, const Vec2i &goalPos, const Vec2i &goalSize,
+					  int minrange, int maxrange, unsigned movementMask) const;
+	/// Allocate the entries, all unused
+	void Allocate();
+
+private:
+	unsigned int Epoch;          /// Current epoch of the map
+	std::vector<Entry> Entries;  /// Entries, indexed by hash
+	std::vector<Entry> Loaded;   /// Entries of a loaded game, not in Entries yet
+};
+
+/**
+**  @class CPathPrefetch pathfinder_local.h
+**
+**  A path searched ahead of a unit by the worker threads, before the
+**  actions of the units are handled (see PrefetchPath).
+**
+**  The search only reads the map, but the units handled before the unit
+**  change it. So the path is used only if the unit does the same request
+**  during the same cycle and epoch of the map, and if each cost of move
+**  read by the search is still the same: A* then does exactly the same
+**  search and finds the same path as if it was searched at that time.
+*/
+class CPathPrefetch
+{
+public:
+	/// A cost of move read by the search
+	struct Cost {
+		unsigned int Index;  /// Map index
+		int Value;           /// Result of the cost function, -1 for unpassable
+	};
+
+public:
+	/// Check if the request is the one searched ahead
+	bool Match(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+			   int tilesizex, int tilesizey, int minrange, int maxrange,
+			   int pathlen, const CUnit &unit) const;
+
+public:
+	const CUnit *Unit;       /// Unit asking for the path
+	unsigned long Cycle;     /// Game cycle of the request
+	unsigned int MapEpoch;   /// Epoch of the map during the search
+	bool KnowUnseenTerrain;  /// AStarKnowUnseenTerrain during the search
+	unsigned MovementMask;   /// Movement mask of the unit
+	Vec2i StartPos;          /// Start of the path
+	Vec2i GoalPos;           /// Top left corner of the goal
+	Vec2i GoalSize;          /// Size of the goal
+	Vec2i TileSize;          /// Size of the unit
+	int MinRange;            /// Minimal distance to the goal
+	int MaxRange;            /// Maximal distance to the goal
+	int Result;              /// Result of the search, PF_FAILED if it can't be used
+	char Path[PathFinderOutput::MAX_PATH_LENGTH]; /// Directions, like in PathFinderOutput
+	std::vector<Cost> Costs; /// Costs of move read by the search
+};
+
+/**
+**  @class CAStarContext pathfinder_local.h
+**
+**  State of the A* searches: node matrix, open set, cost cache, goal and
+**  region query.
+**
+**  Searches only write to their context and read the map, so searches
+**  with distinct contexts may run at the same time, for example one
+**  context per worker thread. The region graphs and the flow fields are
+**  shared: they must be up to date before concurrent searches start,
+**  which holds as long as the map is not modified meanwhile.
+*/
+class CAStarContext
+{
+public:
+	CAStarContext();
+	~CAStarContext();
+
+	/// Allocate the data structures for the current map
+	void Init();
+	/// Free the data structures
+	void Free();
+
+	/// Find a path with A*
+	int FindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+				 int tilesizex, int tilesizey, int minrange, int maxrange,
+				 char *path, int pathlen, const CUnit &unit);
+	/// Find a path by following the flow field of the goal
+	int FlowFieldFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						  int tilesizex, int tilesizey, int minrange, int maxrange,
+						  char *path, int pathlen, const CUnit &unit);
+	/// Copy the nodes of the last search, for debugging
+	StatsNode *GetStats() const;
+
+	/// Search a path ahead of the unit, see CPathPrefetch
+	void Prefetch(CPathPrefetch &prefetch);
+
+	/// Use a path cache and the paths searched ahead, NULL for none
+	void SetPathCache(CPathCache *cache) { PathCache = cache; }
+
+private:
+	struct Node;
+	struct Open;
+	struct CostMoveToCacheEntry;
+	class GoalMarker;
+	friend class GoalMarker;
+
+	void Prepare();
+	Node &GetNode(int o);
+	static bool OpenLess(const Open &lhs, const Open &rhs);
+	void SetOpen(int pos, const Open &node);
+	void SiftUp(int pos);
+	void SiftDown(int pos);
+	void RemoveMinimum(int pos);
+	int AddNode(const Vec2i &pos, int o, int costs);
+	void ReplaceNode(int pos, int costs);
+	int FindNode(int eo) const;
+	int CostMoveTo(unsigned int index, const CUnit &unit);
+	int MarkGoal(const Vec2i &goal, int gw, int gh,
+				 int tilesizex, int tilesizey, int minrange, int maxrange, const CUnit &unit);
+	int SavePath(const Vec2i &startPos, const Vec2i &endPos, char *path, int pathLen) const;
+	int FindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw, int gh,
+					   int tilesizex, int tilesizey, int minrange, int maxrange,
+					   char *path, const CUnit &unit);
+	int Search(const Vec2i &startPos, const Vec2i &goalPos,
+			   int tilesizex, int tilesizey, char *path, int pathlen, const CUnit &unit);
+	int FindCachedPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+					   int minrange, int maxrange, char *path, int pathlen, const CUnit &unit);
+	int FindPrefetchedPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						   int tilesizex, int tilesizey, int minrange, int maxrange,
+						   char *path, int pathlen, const CUnit &unit);
+	int SearchPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+				   int tilesizex, int tilesizey, int minrange, int maxrange,
+				   char *path, int pathlen, const CUnit &unit);
+
+private:
+	Node *Matrix;                          /// Cost matrix
+	int MatrixSize;                        /// Size of Matrix in bytes
+	unsigned int CurrentGeneration;        /// Current search, older nodes and cache entries are unset
+	Open *OpenSet;                         /// The set of Open nodes, a binary heap
+	int OpenSetMaxSize;                    /// The capacity of the open node set
+	int OpenSetSize;                       /// The size of the open node set
+	CostMoveToCacheEntry *CostMoveToCache; /// Cost of moving on each map position
+	int CostMoveToCacheSize;               /// Size of CostMoveToCache in bytes
+	Vec2i GoalPos;                         /// Goal of the current search
+	CRegionSearch RegionSearch;            /// Region query of the current search
+	bool UseRegions;                       /// The current search uses RegionSearch
+	bool UseCorridor;                      /// Restrict the current search to the corridor of RegionSearch
+	CPathCache *PathCache;                 /// Cache of the found paths, NULL if not used
+	std::vector<CPathPrefetch::Cost> *CostLog; /// Costs of move read by the search, NULL if not logged
+};
+
+/**
+**  @class CFlowField pathfinder_local.h
+**
+**  Cost to reach a goal area from every position of the map (the
+**  integration field) and the direction to follow from each position
+**  (the direction field), for one movement mask and one unit size.
+**
+**  Units given the same move order share one field instead of running
+**  one A* each. As for the region graph only static obstacles are known,
+**  the units on the way are checked when following the field.
+*/
+class CFlowField
+{
+public:
+	CFlowField(const CUnit &unit, const Vec2i &goalPos, const Vec2i &goalSize, int minrange, int maxrange);
+	/// Empty field, filled by Load
+	CFlowField();
+
+	/// Check if the field leads this unit to this goal
+	bool Match(const CUnit &unit, const Vec2i &goalPos, const Vec2i &goalSize, int minrange, int maxrange) const;
+
+	/// The field has to be (re)computed
+	bool IsDirty() const { return Dirty; }
+	/// The map has changed, the field will be recomputed
+	void MarkDirty() { Dirty = true; }
+	/// Compute the field
+	void Build();
+
+	/// Count a unit asking for the field, true once enough units share it
+	bool AddUser(const CUnit &unit);
+
+	/// Cost to reach the goal from the unit position at map index
+	int GetCost(unsigned int index) const { return Cost[index]; }
+	/// Direction to follow from the unit position at map index
+	int GetDirection(unsigned int index) const { return Direction[index]; }
+
+	/// Game cycle when the field was requested first
+	unsigned long GetCycle() const { return Cycle; }
+
+	/// Save the field
+	void Save(CFile &file) const;
+	/// Save the field to a snapshot
+	void Save(CSnapshotWriter &snapshot) const;
+	/// Load the field from a snapshot
+	void Load(CSnapshotReader &snapshot);
+	/// Load the field from the Lua table at the top of the stack
+	void Load(lua_State *l);
+
+public:
+	static const int Unreachable = 0x7FFFFFFF; /// Cost of unreachable positions
+
+private:
+	int CostMoveTo(const Vec2i &pos) const;
+	/// Read the explored tiles of the player from the map
+	void ReadExplored();
+	/// Explored tiles as the lengths of the runs of unexplored and explored tiles
+	void GetExploredRuns(std::vector<unsigned long> &runs) const;
+	/// Set the explored tiles from the lengths of the runs, false if they don't fit the map
+	bool SetExploredRuns(const std::vector<unsigned long> &runs);
+
+private:
+	unsigned MovementMask;             /// Movement mask of the units
+	int BlockMask;                     /// Static map flags blocking the units
+	Vec2i UnitSize;                    /// Size of the units in tiles
+	int PlayerIndex;                   /// Player whose explored map is used, -1 for all the map
+	Vec2i GoalPos;                     /// Top left corner of the goal
+	Vec2i GoalSize;                    /// Size of the goal
+	int MinRange;                      /// Minimal distance to the goal
+	int MaxRange;                      /// Maximal distance to the goal
+	unsigned long Cycle;               /// Game cycle of the first request
+	bool Dirty;                        /// Field has to be computed
+	bool Shared;                       /// Enough units asked for the field
+	std::vector<int> Users;            /// Slots of the units which asked for the field
+	std::vector<bool> Explored;        /// Explored tiles of the player when the field was computed
+	std::vector<int> Cost;             /// Integration field
+	std::vector<char> Direction;       /// Direction field
+};
+
+/**
+**  Call a functor on the map index of each unit position which is
+**  between minrange and maxrange of a goal rectangle.
+*/
+template <typename T>
+class MinMaxRangeVisitor
+{
+public:
+	explicit MinMaxRangeVisitor(const T &func) : func(func), minrange(0), maxrange(0) {}
+
+	void SetGoal(Vec2i goalTopLeft, Vec2i goalBottomRight) {
+		this->goalTopLeft = goalTopLeft;
+		this->goalBottomRight = goalBottomRight;
+	}
+
+	void SetRange(int minrange, int maxrange) {
+		this->minrange = minrange;
+		this->maxrange = maxrange;
+	}
+
+	void SetUnitSize(const Vec2i &tileSize) {
+		this->unitExtraTileSize.x = tileSize.x - 1;
+		this->unitExtraTileSize.y = tileSize.y - 1;
+	}
+
+	void Visit() const {
+		TopHemicycle();
+		TopHemicycleNoMinRange();
+		Center();
+		BottomHemicycleNoMinRange();
+		BottomHemicycle();
+	}
+
+private:
+	int GetMaxOffsetX(int dy, int range) const {
+		return isqrt(square(range + 1) - square(dy) - 1);
+	}
+
+	// Distance are computed between bottom of unit and top of goal
+	void TopHemicycle() const {
+		const int miny = std::max(0, goalTopLeft.y - maxrange - unitExtraTileSize.y);
+		const int maxy = std::min(goalTopLeft.y - minrange - unitExtraTileSize.y, goalTopLeft.y - 1 - unitExtraTileSize.y);
+		for (int y = miny; y <= maxy; ++y) {
+			const int offsetx = GetMaxOffsetX(y - goalTopLeft.y, maxrange);
+			const int minx = std::max(0, goalTopLeft.x - offsetx - unitExtraTileSize.x);
+			const int maxx = std::min(Map.Info.MapWidth - 1 - unitExtraTileSize.x, goalBottomRight.x + offsetx);
+			Vec2i mpos(minx, y);
+			const unsigned int offset = mpos.y * Map.Info.MapWidth;
+
+			for (mpos.x = minx; mpos.x <= maxx; ++mpos.x) {
+				func(offset + mpos.x);
+			}
+		}
+	}
+
+	void HemiCycleRing(int y, int offsetminx, int offsetmaxx) const {
+		const int minx = std::max(0, goalTopLeft.x - offsetmaxx - unitExtraTileSize.x);
+		const int maxx = std::min(Map.Info.MapWidth - 1 - unitExtraTileSize.x, goalBottomRight.x + offsetmaxx);
+		Vec2i mpos(minx, y);
+		const unsigned int offset = mpos.y * Map.Info.MapWidth;
+
+		for (mpos.x = minx; mpos.x <= goalTopLeft.x - offsetminx - unitExtraTileSize.x; ++mpos.x) {
+			func(offset + mpos.x);
+		}
+		for (mpos.x = goalBottomRight.x + offsetminx; mpos.x <= maxx; ++mpos.x) {
+			func(offset + mpos.x);
+		}
+	}
+
+	void TopHemicycleNoMinRange() const {
+		const int miny = std::max(0, goalTopLeft.y - (minrange - 1) - unitExtraTileSize.y);
+		const int maxy = goalTopLeft.y - 1 - unitExtraTileSize.y;
+		for (int y = miny; y <= maxy; ++y) {
+			const int offsetmaxx = GetMaxOffsetX(y - goalTopLeft.y, maxrange);
+			const int offsetminx = GetMaxOffsetX(y - goalTopLeft.y, minrange - 1) + 1;
+
+			HemiCycleRing(y, offsetminx, offsetmaxx);
+		}
+	}
+
+	void Center() const {
+		const int miny = std::max(0, goalTopLeft.y - unitExtraTileSize.y);
+		const int maxy = std::min<int>(Map.Info.MapHeight - 1 - unitExtraTileSize.y, goalBottomRight.y);
+		const int minx = std::max(0, goalTopLeft.x - maxrange - unitExtraTileSize.x);
+		const int maxx = std::min<int>(Map.Info.MapWidth - 1 - unitExtraTileSize.x, goalBottomRight.x + maxrange);
+
+		if (minrange == 0) {
+			for (int y = miny; y <= maxy; ++y) {
+				Vec2i mpos(minx, y);
+				const unsigned int offset = mpos.y * Map.Info.MapWidth;
+
+				for (mpos.x = minx; mpos.x <= maxx; ++mpos.x) {
+					func(offset + mpos.x);
+				}
+			}
+		} else {
+			for (int y = miny; y <= maxy; ++y) {
+				Vec2i mpos(minx, y);
+				const unsigned int offset = mpos.y * Map.Info.MapWidth;
+
+				for (mpos.x = minx; mpos.x <= goalTopLeft.x - minrange - unitExtraTileSize.x; ++mpos.x) {
+					func(offset + mpos.x);
+				}
+				for (mpos.x = goalBottomRight.x + minrange; mpos.x <= maxx; ++mpos.x) {
+					func(offset + mpos.x);
+				}
+			}
+		}
+	}
+
+	void BottomHemicycleNoMinRange() const {
+		const int miny = goalBottomRight.y + 1;
+		const int maxy = std::min(Map.Info.MapHeight - 1 - unitExtraTileSize.y, goalBottomRight.y + (minrange - 1));
+
+		for (int y = miny; y <= maxy; ++y) {
+			const int offsetmaxx = GetMaxOffsetX(y - goalBottomRight.y, maxrange);
+			const int offsetminx = GetMaxOffsetX(y - goalBottomRight.y, minrange - 1) + 1;
+
+			HemiCycleRing(y, offsetminx, offsetmaxx);
+		}
+	}
+
+	void BottomHemicycle() const {
+		const int miny = std::max(goalBottomRight.y + minrange, goalBottomRight.y + 1);
+		const int maxy = std::min(Map.Info.MapHeight - 1 - unitExtraTileSize.y, goalBottomRight.y + maxrange);
+		for (int y = miny; y <= maxy; ++y) {
+			const int offsetx = GetMaxOffsetX(y - goalBottomRight.y, maxrange);
+			const int minx = std::max(0, goalTopLeft.x - offsetx - unitExtraTileSize.x);
+			const int maxx = std::min(Map.Info.MapWidth - 1 - unitExtraTileSize.x, goalBottomRight.x + offsetx);
+			Vec2i mpos(minx, y);
+			const unsigned int offset = mpos.y * Map.Info.MapWidth;
+
+			for (mpos.x = minx; mpos.x <= maxx; ++mpos.x) {
+				func(offset + mpos.x);
+			}
+		}
+	}
+
+private:
+	T func;
+	Vec2i goalTopLeft;
+	Vec2i goalBottomRight;
+	Vec2i unitExtraTileSize;
+	int minrange;
+	int maxrange;
+};
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Get the region graph for a movement mask and a unit size
+extern CRegionGraph &GetRegionGraph(int movementMask, const Vec2i &unitSize);
+/// Free all region graphs
+extern void FreeRegionGraphs();
+
+/// Get the flow field shared by the units going to a goal
+extern CFlowField *GetFlowField(const CUnit &unit, const Vec2i &goalPos, const Vec2i &goalSize,
+								int minrange, int maxrange);
+/// Tell the flow fields that the map has changed
+extern void FlowFieldsMapChanged();
+/// Free all flow fields
+extern void FreeFlowFields();
+/// Save the flow fields
+extern void SaveFlowFields(CFile &file);
+/// Save the flow fields to a snapshot
+extern void SaveFlowFields(CSnapshotWriter &snapshot);
+/// Load the flow fields from a snapshot, kept until RestoreLoadedFlowFields
+extern void LoadFlowFields(CSnapshotReader &snapshot);
+/// Load a flow field of a saved game, kept until RestoreLoadedFlowFields
+extern void LoadFlowField(lua_State *l);
+/// Use the loaded flow fields
+extern void RestoreLoadedFlowFields();
+
+/// Get the path searched ahead of the unit during this cycle, NULL if none
+extern const CPathPrefetch *FindPathPrefetch(const CUnit &unit);
+/// Free the worker threads and the paths searched ahead
+extern void FreePathPrefetch();
+
+/// Paths found by the game logic
+extern CPathCache PathCache;
+
+//@}
+
+#endif // !__PATHFINDER_LOCAL_H__
@@ -0,0 +1,275 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name pathprefetch.cpp - The paths searched ahead of the units. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "pathfinder_local.h"
+
+#include "SDL.h"
+
+#include "actions.h"
+#include "pathfinder.h"
+#include "unit.h"
+#include "unittype.h"
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/// see pathfinder.h
+int PathfinderThreads = 1;
+
+static std::vector<CPathPrefetch> PathPrefetches; /// Requests, kept to reuse the cost vectors
+static int PathPrefetchCount;                     /// Requests of the current cycle
+static int PathPrefetchNext;                      /// Next request to search
+
+static std::vector<CAStarContext *> PrefetchContexts; /// One per thread, the first for the main thread
+static std::vector<SDL_Thread *> PrefetchThreads;     /// Worker threads
+static SDL_mutex *PrefetchMutex;                      /// Protect PathPrefetchNext
+static SDL_sem *PrefetchStart;                        /// Posted once per worker to start a run
+static SDL_sem *PrefetchDone;                         /// Posted by each worker at the end of a run
+static bool PrefetchQuit;                             /// Workers have to exit
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Check if the request is the one searched ahead.
+**
+**  The path is searched with a full path buffer, like NewPath does.
+*/
+bool CPathPrefetch::Match(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						  int tilesizex, int tilesizey, int minrange, int maxrange,
+						  int pathlen, const CUnit &unit) const
+{
+	return Result != PF_FAILED && Unit == &unit && Cycle == GameCycle
+		   && MapEpoch == PathCache.GetEpoch() && KnowUnseenTerrain == AStarKnowUnseenTerrain
+		   && MovementMask == unit.Type->MovementMask
+		   && StartPos == startPos && GoalPos == goalPos
+		   && GoalSize.x == gw && GoalSize.y == gh
+		   && TileSize.x == tilesizex && TileSize.y == tilesizey
+		   && MinRange == minrange && MaxRange == maxrange
+		   && pathlen == PathFinderOutput::MAX_PATH_LENGTH;
+}
+
+/**
+**  Get the path searched ahead of the unit during this cycle.
+*/
+const CPathPrefetch *FindPathPrefetch(const CUnit &unit)
+{
+	const int index = unit.pathFinderData->prefetch;
+
+	if (index < 0 || index >= PathPrefetchCount) {
+		return NULL;
+	}
+	const CPathPrefetch &prefetch = PathPrefetches[index];
+	if (prefetch.Unit != &unit || prefetch.Cycle != GameCycle) {
+		return NULL;
+	}
+	return &prefetch;
+}
+
+/**
+**  Forget the paths searched ahead of the units.
+*/
+void StartPathPrefetch()
+{
+	PathPrefetchCount = 0;
+}
+
+/**
+**  Select the unit for a path search ahead of its action.
+**
+**  The request is the one NextPathElement will do if the unit moves
+**  during this cycle: the goal is read from a copy of the path finder
+**  input, nothing of the unit is changed.
+**
+**  @param unit  Unit which may move during this cycle.
+*/
+void PrefetchPath(CUnit &unit)
+{
+	PathFinderInput input = unit.pathFinderData->input;
+
+	unit.CurrentOrder()->UpdatePathFinderData(input);
+	if (unit.pathFinderData->output.Length > 0 && !input.IsRecalculateNeeded()) {
+		// The unit follows its path.
+		return;
+	}
+	if (PathPrefetchCount == (int)PathPrefetches.size()) {
+		PathPrefetches.push_back(CPathPrefetch());
+	}
+	CPathPrefetch &prefetch = PathPrefetches[PathPrefetchCount];
+
+	prefetch.Unit = &unit;
+	prefetch.Cycle = GameCycle;
+	prefetch.MapEpoch = PathCache.GetEpoch();
+	prefetch.KnowUnseenTerrain = AStarKnowUnseenTerrain;
+	prefetch.MovementMask = unit.Type->MovementMask;
+	prefetch.StartPos = input.GetUnitPos();
+	prefetch.GoalPos = input.GetGoalPos();
+	prefetch.GoalSize = input.GetGoalSize();
+	prefetch.TileSize = input.GetUnitSize();
+	prefetch.MinRange = input.GetMinRange();
+	prefetch.MaxRange = input.GetMaxRange();
+	prefetch.Result = PF_FAILED;
+	unit.pathFinderData->prefetch = PathPrefetchCount;
+	++PathPrefetchCount;
+
+	// The workers only read the region graphs, build them now.
+	if (AStarKnowUnseenTerrain) {
+		GetRegionGraph(prefetch.MovementMask, prefetch.TileSize).Update();
+	}
+}
+
+/**
+**  Search the requests until there is none left.
+*/
+static void SearchPathPrefetches(CAStarContext &context)
+{
+	for (;;) {
+		SDL_LockMutex(PrefetchMutex);
+		const int index = PathPrefetchNext++;
+		SDL_UnlockMutex(PrefetchMutex);
+
+		if (index >= PathPrefetchCount) {
+			return;
+		}
+		context.Prefetch(PathPrefetches[index]);
+	}
+}
+
+/**
+**  Main function of the worker threads.
+*/
+static int PathPrefetchThread(void *data)
+{
+	CAStarContext &context = *static_cast<CAStarContext *>(data);
+
+	for (;;) {
+		SDL_SemWait(PrefetchStart);
+		if (PrefetchQuit) {
+			return 0;
+		}
+		SearchPathPrefetches(context);
+		SDL_SemPost(PrefetchDone);
+	}
+}
+
+/**
+**  Create the contexts and the worker threads.
+*/
+static void InitPathPrefetch()
+{
+	int threads = std::max(PathfinderThreads, 1);
+#ifdef ASTAR_PROFILE
+	// The profile counters are not protected.
+	threads = 1;
+#endif
+
+	PrefetchMutex = SDL_CreateMutex();
+	PrefetchStart = SDL_CreateSemaphore(0);
+	PrefetchDone = SDL_CreateSemaphore(0);
+	PrefetchQuit = false;
+	for (int i = 0; i != threads; ++i) {
+		CAStarContext *context = new CAStarContext;
+
+		context->Init();
+		PrefetchContexts.push_back(context);
+		if (i == 0) {
+			continue;
+		}
+		SDL_Thread *thread = SDL_CreateThread(PathPrefetchThread, context);
+		if (thread == NULL) {
+			fprintf(stderr, "Can't create path finder thread: %s\n", SDL_GetError());
+			break;
+		}
+		PrefetchThreads.push_back(thread);
+	}
+}
+
+/**
+**  Search the paths of the selected units.
+**
+**  The main thread works with the workers and returns once all the
+**  requests are searched. Nothing else may run meanwhile: the searches
+**  read the map and the units.
+*/
+void RunPathPrefetch()
+{
+	if (PathPrefetchCount == 0) {
+		return;
+	}
+	if (PrefetchContexts.empty()) {
+		InitPathPrefetch();
+	}
+	PathPrefetchNext = 0;
+	for (size_t i = 0; i != PrefetchThreads.size(); ++i) {
+		SDL_SemPost(PrefetchStart);
+	}
+	SearchPathPrefetches(*PrefetchContexts[0]);
+	for (size_t i = 0; i != PrefetchThreads.size(); ++i) {
+		SDL_SemWait(PrefetchDone);
+	}
+}
+
+/**
+**  Stop the worker threads and free the paths searched ahead.
+*/
+void FreePathPrefetch()
+{
+	PrefetchQuit = true;
+	for (size_t i = 0; i != PrefetchThreads.size(); ++i) {
+		SDL_SemPost(PrefetchStart);
+	}
+	for (size_t i = 0; i != PrefetchThreads.size(); ++i) {
+		SDL_WaitThread(PrefetchThreads[i], NULL);
+	}
+	PrefetchThreads.clear();
+	for (size_t i = 0; i != PrefetchContexts.size(); ++i) {
+		delete PrefetchContexts[i];
+	}
+	PrefetchContexts.clear();
+	if (PrefetchMutex) {
+		SDL_DestroyMutex(PrefetchMutex);
+		SDL_DestroySemaphore(PrefetchStart);
+		SDL_DestroySemaphore(PrefetchDone);
+		PrefetchMutex = NULL;
+		PrefetchStart = NULL;
+		PrefetchDone = NULL;
+	}
+	PathPrefetches.clear();
+	PathPrefetchCount = 0;
+}
+
+//@}
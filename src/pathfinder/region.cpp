@@ -0,0 +1,476 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name region.cpp - The hierarchical region graph of the pathfinder. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "pathfinder_local.h"
+
+#include "map.h"
+#include "pathfinder.h"
+#include "tileset.h"
+
+#include <functional>
+#include <queue>
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+const int CRegionGraph::RegionClusterSize;
+const int CRegionGraph::MaxRegionsPerCluster;
+const int CRegionGraph::RegionNone;
+
+/// All region graphs, one per movement mask and unit size
+static std::vector<CRegionGraph *> RegionGraphs;
+
+/// Number of changes of the passability of the map
+unsigned long PathfinderMapGeneration;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+CRegionGraph::CRegionGraph(int movementMask, const Vec2i &unitSize) :
+	MovementMask(movementMask),
+	BlockMask(movementMask & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit)),
+	UnitSize(unitSize), Dirty(true)
+{
+	ClusterColumns = (Map.Info.MapWidth + RegionClusterSize - 1) / RegionClusterSize;
+	ClusterRows = (Map.Info.MapHeight + RegionClusterSize - 1) / RegionClusterSize;
+
+	const int regionCount = ClusterColumns * ClusterRows * MaxRegionsPerCluster;
+
+	TileRegion.resize(Map.Info.MapWidth * Map.Info.MapHeight, RegionNone);
+	Clusters.resize(ClusterColumns * ClusterRows);
+	Regions.resize(regionCount);
+	Component.resize(regionCount, -1);
+}
+
+/**
+**  Check if a unit can stand at pos, considering only static obstacles.
+*/
+bool CRegionGraph::IsPassable(const Vec2i &pos) const
+{
+	if (pos.x + UnitSize.x > Map.Info.MapWidth || pos.y + UnitSize.y > Map.Info.MapHeight) {
+		return false;
+	}
+	unsigned int index = Map.getIndex(pos);
+	for (int y = 0; y < UnitSize.y; ++y) {
+		const CMapField *mf = Map.Field(index);
+		for (int x = 0; x < UnitSize.x; ++x) {
+			if (mf->Flags & BlockMask) {
+				return false;
+			}
+			++mf;
+		}
+		index += Map.Info.MapWidth;
+	}
+	return true;
+}
+
+/**
+**  The map field at pos has changed.
+**
+**  Every unit position whose footprint covers pos is affected.
+*/
+void CRegionGraph::MarkDirty(const Vec2i &pos)
+{
+	const int minx = std::max(0, pos.x - UnitSize.x + 1);
+	const int miny = std::max(0, pos.y - UnitSize.y + 1);
+	const Vec2i corners[] = {Vec2i(minx, miny), Vec2i(pos.x, miny), Vec2i(minx, pos.y), pos};
+
+	for (unsigned int i = 0; i < sizeof(corners) / sizeof(*corners); ++i) {
+		Clusters[ClusterIndex(corners[i])].Dirty = true;
+	}
+	Dirty = true;
+}
+
+/**
+**  Compute the regions of one cluster with a flood fill.
+*/
+void CRegionGraph::BuildClusterRegions(int cluster)
+{
+	const Vec2i clusterPos((cluster % ClusterColumns) * RegionClusterSize,
+						   (cluster / ClusterColumns) * RegionClusterSize);
+	const int maxx = std::min<int>(clusterPos.x + RegionClusterSize, Map.Info.MapWidth);
+	const int maxy = std::min<int>(clusterPos.y + RegionClusterSize, Map.Info.MapHeight);
+	const int firstRegion = cluster * MaxRegionsPerCluster;
+	Cluster &c = Clusters[cluster];
+
+	for (int i = 0; i != c.RegionCount; ++i) {
+		Regions[firstRegion + i] = Region();
+	}
+	c.RegionCount = 0;
+
+	Vec2i pos;
+	for (pos.y = clusterPos.y; pos.y < maxy; ++pos.y) {
+		for (pos.x = clusterPos.x; pos.x < maxx; ++pos.x) {
+			TileRegion[Map.getIndex(pos)] = IsPassable(pos) ? RegionNone - 1 : RegionNone;
+		}
+	}
+
+	std::vector<Vec2i> stack;
+	for (pos.y = clusterPos.y; pos.y < maxy; ++pos.y) {
+		for (pos.x = clusterPos.x; pos.x < maxx; ++pos.x) {
+			if (TileRegion[Map.getIndex(pos)] != RegionNone - 1) {
+				continue;
+			}
+			Assert(c.RegionCount < MaxRegionsPerCluster);
+			const int regionIndex = firstRegion + c.RegionCount++;
+			Region &region = Regions[regionIndex];
+			int sumx = 0;
+			int sumy = 0;
+
+			TileRegion[Map.getIndex(pos)] = regionIndex;
+			stack.push_back(pos);
+			while (!stack.empty()) {
+				const Vec2i p = stack.back();
+				stack.pop_back();
+				++region.TileCount;
+				sumx += p.x;
+				sumy += p.y;
+				for (int i = 0; i != 8; ++i) {
+					const Vec2i n(p.x + Heading2X[i], p.y + Heading2Y[i]);
+					if (n.x < clusterPos.x || n.x >= maxx || n.y < clusterPos.y || n.y >= maxy) {
+						continue;
+					}
+					unsigned short &tileRegion = TileRegion[Map.getIndex(n)];
+					if (tileRegion == RegionNone - 1) {
+						tileRegion = regionIndex;
+						stack.push_back(n);
+					}
+				}
+			}
+			region.Center.x = sumx / region.TileCount;
+			region.Center.y = sumy / region.TileCount;
+		}
+	}
+	c.Dirty = false;
+}
+
+/**
+**  Add neighbor to the neighbor list of region.
+*/
+void CRegionGraph::AddNeighbor(int region, int neighbor)
+{
+	std::vector<int> &neighbors = Regions[region].Neighbors;
+
+	if (std::find(neighbors.begin(), neighbors.end(), neighbor) == neighbors.end()) {
+		neighbors.push_back(neighbor);
+	}
+}
+
+/**
+**  Compute the links of the regions of one cluster toward the other clusters.
+*/
+void CRegionGraph::LinkClusterRegions(int cluster)
+{
+	const Vec2i clusterPos((cluster % ClusterColumns) * RegionClusterSize,
+						   (cluster / ClusterColumns) * RegionClusterSize);
+	const int maxx = std::min<int>(clusterPos.x + RegionClusterSize, Map.Info.MapWidth);
+	const int maxy = std::min<int>(clusterPos.y + RegionClusterSize, Map.Info.MapHeight);
+	const int firstRegion = cluster * MaxRegionsPerCluster;
+
+	for (int i = 0; i != Clusters[cluster].RegionCount; ++i) {
+		Regions[firstRegion + i].Neighbors.clear();
+	}
+
+	Vec2i pos;
+	for (pos.y = clusterPos.y; pos.y < maxy; ++pos.y) {
+		const bool borderRow = pos.y == clusterPos.y || pos.y == maxy - 1;
+		for (pos.x = clusterPos.x; pos.x < maxx; ++pos.x) {
+			if (!borderRow && pos.x != clusterPos.x && pos.x != maxx - 1) {
+				continue;
+			}
+			const int region = TileRegion[Map.getIndex(pos)];
+			if (region == RegionNone) {
+				continue;
+			}
+			for (int i = 0; i != 8; ++i) {
+				const Vec2i n(pos.x + Heading2X[i], pos.y + Heading2Y[i]);
+				if (!Map.Info.IsPointOnMap(n)
+					|| (clusterPos.x <= n.x && n.x < maxx && clusterPos.y <= n.y && n.y < maxy)) {
+					continue;
+				}
+				const int neighbor = TileRegion[Map.getIndex(n)];
+				if (neighbor != RegionNone) {
+					AddNeighbor(region, neighbor);
+				}
+			}
+		}
+	}
+}
+
+/**
+**  Rebuild the dirty clusters and the links around them.
+*/
+void CRegionGraph::Update()
+{
+	if (!Dirty) {
+		return;
+	}
+	const int clusterCount = ClusterColumns * ClusterRows;
+	std::vector<char> relink(clusterCount, 0);
+
+	for (int i = 0; i != clusterCount; ++i) {
+		if (!Clusters[i].Dirty) {
+			continue;
+		}
+		BuildClusterRegions(i);
+		const int cx = i % ClusterColumns;
+		const int cy = i / ClusterColumns;
+		for (int y = std::max(0, cy - 1); y <= std::min(ClusterRows - 1, cy + 1); ++y) {
+			for (int x = std::max(0, cx - 1); x <= std::min(ClusterColumns - 1, cx + 1); ++x) {
+				relink[y * ClusterColumns + x] = 1;
+			}
+		}
+	}
+	// Region indexes of rebuilt clusters changed: links from them
+	// and from their neighbours have to be recomputed.
+	for (int i = 0; i != clusterCount; ++i) {
+		if (relink[i]) {
+			LinkClusterRegions(i);
+		}
+	}
+	LabelComponents();
+	Dirty = false;
+}
+
+/**
+**  Label the regions by connected component.
+**
+**  Flood fill on the region graph, not on the map: only the dirty
+**  clusters are recomputed tile by tile, the labelling itself costs a
+**  few operations per region.
+*/
+void CRegionGraph::LabelComponents()
+{
+	const int clusterCount = ClusterColumns * ClusterRows;
+	std::vector<int> stack;
+	int component = 0;
+
+	std::fill(Component.begin(), Component.end(), -1);
+	for (int i = 0; i != clusterCount; ++i) {
+		const int firstRegion = i * MaxRegionsPerCluster;
+		for (int j = 0; j != Clusters[i].RegionCount; ++j) {
+			if (Component[firstRegion + j] != -1) {
+				continue;
+			}
+			Component[firstRegion + j] = component;
+			stack.push_back(firstRegion + j);
+			while (!stack.empty()) {
+				const std::vector<int> &neighbors = Regions[stack.back()].Neighbors;
+				stack.pop_back();
+				for (size_t k = 0; k != neighbors.size(); ++k) {
+					if (Component[neighbors[k]] == -1) {
+						Component[neighbors[k]] = component;
+						stack.push_back(neighbors[k]);
+					}
+				}
+			}
+			++component;
+		}
+	}
+}
+
+/**
+**  Start a new query from startRegion: goal and corridor marks of old
+**  queries become invalid.
+*/
+void CRegionSearch::Begin(const CRegionGraph &graph, int startRegion)
+{
+	const size_t regionCount = graph.GetRegionCount();
+
+	if (GoalStamp.size() != regionCount) {
+		GoalStamp.assign(regionCount, 0);
+		CorridorStamp.assign(regionCount, 0);
+		VisitStamp.assign(regionCount, 0);
+		Cost.assign(regionCount, 0);
+		Parent.assign(regionCount, 0);
+	}
+	Graph = &graph;
+	StartRegion = startRegion;
+	StartComponent = graph.GetRegionComponent(startRegion);
+	GoalConnected = false;
+	++SearchStamp;
+	if (SearchStamp == 0) {
+		// Wrapped around, old stamps could look current again.
+		std::fill(GoalStamp.begin(), GoalStamp.end(), 0);
+		std::fill(CorridorStamp.begin(), CorridorStamp.end(), 0);
+		std::fill(VisitStamp.begin(), VisitStamp.end(), 0);
+		SearchStamp = 1;
+	}
+}
+
+/**
+**  Mark the region of the unit position at map index as a goal.
+*/
+void CRegionSearch::MarkGoal(unsigned int index)
+{
+	const int region = Graph->GetRegion(index);
+
+	if (region != CRegionGraph::RegionNone) {
+		GoalStamp[region] = SearchStamp;
+		GoalConnected |= Graph->GetRegionComponent(region) == StartComponent;
+	}
+}
+
+/**
+**  Find the regions to cross to go from the start region to a goal region.
+**
+**  A* on the region graph, costs are distances between region centers.
+**  The regions of the found path and their neighbours form the corridor
+**  where the real search is done.
+**
+**  @param goalPos      Goal position, for the heuristic.
+**
+**  @return             false if no goal region is reachable.
+*/
+bool CRegionSearch::FindCorridor(const Vec2i &goalPos)
+{
+	typedef std::pair<int, int> OpenRegion; // (cost + heuristic, region)
+	std::priority_queue<OpenRegion, std::vector<OpenRegion>, std::greater<OpenRegion> > open;
+
+	const Vec2i &startCenter = Graph->GetRegionCenter(StartRegion);
+
+	VisitStamp[StartRegion] = SearchStamp;
+	Cost[StartRegion] = 0;
+	Parent[StartRegion] = StartRegion;
+	open.push(OpenRegion(std::max(abs(startCenter.x - goalPos.x), abs(startCenter.y - goalPos.y)), StartRegion));
+
+	while (!open.empty()) {
+		const int region = open.top().second;
+		const int cost = open.top().first;
+		open.pop();
+
+		const Vec2i &center = Graph->GetRegionCenter(region);
+		const int heuristic = std::max(abs(center.x - goalPos.x), abs(center.y - goalPos.y));
+		if (cost != Cost[region] + heuristic) {
+			// outdated entry
+			continue;
+		}
+		if (GoalStamp[region] == SearchStamp) {
+			for (int r = region;; r = Parent[r]) {
+				CorridorStamp[r] = SearchStamp;
+				const std::vector<int> &neighbors = Graph->GetRegionNeighbors(r);
+				for (size_t i = 0; i != neighbors.size(); ++i) {
+					CorridorStamp[neighbors[i]] = SearchStamp;
+				}
+				if (r == StartRegion) {
+					break;
+				}
+			}
+			return true;
+		}
+		const std::vector<int> &neighbors = Graph->GetRegionNeighbors(region);
+		for (size_t i = 0; i != neighbors.size(); ++i) {
+			const int neighbor = neighbors[i];
+			const Vec2i &neighborCenter = Graph->GetRegionCenter(neighbor);
+			const int newCost = Cost[region] + 1
+								+ std::max(abs(neighborCenter.x - center.x), abs(neighborCenter.y - center.y));
+
+			if (VisitStamp[neighbor] == SearchStamp && Cost[neighbor] <= newCost) {
+				continue;
+			}
+			VisitStamp[neighbor] = SearchStamp;
+			Cost[neighbor] = newCost;
+			Parent[neighbor] = region;
+			open.push(OpenRegion(newCost + std::max(abs(neighborCenter.x - goalPos.x),
+													abs(neighborCenter.y - goalPos.y)),
+								 neighbor));
+		}
+	}
+	return false;
+}
+
+/**
+**  Get the region graph for a movement mask and a unit size,
+**  create it if needed.
+*/
+CRegionGraph &GetRegionGraph(int movementMask, const Vec2i &unitSize)
+{
+	for (size_t i = 0; i != RegionGraphs.size(); ++i) {
+		if (RegionGraphs[i]->Match(movementMask, unitSize)) {
+			return *RegionGraphs[i];
+		}
+	}
+	RegionGraphs.push_back(new CRegionGraph(movementMask, unitSize));
+	return *RegionGraphs.back();
+}
+
+/**
+**  Free all region graphs.
+*/
+void FreeRegionGraphs()
+{
+	for (size_t i = 0; i != RegionGraphs.size(); ++i) {
+		delete RegionGraphs[i];
+	}
+	RegionGraphs.clear();
+}
+
+/**
+**  Get the connected component of a position for a movement mask.
+**
+**  Positions with different components can't be linked by a path of a
+**  one tile unit using this movement mask.
+**
+**  @param movementMask  Movement mask of the unit.
+**  @param pos           Map tile position.
+**
+**  @return              Component number, -1 if pos is not passable.
+*/
+int GetTileComponent(int movementMask, const Vec2i &pos)
+{
+	CRegionGraph &regions = GetRegionGraph(movementMask, Vec2i(1, 1));
+
+	regions.Update();
+	return regions.GetComponent(Map.getIndex(pos));
+}
+
+/**
+**  Tell the pathfinder that the passability of the map field at pos changed.
+**
+**  @param pos  Map tile position.
+*/
+void PathfinderMapChanged(const Vec2i &pos)
+{
+	for (size_t i = 0; i != RegionGraphs.size(); ++i) {
+		RegionGraphs[i]->MarkDirty(pos);
+	}
+	++PathfinderMapGeneration;
+	FlowFieldsMapChanged();
+	PathCache.MapChanged();
+}
+
+//@}
@@ -36,6 +36,7 @@
 #include "stratagus.h"
 
 #include "pathfinder.h"
+#include "pathfinder_local.h"
 
 #include "map.h"
 #include "player.h"
@@ -101,12 +102,67 @@ static int CclAStar(lua_State *l)
 	return 0;
 }
 
+/**
+**  Load a path of the path cache of a saved game.
+**
+**  @param l  Lua state.
+*/
+static int CclPathCacheEntry(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	if (!lua_istable(l, 1) || lua_rawlen(l, 1) != 14) {
+		LuaError(l, "incorrect argument");
+	}
+	CPathCache::Entry entry;
+
+	entry.StartPos.x = LuaToNumber(l, 1, 1);
+	entry.StartPos.y = LuaToNumber(l, 1, 2);
+	entry.GoalPos.x = LuaToNumber(l, 1, 3);
+	entry.GoalPos.y = LuaToNumber(l, 1, 4);
+	entry.GoalSize.x = LuaToNumber(l, 1, 5);
+	entry.GoalSize.y = LuaToNumber(l, 1, 6);
+	entry.UnitSize.x = LuaToNumber(l, 1, 7);
+	entry.UnitSize.y = LuaToNumber(l, 1, 8);
+	entry.MovementMask = LuaToUnsignedNumber(l, 1, 9);
+	entry.PlayerIndex = LuaToNumber(l, 1, 10);
+	entry.MinRange = LuaToNumber(l, 1, 11);
+	entry.MaxRange = LuaToNumber(l, 1, 12);
+	entry.Length = LuaToNumber(l, 1, 13);
+	const std::string steps = LuaToString(l, 1, 14);
+	if (steps.size() > PathFinderOutput::MAX_PATH_LENGTH) {
+		LuaError(l, "Path too long: %s" _C_ steps.c_str());
+	}
+	entry.StepCount = steps.size();
+	for (int i = 0; i != entry.StepCount; ++i) {
+		if (steps[i] < '0' || steps[i] > '7') {
+			LuaError(l, "Bad path: %s" _C_ steps.c_str());
+		}
+		entry.Steps[i] = steps[i] - '0';
+	}
+	PathCache.Load(entry);
+	return 0;
+}
+
+/**
+**  Load a flow field of a saved game.
+**
+**  @param l  Lua state.
+*/
+static int CclFlowField(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	LoadFlowField(l);
+	return 0;
+}
+
 /**
 **  Register CCL features for pathfinder.
 */
 void PathfinderCclRegister()
 {
 	lua_register(Lua, "AStar", CclAStar);
+	lua_register(Lua, "PathCacheEntry", CclPathCacheEntry);
+	lua_register(Lua, "FlowField", CclFlowField);
 }
 
 //@}
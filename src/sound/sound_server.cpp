@@ -81,8 +81,12 @@ static struct {
 } MusicChannel;
 
 static void ChannelFinished(int channel);
-static int *MixerBuffer;
-static int MixerBufferSize;
+static int *MixerBuffer;         /// mixer buffer, allocated with the audio device
+static int MixerBufferSize;      /// number of samples in the mixer buffer
+static short *MusicBuffer;       /// music conversion buffer, same size as the mixer buffer
+
+/// Shift of the fixed point volumes used by the mixer
+#define MixerVolumeShift 15
 
 
 /*----------------------------------------------------------------------------
@@ -92,17 +96,15 @@ static int MixerBufferSize;
 /**
 **  Convert RAW sound data to 44100 hz, Stereo, 16 bits per channel
 **
-**  @param src        Source buffer
-**  @param dest       Destination buffer
+**  @param buf        Buffer holding the source data, converted in place
 **  @param frequency  Frequency of source
 **  @param chansize   Bitrate in bytes per channel of source
 **  @param channels   Number of channels of source
-**  @param bytes      Number of compressed bytes to read
+**  @param bytes      Number of compressed bytes to convert
 **
-**  @return           Number of bytes written in 'dest'
+**  @return           Number of bytes written in 'buf'
 */
-static int ConvertToStereo32(const char *src, char *dest, int frequency,
-							 int chansize, int channels, int bytes)
+static int ConvertToStereo32(char *buf, int frequency, int chansize, int channels, int bytes)
 {
 	SDL_AudioCVT acvt;
 	Uint16 format;
@@ -114,8 +116,7 @@ static int ConvertToStereo32(const char *src, char *dest, int frequency,
 	}
 	SDL_BuildAudioCVT(&acvt, format, channels, frequency, AUDIO_S16SYS, 2, 44100);
 
-	acvt.buf = (Uint8 *)dest;
-	memcpy(dest, src, bytes);
+	acvt.buf = (Uint8 *)buf;
 	acvt.len = bytes;
 
 	SDL_ConvertAudio(&acvt);
@@ -123,29 +124,71 @@ static int ConvertToStereo32(const char *src, char *dest, int frequency,
 	return acvt.len_mult * bytes;
 }
 
+/**
+**  Check if a sample is in the output format of the mixer.
+*/
+static bool IsSampleStereo16(const CSample &sample)
+{
+	return sample.Frequency == 44100 && sample.SampleSize == 16 && sample.Channels == 2;
+}
+
+/**
+**  Convert a sample loaded in memory to 44100 hz, Stereo, 16 bits per
+**  channel, so that the mixer can use it without any conversion.
+**
+**  @param sample  Sample to convert.
+*/
+static void ConvertSampleToStereo16(CSample &sample)
+{
+	if (IsSampleStereo16(sample) || sample.Buffer == NULL) {
+		return;
+	}
+	SDL_AudioCVT acvt;
+	const Uint16 format = sample.SampleSize == 8 ? AUDIO_U8 : AUDIO_S16SYS;
+
+	if (SDL_BuildAudioCVT(&acvt, format, sample.Channels, sample.Frequency, AUDIO_S16SYS, 2, 44100) < 0) {
+		fprintf(stderr, "Can't convert sample: %s\n", SDL_GetError());
+		return;
+	}
+	unsigned char *buf = new unsigned char[sample.Len * acvt.len_mult];
+	memcpy(buf, sample.Buffer, sample.Len);
+	acvt.buf = buf;
+	acvt.len = sample.Len;
+	SDL_ConvertAudio(&acvt);
+
+	delete[] sample.Buffer;
+	sample.Buffer = buf;
+	// Keep whole stereo frames only
+	sample.Len = acvt.len_cvt & ~3;
+	sample.Frequency = 44100;
+	sample.SampleSize = 16;
+	sample.BitsPerSample = 16;
+	sample.Channels = 2;
+}
+
 /**
 **  Mix music to stereo 32 bit.
 **
 **  @param buffer  Buffer for mixed samples.
 **  @param size    Number of samples that fits into buffer.
 **
-**  @todo this functions can be called from inside the SDL audio callback,
-**  which is bad, the buffer should be precalculated.
+**  @note This function is called from inside the SDL audio callback, it
+**  uses the music buffer allocated with the audio device.
 */
 static void MixMusicToStereo32(int *buffer, int size)
 {
 	if (MusicPlaying) {
 		Assert(MusicChannel.Sample);
+		Assert(size <= MixerBufferSize);
 
-		short *buf = new short[size];
+		short *buf = MusicBuffer;
 		int len = size * sizeof(short);
-		char *tmp = new char[len];
 
 		int div = 176400 / (MusicChannel.Sample->Frequency * (MusicChannel.Sample->SampleSize / 8) * MusicChannel.Sample->Channels);
 
-		size = MusicChannel.Sample->Read(tmp, len / div);
+		size = MusicChannel.Sample->Read(buf, len / div);
 
-		int n = ConvertToStereo32(tmp, (char *)buf, MusicChannel.Sample->Frequency,
+		int n = ConvertToStereo32((char *)buf, MusicChannel.Sample->Frequency,
 								  MusicChannel.Sample->SampleSize / 8, MusicChannel.Sample->Channels, size);
 
 		for (int i = 0; i < n / (int)sizeof(*buf); ++i) {
@@ -154,9 +197,6 @@ static void MixMusicToStereo32(int *buffer, int size)
 			buffer[i] += buf[i] * MusicVolume / MaxVolume / 2;
 		}
 
-		delete[] tmp;
-		delete[] buf;
-
 		if (n < len) { // End reached
 			MusicPlaying = false;
 			delete MusicChannel.Sample;
@@ -172,8 +212,9 @@ static void MixMusicToStereo32(int *buffer, int size)
 /**
 **  Mix sample to buffer.
 **
-**  The input samples are adjusted by the local volume and resampled
-**  to the output frequence.
+**  The input samples are already in the output format (see
+**  ConvertSampleToStereo16), they are only adjusted by the local volume.
+**  The volumes are fixed point, so the loop can be vectorised.
 **
 **  @param sample  Input sample
 **  @param index   Position into input sample
@@ -183,18 +224,15 @@ static void MixMusicToStereo32(int *buffer, int size)
 **  @param size    Size of output buffer (in samples per channel)
 **
 **  @return        The number of bytes used to fill buffer
-**
-**  @todo          Can mix faster if signed 8 bit buffers are used.
 */
-static int MixSampleToStereo32(CSample *sample, int index, unsigned char volume,
+static int MixSampleToStereo32(const CSample &sample, int index, unsigned char volume,
 							   char stereo, int *buffer, int size)
 {
-	static int buf[SOUND_BUFFER_SIZE / 2];
-	unsigned char left;
-	unsigned char right;
+	int left;
+	int right;
 
-	int div = 176400 / (sample->Frequency * (sample->SampleSize / 8) * sample->Channels);
-	int local_volume = (int)volume * EffectsVolume / MaxVolume;
+	Assert(IsSampleStereo16(sample));
+	Assert(!(index & 3));
 
 	if (stereo < 0) {
 		left = 128;
@@ -203,23 +241,19 @@ static int MixSampleToStereo32(CSample *sample, int index, unsigned char volume,
 		left = 128 - stereo;
 		right = 128;
 	}
+	// FIXME: why taking out '/ 2' leads to distortion
+	const int local_volume = (int)volume * EffectsVolume / MaxVolume;
+	const int volumeLeft = (local_volume * left << MixerVolumeShift) / (128 * MaxVolume * 2);
+	const int volumeRight = (local_volume * right << MixerVolumeShift) / (128 * MaxVolume * 2);
+	const short *src = (const short *)(sample.Buffer + index);
 
-	Assert(!(index & 1));
-
-	size = std::min((sample->Len - index) * div / 2, size);
+	size = std::min((sample.Len - index) / (int)sizeof(short), size);
 
-	size = ConvertToStereo32((char *)(sample->Buffer + index), (char *)buf, sample->Frequency,
-							 sample->SampleSize / 8, sample->Channels,
-							 size * 2 / div);
-
-	size /= 2;
 	for (int i = 0; i < size; i += 2) {
-		// FIXME: why taking out '/ 2' leads to distortion
-		buffer[i] += ((short *)buf)[i] * local_volume * left / 128 / MaxVolume / 2;
-		buffer[i + 1] += ((short *)buf)[i + 1] * local_volume * right / 128 / MaxVolume / 2;
+		buffer[i] += (src[i] * volumeLeft) >> MixerVolumeShift;
+		buffer[i + 1] += (src[i + 1] * volumeRight) >> MixerVolumeShift;
 	}
-
-	return 2 * size / div;
+	return size * sizeof(short);
 }
 
 /**
@@ -236,7 +270,7 @@ static int MixChannelsToStereo32(int *buffer, int size)
 
 	for (int channel = 0; channel < MaxChannels; ++channel) {
 		if (Channels[channel].Playing && Channels[channel].Sample) {
-			int i = MixSampleToStereo32(Channels[channel].Sample,
+			int i = MixSampleToStereo32(*Channels[channel].Sample,
 										Channels[channel].Point, Channels[channel].Volume,
 										Channels[channel].Stereo, buffer, size);
 			Channels[channel].Point += i;
@@ -260,12 +294,8 @@ static int MixChannelsToStereo32(int *buffer, int size)
 */
 static void ClipMixToStereo16(const int *mix, int size, short *output)
 {
-	const int *end = mix + size;
-
-	while (mix < end) {
-		int s = (*mix++);
-		clamp(&s, SHRT_MIN, SHRT_MAX);
-		*output++ = s;
+	for (int i = 0; i < size; ++i) {
+		output[i] = std::min<int>(std::max<int>(mix[i], SHRT_MIN), SHRT_MAX);
 	}
 }
 
@@ -274,27 +304,32 @@ static void ClipMixToStereo16(const int *mix, int size, short *output)
 **
 **  @param buffer   Buffer to be filled with samples. Buffer must be big enough.
 **  @param samples  Number of samples.
+**
+**  @note Nothing is allocated here, a request bigger than the mixer
+**  buffer is mixed in several parts.
 */
 static void MixIntoBuffer(void *buffer, int samples)
 {
-	if (samples > MixerBufferSize) {
-		delete[] MixerBuffer;
-		MixerBuffer = new int[samples];
-		MixerBufferSize = samples;
-	}
+	short *output = (short *)buffer;
 
-	// FIXME: can save the memset here, if first channel sets the values
-	memset(MixerBuffer, 0, samples * sizeof(*MixerBuffer));
+	while (samples > 0) {
+		const int size = std::min(samples, MixerBufferSize);
 
-	if (EffectsEnabled) {
-		// Add channels to mixer buffer
-		MixChannelsToStereo32(MixerBuffer, samples);
-	}
-	if (MusicEnabled) {
-		// Add music to mixer buffer
-		MixMusicToStereo32(MixerBuffer, samples);
+		// FIXME: can save the memset here, if first channel sets the values
+		memset(MixerBuffer, 0, size * sizeof(*MixerBuffer));
+
+		if (EffectsEnabled) {
+			// Add channels to mixer buffer
+			MixChannelsToStereo32(MixerBuffer, size);
+		}
+		if (MusicEnabled) {
+			// Add music to mixer buffer
+			MixMusicToStereo32(MixerBuffer, size);
+		}
+		ClipMixToStereo16(MixerBuffer, size, output);
+		output += size;
+		samples -= size;
 	}
-	ClipMixToStereo16(MixerBuffer, samples, (short *)buffer);
 }
 
 /**
@@ -529,7 +564,9 @@ CSample *LoadSample(const std::string &name)
 
 	if (sample == NULL) {
 		fprintf(stderr, "Can't load the sound `%s'\n", name.c_str());
+		return NULL;
 	}
+	ConvertSampleToStereo16(*sample);
 	return sample;
 }
 
@@ -544,6 +581,10 @@ int PlaySample(CSample *sample, Origin *origin)
 {
 	int channel = -1;
 
+	if (sample) {
+		// Samples not coming from LoadSample are converted here, once.
+		ConvertSampleToStereo16(*sample);
+	}
 	SDL_LockAudio();
 	if (SoundEnabled() && EffectsEnabled && sample && NextFreeChannel != MaxChannels) {
 		channel = FillChannel(sample, EffectsVolume, 0, origin);
@@ -769,6 +810,10 @@ static int InitSdlSound(int freq, int size)
 		fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
 		return -1;
 	}
+	//  Mixer buffers are allocated here, never in the audio callback
+	MixerBufferSize = wanted.samples * wanted.channels;
+	MixerBuffer = new int[MixerBufferSize];
+	MusicBuffer = new short[MixerBufferSize];
 	SDL_PauseAudio(0);
 	return 0;
 }
@@ -807,6 +852,9 @@ void QuitSound()
 	SoundInitialized = false;
 	delete[] MixerBuffer;
 	MixerBuffer = NULL;
+	delete[] MusicBuffer;
+	MusicBuffer = NULL;
+	MixerBufferSize = 0;
 }
 
 //@}
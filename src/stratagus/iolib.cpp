@@ -62,6 +62,7 @@ public:
 	~PImpl();
 
 	int open(const char *name, long flags);
+	int open(std::string &buffer);
 	int close();
 	void flush();
 	int read(void *buf, size_t len);
@@ -82,6 +83,7 @@ private:
 #ifdef USE_BZ2LIB
 	BZFILE *cl_bz;   /// bzip2 file pointer
 #endif // !USE_BZ2LIB
+	std::string *cl_buffer; /// memory buffer
 };
 
 CFile::CFile() : pimpl(new CFile::PImpl)
@@ -107,6 +109,16 @@ int CFile::open(const char *name, long flags)
 	return pimpl->open(name, flags);
 }
 
+/**
+**  Open a memory buffer for writing, the data is appended to it.
+**
+**  @param buffer  Buffer to write to, it must outlive the file.
+*/
+int CFile::open(std::string &buffer)
+{
+	return pimpl->open(buffer);
+}
+
 /**
 **  CLclose Library file close
 */
@@ -131,6 +143,17 @@ int CFile::read(void *buf, size_t len)
 	return pimpl->read(buf, len);
 }
 
+/**
+**  CLwrite Library file write
+**
+**  @param buf  Pointer to the data to write.
+**  @param len  number of bytes to write.
+*/
+int CFile::write(const void *buf, size_t len)
+{
+	return pimpl->write(buf, len);
+}
+
 /**
 **  CLseek Library file seek
 **
@@ -198,6 +221,7 @@ int CFile::printf(const char *format, ...)
 CFile::PImpl::PImpl()
 {
 	cl_type = CLF_TYPE_INVALID;
+	cl_buffer = NULL;
 }
 
 CFile::PImpl::~PImpl()
@@ -347,6 +371,13 @@ int CFile::PImpl::open(const char *name, long openflags)
 	return 0;
 }
 
+int CFile::PImpl::open(std::string &buffer)
+{
+	cl_type = CLF_TYPE_BUFFER;
+	cl_buffer = &buffer;
+	return 0;
+}
+
 int CFile::PImpl::close()
 {
 	int ret = EOF;
@@ -367,6 +398,10 @@ int CFile::PImpl::close()
 			ret = 0;
 		}
 #endif // USE_BZ2LIB
+		if (tp == CLF_TYPE_BUFFER) {
+			cl_buffer = NULL;
+			ret = 0;
+		}
 	} else {
 		errno = EBADF;
 	}
@@ -438,6 +473,10 @@ int CFile::PImpl::write(const void *buf, size_t size)
 			ret = BZ2_bzwrite(cl_bz, const_cast<void *>(buf), size);
 		}
 #endif // USE_BZ2LIB
+		if (tp == CLF_TYPE_BUFFER) {
+			cl_buffer->append(static_cast<const char *>(buf), size);
+			ret = size;
+		}
 	} else {
 		errno = EBADF;
 	}
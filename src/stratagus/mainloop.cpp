@@ -36,6 +36,7 @@
 #include "stratagus.h"
 
 #include "actions.h"
+#include "benchmark.h"
 #include "editor.h"
 #include "game.h"
 #include "map.h"
@@ -45,6 +46,7 @@
 #include "replay.h"
 #include "results.h"
 #include "sound.h"
+#include "sync_digest.h"
 #include "trigger.h"
 #include "ui.h"
 #include "unit.h"
@@ -155,6 +157,8 @@ void DrawMapArea()
 		}
 		vp->Draw();
 	}
+	// The viewports have redrawn the changed terrain.
+	Map.ClearTerrainChanges();
 }
 
 /**
@@ -236,13 +240,18 @@ static void GameLogicLoop()
 	// Game logic part
 	//
 	if (!GamePaused && NetworkInSync && !SkipGameCycle) {
+		SaveReplayKeyframe();
 		SinglePlayerReplayEachCycle();
 		++GameCycle;
 		MultiPlayerReplayEachCycle();
 		NetworkCommands(); // Get network commands
+		BenchmarkLap(BenchmarkUnitActions);
 		UnitActions();      // handle units
+		BenchmarkLap(BenchmarkMissileActions);
 		MissileActions();   // handle missiles
+		BenchmarkLap(BenchmarkPlayersEachCycle);
 		PlayersEachCycle(); // handle players
+		BenchmarkLap(BenchmarkOther);
 		UpdateTimer();      // update game timer
 
 		//
@@ -258,9 +267,11 @@ static void GameLogicLoop()
 		switch (GameCycle % CYCLES_PER_SECOND) {
 			case 0: // At cycle 0, start all ai players...
 				if (GameCycle == 0) {
+					BenchmarkLap(BenchmarkPlayersEachSecond);
 					for (int player = 0; player < NumPlayers; ++player) {
 						PlayersEachSecond(player);
 					}
+					BenchmarkLap(BenchmarkOther);
 				}
 				break;
 			case 1:
@@ -283,7 +294,9 @@ static void GameLogicLoop()
 				int player = (GameCycle % CYCLES_PER_SECOND) - 7;
 				Assert(player >= 0);
 				if (player < NumPlayers) {
+					BenchmarkLap(BenchmarkPlayersEachSecond);
 					PlayersEachSecond(player);
+					BenchmarkLap(BenchmarkOther);
 				}
 			}
 		}
@@ -293,8 +306,10 @@ static void GameLogicLoop()
 	UpdateMessages();     // update messages
 	ParticleManager.update(); // handle particles
 	CheckMusicFinished(); // Check for next song
+	BenchmarkEachCycle(); // stop the benchmark when done
 
-	if (FastForwardCycle <= GameCycle || !(GameCycle & 0x3f)) {
+	// The headless benchmark neither waits nor polls the events.
+	if (!BenchmarkCycles && (FastForwardCycle <= GameCycle || !(GameCycle & 0x3f))) {
 		WaitEventsOneFrame();
 	}
 
@@ -373,7 +388,9 @@ static void DisplayLoop()
 static void SingleGameLoop()
 {
 	while (GameRunning) {
-		DisplayLoop();
+		if (!BenchmarkCycles) {
+			DisplayLoop();
+		}
 		GameLogicLoop();
 	}
 }
@@ -408,11 +425,22 @@ void GameMainLoop()
 #endif
 
 	CclCommand("if (GameStarting ~= nil) then GameStarting() end");
+	InitSyncDigest();
+
+	if (BenchmarkCycles) {
+		BenchmarkGameStarting();
+	}
 
 	MultiPlayerReplayEachCycle();
 
 	SingleGameLoop();
 
+	if (BenchmarkCycles) {
+		BenchmarkReport();
+		Exit(0);
+		return;
+	}
+
 	//
 	// Game over
 	//
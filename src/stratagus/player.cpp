@@ -45,7 +45,9 @@
 #include "map.h"
 #include "network.h"
 #include "netconnect.h"
+#include "snapshot.h"
 #include "sound.h"
+#include "sync_digest.h"
 #include "translate.h"
 #include "unitsound.h"
 #include "unittype.h"
@@ -565,6 +567,174 @@ void CPlayer::Save(CFile &file) const
 	DebugPrint("FIXME: must save unit-stats?\n");
 }
 
+/**
+**  Save players to a snapshot.
+**
+**  @param snapshot  Output snapshot.
+*/
+void SavePlayers(CSnapshotWriter &snapshot)
+{
+	snapshot.Varint(NumPlayers);
+	for (int i = 0; i < NumPlayers; ++i) {
+		Players[i].Save(snapshot);
+	}
+	snapshot.Varint(ThisPlayer->Index);
+}
+
+/**
+**  Load players from a snapshot.
+**
+**  @param snapshot  Input snapshot.
+*/
+void LoadPlayers(CSnapshotReader &snapshot)
+{
+	const int numPlayers = snapshot.Varint();
+	if (numPlayers > PlayerMax) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	for (int i = 0; i < numPlayers; ++i) {
+		CPlayer &player = Players[i];
+
+		player.Index = i;
+		player.Load(snapshot);
+	}
+	if (NumPlayers < numPlayers) {
+		NumPlayers = numPlayers;
+	}
+	const int thisPlayer = snapshot.Varint();
+	if (thisPlayer >= PlayerMax) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	ThisPlayer = &Players[thisPlayer];
+}
+
+static void SaveValues(CSnapshotWriter &snapshot, const int *values, int count)
+{
+	snapshot.Varint(count);
+	for (int i = 0; i != count; ++i) {
+		snapshot.Int(values[i]);
+	}
+}
+
+static void LoadValues(CSnapshotReader &snapshot, int *values, int count)
+{
+	if (snapshot.Varint() != (unsigned long)count) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	for (int i = 0; i != count; ++i) {
+		values[i] = snapshot.Int();
+	}
+}
+
+void CPlayer::Save(CSnapshotWriter &snapshot) const
+{
+	snapshot.String(this->Name);
+	snapshot.Int(this->Type);
+	snapshot.String(PlayerRaces.Name[this->Race]);
+	snapshot.String(this->AiName);
+	snapshot.Int(this->Team);
+	snapshot.Varint(this->Enemy);
+	snapshot.Varint(this->Allied);
+	snapshot.Varint(this->SharedVision);
+	snapshot.Pos(this->StartPos);
+
+	SaveValues(snapshot, this->Resources, MaxCosts);
+	SaveValues(snapshot, this->StoredResources, MaxCosts);
+	SaveValues(snapshot, this->MaxResources, MaxCosts);
+	SaveValues(snapshot, this->LastResources, MaxCosts);
+	SaveValues(snapshot, this->Incomes, MaxCosts);
+	SaveValues(snapshot, this->Revenue, MaxCosts);
+	snapshot.Bool(this->AiEnabled);
+
+	snapshot.Int(this->Supply);
+	snapshot.Int(this->UnitLimit);
+	snapshot.Int(this->BuildingLimit);
+	snapshot.Int(this->TotalUnitLimit);
+	snapshot.Int(this->Score);
+	snapshot.Int(this->TotalUnits);
+	snapshot.Int(this->TotalBuildings);
+	SaveValues(snapshot, this->TotalResources, MaxCosts);
+	snapshot.Int(this->TotalRazings);
+	snapshot.Int(this->TotalKills);
+	SaveValues(snapshot, this->SpeedResourcesHarvest, MaxCosts);
+	SaveValues(snapshot, this->SpeedResourcesReturn, MaxCosts);
+	snapshot.Int(this->SpeedBuild);
+	snapshot.Int(this->SpeedTrain);
+	snapshot.Int(this->SpeedUpgrade);
+	snapshot.Int(this->SpeedResearch);
+
+	Uint8 r, g, b;
+
+	SDL_GetRGB(this->Color, TheScreen->format, &r, &g, &b);
+	snapshot.Varint(r);
+	snapshot.Varint(g);
+	snapshot.Varint(b);
+
+	SaveValues(snapshot, this->UpgradeTimers.Upgrades, UpgradeMax);
+}
+
+void CPlayer::Load(CSnapshotReader &snapshot)
+{
+	this->Units.resize(0);
+	this->FreeWorkers.resize(0);
+
+	this->SetName(snapshot.String());
+	this->Type = snapshot.Int();
+	this->Race = PlayerRaces.GetRaceIndexByName(snapshot.String().c_str());
+	if (this->Race == -1) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	this->AiName = snapshot.String();
+	this->Team = snapshot.Int();
+	this->Enemy = snapshot.Varint();
+	this->Allied = snapshot.Varint();
+	this->SharedVision = snapshot.Varint();
+	this->StartPos = snapshot.Pos();
+
+	LoadValues(snapshot, this->Resources, MaxCosts);
+	LoadValues(snapshot, this->StoredResources, MaxCosts);
+	LoadValues(snapshot, this->MaxResources, MaxCosts);
+	LoadValues(snapshot, this->LastResources, MaxCosts);
+	LoadValues(snapshot, this->Incomes, MaxCosts);
+	LoadValues(snapshot, this->Revenue, MaxCosts);
+	this->AiEnabled = snapshot.Bool();
+
+	this->Supply = snapshot.Int();
+	this->UnitLimit = snapshot.Int();
+	this->BuildingLimit = snapshot.Int();
+	this->TotalUnitLimit = snapshot.Int();
+	this->Score = snapshot.Int();
+	this->TotalUnits = snapshot.Int();
+	this->TotalBuildings = snapshot.Int();
+	LoadValues(snapshot, this->TotalResources, MaxCosts);
+	this->TotalRazings = snapshot.Int();
+	this->TotalKills = snapshot.Int();
+	LoadValues(snapshot, this->SpeedResourcesHarvest, MaxCosts);
+	LoadValues(snapshot, this->SpeedResourcesReturn, MaxCosts);
+	this->SpeedBuild = snapshot.Int();
+	this->SpeedTrain = snapshot.Int();
+	this->SpeedUpgrade = snapshot.Int();
+	this->SpeedResearch = snapshot.Int();
+
+	const int r = snapshot.Varint();
+	const int g = snapshot.Varint();
+	const int b = snapshot.Varint();
+	this->Color = Video.MapRGB(TheScreen->format, r, g, b);
+
+	LoadValues(snapshot, this->UpgradeTimers.Upgrades, UpgradeMax);
+
+	// Manage max
+	for (int i = 0; i < MaxCosts; ++i) {
+		if (this->MaxResources[i] != -1) {
+			this->SetResource(i, this->Resources[i] + this->StoredResources[i], STORE_BOTH);
+		}
+	}
+}
+
 /**
 **  Create a new player.
 **
@@ -750,6 +920,7 @@ void CPlayer::Clear()
 	memset(StoredResources, 0, sizeof(StoredResources));
 	memset(MaxResources, 0, sizeof(MaxResources));
 	memset(LastResources, 0, sizeof(LastResources));
+	SyncValue = 0;
 	memset(Incomes, 0, sizeof(Incomes));
 	memset(Revenue, 0, sizeof(Revenue));
 	memset(UnitTypesCount, 0, sizeof(UnitTypesCount));
@@ -904,6 +1075,7 @@ void CPlayer::ChangeResource(const int resource, const int value, const bool sto
 			this->Resources[resource] += value;
 		}
 	}
+	UpdateSyncDigest(*this);
 }
 
 /**
@@ -928,6 +1100,7 @@ void CPlayer::SetResource(const int resource, const int value, const int type)
 	} else if (type == STORE_OVERALL) {
 		this->Resources[resource] = value;
 	}
+	UpdateSyncDigest(*this);
 }
 
 /**
@@ -215,7 +215,20 @@ int LuaLoadFile(const std::string &file)
 	if (GetFileContent(file, content) == false) {
 		return -1;
 	}
-	const int status = luaL_loadbuffer(Lua, content.c_str(), content.size(), file.c_str());
+	return LuaLoadBuffer(content, file);
+}
+
+/**
+**  Load a chunk and execute it
+**
+**  @param content  Content of the chunk
+**  @param name     Name of the chunk, used in the error messages
+**
+**  @return         0 for success, else exit.
+*/
+int LuaLoadBuffer(const std::string &content, const std::string &name)
+{
+	const int status = luaL_loadbuffer(Lua, content.c_str(), content.size(), name.c_str());
 
 	if (!status) {
 		LuaCall(0, 1);
@@ -180,6 +180,7 @@ extern void beos_init(int argc, char **argv);
 #include "stratagus.h"
 
 #include "ai.h"
+#include "benchmark.h"
 #include "editor.h"
 #include "game.h"
 #include "guichan.h"
@@ -190,6 +191,7 @@ extern void beos_init(int argc, char **argv);
 #include "netconnect.h"
 #include "network.h"
 #include "parameters.h"
+#include "pathfinder.h"
 #include "player.h"
 #include "replay.h"
 #include "results.h"
@@ -433,6 +435,13 @@ static void Usage()
 	printf(
 		"\n\nUsage: %s [OPTIONS] [map.smp|map.smp.gz]\n"
 		"\t-a\t\tEnables asserts check in engine code (for debugging)\n"
+		"\t-b scenario\tBenchmark scenario: map, ai, replay (map is a replay),\n"
+		"\t\t\tarmies, harvest, pathing or lockstep (default map)\n"
+		"\t\t\tlockstep runs the network between clients in memory,\n"
+		"\t\t\tmap is its settings: clients=4,latency=20,jitter=0,\n"
+		"\t\t\treorder=0,loss=0,every=30,seed=1\n"
+		"\t-B cycles\tRun the map for cycles without display nor sound,\n"
+		"\t\t\tprint the time of each part of the game cycle and exit\n"
 		"\t-c file.lua\tConfiguration start file (default stratagus.lua)\n"
 		"\t-d datapath\tPath to stratagus data (default current directory)\n"
 		"\t-D depth\tVideo mode depth = pixel per point\n"
@@ -452,6 +461,7 @@ static void Usage()
 		"\t-P port\t\tNetwork port to use\n"
 		"\t-s sleep\tNumber of frames for the AI to sleep before it starts\n"
 		"\t-S speed\tSync speed (100 = 30 frames/s)\n"
+		"\t-T threads\tNumber of threads searching the paths (default 1)\n"
 		"\t-u userpath\tPath where stratagus saves preferences, log and savegame\n"
 		"\t-v mode\t\tVideo mode resolution in format <xres>x<yres>\n"
 		"\t-W\t\tWindowed video mode\n"
@@ -508,10 +518,16 @@ static void RedirectOutput()
 void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 {
 	for (;;) {
-		switch (getopt(argc, argv, "ac:d:D:eE:FhiI:lN:oOP:ps:S:u:v:WZ?")) {
+		switch (getopt(argc, argv, "ab:B:c:d:D:eE:FhiI:lN:oOP:ps:S:T:u:v:WZ?")) {
 			case 'a':
 				EnableAssert = true;
 				continue;
+			case 'b':
+				BenchmarkScenario = optarg;
+				continue;
+			case 'B':
+				BenchmarkCycles = strtoul(optarg, NULL, 0);
+				continue;
 			case 'c':
 				parameters.luaStartFilename = optarg;
 				continue;
@@ -575,6 +591,9 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 			case 'S':
 				VideoSyncSpeed = atoi(optarg);
 				continue;
+			case 'T':
+				PathfinderThreads = std::max(1, atoi(optarg));
+				continue;
 			case 'u':
 				Parameters::Instance.SetUserDirectory(optarg);
 				continue;
@@ -703,11 +722,21 @@ int stratagusMain(int argc, char **argv)
 	PrintHeader();
 	PrintLicense();
 
+	if (BenchmarkCycles) {
+		// Nothing is displayed nor played: use the dummy drivers of SDL.
+		SDL_putenv(strdup("SDL_VIDEODRIVER=dummy"));
+		SDL_putenv(strdup("SDL_AUDIODRIVER=dummy"));
+#if defined(USE_OPENGL) || defined(USE_GLES)
+		ForceUseOpenGL = 1;
+		UseOpenGL = 0;
+#endif
+	}
+
 	// Setup video display
 	InitVideo();
 
 	// Setup sound card
-	if (!InitSound()) {
+	if (!BenchmarkCycles && !InitSound()) {
 		InitMusic();
 	}
 
@@ -720,7 +749,9 @@ int stratagusMain(int argc, char **argv)
 	LoadFonts();
 	SetClipping(0, 0, Video.Width - 1, Video.Height - 1);
 	Video.ClearScreen();
-	ShowTitleScreens();
+	if (!BenchmarkCycles) {
+		ShowTitleScreens();
+	}
 
 	// Init player data
 	ThisPlayer = NULL;
@@ -731,7 +762,11 @@ int stratagusMain(int argc, char **argv)
 	UnitManager.Init(); // Units memory management
 	PreMenuSetup();     // Load everything needed for menus
 
-	MenuLoop();
+	if (BenchmarkCycles) {
+		BenchmarkMain(CliMapName);
+	} else {
+		MenuLoop();
+	}
 
 	Exit(0);
 	return 0;
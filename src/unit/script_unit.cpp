@@ -416,6 +416,8 @@ static int CclUnit(lua_State *l)
 		} else if (!strcmp(value, "ttl")) {
 			// FIXME : unsigned long should be better handled
 			unit->TTL = LuaToNumber(l, 2, j + 1);
+		} else if (!strcmp(value, "target-scan-cycle")) {
+			unit->TargetScanCycle = LuaToNumber(l, 2, j + 1);
 		} else if (!strcmp(value, "threshold")) {
 			// FIXME : unsigned long should be better handled
 			unit->Threshold = LuaToNumber(l, 2, j + 1);
@@ -1064,6 +1066,36 @@ static int CclSlotUsage(lua_State *l)
 	return 0;
 }
 
+/**
+**  Set the enter cycles of the unit buckets of a loaded game.
+**
+**  @param l  Lua state.
+*/
+static int CclUnitBucketEnterCycles(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	if (!lua_istable(l, 1)) {
+		LuaError(l, "incorrect argument");
+	}
+	const int args = lua_rawlen(l, 1);
+	if (args % 4) {
+		LuaError(l, "incorrect argument");
+	}
+	for (int j = 0; j < args; j += 4) {
+		const int x = LuaToNumber(l, 1, j + 1);
+		const int y = LuaToNumber(l, 1, j + 2);
+		const int player = LuaToNumber(l, 1, j + 3);
+		const unsigned long cycle = LuaToUnsignedNumber(l, 1, j + 4);
+
+		if (x < 0 || x >= Map.UnitBuckets.GetWidth() || y < 0 || y >= Map.UnitBuckets.GetHeight()
+			|| player < 0 || player >= PlayerMax) {
+			LuaError(l, "Bucket out of range: %d %d %d" _C_ x _C_ y _C_ player);
+		}
+		Map.UnitBuckets.SetEnterCycle(x, y, player, cycle);
+	}
+	return 0;
+}
+
 /**
 **  Register CCL features for unit.
 */
@@ -1092,6 +1124,7 @@ void UnitCclRegister()
 	lua_register(Lua, "SetUnitVariable", CclSetUnitVariable);
 
 	lua_register(Lua, "SlotUsage", CclSlotUsage);
+	lua_register(Lua, "UnitBucketEnterCycles", CclUnitBucketEnterCycles);
 }
 
 //@}
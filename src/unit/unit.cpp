@@ -55,6 +55,8 @@
 #include "sound.h"
 #include "sound_server.h"
 #include "spells.h"
+#include "sync_digest.h"
+#include "tileset.h"
 #include "translate.h"
 #include "ui.h"
 #include "unit_find.h"
@@ -400,6 +402,7 @@ void CUnit::Init()
 {
 	Refs = 0;
 	ReleaseCycle = 0;
+	SyncValue = 0;
 	PlayerSlot = static_cast<size_t>(-1);
 	InsideCount = 0;
 	BoardCount = 0;
@@ -431,6 +434,7 @@ void CUnit::Init()
 	Direction = 0;
 	DamagedType = ANIMATIONS_DEATHTYPES;
 	Attacked = 0;
+	TargetScanCycle = 0;
 	Burning = 0;
 	Destroyed = 0;
 	Removed = 0;
@@ -491,6 +495,7 @@ void CUnit::Release(bool final)
 
 		// Are more references remaining?
 		Destroyed = 1; // mark as destroyed
+		UpdateSyncDigest(*this);
 
 		if (Container && !final) {
 			if (Boarded) {
@@ -862,6 +867,63 @@ void MapUnmarkUnitSight(CUnit &unit)
 	}
 }
 
+/**
+**  Move on vision table the Sight of the unit
+**  (and units inside for transporter (recursively))
+**
+**  @param unit    Unit to move the sight of.
+**  @param oldPos  coord the sight was marked at.
+**  @param newPos  coord of first container of unit.
+**  @param width   Width of the first container of unit.
+**  @param height  Height of the first container of unit.
+*/
+static void MapMoveUnitSightRec(const CUnit &unit, const Vec2i &oldPos, const Vec2i &newPos,
+								int width, int height)
+{
+	const int range = unit.Container ? unit.Container->CurrentSightRange : unit.CurrentSightRange;
+
+	MapSightMove(*unit.Player, oldPos, newPos, width, height, range,
+				 MapUnmarkTileSight, MapMarkTileSight);
+	if (unit.Type && unit.Type->DetectCloak) {
+		MapSightMove(*unit.Player, oldPos, newPos, width, height, range,
+					 MapUnmarkTileDetectCloak, MapMarkTileDetectCloak);
+	}
+
+	CUnit *unit_inside = unit.UnitInside;
+	for (int i = unit.InsideCount; i--; unit_inside = unit_inside->NextContained) {
+		MapMoveUnitSightRec(*unit_inside, oldPos, newPos, width, height);
+	}
+}
+
+/**
+**  Move on vision table the Sight of a unit on the map
+**  (and units inside for transporter), from its previous position.
+**
+**  @param unit    unit to move its vision, already at its new position.
+**  @param oldPos  previous position of the unit.
+*/
+static void MapMoveUnitSight(CUnit &unit, const Vec2i &oldPos)
+{
+	Assert(unit.Type);
+	Assert(!unit.Container);
+
+	MapMoveUnitSightRec(unit, oldPos, unit.tilePos, unit.Type->TileWidth, unit.Type->TileHeight);
+
+	if (!unit.IsUnusable()) {
+		const int radar = unit.Stats->Variables[RADAR_INDEX].Value;
+		const int radarJammer = unit.Stats->Variables[RADARJAMMER_INDEX].Value;
+
+		if (radar) {
+			MapSightMove(*unit.Player, oldPos, unit.tilePos, unit.Type->TileWidth,
+						 unit.Type->TileHeight, radar, MapUnmarkTileRadar, MapMarkTileRadar);
+		}
+		if (radarJammer) {
+			MapSightMove(*unit.Player, oldPos, unit.tilePos, unit.Type->TileWidth,
+						 unit.Type->TileHeight, radarJammer, MapUnmarkTileRadarJammer, MapMarkTileRadarJammer);
+		}
+	}
+}
+
 /**
 **  Update the Unit Current sight range to good value and transported units inside.
 **
@@ -898,6 +960,24 @@ void UpdateUnitSightRange(CUnit &unit)
 	}
 }
 
+/**
+**  Tell the pathfinder that the unit changed the passability of its fields.
+**
+**  @param unit  unit (un)marked on the map.
+*/
+static void UnitFieldFlagsChanged(const CUnit &unit)
+{
+	// Only buildings and alike block the way, other units are moving obstacles.
+	if ((unit.Type->FieldFlags & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit)) == 0) {
+		return;
+	}
+	for (int y = 0; y < unit.Type->TileHeight; ++y) {
+		for (int x = 0; x < unit.Type->TileWidth; ++x) {
+			PathfinderMapChanged(unit.tilePos + Vec2i(x, y));
+		}
+	}
+}
+
 /**
 **  Mark the field with the FieldFlags.
 **
@@ -922,6 +1002,7 @@ void MarkUnitFieldFlags(const CUnit &unit)
 		} while (--w);
 		index += Map.Info.MapWidth;
 	} while (--h);
+	UnitFieldFlagsChanged(unit);
 }
 
 class _UnmarkUnitFieldFlags
@@ -969,6 +1050,7 @@ void UnmarkUnitFieldFlags(const CUnit &unit)
 		} while (--w);
 		index += Map.Info.MapWidth;
 	} while (--h);
+	UnitFieldFlagsChanged(unit);
 }
 
 /**
@@ -1048,7 +1130,13 @@ static void UnitInXY(CUnit &unit, const Vec2i &pos)
 */
 void CUnit::MoveToXY(const Vec2i &pos)
 {
-	MapUnmarkUnitSight(*this);
+	const Vec2i oldPos = tilePos;
+	// A step to a neighbour tile only changes the edge of the sight.
+	const bool step = !Container && abs(pos.x - oldPos.x) <= 1 && abs(pos.y - oldPos.y) <= 1;
+
+	if (!step) {
+		MapUnmarkUnitSight(*this);
+	}
 	Map.Remove(*this);
 	UnmarkUnitFieldFlags(*this);
 
@@ -1058,6 +1146,12 @@ void CUnit::MoveToXY(const Vec2i &pos)
 
 	Map.Insert(*this);
 	MarkUnitFieldFlags(*this);
+	if (step) {
+		MapMoveUnitSight(*this, oldPos);
+		//  Recalculate the seen count.
+		UnitCountSeen(*this);
+		return;
+	}
 	//  Recalculate the seen count.
 	UnitCountSeen(*this);
 	MapMarkUnitSight(*this);
@@ -1511,7 +1605,7 @@ void UnitCountSeen(CUnit &unit)
 				int x = width;
 				do {
 					if (unit.Type->PermanentCloak && unit.Player != &Players[p]) {
-						if (mf->playerInfo.VisCloak[p]) {
+						if (Map.VisCloak[p][mf->playerInfo.Index]) {
 							newv++;
 						}
 					} else {
@@ -1684,7 +1778,13 @@ void CUnit::ChangeOwner(CPlayer &newplayer)
 	}
 
 	MapUnmarkUnitSight(*this);
+	if (!Removed) {
+		Map.UnitBuckets.Remove(*this);
+	}
 	newplayer.AddUnit(*this);
+	if (!Removed) {
+		Map.UnitBuckets.Insert(*this);
+	}
 	Stats = &Type->Stats[newplayer.Index];
 	UpdateUnitSightRange(*this);
 	MapMarkUnitSight(*this);
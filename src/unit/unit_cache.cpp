@@ -42,7 +42,9 @@
 #include "stratagus.h"
 #include "unit.h"
 #include "unittype.h"
+#include "iolib.h"
 #include "map.h"
+#include "snapshot.h"
 
 /**
 **  Insert new unit into cache.
@@ -57,6 +59,7 @@ void CMap::Insert(CUnit &unit)
 	const int h = unit.Type->TileHeight;
 	int j, i = h;
 
+	UnitBuckets.Insert(unit);
 	do {
 		CMapField *mf = Field(index);
 		j = w;
@@ -81,6 +84,7 @@ void CMap::Remove(CUnit &unit)
 	const int h = unit.Type->TileHeight;
 	int j, i = h;
 
+	UnitBuckets.Remove(unit);
 	do {
 		CMapField *mf = Field(index);
 		j = w;
@@ -93,6 +97,209 @@ void CMap::Remove(CUnit &unit)
 }
 
 
+/**
+**  Allocate the bucket grid.
+**
+**  @param mapWidth   Width of the map in tiles.
+**  @param mapHeight  Height of the map in tiles.
+*/
+void CUnitBucketGrid::Init(int mapWidth, int mapHeight)
+{
+	Width = (mapWidth + BucketSize - 1) >> BucketShift;
+	Height = (mapHeight + BucketSize - 1) >> BucketShift;
+	Buckets.clear();
+	Buckets.resize(Width * Height);
+}
+
+/**
+**  Free the bucket grid.
+*/
+void CUnitBucketGrid::Clean()
+{
+	Width = 0;
+	Height = 0;
+	Buckets.clear();
+}
+
+/**
+**  Insert a unit into the buckets it overlaps.
+**
+**  @param unit  Unit to insert, at its current position.
+*/
+void CUnitBucketGrid::Insert(CUnit &unit)
+{
+	const int playerIndex = unit.Player->Index;
+	const int minx = unit.tilePos.x >> BucketShift;
+	const int miny = unit.tilePos.y >> BucketShift;
+	const int maxx = std::min<int>(unit.tilePos.x + unit.Type->TileWidth - 1, Map.Info.MapWidth - 1) >> BucketShift;
+	const int maxy = std::min<int>(unit.tilePos.y + unit.Type->TileHeight - 1, Map.Info.MapHeight - 1) >> BucketShift;
+
+	for (int y = miny; y <= maxy; ++y) {
+		for (int x = minx; x <= maxx; ++x) {
+			CBucket &bucket = Buckets[x + y * Width];
+
+			bucket.Units.push_back(&unit);
+			++bucket.PlayerCount[playerIndex];
+			bucket.PlayerMask |= 1 << playerIndex;
+			bucket.EnterCycle[playerIndex] = GameCycle;
+		}
+	}
+}
+
+/**
+**  Remove a unit from the buckets it overlaps.
+**
+**  @param unit  Unit to remove, at the position it was inserted.
+*/
+void CUnitBucketGrid::Remove(CUnit &unit)
+{
+	const int playerIndex = unit.Player->Index;
+	const int minx = unit.tilePos.x >> BucketShift;
+	const int miny = unit.tilePos.y >> BucketShift;
+	const int maxx = std::min<int>(unit.tilePos.x + unit.Type->TileWidth - 1, Map.Info.MapWidth - 1) >> BucketShift;
+	const int maxy = std::min<int>(unit.tilePos.y + unit.Type->TileHeight - 1, Map.Info.MapHeight - 1) >> BucketShift;
+
+	for (int y = miny; y <= maxy; ++y) {
+		for (int x = minx; x <= maxx; ++x) {
+			CBucket &bucket = Buckets[x + y * Width];
+			std::vector<CUnit *>::iterator it = std::find(bucket.Units.begin(), bucket.Units.end(), &unit);
+
+			Assert(it != bucket.Units.end());
+			*it = bucket.Units.back();
+			bucket.Units.pop_back();
+			Assert(bucket.PlayerCount[playerIndex]);
+			if (--bucket.PlayerCount[playerIndex] == 0) {
+				bucket.PlayerMask &= ~(1 << playerIndex);
+			}
+		}
+	}
+}
+
+/**
+**  Save the enter cycles of the buckets to a snapshot.
+**
+**  Only the cycles of the players with units in a bucket are saved, as
+**  x, y, player and cycle.
+**
+**  @param snapshot  Output snapshot.
+*/
+void CUnitBucketGrid::Save(CSnapshotWriter &snapshot) const
+{
+	unsigned long count = 0;
+	for (size_t i = 0; i != Buckets.size(); ++i) {
+		for (int p = 0; p != PlayerMax; ++p) {
+			count += (Buckets[i].PlayerMask >> p) & 1;
+		}
+	}
+	snapshot.Varint(count);
+	for (int y = 0; y != Height; ++y) {
+		for (int x = 0; x != Width; ++x) {
+			const CBucket &bucket = Buckets[x + y * Width];
+
+			for (int p = 0; p != PlayerMax; ++p) {
+				if (bucket.PlayerMask & (1 << p)) {
+					snapshot.Pos(Vec2i(x, y));
+					snapshot.Varint(p);
+					snapshot.Varint(bucket.EnterCycle[p]);
+				}
+			}
+		}
+	}
+}
+
+/**
+**  Load the enter cycles of the buckets from a snapshot.
+**
+**  The units are not placed yet: the cycles are set as saved, and kept
+**  by LoadGame when it places the units.
+**
+**  @param snapshot  Input snapshot.
+*/
+void CUnitBucketGrid::Load(CSnapshotReader &snapshot)
+{
+	const unsigned long count = snapshot.Varint();
+	for (unsigned long i = 0; i != count && !snapshot.IsCorrupted(); ++i) {
+		const Vec2i pos = snapshot.Pos();
+		const unsigned long player = snapshot.Varint();
+		const unsigned long cycle = snapshot.Varint();
+
+		if (pos.x < 0 || pos.x >= Width || pos.y < 0 || pos.y >= Height || player >= PlayerMax) {
+			snapshot.SetCorrupted();
+			return;
+		}
+		SetEnterCycle(pos.x, pos.y, player, cycle);
+	}
+}
+
+/**
+**  Save the enter cycles of the buckets in a Lua saved game.
+**
+**  Like in the snapshots, only the cycles of the players with units in
+**  a bucket are saved, as x, y, player and cycle.
+**
+**  @param file  Output file.
+*/
+void CUnitBucketGrid::Save(CFile &file) const
+{
+	file.printf("UnitBucketEnterCycles({");
+	for (int y = 0; y != Height; ++y) {
+		for (int x = 0; x != Width; ++x) {
+			const CBucket &bucket = Buckets[x + y * Width];
+
+			for (int p = 0; p != PlayerMax; ++p) {
+				if (bucket.PlayerMask & (1 << p)) {
+					file.printf("\n  %d, %d, %d, %lu,", x, y, p, bucket.EnterCycle[p]);
+				}
+			}
+		}
+	}
+	file.printf("})\n");
+}
+
+/**
+**  Set the enter cycle of a player in a bucket of a loaded game.
+**
+**  @param x       X position of the bucket.
+**  @param y       Y position of the bucket.
+**  @param player  Index of the player.
+**  @param cycle   Last cycle a unit of the player entered the bucket.
+*/
+void CUnitBucketGrid::SetEnterCycle(int x, int y, int player, unsigned long cycle)
+{
+	Assert(0 <= x && x < Width && 0 <= y && y < Height);
+	Assert(0 <= player && player < PlayerMax);
+	Buckets[x + y * Width].EnterCycle[player] = cycle;
+}
+
+/**
+**  Get the enter cycles of all the buckets.
+**
+**  @param cycles  Filled with the cycles of each bucket and player.
+*/
+void CUnitBucketGrid::GetEnterCycles(std::vector<unsigned long> &cycles) const
+{
+	cycles.resize(Buckets.size() * PlayerMax);
+	for (size_t i = 0; i != Buckets.size(); ++i) {
+		std::copy(Buckets[i].EnterCycle, Buckets[i].EnterCycle + PlayerMax, cycles.begin() + i * PlayerMax);
+	}
+}
+
+/**
+**  Set the enter cycles of all the buckets.
+**
+**  Placing the units of a loaded game sets the enter cycles to the
+**  current game cycle: LoadGame restores the loaded ones after.
+**
+**  @param cycles  Cycles got by GetEnterCycles.
+*/
+void CUnitBucketGrid::SetEnterCycles(const std::vector<unsigned long> &cycles)
+{
+	Assert(cycles.size() == Buckets.size() * PlayerMax);
+	for (size_t i = 0; i != Buckets.size(); ++i) {
+		std::copy(cycles.begin() + i * PlayerMax, cycles.begin() + (i + 1) * PlayerMax, Buckets[i].EnterCycle);
+	}
+}
+
 void CMap::Clamp(Vec2i &pos) const
 {
 	clamp<short int>(&pos.x, 0, this->Info.MapWidth - 1);
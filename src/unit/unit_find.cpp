@@ -33,6 +33,7 @@
 --  Includes
 ----------------------------------------------------------------------------*/
 
+#include <algorithm>
 #include <limits.h>
 
 #include "stratagus.h"
@@ -407,6 +408,154 @@ VisitResult ResourceUnitFinder::Visit(TerrainTraversal &terrainTraversal, const
 	}
 }
 
+/**
+**  Check if the tiles around a unit (or a unit rectangle) touch a component.
+**
+**  @param pos         Top left corner of the rectangle.
+**  @param size        Size of the rectangle.
+**  @param movemask    Movement mask of the worker.
+**  @param components  Components to look for, or to fill.
+**  @param collect     Add the components around the rectangle to components.
+**
+**  @return            true if a tile around the rectangle is in components.
+*/
+static bool RingTouchesComponents(const Vec2i &pos, const Vec2i &size, int movemask,
+								  std::vector<int> &components, bool collect)
+{
+	const Vec2i minPos(std::max(0, pos.x - 1), std::max(0, pos.y - 1));
+	const Vec2i maxPos(std::min(Map.Info.MapWidth - 1, pos.x + size.x),
+					   std::min(Map.Info.MapHeight - 1, pos.y + size.y));
+	Vec2i it;
+
+	for (it.y = minPos.y; it.y <= maxPos.y; ++it.y) {
+		for (it.x = minPos.x; it.x <= maxPos.x; ++it.x) {
+			const int component = GetTileComponent(movemask, it);
+
+			if (component == -1) {
+				continue;
+			}
+			const bool found = std::find(components.begin(), components.end(), component) != components.end();
+			if (collect) {
+				if (!found) {
+					components.push_back(component);
+				}
+			} else if (found) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/**
+**  Connected components next to the resources of one type, for one
+**  movement mask.
+**
+**  Built by going through all the units, and kept until the next game
+**  cycle or the next change of the passability of the map, which also
+**  happens when a resource building is placed or removed.
+*/
+struct ResourceComponents {
+	ResourceComponents() : MovementMask(0), Resource(0), Cycle(0), Generation(0), Valid(false) {}
+
+	int MovementMask;              /// Movement mask of the workers
+	int Resource;                  /// Resource of the mines
+	unsigned long Cycle;           /// Game cycle of the table
+	unsigned long Generation;      /// PathfinderMapGeneration of the table
+	bool Valid;                    /// The table was built
+	std::vector<int> Components;   /// Components touching a mine
+};
+
+/// Tables of the last requests
+static std::vector<ResourceComponents> ResourceComponentsCache;
+
+/**
+**  Get the connected components touching a mine of a resource.
+*/
+static const std::vector<int> &GetResourceComponents(int movemask, int resource)
+{
+	ResourceComponents *table = NULL;
+
+	for (size_t i = 0; i != ResourceComponentsCache.size(); ++i) {
+		if (ResourceComponentsCache[i].MovementMask == movemask
+			&& ResourceComponentsCache[i].Resource == resource) {
+			table = &ResourceComponentsCache[i];
+			break;
+		}
+	}
+	if (table == NULL) {
+		ResourceComponentsCache.push_back(ResourceComponents());
+		table = &ResourceComponentsCache.back();
+		table->MovementMask = movemask;
+		table->Resource = resource;
+	}
+	if (table->Valid && table->Cycle == GameCycle && table->Generation == PathfinderMapGeneration) {
+		return table->Components;
+	}
+	CResourceFinder res_finder(resource, 1);
+
+	table->Components.clear();
+	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
+		const CUnit &mine = **it;
+
+		if (mine.Removed || !res_finder(&mine)) {
+			continue;
+		}
+		const Vec2i mineSize(mine.Type->TileWidth, mine.Type->TileHeight);
+		RingTouchesComponents(mine.tilePos, mineSize, movemask, table->Components, true);
+	}
+	table->Generation = PathfinderMapGeneration;
+	table->Cycle = GameCycle;
+	table->Valid = true;
+	return table->Components;
+}
+
+/**
+**  Check if a resource may be reachable from startUnit.
+**
+**  Uses the connected components of the map, so a worker on an island
+**  without mine doesn't flood the whole island looking for one.
+**  Only static obstacles are considered: false means no resource can be
+**  found by UnitFindResource, true means one may be found.
+*/
+static bool ResourceMayBeReachable(const CUnit &unit, const CUnit &start, int resource)
+{
+	const CUnit &startUnit = *GetFirstContainer(start);
+	const int movemask = unit.Type->MovementMask;
+	const Vec2i startSize(startUnit.Type->TileWidth, startUnit.Type->TileHeight);
+	const Vec2i minPos(std::max(0, startUnit.tilePos.x - 1), std::max(0, startUnit.tilePos.y - 1));
+	const Vec2i maxPos(std::min(Map.Info.MapWidth - 1, startUnit.tilePos.x + startSize.x),
+					   std::min(Map.Info.MapHeight - 1, startUnit.tilePos.y + startSize.y));
+	CResourceFinder res_finder(resource, 1);
+	Vec2i it;
+
+	// Mine next to the start unit: seen without moving.
+	for (it.y = minPos.y; it.y <= maxPos.y; ++it.y) {
+		for (it.x = minPos.x; it.x <= maxPos.x; ++it.x) {
+			const CUnitCache &cache = Map.Field(it)->UnitCache;
+
+			for (CUnitCache::const_iterator u = cache.begin(); u != cache.end(); ++u) {
+				if (!(*u)->Removed && res_finder(*u)) {
+					return true;
+				}
+			}
+		}
+	}
+	std::vector<int> components;
+
+	RingTouchesComponents(startUnit.tilePos, startSize, movemask, components, true);
+	if (components.empty()) {
+		return false;
+	}
+	const std::vector<int> &mineComponents = GetResourceComponents(movemask, resource);
+	for (size_t i = 0; i != components.size(); ++i) {
+		if (std::find(mineComponents.begin(), mineComponents.end(), components[i]) != mineComponents.end()) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
 **  Find Resource.
 **
@@ -423,6 +572,9 @@ VisitResult ResourceUnitFinder::Visit(TerrainTraversal &terrainTraversal, const
 CUnit *UnitFindResource(const CUnit &unit, const CUnit &startUnit, int range, int resource,
 						bool check_usage, const CUnit *deposit)
 {
+	if (!ResourceMayBeReachable(unit, startUnit, resource)) {
+		return NULL;
+	}
 	if (!deposit) { // Find the nearest depot
 		deposit = FindDepositNearLoc(*unit.Player, startUnit.tilePos, range, resource);
 	}
@@ -1058,13 +1210,21 @@ CUnit *AttackUnitsInDistance(const CUnit &unit, int range, bool onlyBuildings)
 		return NULL;
 	} else {
 		std::vector<CUnit *> table;
+		// Only enemies can be chosen, skip the buckets without any.
+		unsigned int enemies = 0;
+
+		for (int i = 0; i != PlayerMax; ++i) {
+			if (unit.Player->IsEnemy(i)) {
+				enemies |= 1 << i;
+			}
+		}
 
 		if (onlyBuildings) {
-			SelectAroundUnit(unit, range, table,
-							 MakeAndPredicate(HasNotSamePlayerAs(Players[PlayerNumNeutral]), IsBuildingType()));
+			SelectAroundUnitOfPlayers(unit, range, enemies, table,
+									  MakeAndPredicate(HasNotSamePlayerAs(Players[PlayerNumNeutral]), IsBuildingType()));
 		} else {
-			SelectAroundUnit(unit, range, table,
-							 MakeNotPredicate(HasSamePlayerAs(Players[PlayerNumNeutral])));
+			SelectAroundUnitOfPlayers(unit, range, enemies, table,
+									  MakeNotPredicate(HasSamePlayerAs(Players[PlayerNumNeutral])));
 		}
 
 		const int n = static_cast<int>(table.size());
@@ -1104,4 +1264,74 @@ CUnit *AttackUnitsInReactRange(const CUnit &unit)
 	return AttackUnitsInDistance(unit, range);
 }
 
+/**
+**  Number of cycles between two target scans of a waiting unit.
+*/
+static const unsigned int TargetScanPeriod = 8;
+
+/**
+**  Check if an enemy unit entered the reaction range of a unit since
+**  its last target scan.
+**
+**  @param unit   Unit which looks for a target.
+**  @param range  Reaction range of the unit.
+**
+**  @return       true if an enemy entered a bucket covering the range.
+*/
+static bool EnemyEnteredReactRange(const CUnit &unit, int range)
+{
+	unsigned int enemies = 0;
+
+	for (int i = 0; i != PlayerMax; ++i) {
+		if (unit.Player->IsEnemy(i)) {
+			enemies |= 1 << i;
+		}
+	}
+	Vec2i minPos = unit.tilePos - Vec2i(range, range);
+	Vec2i maxPos = unit.tilePos + Vec2i(unit.Type->TileWidth - 1 + range, unit.Type->TileHeight - 1 + range);
+	const int shift = CUnitBucketGrid::BucketShift;
+
+	Map.FixSelectionArea(minPos, maxPos);
+	for (int by = minPos.y >> shift; by <= maxPos.y >> shift; ++by) {
+		for (int bx = minPos.x >> shift; bx <= maxPos.x >> shift; ++bx) {
+			const CUnitBucketGrid::CBucket &bucket = Map.UnitBuckets.GetBucket(bx, by);
+
+			if ((bucket.PlayerMask & enemies) == 0) {
+				continue;
+			}
+			for (int i = 0; i != PlayerMax; ++i) {
+				if ((bucket.PlayerMask & enemies & (1 << i)) && bucket.EnterCycle[i] >= unit.TargetScanCycle) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+/**
+**  Attack units in reaction range, for units waiting for a target.
+**
+**  The scans are staggered over the cycles by unit slot: a unit scans
+**  once every TargetScanPeriod cycles, when it just started to wait, or
+**  earlier when an enemy entered the buckets covering its reaction range.
+**
+**  @param unit  Find unit in reaction range for this unit.
+**
+**  @return      Pointer to unit which should be attacked.
+*/
+CUnit *AcquireTargetInReactRange(CUnit &unit)
+{
+	Assert(unit.Type->CanAttack);
+	const int range = unit.Player->Type == PlayerPerson ? unit.Type->ReactRangePerson : unit.Type->ReactRangeComputer;
+	const bool due = (GameCycle + UnitNumber(unit)) % TargetScanPeriod == 0
+					 || unit.TargetScanCycle + TargetScanPeriod < GameCycle;
+
+	if (!due && !EnemyEnteredReactRange(unit, range)) {
+		return NULL;
+	}
+	unit.TargetScanCycle = GameCycle;
+	return AttackUnitsInDistance(unit, range);
+}
+
 //@}
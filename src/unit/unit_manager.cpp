@@ -38,7 +38,9 @@
 #include "unit_manager.h"
 #include "unit.h"
 #include "iolib.h"
+#include "map.h"
 #include "script.h"
+#include "snapshot.h"
 
 
 /*----------------------------------------------------------------------------
@@ -63,17 +65,41 @@ void CUnitManager::Init()
 	lastCreated = NULL;
 	//Assert(units.empty());
 	units.clear();
-	// Release memory of units in release list.
-	while (!releasedUnits.empty()) {
-		CUnit *unit = releasedUnits.front();
-		releasedUnits.pop_front();
-		delete unit;
+	releasedUnits.clear();
+
+	// Release memory of all units, slab by slab.
+	for (size_t i = 0; i != unitSlabs.size(); ++i) {
+		delete[] unitSlabs[i];
 	}
+	unitSlabs.clear();
 
 	// Initialize the free unit slots
 	unitSlots.clear();
 }
 
+/**
+**  Get the unit of the next free slot.
+**
+**  Units are allocated in slabs of contiguous units, the unit of slot n
+**  is unit n % UnitSlabSize of slab n / UnitSlabSize, so units which are
+**  updated together are near in memory.
+**
+**  @return  Unit for slot unitSlots.size(), not yet in unitSlots.
+*/
+CUnit *CUnitManager::NewSlotUnit()
+{
+	const unsigned int slot = unitSlots.size();
+
+	if (slot % UnitSlabSize == 0) {
+		unitSlabs.push_back(new CUnit[UnitSlabSize]);
+	}
+	CUnit *unit = &unitSlabs[slot / UnitSlabSize][slot % UnitSlabSize];
+
+	unit->UnitManagerData.slot = slot;
+	unitSlots.push_back(unit);
+	return unit;
+}
+
 /**
 **  Allocate a new unit
 **
@@ -91,11 +117,7 @@ CUnit *CUnitManager::AllocUnit()
 		unit->UnitManagerData.unitSlot = -1;
 		return unit;
 	} else {
-		CUnit *unit = new CUnit;
-
-		unit->UnitManagerData.slot = unitSlots.size();
-		unitSlots.push_back(unit);
-		return unit;
+		return NewSlotUnit();
 	}
 }
 
@@ -181,6 +203,7 @@ void CUnitManager::Save(CFile &file) const
 		const CUnit &unit = **it;
 		SaveUnit(unit, file);
 	}
+	Map.UnitBuckets.Save(file);
 }
 
 void CUnitManager::Load(lua_State *l)
@@ -191,10 +214,8 @@ void CUnitManager::Load(lua_State *l)
 		return;
 	}
 	unsigned int unitCount = LuaToNumber(l, 1);
-	for (unsigned int i = 0; i < unitCount; i++) {
-		CUnit *unit = new CUnit;
-		unitSlots.push_back(unit);
-		unit->UnitManagerData.slot = i;
+	for (unsigned long i = 0; i < unitCount; i++) {
+		NewSlotUnit();
 	}
 	for (unsigned int i = 2; i <= args; i++) {
 		int unit_index = -1;
@@ -218,4 +239,72 @@ void CUnitManager::Load(lua_State *l)
 }
 
 
+/**
+**  Save state of unit manager to a snapshot.
+**
+**  @param snapshot  Output snapshot.
+*/
+void CUnitManager::Save(CSnapshotWriter &snapshot) const
+{
+	snapshot.Varint(unitSlots.size());
+	snapshot.Varint(releasedUnits.size());
+	for (std::list<CUnit *>::const_iterator it = releasedUnits.begin(); it != releasedUnits.end(); ++it) {
+		const CUnit &unit = **it;
+		snapshot.Varint(UnitNumber(unit));
+		snapshot.Varint(unit.ReleaseCycle);
+	}
+
+	snapshot.Varint(units.size());
+	for (std::vector<CUnit *>::const_iterator it = units.begin(); it != units.end(); ++it) {
+		const CUnit &unit = **it;
+		SaveUnit(unit, snapshot);
+	}
+}
+
+/**
+**  Load state of unit manager and the units from a snapshot.
+**
+**  Each slot is saved as a released or a used unit, of one byte at
+**  least: a count of slots above the size of the section is corrupted.
+**
+**  @param snapshot  Input snapshot.
+*/
+void CUnitManager::Load(CSnapshotReader &snapshot)
+{
+	Init();
+	const unsigned long unitCount = snapshot.Varint();
+	if (unitCount > snapshot.Remaining()) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	for (unsigned long i = 0; i < unitCount; i++) {
+		NewSlotUnit();
+	}
+	const unsigned long releasedCount = snapshot.Varint();
+	if (releasedCount > unitCount) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	for (unsigned long i = 0; i != releasedCount && !snapshot.IsCorrupted(); ++i) {
+		const unsigned int unit_index = snapshot.Varint();
+		const unsigned int cycle = snapshot.Varint();
+
+		if (unit_index >= unitCount) {
+			snapshot.SetCorrupted();
+			return;
+		}
+		ReleaseUnit(unitSlots[unit_index]);
+		unitSlots[unit_index]->ReleaseCycle = cycle;
+	}
+	const unsigned long count = snapshot.Varint();
+	if (releasedCount + count > unitCount) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	for (unsigned long i = 0; i != count && !snapshot.IsCorrupted(); ++i) {
+		LoadUnit(snapshot);
+	}
+}
+
+
 //@}
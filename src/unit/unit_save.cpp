@@ -44,9 +44,12 @@
 #include "animation.h"
 #include "construct.h"
 #include "iolib.h"
+#include "map.h"
 #include "pathfinder.h"
 #include "player.h"
+#include "snapshot.h"
 #include "spells.h"
+#include "unit_manager.h"
 #include "unittype.h"
 
 #include <stdio.h>
@@ -115,6 +118,47 @@ void PathFinderOutput::Save(CFile &file) const
 }
 
 
+void PathFinderInput::Save(CSnapshotWriter &snapshot) const
+{
+	snapshot.Bool(this->isRecalculatePathNeeded);
+	snapshot.Pos(this->unitSize);
+	snapshot.Pos(this->goalPos);
+	snapshot.Pos(this->goalSize);
+	snapshot.Int(this->minRange);
+	snapshot.Int(this->maxRange);
+}
+
+void PathFinderInput::Load(CSnapshotReader &snapshot)
+{
+	this->isRecalculatePathNeeded = snapshot.Bool();
+	this->unitSize = snapshot.Pos();
+	this->goalPos = snapshot.Pos();
+	this->goalSize = snapshot.Pos();
+	this->minRange = snapshot.Int();
+	this->maxRange = snapshot.Int();
+}
+
+void PathFinderOutput::Save(CSnapshotWriter &snapshot) const
+{
+	snapshot.Varint(this->Cycles);
+	snapshot.Bool(this->Fast != 0);
+	snapshot.Varint(this->Length > 0 ? this->Length : 0);
+	snapshot.Bytes(this->Path, this->Length > 0 ? this->Length : 0);
+}
+
+void PathFinderOutput::Load(CSnapshotReader &snapshot)
+{
+	this->Cycles = snapshot.Varint();
+	this->Fast = snapshot.Bool();
+	const unsigned int length = snapshot.Varint();
+	if (length > MAX_PATH_LENGTH) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	this->Length = length;
+	snapshot.Bytes(this->Path, length);
+}
+
 /**
 **  Save the state of a unit to file.
 **
@@ -214,6 +258,7 @@ void SaveUnit(const CUnit &unit, CFile &file)
 		file.printf(" \"active\",");
 	}
 	file.printf("\"ttl\", %lu,\n  ", unit.TTL);
+	file.printf("\"target-scan-cycle\", %lu,\n  ", unit.TargetScanCycle);
 	file.printf("\"threshold\", %d,\n  ", unit.Threshold);
 
 	for (size_t i = 0; i < UnitTypeVar.GetNumberVariable(); ++i) {
@@ -327,4 +372,309 @@ void SaveUnit(const CUnit &unit, CFile &file)
 	file.printf("})\n");
 }
 
+/**
+**  Save the state of a unit to a snapshot.
+**
+**  The fields follow the Lua save, LoadUnit sets them in the same order
+**  as CclUnit does.
+**
+**  @param unit      Unit to be saved.
+**  @param snapshot  Output snapshot.
+*/
+void SaveUnit(const CUnit &unit, CSnapshotWriter &snapshot)
+{
+	snapshot.Varint(UnitNumber(unit));
+	snapshot.String(unit.Type->Ident);
+	snapshot.String(unit.Seen.Type ? unit.Seen.Type->Ident : "");
+	snapshot.Varint(unit.Player->Index);
+
+	snapshot.Pos(unit.tilePos);
+	snapshot.Pos(unit.Seen.tilePos);
+	snapshot.Varint(unit.Refs);
+	snapshot.Int(unit.IX);
+	snapshot.Int(unit.IY);
+	snapshot.Int(unit.Seen.IX);
+	snapshot.Int(unit.Seen.IY);
+	snapshot.Int(unit.Frame);
+	snapshot.Int(unit.Seen.Frame);
+	snapshot.Varint(unit.Direction);
+	snapshot.Varint(unit.DamagedType);
+	snapshot.Varint(unit.Attacked);
+	snapshot.Int(unit.CurrentSightRange);
+	snapshot.Bool(unit.Burning);
+	snapshot.Bool(unit.Destroyed);
+	snapshot.Bool(unit.Removed);
+	snapshot.Bool(unit.Selected);
+	snapshot.Bool(unit.Summoned);
+	snapshot.Int(unit.RescuedFrom ? unit.RescuedFrom->Index : -1);
+	// See the Lua save: the container may be loaded after the unit.
+	snapshot.Bool(unit.Container && unit.Removed);
+	if (unit.Container && unit.Removed) {
+		snapshot.Pos(unit.Container->tilePos);
+		snapshot.Varint(unit.Container->Type->TileWidth);
+		snapshot.Varint(unit.Container->Type->TileHeight);
+	}
+	snapshot.Varint(unit.Seen.ByPlayer);
+	snapshot.Varint(unit.Seen.Destroyed);
+	snapshot.Bool(unit.Constructed);
+	snapshot.Bool(unit.Seen.Constructed);
+	snapshot.Varint(unit.Seen.State);
+	snapshot.Bool(unit.Active);
+	snapshot.Varint(unit.TTL);
+	snapshot.Varint(unit.TargetScanCycle);
+	snapshot.Int(unit.Threshold);
+
+	const size_t variableCount = UnitTypeVar.GetNumberVariable();
+	size_t changedCount = 0;
+	for (size_t i = 0; i < variableCount; ++i) {
+		if (unit.Variable[i] != unit.Type->DefaultStat.Variables[i]) {
+			++changedCount;
+		}
+	}
+	snapshot.Varint(changedCount);
+	for (size_t i = 0; i < variableCount; ++i) {
+		if (unit.Variable[i] != unit.Type->DefaultStat.Variables[i]) {
+			snapshot.Varint(i);
+			snapshot.Int(unit.Variable[i].Value);
+			snapshot.Int(unit.Variable[i].Max);
+			snapshot.Int(unit.Variable[i].Increase);
+			snapshot.Bool(unit.Variable[i].Enable != 0);
+		}
+	}
+
+	snapshot.Int(unit.GroupId);
+	snapshot.Int(unit.LastGroup);
+	snapshot.Int(unit.ResourcesHeld);
+	snapshot.Varint(unit.CurrentResource);
+
+	unit.pathFinderData->input.Save(snapshot);
+	unit.pathFinderData->output.Save(snapshot);
+
+	snapshot.Varint(unit.Wait);
+	CAnimations::SaveUnitAnim(snapshot, unit);
+	snapshot.Varint(unit.Blink);
+	snapshot.Bool(unit.Moving);
+	snapshot.Bool(unit.ReCast);
+	snapshot.Bool(unit.Boarded);
+	snapshot.Bool(unit.AutoRepair);
+
+	snapshot.Unit(unit.NextWorker);
+	snapshot.Unit(unit.Resource.Workers);
+	snapshot.Int(unit.Resource.Active);
+	snapshot.Int(unit.Resource.Assigned);
+	snapshot.Int(unit.BoardCount);
+
+	snapshot.Varint(unit.UnitInside ? unit.InsideCount : 0);
+	if (unit.UnitInside) {
+		CUnit *uins = unit.UnitInside->PrevContained;
+		for (int i = unit.InsideCount; i; --i, uins = uins->PrevContained) {
+			snapshot.Unit(uins);
+		}
+	}
+	Assert(unit.Orders.empty() == false);
+	snapshot.Varint(unit.Orders.size());
+	for (size_t i = 0; i != unit.Orders.size(); ++i) {
+		SaveOrder(unit.Orders[i], unit, snapshot);
+	}
+	SaveOrder(unit.SavedOrder, unit, snapshot);
+	SaveOrder(unit.CriticalOrder, unit, snapshot);
+	SaveOrder(unit.NewOrder, unit, snapshot);
+
+	snapshot.Unit(unit.Goal);
+	size_t autoCastCount = 0;
+	for (size_t i = 0; unit.AutoCastSpell && i < SpellTypeTable.size(); ++i) {
+		if (unit.AutoCastSpell[i]) {
+			++autoCastCount;
+		}
+	}
+	snapshot.Varint(autoCastCount);
+	for (size_t i = 0; unit.AutoCastSpell && i < SpellTypeTable.size(); ++i) {
+		if (unit.AutoCastSpell[i]) {
+			snapshot.String(SpellTypeTable[i]->Ident);
+		}
+	}
+	snapshot.Varint(unit.SpellCoolDownTimers ? SpellTypeTable.size() : 0);
+	for (size_t i = 0; unit.SpellCoolDownTimers && i < SpellTypeTable.size(); ++i) {
+		snapshot.Int(unit.SpellCoolDownTimers[i]);
+	}
+}
+
+/**
+**  Load a unit from a snapshot, the counterpart of SaveUnit.
+**
+**  @param snapshot  Input snapshot.
+*/
+void LoadUnit(CSnapshotReader &snapshot)
+{
+	const unsigned int slot = snapshot.Varint();
+	CUnitType *type = UnitTypeByIdent(snapshot.String());
+	const std::string seenIdent = snapshot.String();
+	CUnitType *seentype = seenIdent.empty() ? NULL : UnitTypeByIdent(seenIdent);
+	const unsigned int playerIndex = snapshot.Varint();
+
+	if (type == NULL || playerIndex >= PlayerMax || slot >= UnitManager.GetUsedSlotCount()) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	CPlayer &player = Players[playerIndex];
+	CUnit &unit = UnitManager.GetSlotUnit(slot);
+
+	// As CclUnit: the unit is assigned to the player once its orders are known.
+	unit.Init(*type);
+	unit.Seen.Type = seentype;
+	unit.Active = 0;
+	unit.Removed = 0;
+
+	unit.tilePos = snapshot.Pos();
+	unit.Offset = Map.getIndex(unit.tilePos);
+	unit.Seen.tilePos = snapshot.Pos();
+	unit.Refs = snapshot.Varint();
+	unit.Stats = &type->Stats[player.Index];
+	unit.IX = snapshot.Int();
+	unit.IY = snapshot.Int();
+	unit.Seen.IX = snapshot.Int();
+	unit.Seen.IY = snapshot.Int();
+	unit.Frame = snapshot.Int();
+	unit.Seen.Frame = snapshot.Int();
+	unit.Direction = snapshot.Varint();
+	unit.DamagedType = snapshot.Varint();
+	unit.Attacked = snapshot.Varint();
+	unit.CurrentSightRange = snapshot.Int();
+	unit.Burning = snapshot.Bool();
+	unit.Destroyed = snapshot.Bool();
+	unit.Removed = snapshot.Bool();
+	unit.Selected = snapshot.Bool();
+	unit.Summoned = snapshot.Bool();
+	const int rescuedFrom = snapshot.Int();
+	if (rescuedFrom >= PlayerMax) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	unit.RescuedFrom = rescuedFrom >= 0 ? &Players[rescuedFrom] : NULL;
+	if (snapshot.Bool()) {
+		const Vec2i pos = snapshot.Pos();
+		const int w = snapshot.Varint();
+		const int h = snapshot.Varint();
+
+		MapSight(player, pos, w, h, unit.CurrentSightRange, MapMarkTileSight);
+		// Detectcloak works in container
+		if (unit.Type->DetectCloak) {
+			MapSight(player, pos, w, h, unit.CurrentSightRange, MapMarkTileDetectCloak);
+		}
+	}
+	unit.Seen.ByPlayer = snapshot.Varint();
+	unit.Seen.Destroyed = snapshot.Varint();
+	unit.Constructed = snapshot.Bool();
+	unit.Seen.Constructed = snapshot.Bool();
+	unit.Seen.State = snapshot.Varint();
+	unit.Active = snapshot.Bool();
+	unit.TTL = snapshot.Varint();
+	unit.TargetScanCycle = snapshot.Varint();
+	unit.Threshold = snapshot.Int();
+
+	const size_t variableCount = UnitTypeVar.GetNumberVariable();
+	for (size_t changedCount = snapshot.Varint(); changedCount; --changedCount) {
+		const size_t index = snapshot.Varint();
+		if (index >= variableCount) {
+			snapshot.SetCorrupted();
+			return;
+		}
+		unit.Variable[index].Value = snapshot.Int();
+		unit.Variable[index].Max = snapshot.Int();
+		unit.Variable[index].Increase = snapshot.Int();
+		unit.Variable[index].Enable = snapshot.Bool();
+	}
+
+	unit.GroupId = snapshot.Int();
+	unit.LastGroup = snapshot.Int();
+	unit.ResourcesHeld = snapshot.Int();
+	unit.CurrentResource = snapshot.Varint();
+
+	unit.pathFinderData->input.Load(snapshot);
+	unit.pathFinderData->output.Load(snapshot);
+
+	unit.Wait = snapshot.Varint();
+	CAnimations::LoadUnitAnim(snapshot, unit);
+	unit.Blink = snapshot.Varint();
+	unit.Moving = snapshot.Bool();
+	unit.ReCast = snapshot.Bool();
+	unit.Boarded = snapshot.Bool();
+	unit.AutoRepair = snapshot.Bool();
+
+	unit.NextWorker = snapshot.Unit();
+	unit.Resource.Workers = snapshot.Unit();
+	unit.Resource.Active = snapshot.Int();
+	unit.Resource.Assigned = snapshot.Int();
+	unit.BoardCount = snapshot.Int();
+
+	for (unsigned int insideCount = snapshot.Varint(); insideCount; --insideCount) {
+		CUnit *u = snapshot.Unit();
+		if (u == NULL) {
+			snapshot.SetCorrupted();
+			return;
+		}
+		u->AddInContainer(unit);
+	}
+
+	for (std::vector<COrderPtr>::iterator order = unit.Orders.begin();
+		 order != unit.Orders.end();
+		 ++order) {
+		delete *order;
+	}
+	unit.Orders.clear();
+	for (unsigned int orderCount = snapshot.Varint(); orderCount; --orderCount) {
+		COrder *order = LoadOrder(snapshot, unit);
+		if (order == NULL || snapshot.IsCorrupted()) {
+			snapshot.SetCorrupted();
+			return;
+		}
+		unit.Orders.push_back(order);
+	}
+	if (unit.Orders.empty()) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	// now we know unit's action so we can assign it to a player
+	unit.AssignToPlayer(player);
+	if (unit.CurrentAction() == UnitActionBuilt) {
+		// HACK: the building is not ready yet
+		unit.Player->UnitTypesCount[type->Slot]--;
+	}
+	unit.SavedOrder = LoadOrder(snapshot, unit);
+	unit.CriticalOrder = LoadOrder(snapshot, unit);
+	unit.NewOrder = LoadOrder(snapshot, unit);
+
+	unit.Goal = snapshot.Unit();
+	for (unsigned int autoCastCount = snapshot.Varint(); autoCastCount; --autoCastCount) {
+		const SpellType *spell = SpellTypeByIdent(snapshot.String());
+		if (spell == NULL) {
+			snapshot.SetCorrupted();
+			return;
+		}
+		if (!unit.AutoCastSpell) {
+			unit.AutoCastSpell = new char[SpellTypeTable.size()];
+			memset(unit.AutoCastSpell, 0, SpellTypeTable.size());
+		}
+		unit.AutoCastSpell[spell->Slot] = 1;
+	}
+	const size_t coolDownCount = snapshot.Varint();
+	if (coolDownCount != 0 && (coolDownCount != SpellTypeTable.size() || !unit.SpellCoolDownTimers)) {
+		snapshot.SetCorrupted();
+		return;
+	}
+	for (size_t i = 0; i != coolDownCount; ++i) {
+		unit.SpellCoolDownTimers[i] = snapshot.Int();
+	}
+
+	//  Revealers are units that can see while removed
+	if (unit.Removed && unit.Type->Revealer) {
+		MapMarkUnitSight(unit);
+	}
+
+	// Fix Colors for rescued units.
+	if (unit.RescuedFrom) {
+		unit.Colors = &unit.RescuedFrom->UnitColors;
+	}
+}
+
 //@}